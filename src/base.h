@@ -18,6 +18,8 @@
 #include <cassert>
 #include <cstddef>
 #include <iostream>
+#include <sstream>
+#include <string>
 #include <utility>
 
 namespace codec_compare_gen {
@@ -49,6 +51,30 @@ enum class Subsampling {
   k420       // Chroma subsampling 4:2:0 (halved in both dimensions).
 };
 
+// Highest x86 instruction set extension the codec libraries are allowed to
+// select at runtime. See simd.h.
+enum class SimdLevel {
+  kNative,  // Whatever the libraries detect on the current CPU.
+  kNone,    // Plain C code paths only.
+  kSse2,
+  kSse4,
+  kAvx2  // Excludes AVX-512.
+};
+
+// State of the CPU caches when the decoding duration is measured.
+enum class DecodeTiming {
+  kWarm,   // Right after encoding on the same thread, as is.
+  kCold,   // After evicting the CPU caches with unrelated memory accesses.
+  kSteady  // Average of repeated decodings of the same bitstream, warmed up.
+};
+
+// What must be identical for two input image files to be duplicates.
+enum class DedupMode {
+  kNone,   // Each file is evaluated, even if identical to another one.
+  kBytes,  // Same file contents.
+  kPixels  // Same decoded dimensions, durations and samples.
+};
+
 enum class DistortionMetric {
   kLibwebp2Psnr,
   kLibwebp2Ssim,
@@ -110,17 +136,22 @@ struct StatusOr {
   auto CONCAT(s,__LINE__)=(B);OK_OR_RETURN(CONCAT(s,__LINE__).status);A=std::move(CONCAT(s,__LINE__).value)
 // clang-format on
 
+// Message of the last error logged by LogError on the calling thread, even if
+// quiet. Lets the caller of a failed function record why it failed.
+inline std::string& LastErrorMessage() {
+  thread_local std::string message;
+  return message;
+}
+
 struct LogError {
-  explicit LogError(bool quiet) : quiet(quiet) {
-    // TODO(yguyon): Return an std::string error message instead of cerr now?
-    if (!quiet) std::cerr << "Error: ";
-  }
+  explicit LogError(bool quiet) : quiet(quiet) {}
   ~LogError() {
-    if (!quiet) std::cerr << std::endl;
+    LastErrorMessage() = stream.str();
+    if (!quiet) std::cerr << "Error: " << LastErrorMessage() << std::endl;
   }
   template <typename T>
   LogError& operator<<(const T& message) {
-    if (!quiet) std::cerr << message;
+    stream << message;
     return *this;
   }
   operator Status() const { return Status::kUnknownError; }
@@ -129,6 +160,7 @@ struct LogError {
     return Status::kUnknownError;
   }
   const bool quiet;
+  std::ostringstream stream;
 };
 
 // Can be used as follows:
@@ -0,0 +1,417 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/bitstream.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace codec_compare_gen {
+
+namespace {
+
+enum class Category { kHeader, kMetadata, kAlpha, kPayload };
+
+void Add(Category category, size_t size, BitstreamBreakdown& breakdown) {
+  (category == Category::kHeader     ? breakdown.header_size
+   : category == Category::kMetadata ? breakdown.metadata_size
+   : category == Category::kAlpha    ? breakdown.alpha_size
+                                     : breakdown.payload_size) += size;
+}
+
+bool Equals(const uint8_t* tag, const char* expected) {
+  return std::memcmp(tag, expected, std::strlen(expected)) == 0;
+}
+
+uint64_t ReadBigEndian(const uint8_t* bytes, size_t num_bytes) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < num_bytes; ++i) value = (value << 8) | bytes[i];
+  return value;
+}
+
+uint32_t ReadLittleEndian32(const uint8_t* bytes) {
+  return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) |
+         (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+// Bounds-checked big-endian reader. Reads past the end return 0 and clear ok.
+struct Reader {
+  uint64_t Read(size_t num_bytes) {
+    if (num_bytes > end - pos) {
+      ok = false;
+      pos = end;
+      return 0;
+    }
+    pos += num_bytes;
+    return ReadBigEndian(bytes + pos - num_bytes, num_bytes);
+  }
+
+  const uint8_t* bytes;
+  size_t pos;
+  size_t end;
+  bool ok = true;
+};
+
+//------------------------------------------------------------------------------
+// WebP
+
+// Attributes the RIFF chunks in [begin, end). Returns where parsing stopped.
+size_t ParseRiffChunks(const uint8_t* bytes, size_t begin, size_t end,
+                       BitstreamBreakdown& breakdown) {
+  size_t pos = begin;
+  while (end - pos >= 8) {
+    const uint8_t* tag = bytes + pos;
+    const size_t chunk_size = ReadLittleEndian32(bytes + pos + 4);
+    if (chunk_size > end - pos - 8) break;
+    const size_t content = pos + 8;
+    // Chunks are padded to an even size.
+    const size_t chunk_end =
+        std::min(end, content + chunk_size + chunk_size % 2);
+    const size_t content_size = chunk_end - content;
+    breakdown.header_size += 8;
+    if (Equals(tag, "VP8X") || Equals(tag, "ANIM")) {
+      breakdown.header_size += content_size;
+    } else if (Equals(tag, "ICCP") || Equals(tag, "EXIF") ||
+               Equals(tag, "XMP ")) {
+      breakdown.metadata_size += content_size;
+    } else if (Equals(tag, "ALPH")) {
+      breakdown.alpha_size += content_size;
+    } else if (Equals(tag, "VP8 ") || Equals(tag, "VP8L")) {
+      // Frame tag, start code and dimensions, or signature and dimensions.
+      const size_t header_size =
+          std::min<size_t>(content_size, Equals(tag, "VP8 ") ? 10 : 5);
+      breakdown.header_size += header_size;
+      breakdown.payload_size += content_size - header_size;
+    } else if (Equals(tag, "ANMF") && content_size >= 16) {
+      // Frame position, dimensions, duration and flags, then frame chunks.
+      breakdown.header_size += 16;
+      const size_t parsed_end =
+          ParseRiffChunks(bytes, content + 16, chunk_end, breakdown);
+      breakdown.payload_size += chunk_end - parsed_end;
+    } else {
+      breakdown.payload_size += content_size;
+    }
+    pos = chunk_end;
+  }
+  return pos;
+}
+
+void ParseWebp(const uint8_t* bytes, size_t size,
+               BitstreamBreakdown& breakdown) {
+  breakdown.header_size += 12;  // "RIFF", file size, "WEBP".
+  const size_t parsed_end = ParseRiffChunks(bytes, 12, size, breakdown);
+  breakdown.payload_size += size - parsed_end;
+}
+
+//------------------------------------------------------------------------------
+// ISOBMFF
+
+struct Box {
+  const uint8_t* type;  // Four characters.
+  size_t begin;
+  size_t content;  // After the size and type fields.
+  size_t end;
+};
+
+// Reads the box starting at pos. Returns false if it does not fit before end.
+bool ReadBox(const uint8_t* bytes, size_t pos, size_t end, Box& box) {
+  if (end - pos < 8) return false;
+  uint64_t box_size = ReadBigEndian(bytes + pos, 4);
+  box.type = bytes + pos + 4;
+  box.begin = pos;
+  box.content = pos + 8;
+  if (box_size == 1) {
+    if (end - pos < 16) return false;
+    box_size = ReadBigEndian(bytes + pos + 8, 8);
+    box.content = pos + 16;
+  } else if (box_size == 0) {
+    box_size = end - pos;  // Up to the end of the file.
+  }
+  if (box_size < box.content - pos || box_size > end - pos) return false;
+  box.end = pos + box_size;
+  return true;
+}
+
+struct ItemExtent {
+  uint32_t item_id;
+  uint64_t offset;  // From the beginning of the file.
+  uint64_t length;
+};
+
+// Items of an AVIF file that are not coded color samples.
+struct Items {
+  std::unordered_map<uint32_t, Category> categories;
+  std::vector<ItemExtent> extents;
+};
+
+void ParseIinf(const uint8_t* bytes, const Box& iinf, Items& items) {
+  Reader reader = {bytes, iinf.content, iinf.end};
+  const uint64_t version = reader.Read(1);
+  reader.Read(3);  // Flags.
+  reader.Read(version == 0 ? 2 : 4);  // Entry count.
+  Box infe;
+  for (size_t pos = reader.pos; ReadBox(bytes, pos, iinf.end, infe);
+       pos = infe.end) {
+    if (!Equals(infe.type, "infe")) continue;
+    Reader entry = {bytes, infe.content, infe.end};
+    const uint64_t infe_version = entry.Read(1);
+    entry.Read(3);  // Flags.
+    if (infe_version < 2) continue;
+    const uint32_t item_id =
+        static_cast<uint32_t>(entry.Read(infe_version == 2 ? 2 : 4));
+    entry.Read(2);  // Protection index.
+    const size_t item_type = entry.pos;
+    entry.Read(4);
+    if (!entry.ok) continue;
+    if (Equals(bytes + item_type, "Exif") ||
+        Equals(bytes + item_type, "mime")) {  // XMP.
+      items.categories[item_id] = Category::kMetadata;
+    }
+  }
+}
+
+void ParseIref(const uint8_t* bytes, const Box& iref, Items& items) {
+  Reader reader = {bytes, iref.content, iref.end};
+  const uint64_t version = reader.Read(1);
+  reader.Read(3);  // Flags.
+  Box reference;
+  for (size_t pos = reader.pos; ReadBox(bytes, pos, iref.end, reference);
+       pos = reference.end) {
+    // Auxiliary images are assumed to be alpha planes.
+    if (!Equals(reference.type, "auxl")) continue;
+    Reader from = {bytes, reference.content, reference.end};
+    const uint32_t item_id =
+        static_cast<uint32_t>(from.Read(version == 0 ? 2 : 4));
+    if (from.ok) items.categories.emplace(item_id, Category::kAlpha);
+  }
+}
+
+void ParseIloc(const uint8_t* bytes, const Box& iloc, Items& items) {
+  Reader reader = {bytes, iloc.content, iloc.end};
+  const uint64_t version = reader.Read(1);
+  reader.Read(3);  // Flags.
+  const uint64_t sizes = reader.Read(1);
+  const size_t offset_size = sizes >> 4, length_size = sizes & 15;
+  const uint64_t more_sizes = reader.Read(1);
+  const size_t base_offset_size = more_sizes >> 4;
+  const size_t index_size =
+      (version == 1 || version == 2) ? (more_sizes & 15) : 0;
+  const uint64_t item_count = reader.Read(version < 2 ? 2 : 4);
+  for (uint64_t i = 0; i < item_count && reader.ok; ++i) {
+    const uint32_t item_id =
+        static_cast<uint32_t>(reader.Read(version < 2 ? 2 : 4));
+    uint64_t construction_method = 0;  // File offsets.
+    if (version == 1 || version == 2) construction_method = reader.Read(2) & 15;
+    reader.Read(2);  // Data reference index.
+    const uint64_t base_offset = reader.Read(base_offset_size);
+    const uint64_t extent_count = reader.Read(2);
+    for (uint64_t e = 0; e < extent_count && reader.ok; ++e) {
+      reader.Read(index_size);
+      const uint64_t offset = reader.Read(offset_size);
+      const uint64_t length = reader.Read(length_size);
+      if (reader.ok && construction_method == 0) {
+        items.extents.push_back({item_id, base_offset + offset, length});
+      }
+    }
+  }
+}
+
+// Moves the ICC profiles from the header to the metadata.
+void ParseIprp(const uint8_t* bytes, const Box& iprp,
+               BitstreamBreakdown& breakdown) {
+  Box ipco, property;
+  for (size_t pos = iprp.content; ReadBox(bytes, pos, iprp.end, ipco);
+       pos = ipco.end) {
+    if (!Equals(ipco.type, "ipco")) continue;
+    for (size_t p = ipco.content; ReadBox(bytes, p, ipco.end, property);
+         p = property.end) {
+      if (Equals(property.type, "colr") &&
+          property.end - property.content >= 4 &&
+          (Equals(bytes + property.content, "prof") ||
+           Equals(bytes + property.content, "rICC"))) {
+        breakdown.header_size -= property.end - property.begin;
+        breakdown.metadata_size += property.end - property.begin;
+      }
+    }
+  }
+}
+
+void ParseMeta(const uint8_t* bytes, const Box& meta, Items& items,
+               BitstreamBreakdown& breakdown) {
+  breakdown.header_size += meta.end - meta.begin;
+  Box box;
+  // "meta" is a FullBox: version and flags come first.
+  for (size_t pos = meta.content + 4;
+       pos <= meta.end && ReadBox(bytes, pos, meta.end, box); pos = box.end) {
+    if (Equals(box.type, "iinf")) ParseIinf(bytes, box, items);
+    if (Equals(box.type, "iref")) ParseIref(bytes, box, items);
+    if (Equals(box.type, "iloc")) ParseIloc(bytes, box, items);
+    if (Equals(box.type, "iprp")) ParseIprp(bytes, box, breakdown);
+  }
+}
+
+void ParseAvif(const uint8_t* bytes, size_t size,
+               BitstreamBreakdown& breakdown) {
+  Items items;
+  std::vector<Box> mdats;
+  size_t pos = 0;
+  Box box;
+  for (; ReadBox(bytes, pos, size, box); pos = box.end) {
+    if (Equals(box.type, "meta")) {
+      ParseMeta(bytes, box, items, breakdown);
+    } else if (Equals(box.type, "mdat")) {
+      breakdown.header_size += box.content - box.begin;
+      mdats.push_back(box);
+    } else if (Equals(box.type, "mini")) {
+      // The fields of the MinimizedImageBox are bit-packed.
+      breakdown.header_size += box.content - box.begin;
+      breakdown.payload_size += box.end - box.content;
+    } else {
+      breakdown.header_size += box.end - box.begin;
+    }
+  }
+  breakdown.payload_size += size - pos;
+
+  for (const Box& mdat : mdats) {
+    size_t payload_size = mdat.end - mdat.content;
+    for (const ItemExtent& extent : items.extents) {
+      const auto it = items.categories.find(extent.item_id);
+      if (it == items.categories.end() || extent.offset >= mdat.end) continue;
+      const uint64_t extent_end =
+          extent.offset + std::min<uint64_t>(extent.length,
+                                             mdat.end - extent.offset);
+      const uint64_t extent_begin =
+          std::max<uint64_t>(extent.offset, mdat.content);
+      if (extent_end <= extent_begin) continue;
+      const size_t overlap = std::min<size_t>(
+          payload_size, static_cast<size_t>(extent_end - extent_begin));
+      Add(it->second, overlap, breakdown);
+      payload_size -= overlap;
+    }
+    breakdown.payload_size += payload_size;
+  }
+}
+
+//------------------------------------------------------------------------------
+// JPEG XL
+
+void ParseJpegXlContainer(const uint8_t* bytes, size_t size,
+                          BitstreamBreakdown& breakdown) {
+  size_t pos = 0;
+  Box box;
+  for (; ReadBox(bytes, pos, size, box); pos = box.end) {
+    const size_t content_size = box.end - box.content;
+    breakdown.header_size += box.content - box.begin;
+    if (Equals(box.type, "jxlc") || Equals(box.type, "jxlp")) {
+      // Codestream signature, or index of the partial codestream.
+      const size_t header_size =
+          std::min<size_t>(content_size, Equals(box.type, "jxlc") ? 2 : 4);
+      breakdown.header_size += header_size;
+      breakdown.payload_size += content_size - header_size;
+    } else if (Equals(box.type, "Exif") || Equals(box.type, "xml ") ||
+               Equals(box.type, "jumb") || Equals(box.type, "brob")) {
+      breakdown.metadata_size += content_size;
+    } else if (Equals(box.type, "JXL ") || Equals(box.type, "ftyp") ||
+               Equals(box.type, "jxll") || Equals(box.type, "jxli") ||
+               Equals(box.type, "jbrd")) {
+      breakdown.header_size += content_size;
+    } else {
+      breakdown.payload_size += content_size;
+    }
+  }
+  breakdown.payload_size += size - pos;
+}
+
+//------------------------------------------------------------------------------
+// JPEG
+
+Category JpegSegmentCategory(uint8_t marker) {
+  // JFIF and Adobe (color transform) application segments describe the image.
+  if (marker == 0xE0 || marker == 0xEE) return Category::kHeader;
+  // Exif, XMP, ICC profile, MPF etc. and comments.
+  if ((marker >= 0xE1 && marker <= 0xEF) || marker == 0xFE) {
+    return Category::kMetadata;
+  }
+  return Category::kHeader;  // Tables, frame and scan headers.
+}
+
+bool IsRestartMarker(uint8_t marker) {
+  return marker >= 0xD0 && marker <= 0xD7;
+}
+
+void ParseJpeg(const uint8_t* bytes, size_t size,
+               BitstreamBreakdown& breakdown) {
+  size_t pos = 0;
+  while (size - pos >= 2 && bytes[pos] == 0xFF) {
+    const uint8_t marker = bytes[pos + 1];
+    if (marker == 0xFF) {  // Fill byte.
+      breakdown.header_size += 1;
+      pos += 1;
+      continue;
+    }
+    if (marker == 0xD8 || marker == 0xD9 || marker == 0x01 ||
+        IsRestartMarker(marker)) {  // No segment.
+      breakdown.header_size += 2;
+      pos += 2;
+      if (marker == 0xD9) break;  // End of image.
+      continue;
+    }
+    if (size - pos < 4) break;
+    const size_t length = ReadBigEndian(bytes + pos + 2, 2);  // With itself.
+    if (length < 2 || length > size - pos - 2) break;
+    Add(JpegSegmentCategory(marker), 2 + length, breakdown);
+    pos += 2 + length;
+
+    if (marker == 0xDA) {  // Start of scan, followed by entropy-coded data.
+      size_t scan_end = pos;
+      while (scan_end + 1 < size &&
+             !(bytes[scan_end] == 0xFF && bytes[scan_end + 1] != 0x00 &&
+               !IsRestartMarker(bytes[scan_end + 1]))) {
+        ++scan_end;
+      }
+      if (scan_end + 1 >= size) scan_end = size;
+      breakdown.payload_size += scan_end - pos;
+      pos = scan_end;
+    }
+  }
+  breakdown.payload_size += size - pos;  // Including data after end of image.
+}
+
+}  // namespace
+
+BitstreamBreakdown AnalyzeBitstream(const uint8_t* bytes, size_t size) {
+  BitstreamBreakdown breakdown;
+  if (size >= 12 && Equals(bytes, "RIFF") && Equals(bytes + 8, "WEBP")) {
+    ParseWebp(bytes, size, breakdown);
+  } else if (size >= 12 && Equals(bytes + 4, "JXL ")) {
+    ParseJpegXlContainer(bytes, size, breakdown);
+  } else if (size >= 8 && Equals(bytes + 4, "ftyp")) {
+    ParseAvif(bytes, size, breakdown);
+  } else if (size >= 2 && bytes[0] == 0xFF && bytes[1] == 0x0A) {
+    // Bare JPEG XL codestream. Its headers are bit-packed.
+    breakdown.header_size = 2;
+    breakdown.payload_size = size - 2;
+  } else if (size >= 2 && bytes[0] == 0xFF && bytes[1] == 0xD8) {
+    ParseJpeg(bytes, size, breakdown);
+  } else {
+    breakdown.payload_size = size;
+  }
+  return breakdown;
+}
+
+}  // namespace codec_compare_gen
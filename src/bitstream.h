@@ -0,0 +1,40 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_BITSTREAM_H_
+#define SRC_BITSTREAM_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace codec_compare_gen {
+
+// Split of the bytes of an encoded image file by purpose.
+struct BitstreamBreakdown {
+  size_t header_size = 0;    // Container structure, image and coding headers.
+  size_t metadata_size = 0;  // ICC profile, Exif, XMP, comments.
+  size_t alpha_size = 0;     // Separately coded alpha plane.
+  size_t payload_size = 0;   // Coded samples and unrecognized bytes.
+};
+
+// Parses the container and headers of a WebP (RIFF chunks), AVIF (ISOBMFF
+// boxes, except for the bit-packed "mini" box of slimavif), JPEG XL (bare
+// codestream or boxes) or JPEG (markers) file. The bit-packed headers inside
+// coded payloads are not parsed. Other formats, or bytes past a truncated or
+// malformed structure, count as payload. The sizes sum up to size.
+BitstreamBreakdown AnalyzeBitstream(const uint8_t* bytes, size_t size);
+
+}  // namespace codec_compare_gen
+
+#endif  // SRC_BITSTREAM_H_
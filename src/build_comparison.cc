@@ -0,0 +1,164 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/build_comparison.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/base.h"
+#include "src/codec.h"
+#include "src/codec_plugin.h"
+#include "src/framework.h"
+#include "src/serialization.h"
+#include "src/task.h"
+
+namespace codec_compare_gen {
+
+namespace {
+
+bool SameCodecAndEffort(const CodecSettings& a, const CodecSettings& b) {
+  return a.codec == b.codec && a.chroma_subsampling == b.chroma_subsampling &&
+         a.effort == b.effort;
+}
+
+// Returns log(a/b), avoiding infinities for very short durations.
+double LogRatio(double a, double b) {
+  constexpr double kEpsilon = 1e-9;
+  return std::log(std::max(a, kEpsilon)) - std::log(std::max(b, kEpsilon));
+}
+
+std::string BuildToString(const std::string& build) {
+  return build.empty() ? "linked" : CodecBuildName(build);
+}
+
+std::string RatioToPercentString(double ratio) {
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(2) << std::showpos
+     << (ratio - 1) * 100 << "%";
+  return ss.str();
+}
+
+}  // namespace
+
+std::string BuildComparison::ToString() const {
+  std::stringstream ss;
+  ss << CodecName(codec_settings.codec) << " "
+     << SubsamplingToString(codec_settings.chroma_subsampling) << " effort "
+     << codec_settings.effort << ": "
+     << BuildToString(build) << " vs " << BuildToString(reference_build)
+     << " over " << num_pairs << " pairs: encoded size "
+     << RatioToPercentString(encoded_size_ratio) << ", encoding duration "
+     << RatioToPercentString(encoding_duration_ratio)
+     << ", decoding duration " << RatioToPercentString(decoding_duration_ratio);
+  return ss.str();
+}
+
+StatusOr<std::vector<BuildComparison>> CompareBuilds(
+    const std::vector<std::vector<TaskOutput>>& results, bool quiet) {
+  std::vector<BuildComparison> comparisons;
+  const std::vector<TaskOutput>* reference = nullptr;
+  std::map<std::pair<std::string, int>, const TaskOutput*> reference_tasks;
+  for (const std::vector<TaskOutput>& tasks : results) {
+    if (tasks.empty()) continue;
+    const CodecSettings& settings = tasks.front().task_input.codec_settings;
+    if (reference == nullptr ||
+        !SameCodecAndEffort(
+            reference->front().task_input.codec_settings, settings)) {
+      // First build of these codec settings.
+      reference = &tasks;
+      reference_tasks.clear();
+      for (const TaskOutput& task : tasks) {
+        reference_tasks[{task.task_input.image_path,
+                         task.task_input.codec_settings.quality}] = &task;
+      }
+      continue;
+    }
+    CHECK_OR_RETURN(
+        reference->front().task_input.codec_settings.build < settings.build,
+        quiet)
+        << "Results are not sorted by build";
+
+    BuildComparison comparison;
+    comparison.codec_settings = settings;
+    comparison.reference_build =
+        reference->front().task_input.codec_settings.build;
+    comparison.build = settings.build;
+    double sum_encoded_size = 0;
+    double sum_encoding_duration = 0;
+    double sum_decoding_duration = 0;
+    for (const TaskOutput& task : tasks) {
+      const auto it = reference_tasks.find(
+          {task.task_input.image_path, task.task_input.codec_settings.quality});
+      if (it == reference_tasks.end()) continue;
+      const TaskOutput& reference_task = *it->second;
+      sum_encoded_size += LogRatio(static_cast<double>(task.encoded_size),
+                                   reference_task.encoded_size);
+      sum_encoding_duration += LogRatio(task.encoding_duration,
+                                        reference_task.encoding_duration);
+      sum_decoding_duration += LogRatio(task.decoding_duration,
+                                        reference_task.decoding_duration);
+      ++comparison.num_pairs;
+    }
+    if (comparison.num_pairs == 0) continue;
+    comparison.encoded_size_ratio =
+        std::exp(sum_encoded_size / comparison.num_pairs);
+    comparison.encoding_duration_ratio =
+        std::exp(sum_encoding_duration / comparison.num_pairs);
+    comparison.decoding_duration_ratio =
+        std::exp(sum_decoding_duration / comparison.num_pairs);
+    comparisons.push_back(comparison);
+  }
+  return comparisons;
+}
+
+Status BuildComparisonsToJson(const std::vector<BuildComparison>& comparisons,
+                              const std::string& file_path, bool quiet) {
+  std::ofstream file(file_path, std::ios::trunc);
+  CHECK_OR_RETURN(file.is_open(), quiet)
+      << "Failed to open build comparison file at " << file_path
+      << " for writing";
+  file << "[" << std::endl;
+  for (size_t i = 0; i < comparisons.size(); ++i) {
+    const BuildComparison& comparison = comparisons[i];
+    const CodecSettings& settings = comparison.codec_settings;
+    file << "  {\"codec\": " << Escape(CodecName(settings.codec))
+         << ", \"chroma_subsampling\": "
+         << Escape(SubsamplingToString(settings.chroma_subsampling))
+         << ", \"effort\": " << settings.effort
+         << ", \"reference_build\": "
+         << Escape(BuildToString(comparison.reference_build))
+         << ", \"build\": " << Escape(BuildToString(comparison.build))
+         << ", \"num_pairs\": " << comparison.num_pairs
+         << ", \"encoded_size_ratio\": " << comparison.encoded_size_ratio
+         << ", \"encoding_duration_ratio\": "
+         << comparison.encoding_duration_ratio
+         << ", \"decoding_duration_ratio\": "
+         << comparison.decoding_duration_ratio << "}"
+         << (i + 1 == comparisons.size() ? "" : ",") << std::endl;
+  }
+  file << "]" << std::endl;
+  CHECK_OR_RETURN(file.good(), quiet) << "Failed to write " << file_path;
+  return Status::kOk;
+}
+
+}  // namespace codec_compare_gen
@@ -0,0 +1,57 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_BUILD_COMPARISON_H_
+#define SRC_BUILD_COMPARISON_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "src/base.h"
+#include "src/framework.h"
+#include "src/task.h"
+
+namespace codec_compare_gen {
+
+// Paired differences between two builds of the same codec settings, computed
+// over the images and qualities evaluated with both builds.
+struct BuildComparison {
+  CodecSettings codec_settings;  // quality is irrelevant.
+  std::string reference_build;   // Empty for the codec linked to libccgen.
+  std::string build;
+  size_t num_pairs = 0;
+  // Geometric means of the build/reference_build ratios.
+  // Below 1 means that build is smaller or faster than reference_build.
+  double encoded_size_ratio = 1;
+  double encoding_duration_ratio = 1;
+  double decoding_duration_ratio = 1;
+
+  std::string ToString() const;
+};
+
+// Compares each build to the reference build of the same codec, chroma
+// subsampling and effort. The reference build is the one sorted first, meaning
+// the codec linked to libccgen if it was evaluated. The results are expected to
+// be returned by SplitByCodecSettingsAndAggregateByImageAndQuality().
+StatusOr<std::vector<BuildComparison>> CompareBuilds(
+    const std::vector<std::vector<TaskOutput>>& results, bool quiet);
+
+// Writes the comparisons as a JSON array to file_path.
+Status BuildComparisonsToJson(const std::vector<BuildComparison>& comparisons,
+                              const std::string& file_path, bool quiet);
+
+}  // namespace codec_compare_gen
+
+#endif  // SRC_BUILD_COMPARISON_H_
@@ -20,12 +20,15 @@
 #include <cstdint>
 #include <filesystem>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "src/base.h"
+#include "src/bitstream.h"
 #include "src/codec_avif.h"
 #include "src/codec_combination.h"
 #include "src/codec_jpegli.h"
@@ -33,11 +36,18 @@
 #include "src/codec_jpegsimple.h"
 #include "src/codec_jpegturbo.h"
 #include "src/codec_jpegxl.h"
+#include "src/codec_plugin.h"
 #include "src/codec_webp.h"
 #include "src/codec_webp2.h"
 #include "src/distortion.h"
+#include "src/file_writer.h"
 #include "src/frame.h"
 #include "src/framework.h"
+#include "src/rendition.h"
+#include "src/serialization.h"
+#include "src/simd.h"
+#include "src/stats.h"
+#include "src/system_conditions.h"
 #include "src/task.h"
 #include "src/timer.h"
 
@@ -140,6 +150,120 @@ bool CodecIsSupportedByBrowsers(Codec codec) {
          codec == Codec::kJpegsimple || codec == Codec::kJpegmoz;
 }
 
+bool CodecSupportsLosslessBitDepth(Codec codec, uint32_t bit_depth) {
+  if (bit_depth <= 8) return true;
+  if (codec == Codec::kJpegXl) return true;
+  if (codec == Codec::kAvif || codec == Codec::kSlimAvif ||
+      codec == Codec::kSlimAvifAvm) {
+    return bit_depth <= 12;  // AV1 profiles stop at 12 bits.
+  }
+  if (codec == Codec::kJpegturbo) return JpegturboSupportsLossless();
+  return false;
+}
+
+CodecCapabilities GetCodecCapabilities(Codec codec) {
+  // Mirrors the checks of the encoder wrappers, plus lossless JPEG which only
+  // libjpeg-turbo 3 produces. kCombination forwards its settings to WebP, WebP2
+  // or JPEG XL depending on its effort, so it accepts what any of them accepts.
+  // The JPEG libraries encode and decode on the calling thread only.
+  static constexpr CodecCapabilities kWebp = {
+      /*lossy_420=*/true, /*lossy_444=*/false, /*lossless_444=*/true,
+      /*lossless_420=*/false, /*animation=*/true, /*multithreading=*/true,
+      /*min_effort=*/0, /*max_lossy_effort=*/6, /*max_lossless_effort=*/9};
+  static constexpr CodecCapabilities kWebp2 = {
+      /*lossy_420=*/true, /*lossy_444=*/true, /*lossless_444=*/true,
+      /*lossless_420=*/true, /*animation=*/true, /*multithreading=*/true,
+      /*min_effort=*/0, /*max_lossy_effort=*/9, /*max_lossless_effort=*/9};
+  static constexpr CodecCapabilities kJpegXl = {
+      /*lossy_420=*/false, /*lossy_444=*/true, /*lossless_444=*/true,
+      /*lossless_420=*/false, /*animation=*/true, /*multithreading=*/true,
+      /*min_effort=*/1, /*max_lossy_effort=*/10, /*max_lossless_effort=*/10};
+  static constexpr CodecCapabilities kAvif = {
+      /*lossy_420=*/true, /*lossy_444=*/true, /*lossless_444=*/true,
+      /*lossless_420=*/false, /*animation=*/true, /*multithreading=*/true,
+      /*min_effort=*/0, /*max_lossy_effort=*/10, /*max_lossless_effort=*/10};
+  static constexpr CodecCapabilities kCombination = {
+      /*lossy_420=*/true, /*lossy_444=*/true, /*lossless_444=*/true,
+      /*lossless_420=*/true, /*animation=*/true, /*multithreading=*/true,
+      /*min_effort=*/0, /*max_lossy_effort=*/9, /*max_lossless_effort=*/9};
+  static constexpr CodecCapabilities kJpegturbo = {
+      /*lossy_420=*/true, /*lossy_444=*/true, /*lossless_444=*/true,
+      /*lossless_420=*/false, /*animation=*/false, /*multithreading=*/false,
+      /*min_effort=*/0, /*max_lossy_effort=*/0, /*max_lossless_effort=*/0};
+  static constexpr CodecCapabilities kJpeg = {
+      /*lossy_420=*/true, /*lossy_444=*/true, /*lossless_444=*/false,
+      /*lossless_420=*/false, /*animation=*/false, /*multithreading=*/false,
+      /*min_effort=*/0, /*max_lossy_effort=*/0, /*max_lossless_effort=*/0};
+  static constexpr CodecCapabilities kJpegsimple = {
+      /*lossy_420=*/true, /*lossy_444=*/true, /*lossless_444=*/false,
+      /*lossless_420=*/false, /*animation=*/false, /*multithreading=*/false,
+      /*min_effort=*/0, /*max_lossy_effort=*/8, /*max_lossless_effort=*/8};
+  switch (codec) {
+    case Codec::kWebp:
+      return kWebp;
+    case Codec::kWebp2:
+      return kWebp2;
+    case Codec::kJpegXl:
+      return kJpegXl;
+    case Codec::kAvif:
+    case Codec::kSlimAvif:
+    case Codec::kSlimAvifAvm:
+      return kAvif;
+    case Codec::kCombination:
+      return kCombination;
+    case Codec::kJpegturbo: {
+      CodecCapabilities capabilities = kJpegturbo;
+      capabilities.lossless_444 = JpegturboSupportsLossless();
+      return capabilities;
+    }
+    case Codec::kJpegli:
+    case Codec::kJpegmoz:
+      return kJpeg;
+    case Codec::kJpegsimple:
+      return kJpegsimple;
+  }
+  return {};
+}
+
+Status CheckCodecCapabilities(const CodecSettings& settings, bool quiet) {
+  const CodecCapabilities capabilities = GetCodecCapabilities(settings.codec);
+  const bool lossless = settings.quality == kQualityLossless;
+  const bool supported =
+      settings.chroma_subsampling == Subsampling::kDefault
+          ? (lossless ? capabilities.lossless_444 || capabilities.lossless_420
+                      : capabilities.lossy_420 || capabilities.lossy_444)
+      : settings.chroma_subsampling == Subsampling::k444
+          ? (lossless ? capabilities.lossless_444 : capabilities.lossy_444)
+          : (lossless ? capabilities.lossless_420 : capabilities.lossy_420);
+  CHECK_OR_RETURN(supported, quiet)
+      << CodecName(settings.codec) << " does not support "
+      << (lossless ? "lossless" : "lossy")
+      << " encodings with chroma subsampling "
+      << SubsamplingToString(settings.chroma_subsampling);
+  const int max_effort = lossless ? capabilities.max_lossless_effort
+                                  : capabilities.max_lossy_effort;
+  CHECK_OR_RETURN(settings.effort >= capabilities.min_effort &&
+                      settings.effort <= max_effort,
+                  quiet)
+      << CodecName(settings.codec) << " effort " << settings.effort
+      << " is not in [" << capabilities.min_effort << ":" << max_effort << "]"
+      << (lossless ? " for lossless encodings" : "");
+  CHECK_OR_RETURN(settings.num_threads >= 1, quiet);
+  CHECK_OR_RETURN(settings.num_threads == 1 || capabilities.multithreading,
+                  quiet)
+      << CodecName(settings.codec) << " does not use several threads per image";
+  return Status::kOk;
+}
+
+bool HasSharedEncoderInput(const CodecSettings& settings) {
+  // mozjpeg and jpegli tune their own conversion and downsampling, which their
+  // raw data input would bypass.
+  if (settings.quality == kQualityLossless || !settings.build.empty()) {
+    return false;
+  }
+  return settings.codec == Codec::kWebp || settings.codec == Codec::kJpegturbo;
+}
+
 #if defined(HAS_WEBP2)
 
 namespace {
@@ -164,41 +288,193 @@ WP2SampleFormat CodecToNeededFormat(Codec codec, bool has_transparency) {
   return WP2_ARGB_32;
 }
 
+// Representation of the samples of an image that an encoder can take instead
+// of RGB and that does not depend on the quality setting.
+struct SharedEncoderInput {
+  std::string name;  // Empty if there is none.
+  ImageConversion convert;
+};
+
+SharedEncoderInput GetSharedEncoderInput(const CodecSettings& settings) {
+  if (!HasSharedEncoderInput(settings)) return {};
+  if (settings.codec == Codec::kWebp) {
+    return {"webp_sharp_yuv", &WebpSharpYuv};
+  }
+  if (settings.codec == Codec::kJpegturbo) {
+    const Subsampling subsampling =
+        settings.chroma_subsampling == Subsampling::k444 ? Subsampling::k444
+                                                         : Subsampling::k420;
+    return {"jpegturbo_" + SubsamplingToString(subsampling),
+            [subsampling](const Image& image, bool quiet) {
+              return JpegturboYuv(image, subsampling, quiet);
+            }};
+  }
+  return {};
+}
+
+// Waits for the file queued in a FileWriter, if any. The error is logged again
+// because the FileWriter logs it from its own thread.
+Status WaitForFile(std::future<Status>& written, const std::string& file_path,
+                   bool quiet) {
+  if (!written.valid()) return Status::kOk;
+  CHECK_OR_RETURN(written.get() == Status::kOk, quiet)
+      << "Could not write " << file_path;
+  return Status::kOk;
+}
+
+// Larger than the last level cache of most CPUs.
+constexpr size_t kCacheEvictionBufferSize = size_t{64} << 20;
+
+// Replaces the content of the CPU caches by unrelated data, at least for the
+// calling thread. The buffer is allocated once per thread.
+void EvictCpuCaches() {
+  thread_local std::vector<uint8_t> buffer(kCacheEvictionBufferSize);
+  constexpr size_t kCacheLineSize = 64;
+  uint8_t sum = 0;
+  for (size_t i = 0; i < buffer.size(); i += kCacheLineSize) {
+    buffer[i] += 1;  // Dirty the line so that it is also written back.
+    sum += buffer[i];
+  }
+  // Keep the loop from being optimized away.
+  volatile uint8_t sink = sum;
+  (void)sink;
+}
+
 }  // namespace
 
+StatusOr<WP2::Data> ReadEncodedImage(const std::string& encoded_path,
+                                     bool quiet) {
+  CHECK_OR_RETURN(!encoded_path.empty(), quiet);
+  std::ifstream file{encoded_path, std::ios::binary};
+  CHECK_OR_RETURN(file.good(), quiet);
+  auto length{std::filesystem::file_size(encoded_path)};
+  WP2::Data encoded_image;
+  CHECK_OR_RETURN(encoded_image.Resize(length, false) == WP2_STATUS_OK, quiet);
+  file.read(reinterpret_cast<char*>(encoded_image.bytes),
+            static_cast<long>(length));
+  return encoded_image;
+}
+
+StatusOr<TimedDecoding> Decode(const TaskInput& input,
+                               const WP2::Data& encoded_image, bool quiet) {
+  TimedDecoding decoding;
+  const Timer decoding_duration;
+  // Empty build means the codec linked to libccgen.
+  if (!input.codec_settings.build.empty()) {
+    ASSIGN_OR_RETURN(PluginDecodedImage decoded,
+                     DecodeWithPlugin(input, encoded_image, quiet));
+    decoding.image = std::move(decoded.image);
+    decoding.color_conversion_duration = decoded.color_conversion_duration;
+    decoding.duration = decoded.duration;
+    return decoding;
+  }
+
+  auto decode_func =
+      input.codec_settings.codec == Codec::kWebp          ? &DecodeWebp
+      : input.codec_settings.codec == Codec::kWebp2       ? &DecodeWebp2
+      : input.codec_settings.codec == Codec::kJpegXl      ? &DecodeJxl
+      : input.codec_settings.codec == Codec::kAvif        ? &DecodeAvif
+      : input.codec_settings.codec == Codec::kSlimAvif    ? &DecodeAvif
+      : input.codec_settings.codec == Codec::kSlimAvifAvm ? &DecodeAvifAvm
+      : input.codec_settings.codec == Codec::kCombination
+          ? &DecodeCodecCombination
+      : input.codec_settings.codec == Codec::kJpegturbo  ? &DecodeJpegturbo
+      : input.codec_settings.codec == Codec::kJpegli     ? &DecodeJpegli
+      : input.codec_settings.codec == Codec::kJpegsimple ? &DecodeJpegsimple
+      : input.codec_settings.codec == Codec::kJpegmoz    ? &DecodeJpegmoz
+                                                         : nullptr;
+  CHECK_OR_RETURN(decode_func != nullptr, quiet);
+  ASSIGN_OR_RETURN(auto image_and_color_conversion_duration,
+                   decode_func(input, encoded_image, quiet));
+  decoding.image = std::move(image_and_color_conversion_duration.first);
+  decoding.color_conversion_duration =
+      image_and_color_conversion_duration.second;
+  decoding.duration = decoding_duration.seconds();
+
+  const Image& image = decoding.image;
+  if (image.size() > 1 && image.back().decoded_after > 0) {
+    std::vector<double> frame_durations;
+    frame_durations.reserve(image.size());
+    for (size_t i = 0; i < image.size(); ++i) {
+      frame_durations.push_back(
+          image[i].decoded_after - (i == 0 ? 0 : image[i - 1].decoded_after));
+    }
+    decoding.first_frame_duration = frame_durations.front();
+    std::sort(frame_durations.begin(), frame_durations.end());
+    decoding.frame_duration_p50 = Percentile(frame_durations, 0.5);
+    decoding.frame_duration_p99 = Percentile(frame_durations, 0.99);
+    decoding.frame_duration_max = frame_durations.back();
+  }
+  return decoding;
+}
+
 StatusOr<TaskOutput> EncodeDecode(const TaskInput& input,
                                   const std::string& metric_binary_folder_path,
                                   size_t thread_id, EncodeMode encode_mode,
+                                  const EncodeDecodeOptions& options,
                                   bool quiet) {
+  const DecodeTiming decode_timing = options.decode_timing;
   TaskOutput task;
   task.task_input = input;
+  task.simd_level = GetSimdLevel();
+  task.decode_timing = decode_timing;
 
-  const WP2SampleFormat initial_format = CodecToNeededFormat(
-      input.codec_settings.codec, /*has_transparency=*/true);
-  ASSIGN_OR_RETURN(Image original_image,
-                   ReadStillImageOrAnimation(input.image_path.c_str(),
-                                             initial_format, quiet));
+  // The cached images are shared by all tasks so they are only read here.
+  RenditionCache no_cache(/*capacity=*/0);
+  RenditionCache& cache = options.rendition_cache != nullptr
+                              ? *options.rendition_cache
+                              : no_cache;
+  ASSIGN_OR_RETURN(const std::shared_ptr<const Image> source,
+                   cache.Get(input.image_path, input.rendition_width, quiet));
 
   bool has_transparency = false;
-  for (const Frame& frame : original_image) {
+  for (const Frame& frame : *source) {
     has_transparency |= frame.pixels.HasTransparency();
   }
   WP2SampleFormat needed_format =
       CodecToNeededFormat(input.codec_settings.codec, has_transparency);
-  if (initial_format != needed_format) {
-    needed_format = WP2FormatAtbpc(
-        needed_format, WP2Formatbpc(original_image.front().pixels.format()));
-    CHECK_OR_RETURN(needed_format != WP2_FORMAT_NUM, quiet);
-    // Ditch alpha because the image is opaque.
-    ASSIGN_OR_RETURN(original_image,
-                     CloneAs(original_image, needed_format, quiet));
-  }
+  needed_format = WP2FormatAtbpc(needed_format,
+                                 WP2Formatbpc(source->front().pixels.format()));
+  CHECK_OR_RETURN(needed_format != WP2_FORMAT_NUM, quiet);
+  // Ditch alpha if the image is opaque. The source outlives original_image so
+  // its pixels can be shared when no conversion is needed.
+  ASSIGN_OR_RETURN(Image original_image,
+                   source->front().pixels.format() == needed_format
+                       ? MakeView(*source, quiet)
+                       : CloneAs(*source, needed_format, quiet));
   if (WP2Formatbpc(original_image.front().pixels.format()) == 16 &&
-      input.codec_settings.codec != Codec::kJpegXl &&
-      input.codec_settings.quality == kQualityLossless) {
-    // The codec does not support 16-bit images. Consider the frames to be 8-bit
-    // and twice as large. The compression rate is likely terrible.
-    ASSIGN_OR_RETURN(original_image, SpreadTo8bit(original_image, quiet));
+      input.codec_settings.quality == kQualityLossless &&
+      !CodecSupportsLosslessBitDepth(input.codec_settings.codec, 16)) {
+    const uint32_t bit_depth = GetSignificantBitDepth(original_image);
+    if (bit_depth == 8) {
+      // 8-bit samples stored as 16-bit ones. Encoding them as 8-bit frames is
+      // lossless.
+      ASSIGN_OR_RETURN(original_image, ReduceTo8bit(original_image, quiet));
+    } else if (!CodecSupportsLosslessBitDepth(input.codec_settings.codec,
+                                              bit_depth)) {
+      // The codec does not support that many bits per sample. Consider the
+      // frames to be 8-bit and twice as large. The compression rate is likely
+      // terrible.
+      ASSIGN_OR_RETURN(original_image, SpreadTo8bit(original_image, quiet));
+    }
+    // Otherwise the codec reduces the samples to bit_depth itself.
+  }
+
+  // Convert the RGB samples once per image rather than once per quality.
+  const SharedEncoderInput shared_input =
+      GetSharedEncoderInput(input.codec_settings);
+  double encoding_color_conversion_duration = 0;
+  if (!shared_input.name.empty() && encode_mode != EncodeMode::kLoadFromDisk &&
+      original_image.size() == 1 &&
+      original_image.front().yuv == nullptr && !has_transparency &&
+      WP2Formatbpc(original_image.front().pixels.format()) == 8) {
+    ASSIGN_OR_RETURN(
+        const std::shared_ptr<const Image> converted,
+        cache.GetConverted(input.image_path, input.rendition_width,
+                           shared_input.name, shared_input.convert, quiet));
+    original_image.front().yuv = converted->front().yuv;
+    encoding_color_conversion_duration =
+        original_image.front().yuv->conversion_duration;
   }
 
   auto encode_func =
@@ -215,61 +491,103 @@ StatusOr<TaskOutput> EncodeDecode(const TaskInput& input,
       : input.codec_settings.codec == Codec::kJpegsimple ? &EncodeJpegsimple
       : input.codec_settings.codec == Codec::kJpegmoz    ? &EncodeJpegmoz
                                                          : nullptr;
-  auto decode_func =
-      input.codec_settings.codec == Codec::kWebp          ? &DecodeWebp
-      : input.codec_settings.codec == Codec::kWebp2       ? &DecodeWebp2
-      : input.codec_settings.codec == Codec::kJpegXl      ? &DecodeJxl
-      : input.codec_settings.codec == Codec::kAvif        ? &DecodeAvif
-      : input.codec_settings.codec == Codec::kSlimAvif    ? &DecodeAvif
-      : input.codec_settings.codec == Codec::kSlimAvifAvm ? &DecodeAvifAvm
-      : input.codec_settings.codec == Codec::kCombination
-          ? &DecodeCodecCombination
-      : input.codec_settings.codec == Codec::kJpegturbo  ? &DecodeJpegturbo
-      : input.codec_settings.codec == Codec::kJpegli     ? &DecodeJpegli
-      : input.codec_settings.codec == Codec::kJpegsimple ? &DecodeJpegsimple
-      : input.codec_settings.codec == Codec::kJpegmoz    ? &DecodeJpegmoz
-                                                         : nullptr;
-
+  // Empty build means the codec linked to libccgen.
+  const bool use_plugin = !input.codec_settings.build.empty();
+  double plugin_encoding_duration = -1;  // Unset.
+  // Reading the image and computing the distortions are left out, so that only
+  // the timed steps are judged.
+  SystemSample start_sample;
+  if (options.system_sampler != nullptr) {
+    start_sample = options.system_sampler->ReadSample();
+  }
   const Timer encoding_duration;
   WP2::Data encoded_image;
   if (encode_mode == EncodeMode::kLoadFromDisk) {
-    CHECK_OR_RETURN(!task.task_input.encoded_path.empty(), quiet);
-    std::ifstream file{task.task_input.encoded_path, std::ios::binary};
-    CHECK_OR_RETURN(file.good(), quiet);
-    auto length{std::filesystem::file_size(task.task_input.encoded_path)};
-    CHECK_OR_RETURN(encoded_image.Resize(length, false) == WP2_STATUS_OK,
-                    quiet);
-    file.read(reinterpret_cast<char*>(encoded_image.bytes),
-              static_cast<long>(length));
+    ASSIGN_OR_RETURN(encoded_image,
+                     ReadEncodedImage(task.task_input.encoded_path, quiet));
+  } else if (use_plugin) {
+    ASSIGN_OR_RETURN(auto encoded_image_and_duration,
+                     EncodeWithPlugin(input, original_image, quiet));
+    encoded_image = std::move(encoded_image_and_duration.first);
+    plugin_encoding_duration = encoded_image_and_duration.second;
   } else {
     CHECK_OR_RETURN(encode_func != nullptr, quiet);
     ASSIGN_OR_RETURN(encoded_image, encode_func(input, original_image, quiet));
   }
-  task.encoding_duration = encoding_duration.seconds();
+  // Plugins measure their own timings to exclude the pixel copies at the
+  // plugin boundary. The shared conversion is accounted for as if each
+  // encoding did it, so that timings stay comparable across codecs.
+  task.encoding_duration = (plugin_encoding_duration >= 0
+                                ? plugin_encoding_duration
+                                : encoding_duration.seconds()) +
+                           encoding_color_conversion_duration;
+  task.encoding_color_conversion_duration = encoding_color_conversion_duration;
   task.image_width = original_image.front().pixels.width();
   task.image_height = original_image.front().pixels.height();
-  task.bit_depth = WP2Formatbpc(original_image.front().pixels.format());
+  // The bit depth of the source, not the one the samples were reduced to above
+  // for the codec.
+  task.bit_depth = WP2Formatbpc(source->front().pixels.format());
   task.num_frames = static_cast<uint32_t>(original_image.size());
   task.encoded_size = encoded_image.size;
+  const BitstreamBreakdown breakdown =
+      AnalyzeBitstream(encoded_image.bytes, encoded_image.size);
+  task.header_size = breakdown.header_size;
+  task.metadata_size = breakdown.metadata_size;
+  task.alpha_size = breakdown.alpha_size;
 
-  const Timer decoding_duration;
-  Image decoded_image;
-  CHECK_OR_RETURN(decode_func != nullptr, quiet);
-  {
-    ASSIGN_OR_RETURN(auto image_and_color_conversion_duration,
-                     decode_func(input, encoded_image, quiet));
-    decoded_image = std::move(image_and_color_conversion_duration.first);
-    task.decoding_color_conversion_duration =
-        image_and_color_conversion_duration.second;
+  if (decode_timing == DecodeTiming::kCold) EvictCpuCaches();
+  ASSIGN_OR_RETURN(TimedDecoding decoding,
+                   Decode(input, encoded_image, quiet));
+  if (decode_timing == DecodeTiming::kSteady) {
+    // The first decoding above warmed the caches and the decoder up.
+    TimedDecoding sum;
+    for (size_t i = 0; i < kNumSteadyDecodings; ++i) {
+      ASSIGN_OR_RETURN(const TimedDecoding repeated_decoding,
+                       Decode(input, encoded_image, quiet));
+      sum.duration += repeated_decoding.duration;
+      sum.color_conversion_duration +=
+          repeated_decoding.color_conversion_duration;
+      sum.first_frame_duration += repeated_decoding.first_frame_duration;
+      sum.frame_duration_p50 += repeated_decoding.frame_duration_p50;
+      sum.frame_duration_p99 += repeated_decoding.frame_duration_p99;
+      sum.frame_duration_max += repeated_decoding.frame_duration_max;
+    }
+    decoding.duration = sum.duration / kNumSteadyDecodings;
+    decoding.color_conversion_duration =
+        sum.color_conversion_duration / kNumSteadyDecodings;
+    decoding.first_frame_duration =
+        sum.first_frame_duration / kNumSteadyDecodings;
+    decoding.frame_duration_p50 = sum.frame_duration_p50 / kNumSteadyDecodings;
+    decoding.frame_duration_p99 = sum.frame_duration_p99 / kNumSteadyDecodings;
+    decoding.frame_duration_max = sum.frame_duration_max / kNumSteadyDecodings;
+  }
+  Image decoded_image = std::move(decoding.image);
+  task.decoding_duration = decoding.duration;
+  task.decoding_color_conversion_duration = decoding.color_conversion_duration;
+  task.first_frame_decoding_duration = decoding.first_frame_duration;
+  task.frame_decoding_duration_p50 = decoding.frame_duration_p50;
+  task.frame_decoding_duration_p99 = decoding.frame_duration_p99;
+  task.frame_decoding_duration_max = decoding.frame_duration_max;
+  if (options.system_sampler != nullptr) {
+    task.system_conditions = options.system_sampler->GetConditions(
+        start_sample, options.system_sampler->ReadSample());
   }
-  task.decoding_duration = decoding_duration.seconds();
 
   std::string decoded_path;
+  // Waited for before returning, so that the task is only reported as done
+  // once the encoded file is on disk.
+  std::future<Status> encoded_file_written;
   if (encode_mode == EncodeMode::kEncodeAndSaveToDisk) {
     CHECK_OR_RETURN(!input.encoded_path.empty(), quiet);
-    std::ofstream(input.encoded_path, std::ios::binary)
-        .write(reinterpret_cast<char*>(encoded_image.bytes),
-               encoded_image.size);
+    if (options.file_writer != nullptr) {
+      // encoded_image is not used below.
+      encoded_file_written = options.file_writer->Write(
+          input.encoded_path, std::move(encoded_image));
+    } else {
+      std::ofstream(input.encoded_path, std::ios::binary)
+          .write(reinterpret_cast<char*>(encoded_image.bytes),
+                 encoded_image.size);
+    }
 
     // Some image formats are not supported by all major browsers.
     if (!CodecIsSupportedByBrowsers(input.codec_settings.codec)) {
@@ -281,13 +599,23 @@ StatusOr<TaskOutput> EncodeDecode(const TaskInput& input,
     }
   }
 
+  if (!options.compute_distortions) {
+    std::fill(task.distortions, task.distortions + kNumDistortionMetrics, 0.f);
+    OK_OR_RETURN(WaitForFile(encoded_file_written, input.encoded_path, quiet));
+    return task;
+  }
+
+  // The metric binaries read the original image file directly if it is a PNG.
+  // Renditions only exist in memory, which an empty path tells.
+  const std::string reference_path =
+      input.rendition_width == 0 ? input.image_path : "";
   ASSIGN_OR_RETURN(const bool pixel_equality,
                    PixelEquality(original_image, decoded_image, quiet));
   if (task.task_input.codec_settings.quality == kQualityLossless &&
       !pixel_equality) {
     ASSIGN_OR_RETURN(const float psnr,
                      GetAverageDistortion(
-                         input.image_path, original_image, decoded_path,
+                         reference_path, original_image, decoded_path,
                          decoded_image, input, metric_binary_folder_path,
                          DistortionMetric::kLibwebp2Psnr, thread_id, quiet));
     CHECK_OR_RETURN(false, quiet)
@@ -299,21 +627,35 @@ StatusOr<TaskOutput> EncodeDecode(const TaskInput& input,
   if (pixel_equality) {
     std::fill(task.distortions, task.distortions + kNumDistortionMetrics,
               kNoDistortion);
+  } else if (options.quick_metrics) {
+    for (size_t m = 0; m < kNumDistortionMetrics; ++m) {
+      ASSIGN_OR_RETURN(const SampledDistortion distortion,
+                       GetSampledDistortion(
+                           reference_path, original_image, decoded_path,
+                           decoded_image, input, metric_binary_folder_path,
+                           static_cast<DistortionMetric>(m), thread_id, quiet));
+      task.distortions[m] = distortion.value;
+      task.distortion_errors[m] = distortion.error;
+      task.approximate_distortions |= distortion.sampled;
+    }
   } else {
     for (size_t m = 0; m < kNumDistortionMetrics; ++m) {
       ASSIGN_OR_RETURN(task.distortions[m],
                        GetAverageDistortion(
-                           input.image_path, original_image, decoded_path,
+                           reference_path, original_image, decoded_path,
                            decoded_image, input, metric_binary_folder_path,
                            static_cast<DistortionMetric>(m), thread_id, quiet));
     }
   }
+  OK_OR_RETURN(WaitForFile(encoded_file_written, input.encoded_path, quiet));
   return task;
 }
 
 #else
 
-StatusOr<TaskOutput> EncodeDecode(const TaskInput&, bool quiet) {
+StatusOr<TaskOutput> EncodeDecode(const TaskInput&, const std::string&, size_t,
+                                  EncodeMode, const EncodeDecodeOptions&,
+                                  bool quiet) {
   CHECK_OR_RETURN(false, quiet) << "Reading images requires HAS_WEBP2";
 }
 
@@ -22,6 +22,11 @@
 #include "src/base.h"
 #include "src/task.h"
 
+#if defined(HAS_WEBP2)
+#include "src/frame.h"
+#include "third_party/libwebp2/src/wp2/base.h"
+#endif
+
 namespace codec_compare_gen {
 
 std::string CodecName(Codec codec);
@@ -30,14 +35,97 @@ StatusOr<Codec> CodecFromName(const std::string& name, bool quiet);
 std::vector<int> CodecLossyQualities(Codec codec);
 std::string CodecExtension(Codec codec);
 bool CodecIsSupportedByBrowsers(Codec codec);
+// Returns true if the codec can losslessly encode samples of the given bit
+// depth natively, without considering 16-bit frames as twice as wide 8-bit
+// frames (see SpreadTo8bit()).
+bool CodecSupportsLosslessBitDepth(Codec codec, uint32_t bit_depth);
+
+// Settings accepted by the encoder wrapper of a codec. Checked by PlanTasks()
+// before reading any image, so that impossible tasks are not evaluated.
+struct CodecCapabilities {
+  bool lossy_420;     // Lossy encodings with chroma subsampling 4:2:0.
+  bool lossy_444;     // Lossy encodings without chroma subsampling.
+  bool lossless_444;  // Lossless encodings without chroma subsampling.
+  bool lossless_420;  // Lossless encodings with Subsampling::k420.
+  bool animation;     // More than one frame.
+  bool multithreading;  // More than one CodecSettings::num_threads.
+  int min_effort;
+  int max_lossy_effort;
+  int max_lossless_effort;
+};
+CodecCapabilities GetCodecCapabilities(Codec codec);
+
+// Returns an error if the codec cannot encode with these settings, whatever
+// the image. Subsampling::kDefault is always accepted.
+Status CheckCodecCapabilities(const CodecSettings& settings, bool quiet);
+
+// Returns true if the encodings with these settings take a representation of
+// the image that is converted once and shared by all qualities (see
+// RenditionCache::GetConverted()).
+bool HasSharedEncoderInput(const CodecSettings& settings);
 
 enum class EncodeMode { kEncode, kEncodeAndSaveToDisk, kLoadFromDisk };
 
+// Number of timed decodings averaged with DecodeTiming::kSteady, after one
+// untimed decoding.
+constexpr size_t kNumSteadyDecodings = 8;
+
+class FileWriter;
+class RenditionCache;
+class SystemSampler;
+
+// Optional behaviors of EncodeDecode(). The defaults match the baseline.
+struct EncodeDecodeOptions {
+  DecodeTiming decode_timing = DecodeTiming::kWarm;
+  // If true, lossy distortions are estimated with GetSampledDistortion() and
+  // the task is marked as approximate.
+  bool quick_metrics = false;
+  // If false, the decoded image is not compared to the original image at all
+  // and TaskOutput::distortions are left at 0. Only the timings, the sizes and
+  // the image properties are meaningful then.
+  bool compute_distortions = true;
+  // Shares the original images, their renditions and their conversions across
+  // tasks. The images are read from disk if null.
+  RenditionCache* rendition_cache = nullptr;
+  // Writes the encoded image with EncodeMode::kEncodeAndSaveToDisk, in the
+  // background while the distortions are computed. EncodeDecode() returns once
+  // the file is written either way.
+  FileWriter* file_writer = nullptr;
+  // Samples the host right before encoding and right after decoding to fill
+  // TaskOutput::system_conditions. Nothing is sampled if null.
+  SystemSampler* system_sampler = nullptr;
+};
+
+// Reads the original image (or its rendition, see TaskInput::rendition_width),
+// then encodes, decodes and compares it.
 StatusOr<TaskOutput> EncodeDecode(const TaskInput& input,
                                   const std::string& metric_binary_folder_path,
                                   size_t thread_id, EncodeMode encode_mode,
+                                  const EncodeDecodeOptions& options,
                                   bool quiet);
 
+#if defined(HAS_WEBP2)
+struct TimedDecoding {
+  Image image;
+  double duration = 0;                   // in seconds
+  double color_conversion_duration = 0;  // in seconds
+  // Decoding durations of the frames of an animation, in seconds, if the
+  // decoder measured them (see Frame::decoded_after). 0 otherwise.
+  double first_frame_duration = 0;  // Since the start of the decoding.
+  double frame_duration_p50 = 0;
+  double frame_duration_p99 = 0;
+  double frame_duration_max = 0;
+};
+
+// Reads the whole encoded image file into memory.
+StatusOr<WP2::Data> ReadEncodedImage(const std::string& encoded_path,
+                                     bool quiet);
+// Decodes the encoded_image with the codec linked to libccgen or with the
+// plugin, depending on input.codec_settings.
+StatusOr<TimedDecoding> Decode(const TaskInput& input,
+                               const WP2::Data& encoded_image, bool quiet);
+#endif  // HAS_WEBP2
+
 }  // namespace codec_compare_gen
 
 #endif  // SRC_CODEC_H_
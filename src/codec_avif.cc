@@ -25,6 +25,7 @@
 #include "src/serialization.h"
 #include "src/task.h"
 #include "src/timer.h"
+#include "src/yuv.h"
 
 #if defined(HAS_WEBP2)
 #include "third_party/libwebp2/src/wp2/base.h"
@@ -72,25 +73,41 @@ StatusOr<avifRGBFormat> WP2SampleFormatToAvifRGBFormat(WP2SampleFormat format) {
   if (format == WP2_BGRA_32) return AVIF_RGB_FORMAT_BGRA;
   if (format == WP2_RGB_24) return AVIF_RGB_FORMAT_RGB;
   if (format == WP2_BGR_24) return AVIF_RGB_FORMAT_BGR;
+  if (format == WP2_ARGB_64) return AVIF_RGB_FORMAT_ARGB;
+  if (format == WP2_RGB_48) return AVIF_RGB_FORMAT_RGB;
   return codec_compare_gen::Status::kUnknownError;
 }
 
+// bit_depth is the number of significant bits of the samples of wp2_image (see
+// GetSignificantBitDepth()). 16-bit buffers are reduced to that bit depth,
+// which must be supported by AV1.
 StatusOr<avif::ImagePtr> ArgbBufferToAvifImage(const WP2::ArgbBuffer& wp2_image,
+                                               uint32_t bit_depth,
                                                bool lossless,
                                                Subsampling subsampling,
                                                bool quiet) {
+  const bool is_16bit = WP2Formatbpc(wp2_image.format()) == 16;
+  CHECK_OR_RETURN(is_16bit ? (bit_depth == 10 || bit_depth == 12)
+                           : bit_depth == 8,
+                  quiet)
+      << "Unexpected " << bit_depth << "-bit samples in format "
+      << wp2_image.format();
+  CHECK_OR_RETURN(lossless || !is_16bit, quiet)
+      << "Lossy AVIF encoding of 16-bit images is not supported";
   avif::ImagePtr image(avifImageCreate(wp2_image.width(), wp2_image.height(),
-                                       WP2Formatbpc(wp2_image.format()),
-                                       AVIF_PIXEL_FORMAT_YUV444));
+                                       bit_depth, AVIF_PIXEL_FORMAT_YUV444));
   CHECK_OR_RETURN(image != nullptr, quiet) << "avifImageCreate() failed";
   if (lossless) {
     image->colorPrimaries = AVIF_COLOR_PRIMARIES_UNSPECIFIED;
     image->transferCharacteristics = AVIF_TRANSFER_CHARACTERISTICS_UNSPECIFIED;
-    // AVIF_MATRIX_COEFFICIENTS_YCGCO_RE
-    image->matrixCoefficients = (avifMatrixCoefficients)16;
-    CHECK_OR_RETURN(WP2Formatbpc(wp2_image.format()) == 8, quiet)
-        << "Unexpected format " << wp2_image.format();
-    image->depth = 10;
+    if (bit_depth <= 10) {
+      // AVIF_MATRIX_COEFFICIENTS_YCGCO_RE needs two more bits than RGB.
+      image->matrixCoefficients = (avifMatrixCoefficients)16;
+      image->depth = bit_depth + 2;
+    } else {
+      // The RGB samples are stored as is. See AvifImageToArgbBuffer().
+      image->matrixCoefficients = AVIF_MATRIX_COEFFICIENTS_IDENTITY;
+    }
     CHECK_OR_RETURN(subsampling == Subsampling::kDefault ||
                         subsampling == Subsampling::k444,
                     quiet)
@@ -108,41 +125,111 @@ StatusOr<avif::ImagePtr> ArgbBufferToAvifImage(const WP2::ArgbBuffer& wp2_image,
   }
   avifRGBImage rgb_image;
   avifRGBImageSetDefaults(&rgb_image, image.get());
-  if (lossless) {
-    rgb_image.depth = 8;
-  }
+  rgb_image.depth = bit_depth;
   ASSIGN_OR_RETURN(rgb_image.format,
                    WP2SampleFormatToAvifRGBFormat(wp2_image.format()));
   rgb_image.alphaPremultiplied = WP2IsPremultiplied(wp2_image.format());
-  rgb_image.pixels = const_cast<uint8_t*>(wp2_image.GetRow8(0));
-  rgb_image.rowBytes = wp2_image.stride();
+  std::vector<uint16_t> samples;
+  if (is_16bit) {
+    // libavif expects the samples in [0:2^bit_depth-1].
+    const uint32_t num_samples =
+        wp2_image.width() * WP2FormatNumChannels(wp2_image.format());
+    samples.resize(static_cast<size_t>(num_samples) * wp2_image.height());
+    for (uint32_t y = 0; y < wp2_image.height(); ++y) {
+      const uint16_t* row = wp2_image.GetRow16(y);
+      for (uint32_t i = 0; i < num_samples; ++i) {
+        samples[static_cast<size_t>(y) * num_samples + i] =
+            ReduceSample(row[i], bit_depth);
+      }
+    }
+    rgb_image.pixels = reinterpret_cast<uint8_t*>(samples.data());
+    rgb_image.rowBytes = num_samples * sizeof(uint16_t);
+  } else {
+    rgb_image.pixels = const_cast<uint8_t*>(wp2_image.GetRow8(0));
+    rgb_image.rowBytes = wp2_image.stride();
+  }
   const avifResult result = avifImageRGBToYUV(image.get(), &rgb_image);
   CHECK_OR_RETURN(result == AVIF_RESULT_OK, quiet)
       << "avifImageRGBToYUV() failed: " << result;
   return image;
 }
 
+// Returns true if the source samples can be encoded as is.
+bool CanEncodeYuvImage(const YuvImage& yuv, bool lossless,
+                       Subsampling subsampling) {
+  if (lossless) return false;  // The lossless path relies on YCgCo-R.
+  if (subsampling == Subsampling::kDefault) return true;
+  return subsampling == yuv.subsampling;
+}
+
+// Wraps the source samples without any color conversion. The returned image
+// does not own the planes so it must not outlive yuv.
+StatusOr<avif::ImagePtr> YuvImageToAvifImage(const YuvImage& yuv, bool quiet) {
+  avif::ImagePtr image(avifImageCreate(
+      yuv.width, yuv.height, yuv.bit_depth,
+      yuv.subsampling == Subsampling::k444 ? AVIF_PIXEL_FORMAT_YUV444
+                                           : AVIF_PIXEL_FORMAT_YUV420));
+  CHECK_OR_RETURN(image != nullptr, quiet) << "avifImageCreate() failed";
+  image->yuvRange = yuv.full_range ? AVIF_RANGE_FULL : AVIF_RANGE_LIMITED;
+  image->matrixCoefficients = AVIF_MATRIX_COEFFICIENTS_BT601;
+  for (int p = 0; p < 3; ++p) {
+    image->yuvPlanes[p] = const_cast<uint8_t*>(yuv.planes[p].data());
+    image->yuvRowBytes[p] = yuv.RowBytes(p);
+  }
+  image->imageOwnsYUVPlanes = AVIF_FALSE;
+  return image;
+}
+
 StatusOr<WP2::ArgbBuffer> AvifImageToArgbBuffer(const avifImage& image,
                                                 bool quiet) {
-  WP2::ArgbBuffer wp2_image(image.alphaPlane ? WP2_ARGB_32 : WP2_RGB_24);
+  // Lossless encodings of samples with more than 8 bits are decoded to 16-bit
+  // buffers. Other encodings are decoded to 8-bit buffers like the images they
+  // come from. See ArgbBufferToAvifImage().
+  uint32_t rgb_depth = 8;
+  if (image.matrixCoefficients == (avifMatrixCoefficients)16) {
+    CHECK_OR_RETURN(image.depth == 10 || image.depth == 12, quiet)
+        << "Unexpected depth " << image.depth;
+    rgb_depth = image.depth - 2;
+  } else if (image.matrixCoefficients == AVIF_MATRIX_COEFFICIENTS_IDENTITY &&
+             image.depth > 8) {
+    rgb_depth = image.depth;
+  }
+  const bool is_16bit = rgb_depth > 8;
+  WP2::ArgbBuffer wp2_image(
+      image.alphaPlane ? (is_16bit ? WP2_ARGB_64 : WP2_ARGB_32)
+                       : (is_16bit ? WP2_RGB_48 : WP2_RGB_24));
   CHECK_OR_RETURN(wp2_image.Resize(image.width, image.height) == WP2_STATUS_OK,
                   quiet);
 
   avifRGBImage rgb_image;
   avifRGBImageSetDefaults(&rgb_image, &image);
-  if (image.matrixCoefficients == (avifMatrixCoefficients)16) {
-    CHECK_OR_RETURN(image.depth == 10, quiet)
-        << "Unexpected depth " << image.depth;
-    rgb_image.depth = 8;
-  }
+  rgb_image.depth = rgb_depth;
   ASSIGN_OR_RETURN(rgb_image.format,
                    WP2SampleFormatToAvifRGBFormat(wp2_image.format()));
   rgb_image.alphaPremultiplied = WP2IsPremultiplied(wp2_image.format());
-  rgb_image.pixels = const_cast<uint8_t*>(wp2_image.GetRow8(0));
-  rgb_image.rowBytes = wp2_image.stride();
+  const uint32_t num_samples =
+      wp2_image.width() * WP2FormatNumChannels(wp2_image.format());
+  std::vector<uint16_t> samples;
+  if (is_16bit) {
+    samples.resize(static_cast<size_t>(num_samples) * wp2_image.height());
+    rgb_image.pixels = reinterpret_cast<uint8_t*>(samples.data());
+    rgb_image.rowBytes = num_samples * sizeof(uint16_t);
+  } else {
+    rgb_image.pixels = const_cast<uint8_t*>(wp2_image.GetRow8(0));
+    rgb_image.rowBytes = wp2_image.stride();
+  }
   CHECK_OR_RETURN(avifImageYUVToRGB(&image, &rgb_image) == AVIF_RESULT_OK,
                   quiet)
       << "avifImageYUVToRGB() failed";
+  if (is_16bit) {
+    for (uint32_t y = 0; y < wp2_image.height(); ++y) {
+      uint16_t* row = wp2_image.GetRow16(y);
+      for (uint32_t i = 0; i < num_samples; ++i) {
+        row[i] = ExpandSample(samples[static_cast<size_t>(y) * num_samples + i],
+                              rgb_depth);
+      }
+    }
+  }
   return wp2_image;
 }
 
@@ -157,10 +244,17 @@ StatusOr<WP2::Data> EncodeAvifImpl(const TaskInput& input,
                                    bool minimized_image_box, bool avm,
                                    bool quiet) {
   const bool lossless = input.codec_settings.quality == kQualityLossless;
+  // All frames of an animation must have the same bit depth.
+  const uint32_t bit_depth = GetSignificantBitDepth(original_image);
 
   avif::EncoderPtr encoder(avifEncoderCreate());
   CHECK_OR_RETURN(encoder != nullptr, quiet) << "avifEncoderCreate() failed";
   encoder->speed = input.codec_settings.effort;  // Simpler not to reverse.
+  encoder->maxThreads = static_cast<int>(input.codec_settings.num_threads);
+  // Tiles are encoded in parallel. They slightly change the bitstream, so only
+  // split the image into tiles if the encoder is multithreaded.
+  encoder->autoTiling = input.codec_settings.num_threads > 1 ? AVIF_TRUE
+                                                             : AVIF_FALSE;
   encoder->quality =
       lossless ? AVIF_QUALITY_LOSSLESS : input.codec_settings.quality;
   encoder->qualityAlpha = encoder->quality;
@@ -171,10 +265,19 @@ StatusOr<WP2::Data> EncodeAvifImpl(const TaskInput& input,
 
   RwData encoded;
   if (original_image.size() == 1) {
-    ASSIGN_OR_RETURN(
-        avif::ImagePtr yuv,
-        ArgbBufferToAvifImage(original_image.front().pixels, lossless,
-                              input.codec_settings.chroma_subsampling, quiet));
+    const Frame& frame = original_image.front();
+    avif::ImagePtr yuv;
+    if (frame.yuv != nullptr &&
+        CanEncodeYuvImage(*frame.yuv, lossless,
+                          input.codec_settings.chroma_subsampling)) {
+      // Skip the RGB round trip for video frame grabs.
+      ASSIGN_OR_RETURN(yuv, YuvImageToAvifImage(*frame.yuv, quiet));
+    } else {
+      ASSIGN_OR_RETURN(
+          yuv, ArgbBufferToAvifImage(frame.pixels, bit_depth, lossless,
+                                     input.codec_settings.chroma_subsampling,
+                                     quiet));
+    }
     CHECK_OR_RETURN(
         avifEncoderWrite(encoder.get(), yuv.get(), &encoded) == AVIF_RESULT_OK,
         quiet)
@@ -184,7 +287,7 @@ StatusOr<WP2::Data> EncodeAvifImpl(const TaskInput& input,
     for (const Frame& frame : original_image) {
       ASSIGN_OR_RETURN(avif::ImagePtr yuv,
                        ArgbBufferToAvifImage(
-                           frame.pixels, lossless,
+                           frame.pixels, bit_depth, lossless,
                            input.codec_settings.chroma_subsampling, quiet));
       CHECK_OR_RETURN(
           avifEncoderAddImage(encoder.get(), yuv.get(), frame.duration_ms,
@@ -206,9 +309,11 @@ StatusOr<WP2::Data> EncodeAvifImpl(const TaskInput& input,
 StatusOr<std::pair<Image, double>> DecodeAvifImpl(
     const TaskInput& input, const WP2::Data& encoded_image, bool avm,
     bool quiet) {
+  const Timer decoding_duration;
   avif::DecoderPtr decoder(avifDecoderCreate());
   CHECK_OR_RETURN(decoder != nullptr, quiet);
   decoder->codecChoice = avm ? AVIF_CODEC_CHOICE_AVM : AVIF_CODEC_CHOICE_AUTO;
+  decoder->maxThreads = static_cast<int>(input.codec_settings.num_threads);
 
   CHECK_OR_RETURN(avifDecoderSetIOMemory(decoder.get(), encoded_image.bytes,
                                          encoded_image.size) == AVIF_RESULT_OK,
@@ -233,6 +338,7 @@ StatusOr<std::pair<Image, double>> DecodeAvifImpl(
             ? 0
             : static_cast<uint32_t>(decoder->imageTiming.durationInTimescales);
     image.emplace_back(std::move(buffer), duration_ms);
+    image.back().decoded_after = decoding_duration.seconds();
   }
   return std::pair<Image, double>(std::move(image), color_conversion_duration);
 }
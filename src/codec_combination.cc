@@ -90,10 +90,12 @@ StatusOr<WP2::Data> EncodeCodecCombination(const TaskInput& input,
 
   WP2::Data data;
   for (int i = 0; i < kMaxNumCodecs; ++i) {
-    const TaskInput specialized_input = {
+    TaskInput specialized_input = {
         {combination[i].codec, input.codec_settings.chroma_subsampling,
          combination[i].effort, input.codec_settings.quality},
         input.image_path};
+    specialized_input.codec_settings.num_threads =
+        input.codec_settings.num_threads;
     if (specialized_input.codec_settings.effort == kNone.effort) break;
 
     using std::swap;
@@ -15,6 +15,7 @@
 #include "src/codec_jpegturbo.h"
 
 #include <cstdint>
+#include <memory>
 #include <numeric>
 #include <string>
 #include <utility>
@@ -24,6 +25,8 @@
 #include "src/frame.h"
 #include "src/serialization.h"
 #include "src/task.h"
+#include "src/timer.h"
+#include "src/yuv.h"
 
 #if defined(HAS_WEBP2)
 #include "third_party/libwebp2/src/wp2/base.h"
@@ -50,17 +53,113 @@ std::vector<int> JpegturboLossyQualities() {
   return qualities;
 }
 
+bool JpegturboSupportsLossless() {
+#if defined(HAS_JPEGTURBO) && defined(TJ_NUMINIT)
+  return true;
+#else
+  return false;
+#endif
+}
+
 #if defined(HAS_WEBP2)
 
 #if defined(HAS_JPEGTURBO)
 
 constexpr int kPitch = 0;
 
+#if defined(TJ_NUMINIT)  // TurboJPEG 3 API.
+
+namespace {
+
+// Lossless JPEG is RGB 4:4:4 at the precision of the samples.
+StatusOr<WP2::Data> EncodeJpegturboLossless(const WP2::ArgbBuffer& pixels,
+                                            bool quiet) {
+  const tjhandle handle = tj3Init(TJINIT_COMPRESS);
+  CHECK_OR_RETURN(handle != nullptr, quiet) << "tj3Init() failed";
+  int result = tj3Set(handle, TJPARAM_LOSSLESS, 1);
+  if (result == 0) result = tj3Set(handle, TJPARAM_SUBSAMP, TJSAMP_444);
+  unsigned char* compressed_image = nullptr;
+  size_t compressed_num_bytes = 0;
+  if (result == 0 && WP2Formatbpc(pixels.format()) == 16) {
+    result = tj3Compress16(
+        handle, pixels.GetRow16(0), static_cast<int>(pixels.width()),
+        static_cast<int>(pixels.stride() / sizeof(uint16_t)),
+        static_cast<int>(pixels.height()), TJPF_RGB, &compressed_image,
+        &compressed_num_bytes);
+  } else if (result == 0) {
+    result = tj3Compress8(handle, pixels.GetRow8(0),
+                          static_cast<int>(pixels.width()),
+                          static_cast<int>(pixels.stride()),
+                          static_cast<int>(pixels.height()), TJPF_RGB,
+                          &compressed_image, &compressed_num_bytes);
+  }
+  const std::string error = result == 0 ? "" : tj3GetErrorStr(handle);
+  tj3Destroy(handle);
+  CHECK_OR_RETURN(result == 0, quiet)
+      << "Lossless JPEG compression failed: " << error;
+  WP2::Data data;
+  data.bytes = compressed_image;
+  data.size = compressed_num_bytes;
+  return data;
+}
+
+StatusOr<WP2::ArgbBuffer> DecodeJpegturboLossless(
+    const WP2::Data& encoded_image, bool quiet) {
+  const tjhandle handle = tj3Init(TJINIT_DECOMPRESS);
+  CHECK_OR_RETURN(handle != nullptr, quiet) << "tj3Init() (dec) failed";
+  int result =
+      tj3DecompressHeader(handle, encoded_image.bytes, encoded_image.size);
+  const int precision = tj3Get(handle, TJPARAM_PRECISION);
+  WP2::ArgbBuffer pixels(precision > 8 ? WP2_RGB_48 : WP2_RGB_24);
+  if (result == 0 &&
+      pixels.Resize(static_cast<uint32_t>(tj3Get(handle, TJPARAM_JPEGWIDTH)),
+                    static_cast<uint32_t>(tj3Get(
+                        handle, TJPARAM_JPEGHEIGHT))) != WP2_STATUS_OK) {
+    result = -1;
+  }
+  if (result == 0 && precision == 16) {
+    result = tj3Decompress16(
+        handle, encoded_image.bytes, encoded_image.size, pixels.GetRow16(0),
+        static_cast<int>(pixels.stride() / sizeof(uint16_t)), TJPF_RGB);
+  } else if (result == 0 && precision == 8) {
+    result = tj3Decompress8(handle, encoded_image.bytes, encoded_image.size,
+                            pixels.GetRow8(0),
+                            static_cast<int>(pixels.stride()), TJPF_RGB);
+  } else if (result == 0) {
+    result = -1;  // Not written by EncodeJpegturboLossless().
+  }
+  const std::string error = result == 0 ? "" : tj3GetErrorStr(handle);
+  tj3Destroy(handle);
+  CHECK_OR_RETURN(result == 0, quiet)
+      << "Lossless JPEG decompression failed: " << error << " (precision "
+      << precision << ")";
+  return pixels;
+}
+
+}  // namespace
+
+#endif  // TJ_NUMINIT
+
 StatusOr<WP2::Data> EncodeJpegturbo(const TaskInput& input,
                                     const Image& original_image, bool quiet) {
   CHECK_OR_RETURN(original_image.size() == 1, quiet);
   const WP2::ArgbBuffer& pixels = original_image.front().pixels;
   CHECK_OR_RETURN(input.codec_settings.effort == 0, quiet);
+  if (input.codec_settings.quality == kQualityLossless) {
+#if defined(TJ_NUMINIT)
+    CHECK_OR_RETURN(
+        pixels.format() == WP2_RGB_24 || pixels.format() == WP2_RGB_48, quiet);
+    CHECK_OR_RETURN(
+        input.codec_settings.chroma_subsampling == Subsampling::kDefault ||
+            input.codec_settings.chroma_subsampling == Subsampling::k444,
+        quiet)
+        << "Lossless JPEG does not support chroma subsampling "
+        << SubsamplingToString(input.codec_settings.chroma_subsampling);
+    return EncodeJpegturboLossless(pixels, quiet);
+#else
+    CHECK_OR_RETURN(false, quiet) << "Lossless JPEG requires libjpeg-turbo 3";
+#endif
+  }
   CHECK_OR_RETURN(pixels.format() == WP2_RGB_24, quiet);
   TJSAMP chroma_subsampling;
   if (input.codec_settings.chroma_subsampling == Subsampling::kDefault ||
@@ -79,12 +178,34 @@ StatusOr<WP2::Data> EncodeJpegturbo(const TaskInput& input,
 
   const tjhandle handle = tjInitCompress();
   CHECK_OR_RETURN(handle != nullptr, quiet) << "tjInitCompress() failed";
-  int result =
-      tjCompress2(handle, pixels.GetRow8(0), static_cast<int>(pixels.width()),
-                  kPitch, static_cast<int>(pixels.height()), TJPF_RGB,
-                  &compressed_image, &compressed_num_bytes, chroma_subsampling,
-                  input.codec_settings.quality, TJFLAG_FASTDCT);
-  CHECK_OR_RETURN(result == 0, quiet) << "tjCompress2() failed with " << result;
+  const YuvImage* yuv = original_image.front().yuv.get();
+  int result;
+  // JPEG stores 8-bit full-range BT.601 samples, so such video frame grabs can
+  // skip the RGB round trip.
+  if (yuv != nullptr && yuv->bit_depth == 8 && yuv->full_range &&
+      (yuv->subsampling == Subsampling::k444) ==
+          (chroma_subsampling == TJSAMP_444)) {
+    const unsigned char* planes[3];
+    int strides[3];
+    for (int p = 0; p < 3; ++p) {
+      planes[p] = yuv->planes[p].data();
+      strides[p] = static_cast<int>(yuv->RowBytes(p));
+    }
+    result = tjCompressFromYUVPlanes(
+        handle, planes, static_cast<int>(yuv->width), strides,
+        static_cast<int>(yuv->height), chroma_subsampling, &compressed_image,
+        &compressed_num_bytes, input.codec_settings.quality, TJFLAG_FASTDCT);
+    CHECK_OR_RETURN(result == 0, quiet)
+        << "tjCompressFromYUVPlanes() failed with " << result;
+  } else {
+    result = tjCompress2(
+        handle, pixels.GetRow8(0), static_cast<int>(pixels.width()), kPitch,
+        static_cast<int>(pixels.height()), TJPF_RGB, &compressed_image,
+        &compressed_num_bytes, chroma_subsampling, input.codec_settings.quality,
+        TJFLAG_FASTDCT);
+    CHECK_OR_RETURN(result == 0, quiet)
+        << "tjCompress2() failed with " << result;
+  }
   result = tjDestroy(handle);
   CHECK_OR_RETURN(result == 0, quiet) << "tjDestroy() failed with " << result;
   // tjFree(compressed_image); // Data is moved instead.
@@ -94,8 +215,61 @@ StatusOr<WP2::Data> EncodeJpegturbo(const TaskInput& input,
   return data;
 }
 
+StatusOr<Image> JpegturboYuv(const Image& image, Subsampling subsampling,
+                             bool quiet) {
+  CHECK_OR_RETURN(image.size() == 1, quiet);
+  CHECK_OR_RETURN(
+      subsampling == Subsampling::k420 || subsampling == Subsampling::k444,
+      quiet);
+  const Timer conversion_duration;
+  ASSIGN_OR_RETURN(const Image rgb, CloneAs(image, WP2_RGB_24, quiet));
+  const WP2::ArgbBuffer& pixels = rgb.front().pixels;
+  auto yuv = std::make_shared<YuvImage>();
+  yuv->width = pixels.width();
+  yuv->height = pixels.height();
+  yuv->bit_depth = 8;
+  yuv->subsampling = subsampling;
+  yuv->full_range = true;
+  unsigned char* planes[3];
+  int strides[3];
+  for (int p = 0; p < 3; ++p) {
+    yuv->planes[p].resize(static_cast<size_t>(yuv->RowBytes(p)) *
+                          yuv->PlaneHeight(p));
+    planes[p] = yuv->planes[p].data();
+    strides[p] = static_cast<int>(yuv->RowBytes(p));
+  }
+
+  const tjhandle handle = tjInitCompress();
+  CHECK_OR_RETURN(handle != nullptr, quiet) << "tjInitCompress() failed";
+  // Same conversion and downsampling as tjCompress2() in EncodeJpegturbo().
+  int result = tjEncodeYUVPlanes(
+      handle, pixels.GetRow8(0), static_cast<int>(pixels.width()),
+      static_cast<int>(pixels.stride()), static_cast<int>(pixels.height()),
+      TJPF_RGB, planes, strides,
+      subsampling == Subsampling::k444 ? TJSAMP_444 : TJSAMP_420,
+      TJFLAG_FASTDCT);
+  tjDestroy(handle);
+  CHECK_OR_RETURN(result == 0, quiet)
+      << "tjEncodeYUVPlanes() failed with " << result;
+  yuv->conversion_duration = conversion_duration.seconds();
+
+  Image converted;
+  converted.emplace_back(WP2::ArgbBuffer(WP2_RGB_24), /*duration_ms=*/0);
+  converted.back().yuv = std::move(yuv);
+  return converted;
+}
+
 StatusOr<std::pair<Image, double>> DecodeJpegturbo(
     const TaskInput& input, const WP2::Data& encoded_image, bool quiet) {
+#if defined(TJ_NUMINIT)
+  if (input.codec_settings.quality == kQualityLossless) {
+    Image image;
+    ASSIGN_OR_RETURN(WP2::ArgbBuffer pixels,
+                     DecodeJpegturboLossless(encoded_image, quiet));
+    image.emplace_back(std::move(pixels), /*duration_ms=*/0);
+    return std::pair<Image, double>(std::move(image), 0);
+  }
+#endif
   int jpegSubsamp, width, height;
 
   const tjhandle handle = tjInitDecompress();
@@ -139,6 +313,9 @@ StatusOr<std::pair<Image, double>> DecodeJpegturbo(const TaskInput&,
                                                    bool quiet) {
   CHECK_OR_RETURN(false, quiet) << "Decoding images requires HAS_JPEGTURBO";
 }
+StatusOr<Image> JpegturboYuv(const Image&, Subsampling, bool quiet) {
+  CHECK_OR_RETURN(false, quiet) << "Converting images requires HAS_JPEGTURBO";
+}
 #endif  // HAS_JPEGTURBO
 
 #endif  // HAS_WEBP2
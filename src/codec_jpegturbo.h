@@ -33,11 +33,22 @@ std::string JpegturboVersion();
 
 std::vector<int> JpegturboLossyQualities();
 
+// Returns true if libjpeg-turbo was built with the TurboJPEG 3 API, which
+// encodes lossless JPEG with up to 16 bits per sample.
+bool JpegturboSupportsLossless();
+
 #if defined(HAS_WEBP2)
 StatusOr<WP2::Data> EncodeJpegturbo(const TaskInput& input,
                                     const Image& original_image, bool quiet);
 StatusOr<std::pair<Image, double>> DecodeJpegturbo(
     const TaskInput& input, const WP2::Data& encoded_image, bool quiet);
+
+// Returns a frame whose Frame::yuv holds the full-range Y'CbCr samples that
+// EncodeJpegturbo() would compute from the RGB samples of the still image.
+// Encoding that frame skips the conversion, so it can be shared by all
+// qualities. The pixels of the returned frame are left empty.
+StatusOr<Image> JpegturboYuv(const Image& image, Subsampling subsampling,
+                             bool quiet);
 #endif  // HAS_WEBP2
 
 }  // namespace codec_compare_gen
@@ -38,6 +38,8 @@
 #include "third_party/libjxl/lib/include/jxl/decode_cxx.h"
 #include "third_party/libjxl/lib/include/jxl/encode.h"
 #include "third_party/libjxl/lib/include/jxl/encode_cxx.h"
+#include "third_party/libjxl/lib/include/jxl/thread_parallel_runner.h"
+#include "third_party/libjxl/lib/include/jxl/thread_parallel_runner_cxx.h"
 #include "third_party/libjxl/lib/include/jxl/types.h"
 #endif
 
@@ -93,9 +95,24 @@ StatusOr<WP2::Data> EncodeJxl(const TaskInput& input,
       quiet)
       << "libjxl only supports 4:4:4 (no chroma subsampling)";
 
+  // Single-threaded by default. The runner must outlive the encoder.
+  JxlThreadParallelRunnerPtr runner;
+  if (input.codec_settings.num_threads > 1) {
+    runner = JxlThreadParallelRunnerMake(nullptr,
+                                         input.codec_settings.num_threads);
+    CHECK_OR_RETURN(runner != nullptr, quiet)
+        << "JxlThreadParallelRunnerMake() failed";
+  }
   const JxlEncoderPtr encoder = JxlEncoderMake(nullptr);
   CHECK_OR_RETURN(encoder != nullptr, quiet) << "JxlEncoderMake() failed";
-  // Single-threaded by default, no need to call JxlEncoderSetParallelRunner().
+  if (runner != nullptr) {
+    CHECK_OR_RETURN(JxlEncoderSetParallelRunner(encoder.get(),
+                                                JxlThreadParallelRunner,
+                                                runner.get()) ==
+                        JXL_ENC_SUCCESS,
+                    quiet)
+        << "JxlEncoderSetParallelRunner() failed";
+  }
 
   JxlBasicInfo basic_info;
   JxlEncoderInitBasicInfo(&basic_info);
@@ -223,8 +240,25 @@ StatusOr<WP2::Data> EncodeJxl(const TaskInput& input,
 StatusOr<std::pair<Image, double>> DecodeJxl(const TaskInput& input,
                                              const WP2::Data& encoded_image,
                                              bool quiet) {
+  const Timer decoding_duration;
+  // Single-threaded by default. The runner must outlive the decoder.
+  JxlThreadParallelRunnerPtr runner;
+  if (input.codec_settings.num_threads > 1) {
+    runner = JxlThreadParallelRunnerMake(nullptr,
+                                         input.codec_settings.num_threads);
+    CHECK_OR_RETURN(runner != nullptr, quiet)
+        << "JxlThreadParallelRunnerMake() failed";
+  }
   const JxlDecoderPtr decoder = JxlDecoderMake(nullptr);
   CHECK_OR_RETURN(decoder != nullptr, quiet) << "JxlDecoderMake() failed";
+  if (runner != nullptr) {
+    CHECK_OR_RETURN(JxlDecoderSetParallelRunner(decoder.get(),
+                                                JxlThreadParallelRunner,
+                                                runner.get()) ==
+                        JXL_DEC_SUCCESS,
+                    quiet)
+        << "JxlDecoderSetParallelRunner() failed";
+  }
 
   JxlDecoderStatus status = JxlDecoderSubscribeEvents(
       decoder.get(), JXL_DEC_BASIC_INFO | JXL_DEC_FULL_IMAGE);
@@ -289,6 +323,7 @@ StatusOr<std::pair<Image, double>> DecodeJxl(const TaskInput& input,
     CHECK_OR_RETURN(status == JXL_DEC_FULL_IMAGE, quiet)
         << "JxlDecoderProcessInput() unexpectedly returned " << status
         << " instead of JXL_DEC_FULL_IMAGE when decoding " << input.image_path;
+    image.back().decoded_after = decoding_duration.seconds();
   }
   CHECK_OR_RETURN(status == JXL_DEC_SUCCESS, quiet)
       << "Last call to JxlDecoderProcessInput() unexpectedly returned "
@@ -0,0 +1,206 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/codec_plugin.h"
+
+#include <dlfcn.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>  // NOLINT
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/base.h"
+#include "src/codec.h"
+#include "src/codec_plugin_abi.h"
+#include "src/frame.h"
+#include "src/task.h"
+
+#if defined(HAS_WEBP2)
+#include "third_party/libwebp2/src/wp2/base.h"
+#endif
+
+namespace codec_compare_gen {
+
+std::string CodecBuildName(const std::string& path) {
+  if (path.empty()) return "";
+  // "path/to/libccgen_avif_1.1.0.so" becomes "libccgen_avif_1.1.0".
+  return std::filesystem::path(path).stem().string();
+}
+
+namespace {
+
+void* OpenSharedLibrary(const std::string& path) {
+#if defined(__GLIBC__)
+  // A new link map isolates all the dependencies of the plugin, even the ones
+  // sharing a SONAME with a library already loaded by the process.
+  return dlmopen(LM_ID_NEWLM, path.c_str(), RTLD_NOW | RTLD_LOCAL);
+#elif defined(RTLD_DEEPBIND)
+  return dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL | RTLD_DEEPBIND);
+#else
+  return dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+#endif
+}
+
+}  // namespace
+
+StatusOr<const CcgenCodecPlugin*> LoadCodecPlugin(const std::string& path,
+                                                  bool quiet) {
+  static std::mutex mutex;
+  static std::map<std::string, const CcgenCodecPlugin*> plugins;
+  std::lock_guard<std::mutex> lock(mutex);
+  const auto it = plugins.find(path);
+  if (it != plugins.end()) {
+    const CcgenCodecPlugin* plugin = it->second;
+    return plugin;
+  }
+
+  void* library = OpenSharedLibrary(path);
+  CHECK_OR_RETURN(library != nullptr, quiet)
+      << "Could not load codec plugin " << path << ": " << dlerror();
+  const auto get_plugin = reinterpret_cast<CcgenGetCodecPluginFunc>(
+      dlsym(library, CCGEN_PLUGIN_ENTRY_POINT));
+  CHECK_OR_RETURN(get_plugin != nullptr, quiet)
+      << path << " does not export " << CCGEN_PLUGIN_ENTRY_POINT;
+  const CcgenCodecPlugin* loaded_plugin = get_plugin();
+  CHECK_OR_RETURN(loaded_plugin != nullptr, quiet);
+  CHECK_OR_RETURN(loaded_plugin->abi_version == CCGEN_PLUGIN_ABI_VERSION, quiet)
+      << path << " was built for plugin ABI version "
+      << loaded_plugin->abi_version << " instead of "
+      << CCGEN_PLUGIN_ABI_VERSION;
+  CHECK_OR_RETURN(loaded_plugin->version != nullptr &&
+                      loaded_plugin->encode != nullptr &&
+                      loaded_plugin->decode != nullptr &&
+                      loaded_plugin->release != nullptr,
+                  quiet)
+      << path << " is missing plugin functions";
+  plugins[path] = loaded_plugin;
+  return loaded_plugin;
+}
+
+StatusOr<std::string> CodecPluginVersion(const std::string& path, Codec codec,
+                                         bool quiet) {
+  ASSIGN_OR_RETURN(const CcgenCodecPlugin* plugin,
+                   LoadCodecPlugin(path, quiet));
+  const char* version = plugin->version(static_cast<int>(codec));
+  CHECK_OR_RETURN(version != nullptr, quiet)
+      << path << " does not support " << CodecName(codec);
+  return std::string(version);
+}
+
+#if defined(HAS_WEBP2)
+
+namespace {
+
+CcgenPluginSettings ToPluginSettings(const TaskInput& input, bool quiet) {
+  CcgenPluginSettings settings;
+  settings.codec = static_cast<int>(input.codec_settings.codec);
+  settings.chroma_subsampling =
+      static_cast<int>(input.codec_settings.chroma_subsampling);
+  settings.effort = input.codec_settings.effort;
+  settings.quality = input.codec_settings.quality;
+  settings.num_threads = static_cast<int>(input.codec_settings.num_threads);
+  settings.image_path = input.image_path.c_str();
+  settings.quiet = quiet ? 1 : 0;
+  return settings;
+}
+
+// Calls CcgenCodecPlugin::release() when going out of scope.
+class PluginHandle {
+ public:
+  explicit PluginHandle(const CcgenCodecPlugin* plugin) : plugin_(plugin) {}
+  ~PluginHandle() {
+    if (handle_ != nullptr) plugin_->release(handle_);
+  }
+  void** get() { return &handle_; }
+
+ private:
+  const CcgenCodecPlugin* const plugin_;
+  void* handle_ = nullptr;
+};
+
+}  // namespace
+
+StatusOr<std::pair<WP2::Data, double>> EncodeWithPlugin(
+    const TaskInput& input, const Image& original_image, bool quiet) {
+  ASSIGN_OR_RETURN(const CcgenCodecPlugin* plugin,
+                   LoadCodecPlugin(input.codec_settings.build, quiet));
+  const CcgenPluginSettings settings = ToPluginSettings(input, quiet);
+
+  // The plugin only gets a view of the pixels.
+  std::vector<CcgenPluginFrame> frames;
+  frames.reserve(original_image.size());
+  for (const Frame& frame : original_image) {
+    frames.push_back(
+        {frame.pixels.width(), frame.pixels.height(), frame.pixels.stride(),
+         static_cast<int>(frame.pixels.format()), frame.duration_ms,
+         reinterpret_cast<const uint8_t*>(frame.pixels.GetRow(0))});
+  }
+
+  PluginHandle handle(plugin);
+  const uint8_t* encoded = nullptr;
+  size_t encoded_size = 0;
+  double duration = 0;
+  CHECK_OR_RETURN(plugin->encode(&settings, frames.data(), frames.size(),
+                                 handle.get(), &encoded, &encoded_size,
+                                 &duration) == 0,
+                  quiet)
+      << "Codec plugin " << input.codec_settings.build << " failed to encode "
+      << input.image_path;
+  WP2::Data data;
+  CHECK_OR_RETURN(data.CopyFrom(encoded, encoded_size) == WP2_STATUS_OK, quiet);
+  return std::make_pair(std::move(data), duration);
+}
+
+StatusOr<PluginDecodedImage> DecodeWithPlugin(const TaskInput& input,
+                                              const WP2::Data& encoded_image,
+                                              bool quiet) {
+  ASSIGN_OR_RETURN(const CcgenCodecPlugin* plugin,
+                   LoadCodecPlugin(input.codec_settings.build, quiet));
+  const CcgenPluginSettings settings = ToPluginSettings(input, quiet);
+
+  PluginHandle handle(plugin);
+  const CcgenPluginFrame* frames = nullptr;
+  size_t num_frames = 0;
+  PluginDecodedImage decoded;
+  CHECK_OR_RETURN(
+      plugin->decode(&settings, encoded_image.bytes, encoded_image.size,
+                     handle.get(), &frames, &num_frames, &decoded.duration,
+                     &decoded.color_conversion_duration) == 0,
+      quiet)
+      << "Codec plugin " << input.codec_settings.build << " failed to decode "
+      << input.image_path;
+
+  // The pixels belong to the plugin. Copy them before releasing the handle.
+  decoded.image.reserve(num_frames);
+  for (size_t i = 0; i < num_frames; ++i) {
+    const CcgenPluginFrame& frame = frames[i];
+    CHECK_OR_RETURN(frame.format >= 0 && frame.format < WP2_FORMAT_NUM, quiet);
+    const WP2SampleFormat format = static_cast<WP2SampleFormat>(frame.format);
+    decoded.image.emplace_back(WP2::ArgbBuffer(format), frame.duration_ms);
+    CHECK_OR_RETURN(decoded.image.back().pixels.Import(
+                        format, frame.width, frame.height, frame.pixels,
+                        frame.stride) == WP2_STATUS_OK,
+                    quiet);
+  }
+  return decoded;
+}
+
+#endif  // HAS_WEBP2
+
+}  // namespace codec_compare_gen
@@ -0,0 +1,68 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_CODEC_PLUGIN_H_
+#define SRC_CODEC_PLUGIN_H_
+
+#include <string>
+#include <utility>
+
+#include "src/base.h"
+#include "src/codec_plugin_abi.h"
+#include "src/frame.h"
+#include "src/task.h"
+
+#if defined(HAS_WEBP2)
+#include "third_party/libwebp2/src/wp2/base.h"
+#endif
+
+namespace codec_compare_gen {
+
+// Codec plugins are shared libraries built from codec_plugin_entry.cc against
+// another version of a codec library. They are used to compare two builds of
+// the same codec in a single run, on the same tasks and under the same load.
+
+// Returns a short name identifying the build at path, for file names and logs.
+// Returns an empty string for an empty path (the codec linked to libccgen).
+std::string CodecBuildName(const std::string& path);
+
+// Loads the plugin at path, once per process. Each plugin gets its own symbol
+// namespace when possible, so that it does not resolve its codec library
+// symbols to the copy linked to libccgen, nor to the copy of another plugin.
+// Plugins are never unloaded.
+StatusOr<const CcgenCodecPlugin*> LoadCodecPlugin(const std::string& path,
+                                                  bool quiet);
+
+StatusOr<std::string> CodecPluginVersion(const std::string& path, Codec codec,
+                                         bool quiet);
+
+#if defined(HAS_WEBP2)
+// Returns the encoded image and the encoding duration measured by the plugin.
+StatusOr<std::pair<WP2::Data, double>> EncodeWithPlugin(
+    const TaskInput& input, const Image& original_image, bool quiet);
+
+struct PluginDecodedImage {
+  Image image;
+  double duration;                   // in seconds, color conversion inclusive
+  double color_conversion_duration;  // in seconds
+};
+// Returns the decoded image and the durations measured by the plugin.
+StatusOr<PluginDecodedImage> DecodeWithPlugin(const TaskInput& input,
+                                              const WP2::Data& encoded_image,
+                                              bool quiet);
+#endif  // HAS_WEBP2
+
+}  // namespace codec_compare_gen
+
+#endif  // SRC_CODEC_PLUGIN_H_
@@ -0,0 +1,80 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// C interface between ccgen and codec plugins, which are shared libraries
+// wrapping another build of a codec library (see codec_plugin_entry.cc).
+// Only plain C types cross this boundary because a plugin is loaded in its own
+// link map, with its own copies of libwebp2 and of the C++ runtime.
+
+#ifndef SRC_CODEC_PLUGIN_ABI_H_
+#define SRC_CODEC_PLUGIN_ABI_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CCGEN_PLUGIN_ABI_VERSION 2
+#define CCGEN_PLUGIN_ENTRY_POINT "CcgenGetCodecPlugin"
+
+typedef struct {
+  int codec;               // codec_compare_gen::Codec
+  int chroma_subsampling;  // codec_compare_gen::Subsampling
+  int effort;
+  int quality;
+  int num_threads;         // Given to the codec library, per image.
+  const char* image_path;  // For logs.
+  int quiet;
+} CcgenPluginSettings;
+
+typedef struct {
+  uint32_t width;   // in pixels
+  uint32_t height;  // in pixels
+  uint32_t stride;  // in bytes
+  int format;       // WP2SampleFormat
+  uint32_t duration_ms;
+  const uint8_t* pixels;
+} CcgenPluginFrame;
+
+typedef struct {
+  uint32_t abi_version;  // CCGEN_PLUGIN_ABI_VERSION
+  // Returns the version of the wrapped library or null if codec is unknown.
+  const char* (*version)(int codec);
+  // Encodes the frames. Returns 0 on success. On success, *handle must be
+  // given to release() once *encoded is not needed anymore. *duration is the
+  // encoding duration in seconds.
+  int (*encode)(const CcgenPluginSettings* settings,
+                const CcgenPluginFrame* frames, size_t num_frames,
+                void** handle, const uint8_t** encoded, size_t* encoded_size,
+                double* duration);
+  // Decodes the bitstream. Returns 0 on success. On success, *handle must be
+  // given to release() once *frames is not needed anymore. *duration is the
+  // decoding duration in seconds, color conversion inclusive.
+  int (*decode)(const CcgenPluginSettings* settings, const uint8_t* encoded,
+                size_t encoded_size, void** handle,
+                const CcgenPluginFrame** frames, size_t* num_frames,
+                double* duration, double* color_conversion_duration);
+  void (*release)(void* handle);
+} CcgenCodecPlugin;
+
+// Exported by each plugin under the name CCGEN_PLUGIN_ENTRY_POINT.
+typedef const CcgenCodecPlugin* (*CcgenGetCodecPluginFunc)(void);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // SRC_CODEC_PLUGIN_ABI_H_
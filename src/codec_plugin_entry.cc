@@ -0,0 +1,202 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Entry point of a codec plugin. This file is not part of libccgen. It is built
+// together with the codec_*.cc files of the wrapped codec library into a shared
+// library loaded by LoadCodecPlugin(). See CMakeLists.txt.
+
+#if !defined(HAS_WEBP2)
+#error "Codec plugins require HAS_WEBP2"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/base.h"
+#include "src/codec_avif.h"
+#include "src/codec_jpegxl.h"
+#include "src/codec_plugin_abi.h"
+#include "src/codec_webp.h"
+#include "src/frame.h"
+#include "src/task.h"
+#include "src/timer.h"
+#include "third_party/libwebp2/src/wp2/base.h"
+
+namespace codec_compare_gen {
+namespace {
+
+constexpr int kNumCodecs = static_cast<int>(Codec::kJpegmoz) + 1;
+
+using EncodeFunc = StatusOr<WP2::Data> (*)(const TaskInput&, const Image&,
+                                           bool);
+using DecodeFunc = StatusOr<std::pair<Image, double>> (*)(const TaskInput&,
+                                                          const WP2::Data&,
+                                                          bool);
+
+struct PluginCodec {
+  std::string version;  // Empty if the codec is not part of this plugin.
+  EncodeFunc encode = nullptr;
+  DecodeFunc decode = nullptr;
+};
+
+const PluginCodec& GetPluginCodec(int codec) {
+  static const std::vector<PluginCodec>* const codecs = [] {
+    auto* codecs = new std::vector<PluginCodec>(kNumCodecs);
+    [[maybe_unused]] auto add = [&](Codec codec, std::string version,
+                                    EncodeFunc encode, DecodeFunc decode) {
+      (*codecs)[static_cast<int>(codec)] = {std::move(version), encode, decode};
+    };
+#if defined(HAS_AVIF)
+    add(Codec::kAvif, AvifVersion(), &EncodeAvif, &DecodeAvif);
+    add(Codec::kSlimAvif, AvifVersion() + "_mini", &EncodeSlimAvif,
+        &DecodeAvif);
+#if defined(HAS_AVIF_AVM)
+    // Only if the wrapped libavif was built with AVIF_CODEC_AVM.
+    add(Codec::kSlimAvifAvm, AvifVersion() + "_mini_avm", &EncodeSlimAvifAvm,
+        &DecodeAvifAvm);
+#endif
+#endif
+#if defined(HAS_JPEGXL)
+    add(Codec::kJpegXl, JpegXLVersion(), &EncodeJxl, &DecodeJxl);
+#endif
+#if defined(HAS_WEBP)
+    add(Codec::kWebp, WebpVersion(), &EncodeWebp, &DecodeWebp);
+#endif
+    return codecs;
+  }();
+  static const PluginCodec kNone;
+  return codec >= 0 && codec < kNumCodecs ? (*codecs)[codec] : kNone;
+}
+
+TaskInput ToTaskInput(const CcgenPluginSettings& settings) {
+  TaskInput input;
+  input.codec_settings.codec = static_cast<Codec>(settings.codec);
+  input.codec_settings.chroma_subsampling =
+      static_cast<Subsampling>(settings.chroma_subsampling);
+  input.codec_settings.effort = settings.effort;
+  input.codec_settings.quality = settings.quality;
+  input.codec_settings.num_threads =
+      static_cast<uint32_t>(settings.num_threads);
+  input.image_path = settings.image_path;
+  return input;
+}
+
+// Owns what is returned by Encode() or Decode() until Release().
+struct Handle {
+  virtual ~Handle() = default;
+};
+
+struct EncodedHandle : public Handle {
+  WP2::Data data;
+};
+
+struct DecodedHandle : public Handle {
+  Image image;
+  std::vector<CcgenPluginFrame> frames;
+};
+
+const char* Version(int codec) {
+  const PluginCodec& plugin_codec = GetPluginCodec(codec);
+  return plugin_codec.version.empty() ? nullptr : plugin_codec.version.c_str();
+}
+
+int Encode(const CcgenPluginSettings* settings, const CcgenPluginFrame* frames,
+           size_t num_frames, void** handle, const uint8_t** encoded,
+           size_t* encoded_size, double* duration) {
+  const PluginCodec& plugin_codec = GetPluginCodec(settings->codec);
+  if (plugin_codec.encode == nullptr) return 1;
+  const bool quiet = settings->quiet != 0;
+
+  // Wrap the pixels owned by the caller.
+  Image image;
+  image.reserve(num_frames);
+  for (size_t i = 0; i < num_frames; ++i) {
+    const CcgenPluginFrame& frame = frames[i];
+    image.emplace_back(
+        WP2::ArgbBuffer(static_cast<WP2SampleFormat>(frame.format)),
+        frame.duration_ms);
+    if (image.back().pixels.SetExternal(
+            frame.width, frame.height, const_cast<uint8_t*>(frame.pixels),
+            frame.stride) != WP2_STATUS_OK) {
+      return 1;
+    }
+  }
+
+  const Timer timer;
+  StatusOr<WP2::Data> data =
+      plugin_codec.encode(ToTaskInput(*settings), image, quiet);
+  *duration = timer.seconds();
+  if (data.status != Status::kOk) return 1;
+
+  auto* encoded_handle = new EncodedHandle;
+  encoded_handle->data = std::move(data.value);
+  *handle = static_cast<Handle*>(encoded_handle);
+  *encoded = encoded_handle->data.bytes;
+  *encoded_size = encoded_handle->data.size;
+  return 0;
+}
+
+int Decode(const CcgenPluginSettings* settings, const uint8_t* encoded,
+           size_t encoded_size, void** handle, const CcgenPluginFrame** frames,
+           size_t* num_frames, double* duration,
+           double* color_conversion_duration) {
+  const PluginCodec& plugin_codec = GetPluginCodec(settings->codec);
+  if (plugin_codec.decode == nullptr) return 1;
+  const bool quiet = settings->quiet != 0;
+
+  WP2::Data data;
+  if (data.CopyFrom(encoded, encoded_size) != WP2_STATUS_OK) return 1;
+
+  const Timer timer;
+  StatusOr<std::pair<Image, double>> image =
+      plugin_codec.decode(ToTaskInput(*settings), data, quiet);
+  *duration = timer.seconds();
+  if (image.status != Status::kOk) return 1;
+
+  auto* decoded_handle = new DecodedHandle;
+  decoded_handle->image = std::move(image.value.first);
+  *color_conversion_duration = image.value.second;
+  for (const Frame& frame : decoded_handle->image) {
+    decoded_handle->frames.push_back(
+        {frame.pixels.width(), frame.pixels.height(), frame.pixels.stride(),
+         static_cast<int>(frame.pixels.format()), frame.duration_ms,
+         reinterpret_cast<const uint8_t*>(frame.pixels.GetRow(0))});
+  }
+  *handle = static_cast<Handle*>(decoded_handle);
+  *frames = decoded_handle->frames.data();
+  *num_frames = decoded_handle->frames.size();
+  return 0;
+}
+
+void Release(void* handle) { delete static_cast<Handle*>(handle); }
+
+}  // namespace
+}  // namespace codec_compare_gen
+
+extern "C" {
+
+// Must match CCGEN_PLUGIN_ENTRY_POINT.
+__attribute__((visibility("default")))
+const CcgenCodecPlugin* CcgenGetCodecPlugin(void) {
+  static const CcgenCodecPlugin kPlugin = {
+      CCGEN_PLUGIN_ABI_VERSION, &codec_compare_gen::Version,
+      &codec_compare_gen::Encode, &codec_compare_gen::Decode,
+      &codec_compare_gen::Release};
+  return &kPlugin;
+}
+
+}  // extern "C"
@@ -14,6 +14,7 @@
 
 #include "src/codec_webp.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
@@ -27,6 +28,7 @@
 #include "src/frame.h"
 #include "src/task.h"
 #include "src/timer.h"
+#include "src/yuv.h"
 #include "third_party/libwebp/src/webp/mux_types.h"
 
 #if defined(HAS_WEBP2)
@@ -97,6 +99,27 @@ StatusOr<WebPPicture> ArgbBufferToWebPPicture(WP2::ArgbBuffer& buffer,
   return picture;
 }
 
+// Returns a WebPPicture that points to the given 8-bit limited-range 4:2:0
+// samples.
+StatusOr<WebPPicture> YuvImageToWebPPicture(const YuvImage& yuv, bool quiet) {
+  CHECK_OR_RETURN(yuv.bit_depth == 8 && !yuv.full_range &&
+                      yuv.subsampling == Subsampling::k420,
+                  quiet);
+  WebPPicture picture = {};
+  CHECK_OR_RETURN(WebPPictureInit(&picture), quiet);
+  picture.use_argb = 0;
+  picture.colorspace = WEBP_YUV420;
+  picture.width = static_cast<int>(yuv.width);
+  picture.height = static_cast<int>(yuv.height);
+  // Avoid WebPPictureAlloc() and a copy.
+  picture.y = const_cast<uint8_t*>(yuv.planes[0].data());
+  picture.u = const_cast<uint8_t*>(yuv.planes[1].data());
+  picture.v = const_cast<uint8_t*>(yuv.planes[2].data());
+  picture.y_stride = static_cast<int>(yuv.RowBytes(0));
+  picture.uv_stride = static_cast<int>(yuv.RowBytes(1));
+  return picture;
+}
+
 // WebPWriterFunction implementation.
 int WriterFunction(const uint8_t* data, size_t data_size,
                    const WebPPicture* picture) {
@@ -139,17 +162,26 @@ StatusOr<WP2::Data> EncodeWebp(const TaskInput& input,
     config.method = input.codec_settings.effort;
     config.use_sharp_yuv = 1;
   }
-  config.thread_level = 0;
+  // libwebp uses at most one extra thread, in some stages only.
+  config.thread_level = input.codec_settings.num_threads > 1 ? 1 : 0;
 
   const int width = static_cast<int>(original_image.front().pixels.width());
   const int height = static_cast<int>(original_image.front().pixels.height());
 
   if (original_image.size() == 1) {
+    const Frame& frame = original_image.front();
+    // Lossy WebP is 8-bit limited-range 4:2:0, so such samples are encoded as
+    // is. This skips the RGB to YUV conversion otherwise done by WebPEncode().
+    const bool use_yuv = !lossless && frame.yuv != nullptr &&
+                         frame.yuv->bit_depth == 8 && !frame.yuv->full_range &&
+                         frame.yuv->subsampling == Subsampling::k420 &&
+                         !frame.pixels.HasTransparency();
     // Assume WebPEncode() below does not modify the pixels.
-    ASSIGN_OR_RETURN(WebPPicture picture,
-                     ArgbBufferToWebPPicture(const_cast<WP2::ArgbBuffer&>(
-                                                 original_image.front().pixels),
-                                             quiet));
+    ASSIGN_OR_RETURN(
+        WebPPicture picture,
+        use_yuv ? YuvImageToWebPPicture(*frame.yuv, quiet)
+                : ArgbBufferToWebPPicture(
+                      const_cast<WP2::ArgbBuffer&>(frame.pixels), quiet));
     std::unique_ptr<WebPPicture, decltype(&WebPPictureFree)> picture_releaser(
         &picture, WebPPictureFree);
     picture.custom_ptr = &data;
@@ -188,13 +220,55 @@ StatusOr<WP2::Data> EncodeWebp(const TaskInput& input,
   return data;
 }
 
+StatusOr<Image> WebpSharpYuv(const Image& image, bool quiet) {
+  CHECK_OR_RETURN(image.size() == 1, quiet);
+  const Timer conversion_duration;
+  ASSIGN_OR_RETURN(Image argb, CloneAs(image, WebPPictureFormat(), quiet));
+  ASSIGN_OR_RETURN(WebPPicture picture,
+                   ArgbBufferToWebPPicture(argb.front().pixels, quiet));
+  std::unique_ptr<WebPPicture, decltype(&WebPPictureFree)> picture_releaser(
+      &picture, WebPPictureFree);
+  // Same conversion as WebPEncode() with WebPConfig::use_sharp_yuv.
+  CHECK_OR_RETURN(WebPPictureSharpARGBToYUVA(&picture), quiet)
+      << "WebPPictureSharpARGBToYUVA() failed";
+  CHECK_OR_RETURN(picture.colorspace == WEBP_YUV420, quiet)
+      << "Only opaque images are supported";
+
+  auto yuv = std::make_shared<YuvImage>();
+  yuv->width = argb.front().pixels.width();
+  yuv->height = argb.front().pixels.height();
+  yuv->bit_depth = 8;
+  yuv->subsampling = Subsampling::k420;
+  yuv->full_range = false;
+  const uint8_t* const planes[3] = {picture.y, picture.u, picture.v};
+  const int strides[3] = {picture.y_stride, picture.uv_stride,
+                          picture.uv_stride};
+  for (size_t p = 0; p < 3; ++p) {
+    const size_t row_bytes = yuv->RowBytes(p);
+    yuv->planes[p].resize(row_bytes * yuv->PlaneHeight(p));
+    for (uint32_t y = 0; y < yuv->PlaneHeight(p); ++y) {
+      std::copy(planes[p] + y * strides[p],
+                planes[p] + y * strides[p] + row_bytes,
+                yuv->planes[p].data() + y * row_bytes);
+    }
+  }
+  yuv->conversion_duration = conversion_duration.seconds();
+
+  Image converted;
+  converted.emplace_back(WP2::ArgbBuffer(WebPPictureFormat()),
+                         /*duration_ms=*/0);
+  converted.back().yuv = std::move(yuv);
+  return converted;
+}
+
 StatusOr<std::pair<Image, double>> DecodeWebp(const TaskInput& input,
                                               const WP2::Data& encoded_image,
                                               bool quiet) {
+  const Timer decoding_duration;
   WebPAnimDecoderOptions dec_options;
   CHECK_OR_RETURN(WebPAnimDecoderOptionsInit(&dec_options), quiet);
   dec_options.color_mode = MODE_BGRA;
-  dec_options.use_threads = 0;
+  dec_options.use_threads = input.codec_settings.num_threads > 1 ? 1 : 0;
   const WebPData webp_data = {encoded_image.bytes, encoded_image.size};
   std::unique_ptr<WebPAnimDecoder, decltype(&WebPAnimDecoderDelete)> dec(
       WebPAnimDecoderNew(&webp_data, &dec_options), WebPAnimDecoderDelete);
@@ -221,6 +295,7 @@ StatusOr<std::pair<Image, double>> DecodeWebp(const TaskInput& input,
         quiet);
     image.emplace_back(std::move(buffer),
                        static_cast<uint32_t>(timestamp - previous_timestamp));
+    image.back().decoded_after = decoding_duration.seconds();
     previous_timestamp = timestamp;
   }
   return std::pair<Image, double>(std::move(image), 0);
@@ -234,6 +309,9 @@ StatusOr<std::pair<Image, double>> DecodeWebp(const TaskInput&,
                                               const WP2::Data&, bool quiet) {
   CHECK_OR_RETURN(false, quiet) << "Decoding images requires HAS_WEBP";
 }
+StatusOr<Image> WebpSharpYuv(const Image&, bool quiet) {
+  CHECK_OR_RETURN(false, quiet) << "Converting images requires HAS_WEBP";
+}
 #endif  // HAS_WEBP
 
 #endif  // HAS_WEBP2
@@ -42,6 +42,12 @@ StatusOr<WP2::Data> EncodeWebp(const TaskInput& input,
 StatusOr<std::pair<Image, double>> DecodeWebp(const TaskInput& input,
                                               const WP2::Data& encoded_image,
                                               bool quiet);
+
+// Returns a frame whose Frame::yuv holds the limited-range 4:2:0 samples that
+// EncodeWebp() would compute from the RGB samples of the opaque still image
+// for lossy compression. Encoding that frame skips the conversion, so it can
+// be shared by all qualities. The pixels of the returned frame are left empty.
+StatusOr<Image> WebpSharpYuv(const Image& image, bool quiet);
 #endif  // HAS_WEBP2
 
 }  // namespace codec_compare_gen
@@ -26,6 +26,7 @@
 #include "src/framework.h"
 #include "src/serialization.h"
 #include "src/task.h"
+#include "src/timer.h"
 
 #if defined(HAS_WEBP2)
 #include "third_party/libwebp2/src/wp2/base.h"
@@ -86,7 +87,7 @@ StatusOr<WP2::Data> EncodeWebp2(const TaskInput& input,
     config.uv_mode = WP2::EncoderConfig::UVMode444;
   }
   config.effort = input.codec_settings.effort;
-  config.thread_level = 0;
+  config.thread_level = input.codec_settings.num_threads - 1;  // Extra.
   if (original_image.size() == 1) {
     const WP2Status status =
         WP2::Encode(original_image.front().pixels, &writer, config);
@@ -119,8 +120,9 @@ StatusOr<std::pair<Image, double>> DecodeWebp2(const TaskInput& input,
   //         codec_webp2.cc.o:(.data.rel.ro.ArrayDecoderE):
   //         undefined reference to typeinfo for WP2::Decoder
 
+  const Timer decoding_duration;
   WP2::DecoderConfig config;
-  config.thread_level = 0;
+  config.thread_level = input.codec_settings.num_threads - 1;  // Extra.
   WP2::ArrayDecoder decoder(encoded_image.bytes, encoded_image.size, config);
   Image image;
 
@@ -130,6 +132,7 @@ StatusOr<std::pair<Image, double>> DecodeWebp2(const TaskInput& input,
     CHECK_OR_RETURN(
         image.back().pixels.ConvertFrom(decoder.GetPixels()) == WP2_STATUS_OK,
         quiet);
+    image.back().decoded_after = decoding_duration.seconds();
   }
   CHECK_OR_RETURN(decoder.GetStatus() == WP2_STATUS_OK, quiet)
       << "WP2::ArrayDecoder::ReadFrame() failed with \""
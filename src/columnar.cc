@@ -0,0 +1,549 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/columnar.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "src/base.h"
+#include "src/serialization.h"
+#include "src/system_conditions.h"
+#include "src/task.h"
+
+namespace codec_compare_gen {
+
+namespace {
+
+constexpr char kMagic[8] = {'C', 'C', 'G', 'E', 'N', 'C', 'O', 'L'};
+constexpr uint32_t kByteOrderMark = 0x01020304;
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderSize = 40;
+constexpr size_t kColumnNameSize = 32;
+constexpr size_t kColumnDescriptorSize = kColumnNameSize + 16;
+
+size_t ColumnTypeSize(ColumnType type) {
+  switch (type) {
+    case ColumnType::kUint32:
+    case ColumnType::kInt32:
+    case ColumnType::kFloat32:
+      return 4;
+    case ColumnType::kUint64:
+    case ColumnType::kFloat64:
+      return 8;
+  }
+  return 0;
+}
+
+size_t PaddedTo8(size_t size) { return (size + 7) & ~size_t{7}; }
+
+template <typename T>
+void Append(std::vector<uint8_t>& bytes, T value) {
+  const size_t offset = bytes.size();
+  bytes.resize(offset + sizeof(T));
+  std::memcpy(bytes.data() + offset, &value, sizeof(T));
+}
+
+template <typename T>
+T Read(const uint8_t* data) {
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+bool IsLittleEndian() {
+  const uint32_t value = kByteOrderMark;
+  uint8_t first_byte;
+  std::memcpy(&first_byte, &value, 1);
+  return first_byte == 0x04;
+}
+
+struct Column {
+  std::string name;
+  ColumnType type;
+  std::vector<uint8_t> values;
+};
+
+class ColumnsBuilder {
+ public:
+  explicit ColumnsBuilder(const std::vector<TaskOutput>& tasks)
+      : tasks_(tasks) {}
+
+  template <typename T, typename GetValue>
+  void Add(std::string name, GetValue get_value) {
+    columns_.push_back({std::move(name), ColumnTypeOf<T>(), {}});
+    std::vector<uint8_t>& values = columns_.back().values;
+    values.reserve(tasks_.size() * sizeof(T));
+    for (const TaskOutput& task : tasks_) {
+      Append<T>(values, static_cast<T>(get_value(task)));
+    }
+  }
+
+  uint32_t StringIndex(const std::string& str) {
+    const auto [it, inserted] =
+        string_indices_.emplace(str, static_cast<uint32_t>(strings_.size()));
+    if (inserted) strings_.push_back(str);
+    return it->second;
+  }
+
+  const std::vector<Column>& columns() const { return columns_; }
+  const std::vector<std::string>& strings() const { return strings_; }
+
+ private:
+  const std::vector<TaskOutput>& tasks_;
+  std::vector<Column> columns_;
+  std::vector<std::string> strings_;
+  std::unordered_map<std::string, uint32_t> string_indices_;
+};
+
+// The single source of truth of the column names, types and content.
+std::vector<Column> BuildColumns(const std::vector<TaskOutput>& tasks,
+                                 std::vector<std::string>& strings) {
+  ColumnsBuilder builder(tasks);
+  builder.Add<uint32_t>("image", [&](const TaskOutput& task) {
+    return builder.StringIndex(task.task_input.image_path);
+  });
+  builder.Add<uint32_t>("codec", [](const TaskOutput& task) {
+    return task.task_input.codec_settings.codec;
+  });
+  builder.Add<uint32_t>("chroma_subsampling", [](const TaskOutput& task) {
+    return task.task_input.codec_settings.chroma_subsampling;
+  });
+  builder.Add<int32_t>("effort", [](const TaskOutput& task) {
+    return task.task_input.codec_settings.effort;
+  });
+  builder.Add<int32_t>("quality", [](const TaskOutput& task) {
+    return task.task_input.codec_settings.quality;
+  });
+  builder.Add<uint32_t>("build", [&](const TaskOutput& task) {
+    return builder.StringIndex(task.task_input.codec_settings.build);
+  });
+  builder.Add<uint32_t>(
+      "width", [](const TaskOutput& task) { return task.image_width; });
+  builder.Add<uint32_t>(
+      "height", [](const TaskOutput& task) { return task.image_height; });
+  builder.Add<uint32_t>(
+      "depth", [](const TaskOutput& task) { return task.bit_depth; });
+  builder.Add<uint32_t>(
+      "frame_count", [](const TaskOutput& task) { return task.num_frames; });
+  builder.Add<uint64_t>(
+      "encoded_size", [](const TaskOutput& task) { return task.encoded_size; });
+  builder.Add<double>("encoding_time", [](const TaskOutput& task) {
+    return task.encoding_duration;
+  });
+  builder.Add<double>("decoding_time", [](const TaskOutput& task) {
+    return task.decoding_duration;
+  });
+  builder.Add<double>("decoding_color_conversion_time",
+                      [](const TaskOutput& task) {
+                        return task.decoding_color_conversion_duration;
+                      });
+  builder.Add<double>("encoding_color_conversion_time",
+                      [](const TaskOutput& task) {
+                        return task.encoding_color_conversion_duration;
+                      });
+  builder.Add<uint64_t>(
+      "header_size", [](const TaskOutput& task) { return task.header_size; });
+  builder.Add<uint64_t>("metadata_size", [](const TaskOutput& task) {
+    return task.metadata_size;
+  });
+  builder.Add<uint64_t>(
+      "alpha_size", [](const TaskOutput& task) { return task.alpha_size; });
+  builder.Add<double>("first_frame_decoding_time", [](const TaskOutput& task) {
+    return task.first_frame_decoding_duration;
+  });
+  builder.Add<double>("frame_decoding_time_p50", [](const TaskOutput& task) {
+    return task.frame_decoding_duration_p50;
+  });
+  builder.Add<double>("frame_decoding_time_p99", [](const TaskOutput& task) {
+    return task.frame_decoding_duration_p99;
+  });
+  builder.Add<double>("frame_decoding_time_max", [](const TaskOutput& task) {
+    return task.frame_decoding_duration_max;
+  });
+  builder.Add<double>("task_time", [](const TaskOutput& task) {
+    return task.task_duration;
+  });
+  for (size_t m = 0; m < kNumDistortionMetrics; ++m) {
+    builder.Add<float>(
+        DistortionMetricToString(static_cast<DistortionMetric>(m)),
+        [m](const TaskOutput& task) { return task.distortions[m]; });
+  }
+  builder.Add<uint32_t>("approximate", [](const TaskOutput& task) {
+    return task.approximate_distortions ? 1u : 0u;
+  });
+  for (size_t m = 0; m < kNumDistortionMetrics; ++m) {
+    builder.Add<float>(
+        DistortionMetricToString(static_cast<DistortionMetric>(m)) + "_error",
+        [m](const TaskOutput& task) { return task.distortion_errors[m]; });
+  }
+  builder.Add<uint32_t>(
+      "simd_level", [](const TaskOutput& task) { return task.simd_level; });
+  builder.Add<uint32_t>("decode_timing", [](const TaskOutput& task) {
+    return task.decode_timing;
+  });
+  builder.Add<uint32_t>("rendition_width", [](const TaskOutput& task) {
+    return task.task_input.rendition_width;
+  });
+  builder.Add<uint32_t>("system_sampled", [](const TaskOutput& task) {
+    return task.system_conditions.sampled ? 1u : 0u;
+  });
+  builder.Add<float>("cpu_frequency_ratio", [](const TaskOutput& task) {
+    return task.system_conditions.cpu_frequency_ratio;
+  });
+  builder.Add<uint32_t>("run_queue_length", [](const TaskOutput& task) {
+    return task.system_conditions.run_queue_length;
+  });
+  builder.Add<float>("cpu_pressure", [](const TaskOutput& task) {
+    return task.system_conditions.cpu_pressure;
+  });
+  builder.Add<float>("memory_pressure", [](const TaskOutput& task) {
+    return task.system_conditions.memory_pressure;
+  });
+  builder.Add<uint32_t>("thermal_throttles", [](const TaskOutput& task) {
+    return task.system_conditions.num_thermal_throttles;
+  });
+  builder.Add<uint32_t>("abnormal_conditions", [](const TaskOutput& task) {
+    return task.system_conditions.abnormal ? 1u : 0u;
+  });
+  strings = builder.strings();
+  return builder.columns();
+}
+
+}  // namespace
+
+std::vector<std::string> ColumnarColumnNames() {
+  std::vector<std::string> strings;
+  std::vector<std::string> names;
+  for (const Column& column : BuildColumns({}, strings)) {
+    names.push_back(column.name);
+  }
+  return names;
+}
+
+Status TasksToColumnarFile(const std::vector<TaskOutput>& tasks,
+                           const std::string& file_path, bool quiet) {
+  CHECK_OR_RETURN(IsLittleEndian(), quiet)
+      << "Columnar files are only supported on little-endian platforms";
+  std::vector<std::string> strings;
+  const std::vector<Column> columns = BuildColumns(tasks, strings);
+
+  std::vector<uint8_t> header;
+  header.insert(header.end(), kMagic, kMagic + sizeof(kMagic));
+  Append<uint32_t>(header, kByteOrderMark);
+  Append<uint32_t>(header, kVersion);
+  Append<uint64_t>(header, tasks.size());
+  Append<uint32_t>(header, static_cast<uint32_t>(columns.size()));
+  Append<uint32_t>(header, static_cast<uint32_t>(strings.size()));
+  uint64_t offset = kHeaderSize + columns.size() * kColumnDescriptorSize;
+  for (const Column& column : columns) {
+    offset += PaddedTo8(column.values.size());
+  }
+  Append<uint64_t>(header, offset);  // strings_offset
+
+  offset = kHeaderSize + columns.size() * kColumnDescriptorSize;
+  for (const Column& column : columns) {
+    // Names are zero-terminated within their descriptor. See columnar.h.
+    CHECK_OR_RETURN(column.name.size() < kColumnNameSize, quiet)
+        << "Column name " << column.name << " is too long";
+    char name[kColumnNameSize] = {};
+    std::memcpy(name, column.name.data(), column.name.size());
+    header.insert(header.end(), name, name + kColumnNameSize);
+    Append<uint32_t>(header, static_cast<uint32_t>(column.type));
+    Append<uint32_t>(header, 0);
+    Append<uint64_t>(header, offset);
+    offset += PaddedTo8(column.values.size());
+  }
+
+  std::ofstream file(file_path, std::ios::binary | std::ios::trunc);
+  CHECK_OR_RETURN(file.is_open(), quiet)
+      << "Failed to open columnar file at " << file_path << " for writing";
+  const char padding[8] = {};
+  file.write(reinterpret_cast<const char*>(header.data()), header.size());
+  for (const Column& column : columns) {
+    file.write(reinterpret_cast<const char*>(column.values.data()),
+               column.values.size());
+    file.write(padding, PaddedTo8(column.values.size()) - column.values.size());
+  }
+  uint64_t end = 0;
+  for (const std::string& str : strings) {
+    end += str.size();
+    file.write(reinterpret_cast<const char*>(&end), sizeof(end));
+  }
+  for (const std::string& str : strings) file.write(str.data(), str.size());
+  file.close();
+  CHECK_OR_RETURN(!file.fail(), quiet) << "Failed to write " << file_path;
+  return Status::kOk;
+}
+
+//------------------------------------------------------------------------------
+
+ColumnarResults& ColumnarResults::operator=(ColumnarResults&& other) {
+  std::swap(data_, other.data_);
+  std::swap(size_, other.size_);
+  std::swap(num_rows_, other.num_rows_);
+  std::swap(num_columns_, other.num_columns_);
+  std::swap(num_strings_, other.num_strings_);
+  std::swap(string_ends_, other.string_ends_);
+  std::swap(string_chars_, other.string_chars_);
+  return *this;
+}
+
+ColumnarResults::~ColumnarResults() {
+  if (data_ != nullptr) munmap(const_cast<uint8_t*>(data_), size_);
+}
+
+StatusOr<ColumnarResults> ColumnarResults::Open(const std::string& file_path,
+                                                bool quiet) {
+  CHECK_OR_RETURN(IsLittleEndian(), quiet)
+      << "Columnar files are only supported on little-endian platforms";
+  const int fd = open(file_path.c_str(), O_RDONLY);
+  CHECK_OR_RETURN(fd >= 0, quiet)
+      << "Could not open " << file_path << " for reading";
+  struct stat file_stat;
+  const bool has_size = fstat(fd, &file_stat) == 0;
+  const size_t size = has_size ? static_cast<size_t>(file_stat.st_size) : 0;
+  void* data = size >= kHeaderSize
+                   ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)
+                   : MAP_FAILED;
+  close(fd);
+  CHECK_OR_RETURN(data != MAP_FAILED, quiet)
+      << "Could not map " << file_path << " in memory";
+
+  ColumnarResults results;
+  results.data_ = static_cast<const uint8_t*>(data);
+  results.size_ = size;
+  const uint8_t* header = results.data_;
+  CHECK_OR_RETURN(std::memcmp(header, kMagic, sizeof(kMagic)) == 0 &&
+                      Read<uint32_t>(header + 8) == kByteOrderMark,
+                  quiet)
+      << file_path << " is not a columnar file";
+  CHECK_OR_RETURN(Read<uint32_t>(header + 12) == kVersion, quiet)
+      << "Unsupported columnar file version " << Read<uint32_t>(header + 12);
+  results.num_rows_ = Read<uint64_t>(header + 16);
+  results.num_columns_ = Read<uint32_t>(header + 24);
+  results.num_strings_ = Read<uint32_t>(header + 28);
+  const uint64_t strings_offset = Read<uint64_t>(header + 32);
+
+  CHECK_OR_RETURN(
+      kHeaderSize + results.num_columns_ * kColumnDescriptorSize <= size,
+      quiet)
+      << "Truncated columnar file " << file_path;
+  for (size_t c = 0; c < results.num_columns_; ++c) {
+    const uint8_t* descriptor =
+        header + kHeaderSize + c * kColumnDescriptorSize;
+    const ColumnType type =
+        static_cast<ColumnType>(Read<uint32_t>(descriptor + kColumnNameSize));
+    const uint64_t offset = Read<uint64_t>(descriptor + kColumnNameSize + 8);
+    const size_t type_size = ColumnTypeSize(type);
+    CHECK_OR_RETURN(type_size != 0 && offset % 8 == 0 && offset <= size &&
+                        results.num_rows_ <= (size - offset) / type_size,
+                    quiet)
+        << "Bad column " << c << " in " << file_path;
+  }
+  CHECK_OR_RETURN(strings_offset % 8 == 0 && strings_offset <= size &&
+                      results.num_strings_ <= (size - strings_offset) / 8,
+                  quiet)
+      << "Bad string dictionary in " << file_path;
+  results.string_ends_ =
+      reinterpret_cast<const uint64_t*>(header + strings_offset);
+  results.string_chars_ = reinterpret_cast<const char*>(
+      results.string_ends_ + results.num_strings_);
+  uint64_t previous_end = 0;
+  for (size_t i = 0; i < results.num_strings_; ++i) {
+    CHECK_OR_RETURN(results.string_ends_[i] >= previous_end, quiet)
+        << "Bad string dictionary in " << file_path;
+    previous_end = results.string_ends_[i];
+  }
+  CHECK_OR_RETURN(
+      previous_end <= size - strings_offset - results.num_strings_ * 8, quiet)
+      << "Truncated string dictionary in " << file_path;
+  return results;
+}
+
+std::string_view ColumnarResults::String(size_t index) const {
+  const uint64_t begin = index == 0 ? 0 : string_ends_[index - 1];
+  return std::string_view(string_chars_ + begin, string_ends_[index] - begin);
+}
+
+StatusOr<const void*> ColumnarResults::FindColumn(std::string_view name,
+                                                  ColumnType type,
+                                                  bool quiet) const {
+  for (size_t c = 0; c < num_columns_; ++c) {
+    const uint8_t* descriptor = data_ + kHeaderSize + c * kColumnDescriptorSize;
+    const char* column_name = reinterpret_cast<const char*>(descriptor);
+    if (name != std::string_view(column_name,
+                                 strnlen(column_name, kColumnNameSize))) {
+      continue;
+    }
+    CHECK_OR_RETURN(Read<uint32_t>(descriptor + kColumnNameSize) ==
+                        static_cast<uint32_t>(type),
+                    quiet)
+        << "Column " << name << " is not of the requested type";
+    const void* values =
+        data_ + Read<uint64_t>(descriptor + kColumnNameSize + 8);
+    return values;
+  }
+  CHECK_OR_RETURN(false, quiet) << "Column " << name << " not found";
+  return Status::kUnknownError;
+}
+
+StatusOr<std::vector<TaskOutput>> ColumnarResults::ToTaskOutputs(
+    bool quiet) const {
+  ASSIGN_OR_RETURN(const uint32_t* images, Column<uint32_t>("image", quiet));
+  ASSIGN_OR_RETURN(const uint32_t* codecs, Column<uint32_t>("codec", quiet));
+  ASSIGN_OR_RETURN(const uint32_t* subsamplings,
+                   Column<uint32_t>("chroma_subsampling", quiet));
+  ASSIGN_OR_RETURN(const int32_t* efforts, Column<int32_t>("effort", quiet));
+  ASSIGN_OR_RETURN(const int32_t* qualities, Column<int32_t>("quality", quiet));
+  ASSIGN_OR_RETURN(const uint32_t* builds, Column<uint32_t>("build", quiet));
+  ASSIGN_OR_RETURN(const uint32_t* widths, Column<uint32_t>("width", quiet));
+  ASSIGN_OR_RETURN(const uint32_t* heights, Column<uint32_t>("height", quiet));
+  ASSIGN_OR_RETURN(const uint32_t* depths, Column<uint32_t>("depth", quiet));
+  ASSIGN_OR_RETURN(const uint32_t* frame_counts,
+                   Column<uint32_t>("frame_count", quiet));
+  ASSIGN_OR_RETURN(const uint64_t* encoded_sizes,
+                   Column<uint64_t>("encoded_size", quiet));
+  ASSIGN_OR_RETURN(const double* encoding_times,
+                   Column<double>("encoding_time", quiet));
+  ASSIGN_OR_RETURN(const double* decoding_times,
+                   Column<double>("decoding_time", quiet));
+  ASSIGN_OR_RETURN(const double* color_conversion_times,
+                   Column<double>("decoding_color_conversion_time", quiet));
+  ASSIGN_OR_RETURN(
+      const double* encoding_color_conversion_times,
+      Column<double>("encoding_color_conversion_time", quiet));
+  ASSIGN_OR_RETURN(const uint64_t* header_sizes,
+                   Column<uint64_t>("header_size", quiet));
+  ASSIGN_OR_RETURN(const uint64_t* metadata_sizes,
+                   Column<uint64_t>("metadata_size", quiet));
+  ASSIGN_OR_RETURN(const uint64_t* alpha_sizes,
+                   Column<uint64_t>("alpha_size", quiet));
+  ASSIGN_OR_RETURN(const double* first_frame_decoding_times,
+                   Column<double>("first_frame_decoding_time", quiet));
+  ASSIGN_OR_RETURN(const double* frame_decoding_times_p50,
+                   Column<double>("frame_decoding_time_p50", quiet));
+  ASSIGN_OR_RETURN(const double* frame_decoding_times_p99,
+                   Column<double>("frame_decoding_time_p99", quiet));
+  ASSIGN_OR_RETURN(const double* frame_decoding_times_max,
+                   Column<double>("frame_decoding_time_max", quiet));
+  ASSIGN_OR_RETURN(const double* task_times,
+                   Column<double>("task_time", quiet));
+  const float* distortions[kNumDistortionMetrics];
+  for (size_t m = 0; m < kNumDistortionMetrics; ++m) {
+    const std::string name =
+        DistortionMetricToString(static_cast<DistortionMetric>(m));
+    ASSIGN_OR_RETURN(distortions[m], Column<float>(name, quiet));
+  }
+  ASSIGN_OR_RETURN(const uint32_t* approximates,
+                   Column<uint32_t>("approximate", quiet));
+  const float* distortion_errors[kNumDistortionMetrics];
+  for (size_t m = 0; m < kNumDistortionMetrics; ++m) {
+    const std::string name =
+        DistortionMetricToString(static_cast<DistortionMetric>(m)) + "_error";
+    ASSIGN_OR_RETURN(distortion_errors[m], Column<float>(name, quiet));
+  }
+  ASSIGN_OR_RETURN(const uint32_t* simd_levels,
+                   Column<uint32_t>("simd_level", quiet));
+  ASSIGN_OR_RETURN(const uint32_t* decode_timings,
+                   Column<uint32_t>("decode_timing", quiet));
+  ASSIGN_OR_RETURN(const uint32_t* rendition_widths,
+                   Column<uint32_t>("rendition_width", quiet));
+  ASSIGN_OR_RETURN(const uint32_t* sampled_flags,
+                   Column<uint32_t>("system_sampled", quiet));
+  ASSIGN_OR_RETURN(const float* cpu_frequency_ratios,
+                   Column<float>("cpu_frequency_ratio", quiet));
+  ASSIGN_OR_RETURN(const uint32_t* run_queue_lengths,
+                   Column<uint32_t>("run_queue_length", quiet));
+  ASSIGN_OR_RETURN(const float* cpu_pressures,
+                   Column<float>("cpu_pressure", quiet));
+  ASSIGN_OR_RETURN(const float* memory_pressures,
+                   Column<float>("memory_pressure", quiet));
+  ASSIGN_OR_RETURN(const uint32_t* thermal_throttles,
+                   Column<uint32_t>("thermal_throttles", quiet));
+  ASSIGN_OR_RETURN(const uint32_t* abnormal_flags,
+                   Column<uint32_t>("abnormal_conditions", quiet));
+
+  std::vector<TaskOutput> tasks(num_rows_);
+  for (size_t i = 0; i < num_rows_; ++i) {
+    CHECK_OR_RETURN(images[i] < num_strings_ && builds[i] < num_strings_ &&
+                        codecs[i] <= static_cast<uint32_t>(Codec::kJpegmoz) &&
+                        subsamplings[i] <=
+                            static_cast<uint32_t>(Subsampling::k420) &&
+                        simd_levels[i] <=
+                            static_cast<uint32_t>(SimdLevel::kAvx2) &&
+                        decode_timings[i] <=
+                            static_cast<uint32_t>(DecodeTiming::kSteady),
+                    quiet)
+        << "Bad value in row " << i;
+    TaskOutput& task = tasks[i];
+    CodecSettings& settings = task.task_input.codec_settings;
+    settings.codec = static_cast<Codec>(codecs[i]);
+    settings.chroma_subsampling = static_cast<Subsampling>(subsamplings[i]);
+    settings.effort = efforts[i];
+    settings.quality = qualities[i];
+    settings.build = String(builds[i]);
+    task.task_input.image_path = String(images[i]);
+    task.task_input.rendition_width = rendition_widths[i];
+    task.image_width = widths[i];
+    task.image_height = heights[i];
+    task.bit_depth = depths[i];
+    task.num_frames = frame_counts[i];
+    task.encoded_size = encoded_sizes[i];
+    task.encoding_duration = encoding_times[i];
+    task.decoding_duration = decoding_times[i];
+    task.decoding_color_conversion_duration = color_conversion_times[i];
+    task.encoding_color_conversion_duration =
+        encoding_color_conversion_times[i];
+    task.header_size = header_sizes[i];
+    task.metadata_size = metadata_sizes[i];
+    task.alpha_size = alpha_sizes[i];
+    task.first_frame_decoding_duration = first_frame_decoding_times[i];
+    task.frame_decoding_duration_p50 = frame_decoding_times_p50[i];
+    task.frame_decoding_duration_p99 = frame_decoding_times_p99[i];
+    task.frame_decoding_duration_max = frame_decoding_times_max[i];
+    task.task_duration = task_times[i];
+    for (size_t m = 0; m < kNumDistortionMetrics; ++m) {
+      task.distortions[m] = distortions[m][i];
+    }
+    task.approximate_distortions = approximates[i] != 0;
+    for (size_t m = 0; m < kNumDistortionMetrics; ++m) {
+      task.distortion_errors[m] = distortion_errors[m][i];
+    }
+    task.simd_level = static_cast<SimdLevel>(simd_levels[i]);
+    task.decode_timing = static_cast<DecodeTiming>(decode_timings[i]);
+    SystemConditions& conditions = task.system_conditions;
+    conditions.sampled = sampled_flags[i] != 0;
+    conditions.cpu_frequency_ratio = cpu_frequency_ratios[i];
+    conditions.run_queue_length = run_queue_lengths[i];
+    conditions.cpu_pressure = cpu_pressures[i];
+    conditions.memory_pressure = memory_pressures[i];
+    conditions.num_thermal_throttles = thermal_throttles[i];
+    conditions.abnormal = abnormal_flags[i] != 0;
+  }
+  return tasks;
+}
+
+}  // namespace codec_compare_gen
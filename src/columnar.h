@@ -0,0 +1,141 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_COLUMNAR_H_
+#define SRC_COLUMNAR_H_
+
+// Columnar binary storage of TaskOutputs, meant to be memory-mapped.
+//
+// All integers and floats are little-endian. All offsets are in bytes from
+// the beginning of the file and are multiples of 8.
+//
+//   Header (40 bytes):
+//     char     magic[8] = "CCGENCOL"
+//     uint32_t byte_order_mark = 0x01020304
+//     uint32_t version = 1
+//     uint64_t num_rows
+//     uint32_t num_columns
+//     uint32_t num_strings
+//     uint64_t strings_offset
+//   Column descriptors (num_columns * 48 bytes):
+//     char     name[32]  (zero-padded)
+//     uint32_t type      (ColumnType)
+//     uint32_t reserved = 0
+//     uint64_t offset    (num_rows values of the given type)
+//   Column values, each padded to a multiple of 8 bytes.
+//   String dictionary at strings_offset:
+//     uint64_t ends[num_strings]  (end of each string in chars)
+//     char     chars[]            (concatenated, not zero-terminated)
+//
+// Files are named *.ccgencol by convention.
+// The columns are listed by ColumnarColumnNames(). The "image" and "build"
+// columns are indices in the string dictionary. "codec", "chroma_subsampling",
+// "simd_level" and "decode_timing" are the numerical values of the enums in
+// base.h. "rendition_width" is 0 for tasks encoding the original image size.
+// The columns from "system_sampled" to "abnormal_conditions" are the
+// SystemConditions of each task, 0 or 1 for booleans.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "src/base.h"
+#include "src/task.h"
+
+namespace codec_compare_gen {
+
+enum class ColumnType : uint32_t {
+  kUint32,
+  kInt32,
+  kUint64,
+  kFloat32,
+  kFloat64
+};
+
+template <typename T>
+constexpr ColumnType ColumnTypeOf();
+template <>
+constexpr ColumnType ColumnTypeOf<uint32_t>() {
+  return ColumnType::kUint32;
+}
+template <>
+constexpr ColumnType ColumnTypeOf<int32_t>() {
+  return ColumnType::kInt32;
+}
+template <>
+constexpr ColumnType ColumnTypeOf<uint64_t>() {
+  return ColumnType::kUint64;
+}
+template <>
+constexpr ColumnType ColumnTypeOf<float>() {
+  return ColumnType::kFloat32;
+}
+template <>
+constexpr ColumnType ColumnTypeOf<double>() {
+  return ColumnType::kFloat64;
+}
+
+// Returns the names of the columns written by TasksToColumnarFile(), in order.
+std::vector<std::string> ColumnarColumnNames();
+
+// Writes all tasks as is, including repetitions. Encoded paths are not kept.
+Status TasksToColumnarFile(const std::vector<TaskOutput>& tasks,
+                           const std::string& file_path, bool quiet);
+
+// Read-only memory-mapped view of a file written by TasksToColumnarFile().
+class ColumnarResults {
+ public:
+  ColumnarResults() = default;
+  ColumnarResults(ColumnarResults&& other) { *this = std::move(other); }
+  ColumnarResults& operator=(ColumnarResults&& other);
+  ~ColumnarResults();
+
+  static StatusOr<ColumnarResults> Open(const std::string& file_path,
+                                        bool quiet);
+
+  size_t num_rows() const { return num_rows_; }
+  size_t num_strings() const { return num_strings_; }
+  std::string_view String(size_t index) const;
+
+  // Returns the num_rows() values of the column with the given name.
+  template <typename T>
+  StatusOr<const T*> Column(std::string_view name, bool quiet) const {
+    const void* values;
+    ASSIGN_OR_RETURN(values, FindColumn(name, ColumnTypeOf<T>(), quiet));
+    const T* typed_values = static_cast<const T*>(values);
+    return typed_values;
+  }
+
+  // Converts all rows back. Slower than reading columns.
+  StatusOr<std::vector<TaskOutput>> ToTaskOutputs(bool quiet) const;
+
+ private:
+  StatusOr<const void*> FindColumn(std::string_view name, ColumnType type,
+                                   bool quiet) const;
+
+  const uint8_t* data_ = nullptr;  // Memory-mapped file content.
+  size_t size_ = 0;
+  size_t num_rows_ = 0;
+  size_t num_columns_ = 0;
+  size_t num_strings_ = 0;
+  const uint64_t* string_ends_ = nullptr;
+  const char* string_chars_ = nullptr;
+};
+
+}  // namespace codec_compare_gen
+
+#endif  // SRC_COLUMNAR_H_
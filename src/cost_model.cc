@@ -0,0 +1,270 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/cost_model.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "src/base.h"
+#include "src/codec.h"
+#include "src/framework.h"
+#include "src/image_info.h"
+#include "src/rendition.h"
+#include "src/task.h"
+#include "src/timer.h"
+
+namespace codec_compare_gen {
+
+std::string CostCalibrationToString(CostCalibration calibration) {
+  switch (calibration) {
+    case CostCalibration::kSettings:
+      return "same settings";
+    case CostCalibration::kEffort:
+      return "same effort";
+    case CostCalibration::kCodec:
+      return "same codec";
+    case CostCalibration::kNone:
+      return "none";
+  }
+  return "unknown";
+}
+
+//------------------------------------------------------------------------------
+
+CostModel::CostModel(const std::vector<TaskOutput>& tasks) {
+  for (const TaskOutput& task : tasks) {
+    const CodecSettings& settings = task.task_input.codec_settings;
+    const bool lossless = settings.quality == kQualityLossless;
+    Add(task, by_settings_[{settings.codec, settings.chroma_subsampling,
+                            settings.effort, settings.quality,
+                            settings.build}]);
+    Add(task, by_effort_[{settings.codec, settings.chroma_subsampling,
+                          settings.effort, lossless, settings.build}]);
+    Add(task, by_codec_[{settings.codec, lossless}]);
+    ++num_tasks_;
+  }
+}
+
+void CostModel::Add(const TaskOutput& task, Sums& sums) {
+  sums.num_pixels += static_cast<double>(task.image_width) *
+                     task.image_height * task.num_frames;
+  sums.encoding_duration += task.encoding_duration;
+  sums.decoding_duration += task.decoding_duration;
+  sums.encoded_size += static_cast<double>(task.encoded_size);
+  if (task.task_duration > 0) {
+    sums.timed_num_pixels += static_cast<double>(task.image_width) *
+                             task.image_height * task.num_frames;
+    sums.task_duration += task.task_duration;
+  }
+}
+
+TaskCost CostModel::Predict(const CodecSettings& settings,
+                            uint64_t num_pixels) const {
+  const bool lossless = settings.quality == kQualityLossless;
+  const Sums* sums = nullptr;
+  TaskCost cost;
+  if (const auto it = by_settings_.find(
+          {settings.codec, settings.chroma_subsampling, settings.effort,
+           settings.quality, settings.build});
+      it != by_settings_.end()) {
+    sums = &it->second;
+    cost.calibration = CostCalibration::kSettings;
+  } else if (const auto it = by_effort_.find(
+                 {settings.codec, settings.chroma_subsampling, settings.effort,
+                  lossless, settings.build});
+             it != by_effort_.end()) {
+    sums = &it->second;
+    cost.calibration = CostCalibration::kEffort;
+  } else if (const auto it = by_codec_.find({settings.codec, lossless});
+             it != by_codec_.end()) {
+    sums = &it->second;
+    cost.calibration = CostCalibration::kCodec;
+  }
+  if (sums == nullptr || sums->num_pixels <= 0) {
+    cost.calibration = CostCalibration::kNone;
+    return cost;
+  }
+  const double scale = static_cast<double>(num_pixels) / sums->num_pixels;
+  cost.encoding_duration = sums->encoding_duration * scale;
+  cost.decoding_duration = sums->decoding_duration * scale;
+  cost.encoded_size = sums->encoded_size * scale;
+  if (sums->timed_num_pixels > 0) {
+    cost.task_duration = sums->task_duration * static_cast<double>(num_pixels) /
+                         sums->timed_num_pixels;
+  }
+  return cost;
+}
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+std::string BytesToString(double bytes) {
+  std::stringstream ss;
+  ss.precision(3);
+  if (bytes >= 1e9) {
+    ss << bytes / 1e9 << " GB";
+  } else {
+    ss << bytes / 1e6 << " MB";
+  }
+  return ss.str();
+}
+
+std::string CpuHoursToString(double seconds) {
+  std::stringstream ss;
+  ss.precision(3);
+  ss << seconds / 3600 << " CPU hours";
+  return ss.str();
+}
+
+}  // namespace
+
+std::string RunEstimate::ToString() const {
+  std::stringstream ss;
+  ss << num_remaining_tasks << " of " << num_planned_tasks
+     << " planned tasks remain";
+  for (const BatchEstimate& batch : batches) {
+    ss << std::endl
+       << "  " << batch.batch_name << ": " << batch.num_tasks << " tasks, "
+       << CpuHoursToString(batch.cpu_duration) << ", "
+       << BytesToString(batch.encoded_size) << " encoded (calibration: "
+       << CostCalibrationToString(batch.calibration) << ")";
+    if (batch.num_unpredicted_tasks > 0) {
+      ss << ", " << batch.num_unpredicted_tasks << " not counted";
+    }
+  }
+  ss << std::endl
+     << "Total: " << CpuHoursToString(cpu_duration) << ", "
+     << Timer::SecondsToString(wall_duration) << " of wall time";
+  if (disk_size > 0) ss << ", " << BytesToString(disk_size) << " on disk";
+  ss << std::endl
+     << "Peak memory: " << BytesToString(memory_per_worker)
+     << " per worker thread, " << BytesToString(shared_memory)
+     << " of shared image cache";
+  if (num_tasks_without_task_duration > 0) {
+    ss << std::endl
+       << num_tasks_without_task_duration
+       << " tasks are calibrated on progress files that do not record the "
+          "whole task durations: the time spent reading images and computing "
+          "distortions is not counted in their wall time";
+  }
+  if (num_unpredicted_tasks > 0) {
+    ss << std::endl
+       << num_unpredicted_tasks
+       << " tasks are not counted: no completed task of the same codec to "
+          "calibrate on, or unknown image dimensions";
+  }
+  return ss.str();
+}
+
+RunEstimate EstimateRun(
+    const std::vector<TaskInput>& remaining_tasks, size_t num_planned_tasks,
+    const std::unordered_map<std::string, ImageInfo>& images,
+    const CostModel& model, const ComparisonSettings& settings) {
+  RunEstimate estimate;
+  estimate.num_planned_tasks = num_planned_tasks;
+  estimate.num_remaining_tasks = remaining_tasks.size();
+  const size_t num_decodings =
+      settings.decode_timing == DecodeTiming::kSteady ? 1 + kNumSteadyDecodings
+                                                      : 1;
+  std::unordered_map<std::string, size_t> batch_indices;
+  // Repetitions write the same encoded file once.
+  std::unordered_set<std::string> encoded_paths;
+  double total_task_duration = 0;
+  double longest_task_duration = 0;
+  for (const TaskInput& task : remaining_tasks) {
+    const std::string batch_name =
+        BatchName(task.codec_settings, task.rendition_width,
+                  settings.simd_level, settings.decode_timing);
+    const auto [it, inserted] =
+        batch_indices.emplace(batch_name, estimate.batches.size());
+    if (inserted) estimate.batches.push_back({batch_name});
+    BatchEstimate& batch = estimate.batches[it->second];
+    ++batch.num_tasks;
+
+    const auto image = images.find(task.image_path);
+    if (image == images.end() || image->second.width == 0 ||
+        image->second.height == 0) {
+      ++batch.num_unpredicted_tasks;
+      continue;
+    }
+    const ImageInfo& info = image->second;
+    uint64_t width = info.width, height = info.height;
+    if (task.rendition_width != 0 && task.rendition_width < info.width) {
+      width = task.rendition_width;
+      height = RenditionHeight(info.width, info.height, task.rendition_width);
+    }
+    const uint64_t num_pixels = width * height * info.num_frames;
+    const TaskCost cost = model.Predict(task.codec_settings, num_pixels);
+    if (cost.calibration == CostCalibration::kNone) {
+      ++batch.num_unpredicted_tasks;
+      continue;
+    }
+    batch.calibration = std::max(batch.calibration, cost.calibration);
+    const double duration =
+        cost.encoding_duration + cost.decoding_duration * num_decodings;
+    batch.cpu_duration += duration;
+    batch.encoded_size += cost.encoded_size;
+    // The completed tasks may have been decoded fewer times.
+    const double task_duration = std::max(cost.task_duration, duration);
+    if (cost.task_duration == 0) ++estimate.num_tasks_without_task_duration;
+    total_task_duration += task_duration;
+    longest_task_duration = std::max(longest_task_duration, task_duration);
+    if (!task.encoded_path.empty() &&
+        encoded_paths.insert(task.encoded_path).second) {
+      estimate.disk_size += cost.encoded_size;
+    }
+    // ARGB samples of 8 or 16 bits.
+    const double decoded_size =
+        static_cast<double>(num_pixels) * (info.bit_depth > 8 ? 8 : 4);
+    estimate.memory_per_worker = std::max(estimate.memory_per_worker,
+                                          3 * decoded_size + cost.encoded_size);
+  }
+  for (BatchEstimate& batch : estimate.batches) {
+    if (batch.num_unpredicted_tasks == batch.num_tasks) {
+      batch.calibration = CostCalibration::kNone;
+    }
+    estimate.cpu_duration += batch.cpu_duration;
+    estimate.num_unpredicted_tasks += batch.num_unpredicted_tasks;
+  }
+  estimate.wall_duration =
+      std::max(total_task_duration / (1 + settings.num_extra_threads),
+               longest_task_duration);
+
+  // The cache keeps the most recently used original images.
+  std::vector<double> original_sizes;
+  for (const auto& [path, info] : images) {
+    original_sizes.push_back(static_cast<double>(info.width) * info.height *
+                             info.num_frames * (info.bit_depth > 8 ? 8 : 4));
+  }
+  const size_t num_cached_images =
+      std::min<size_t>(settings.image_cache_size, original_sizes.size());
+  std::partial_sort(original_sizes.begin(),
+                    original_sizes.begin() + num_cached_images,
+                    original_sizes.end(), std::greater<double>());
+  for (size_t i = 0; i < num_cached_images; ++i) {
+    estimate.shared_memory += original_sizes[i];
+  }
+  return estimate;
+}
+
+}  // namespace codec_compare_gen
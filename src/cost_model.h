@@ -0,0 +1,135 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_COST_MODEL_H_
+#define SRC_COST_MODEL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "src/base.h"
+#include "src/framework.h"
+#include "src/image_info.h"
+#include "src/task.h"
+
+namespace codec_compare_gen {
+
+// How closely the completed tasks used for a prediction match the planned one,
+// from the closest to the loosest.
+enum class CostCalibration {
+  kSettings,  // Same codec, chroma subsampling, effort, quality and build.
+  kEffort,    // Same as above but any quality, lossy or lossless as planned.
+  kCodec,     // Same codec, lossy or lossless as planned.
+  kNone,      // No completed task of that codec.
+};
+
+std::string CostCalibrationToString(CostCalibration calibration);
+
+struct TaskCost {
+  double encoding_duration = 0;  // in seconds
+  double decoding_duration = 0;  // in seconds, for a single decoding
+  double encoded_size = 0;       // in bytes
+  // Wall time of the whole task in its worker thread (see
+  // TaskOutput::task_duration), 0 if no matching completed task recorded it.
+  double task_duration = 0;  // in seconds
+  CostCalibration calibration = CostCalibration::kNone;
+};
+
+// Average durations and sizes per pixel of completed tasks, used to predict
+// those of planned tasks on other images. Assumes that they scale linearly
+// with the number of pixels, and that the tasks ran on similar machines.
+class CostModel {
+ public:
+  CostModel() = default;
+  // The tasks may come from progress files of several previous runs.
+  explicit CostModel(const std::vector<TaskOutput>& tasks);
+
+  // Returns the cost of a task encoding num_pixels (all frames included) with
+  // the given settings. Zero with CostCalibration::kNone.
+  TaskCost Predict(const CodecSettings& settings, uint64_t num_pixels) const;
+
+  size_t num_tasks() const { return num_tasks_; }
+
+ private:
+  struct Sums {
+    double num_pixels = 0;
+    double encoding_duration = 0;
+    double decoding_duration = 0;
+    double encoded_size = 0;
+    // Only of the tasks that recorded their whole duration.
+    double timed_num_pixels = 0;
+    double task_duration = 0;
+  };
+  static void Add(const TaskOutput& task, Sums& sums);
+
+  size_t num_tasks_ = 0;
+  std::map<std::tuple<Codec, Subsampling, int, int, std::string>, Sums>
+      by_settings_;
+  std::map<std::tuple<Codec, Subsampling, int, bool, std::string>, Sums>
+      by_effort_;
+  std::map<std::tuple<Codec, bool>, Sums> by_codec_;
+};
+
+// Predicted cost of the remaining tasks of a batch. See BatchName().
+struct BatchEstimate {
+  std::string batch_name;
+  size_t num_tasks = 0;
+  // Tasks without calibration or whose image dimensions are unknown. They are
+  // not counted in the fields below.
+  size_t num_unpredicted_tasks = 0;
+  CostCalibration calibration = CostCalibration::kSettings;  // Loosest one.
+  double cpu_duration = 0;  // in seconds, spent encoding and decoding
+  double encoded_size = 0;  // in bytes
+};
+
+struct RunEstimate {
+  size_t num_planned_tasks = 0;
+  size_t num_remaining_tasks = 0;
+  std::vector<BatchEstimate> batches;  // In order of first planned task.
+  double cpu_duration = 0;   // in seconds, sum of the batches
+  // In seconds, with all worker threads busy. Based on the whole durations of
+  // the completed tasks, including reading images and computing distortions,
+  // when recorded.
+  double wall_duration = 0;
+  // Tasks predicted from completed tasks that did not record their whole
+  // duration, so only their encoding and decoding count in wall_duration.
+  size_t num_tasks_without_task_duration = 0;
+  // Bytes written to ComparisonSettings::encoded_folder_path, 0 if empty.
+  double disk_size = 0;
+  // Peak bytes held by a worker thread for the largest task: the decoded
+  // source, its copy converted for the encoder, the decoded output and the
+  // encoded bitstream. Codec internal buffers are not counted.
+  double memory_per_worker = 0;
+  // Bytes held by the RenditionCache shared by all workers, at most.
+  double shared_memory = 0;
+  size_t num_unpredicted_tasks = 0;
+
+  std::string ToString() const;
+};
+
+// Predicts the cost of evaluating the remaining_tasks out of num_planned_tasks
+// with the given settings. images maps each image path to its dimensions.
+RunEstimate EstimateRun(
+    const std::vector<TaskInput>& remaining_tasks, size_t num_planned_tasks,
+    const std::unordered_map<std::string, ImageInfo>& images,
+    const CostModel& model, const ComparisonSettings& settings);
+
+}  // namespace codec_compare_gen
+
+#endif  // SRC_COST_MODEL_H_
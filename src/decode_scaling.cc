@@ -0,0 +1,191 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/decode_scaling.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "src/base.h"
+#include "src/codec.h"
+#include "src/stats.h"
+#include "src/task.h"
+#include "src/timer.h"
+#include "src/worker.h"
+
+namespace codec_compare_gen {
+
+std::vector<size_t> DecodeScalingThreadCounts(size_t max_num_threads) {
+  std::vector<size_t> thread_counts;
+  for (size_t num_threads = 1; num_threads < max_num_threads;
+       num_threads *= 2) {
+    thread_counts.push_back(num_threads);
+  }
+  thread_counts.push_back(std::max<size_t>(max_num_threads, 1));
+  return thread_counts;
+}
+
+#if defined(HAS_WEBP2)
+
+namespace {
+
+struct Bitstream {
+  TaskInput input;
+  WP2::Data data;
+};
+
+// Shared among all DecodeScalingWorkers. Guarded by a mutex in WorkerPool.
+struct DecodeScalingContext {
+  Status status = Status::kOk;  // kOk or first encountered error.
+  const std::vector<Bitstream>* bitstreams = nullptr;
+  size_t num_remaining_decodings = 0;
+  std::vector<double> latencies;  // One per completed decoding, in seconds.
+  bool quiet = true;
+};
+
+class DecodeScalingWorker
+    : public Worker<DecodeScalingContext, DecodeScalingWorker> {
+ public:
+  using Worker<DecodeScalingContext, DecodeScalingWorker>::Worker;
+
+ private:
+  bool AssignTask(DecodeScalingContext& context) override {
+    if (context.status != Status::kOk || context.num_remaining_decodings == 0) {
+      return false;
+    }
+    // Consecutive decodings are of different bitstreams.
+    --context.num_remaining_decodings;
+    bitstream_ = &(*context.bitstreams)[context.num_remaining_decodings %
+                                        context.bitstreams->size()];
+    quiet_ = context.quiet;
+    return true;
+  }
+
+  void DoTask() override {
+    const Timer timer;
+    // The decoded image is discarded right away.
+    status_ = Decode(bitstream_->input, bitstream_->data, quiet_).status;
+    latency_ = timer.seconds();
+  }
+
+  void EndTask(DecodeScalingContext& context) override {
+    if (status_ != Status::kOk) {
+      if (context.status == Status::kOk) context.status = status_;
+      return;
+    }
+    context.latencies.push_back(latency_);
+  }
+
+  const Bitstream* bitstream_ = nullptr;
+  Status status_ = Status::kOk;
+  double latency_ = 0;
+  bool quiet_ = true;
+};
+
+StatusOr<DecodeScalingPoint> MeasureDecodeScalingPoint(
+    const std::vector<Bitstream>& bitstreams, size_t num_threads,
+    size_t num_passes, bool quiet) {
+  CHECK_OR_RETURN(num_threads > 0 && num_passes > 0, quiet);
+  DecodeScalingContext context;
+  context.bitstreams = &bitstreams;
+  // Each thread decodes all the bitstreams num_passes times in average, so
+  // that all threads stay busy for most of the measurement.
+  context.num_remaining_decodings =
+      bitstreams.size() * num_threads * num_passes;
+  context.latencies.reserve(context.num_remaining_decodings);
+  context.quiet = quiet;
+
+  const Timer timer;
+  WorkerPool<DecodeScalingContext, DecodeScalingWorker> pool(num_threads);
+  pool.Run(context);
+  const double duration = timer.seconds();
+  OK_OR_RETURN(context.status);
+
+  std::sort(context.latencies.begin(), context.latencies.end());
+  DecodeScalingPoint point;
+  point.num_threads = num_threads;
+  point.num_decodings = context.latencies.size();
+  point.duration = duration;
+  point.images_per_second =
+      duration > 0 ? static_cast<double>(point.num_decodings) / duration : 0;
+  point.latency_p50 = Percentile(context.latencies, 0.5);
+  point.latency_p90 = Percentile(context.latencies, 0.9);
+  point.latency_p99 = Percentile(context.latencies, 0.99);
+  return point;
+}
+
+}  // namespace
+
+StatusOr<std::vector<DecodeScaling>> MeasureDecodeScaling(
+    const std::vector<TaskOutput>& tasks,
+    const DecodeScalingSettings& settings, bool quiet) {
+  // Distinct encoded files grouped by batch, in order of first appearance.
+  std::vector<DecodeScaling> results;
+  std::vector<std::vector<TaskInput>> inputs;
+  std::unordered_map<std::string, size_t> batch_indices;
+  std::unordered_set<std::string> encoded_paths;
+  for (const TaskOutput& task : tasks) {
+    CHECK_OR_RETURN(!task.task_input.encoded_path.empty(), quiet)
+        << "Missing encoded path for " << task.task_input.image_path;
+    if (!encoded_paths.insert(task.task_input.encoded_path).second) continue;
+    const std::string batch_name =
+        BatchName(task.task_input.codec_settings,
+                  task.task_input.rendition_width, task.simd_level,
+                  task.decode_timing);
+    const auto [it, inserted] =
+        batch_indices.emplace(batch_name, results.size());
+    if (inserted) {
+      results.emplace_back();
+      results.back().batch_name = batch_name;
+      inputs.emplace_back();
+    }
+    inputs[it->second].push_back(task.task_input);
+  }
+
+  for (size_t b = 0; b < results.size(); ++b) {
+    // Only the bitstreams of one batch are held in memory at a time.
+    std::vector<Bitstream> bitstreams;
+    bitstreams.reserve(inputs[b].size());
+    for (const TaskInput& input : inputs[b]) {
+      ASSIGN_OR_RETURN(WP2::Data data,
+                       ReadEncodedImage(input.encoded_path, quiet));
+      bitstreams.push_back({input, std::move(data)});
+    }
+    results[b].num_bitstreams = bitstreams.size();
+
+    for (const size_t num_threads : settings.thread_counts) {
+      ASSIGN_OR_RETURN(DecodeScalingPoint point,
+                       MeasureDecodeScalingPoint(bitstreams, num_threads,
+                                                 settings.num_passes, quiet));
+      results[b].points.push_back(point);
+    }
+  }
+  return results;
+}
+
+#else
+
+StatusOr<std::vector<DecodeScaling>> MeasureDecodeScaling(
+    const std::vector<TaskOutput>&, const DecodeScalingSettings&, bool quiet) {
+  CHECK_OR_RETURN(false, quiet) << "Decoding images requires HAS_WEBP2";
+}
+
+#endif  // HAS_WEBP2
+
+}  // namespace codec_compare_gen
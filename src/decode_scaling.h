@@ -0,0 +1,65 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_DECODE_SCALING_H_
+#define SRC_DECODE_SCALING_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "src/base.h"
+#include "src/framework.h"
+#include "src/task.h"
+
+namespace codec_compare_gen {
+
+// Returns 1, 2, 4 etc. up to max_num_threads, and max_num_threads itself.
+std::vector<size_t> DecodeScalingThreadCounts(size_t max_num_threads);
+
+struct DecodeScalingSettings {
+  std::vector<size_t> thread_counts = {1};
+  // Each thread decodes all the bitstreams of a batch that many times.
+  size_t num_passes = 1;
+};
+
+// Aggregate decoding performance of one batch with some concurrent threads.
+struct DecodeScalingPoint {
+  size_t num_threads;
+  size_t num_decodings;
+  double duration;           // Wall-clock seconds for all decodings.
+  double images_per_second;  // num_decodings / duration
+  // Latency percentiles of a single decoding, in seconds.
+  double latency_p50;
+  double latency_p90;
+  double latency_p99;
+};
+
+struct DecodeScaling {
+  std::string batch_name;  // See BatchName().
+  size_t num_bitstreams = 0;
+  std::vector<DecodeScalingPoint> points;  // In thread_counts order.
+};
+
+// Loads the distinct encoded files referenced by the tasks, then for each
+// batch and each thread count, decodes them with that many threads running
+// concurrently. All bitstreams are held in memory so that the storage is not
+// measured. The tasks must have an encoded_path (see --encoded_folder).
+StatusOr<std::vector<DecodeScaling>> MeasureDecodeScaling(
+    const std::vector<TaskOutput>& tasks,
+    const DecodeScalingSettings& settings, bool quiet);
+
+}  // namespace codec_compare_gen
+
+#endif  // SRC_DECODE_SCALING_H_
@@ -0,0 +1,378 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/dedup.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "src/base.h"
+#include "src/serialization.h"
+#include "src/task.h"
+#include "src/worker.h"
+
+#if defined(HAS_WEBP2)
+#include "src/frame.h"
+#include "third_party/libwebp2/src/wp2/base.h"
+#endif
+
+namespace codec_compare_gen {
+
+namespace {
+
+template <typename T>
+void Append(const T& value, std::string& bytes) {
+  bytes.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Returns what must be equal for two image files to be duplicates.
+StatusOr<std::string> GetContent(const std::string& image_path,
+                                 DedupMode mode, bool quiet) {
+  if (mode == DedupMode::kBytes) {
+    std::ifstream file(image_path, std::ios::binary);
+    CHECK_OR_RETURN(file.is_open(), quiet) << "Cannot open " << image_path;
+    std::stringstream bytes;
+    bytes << file.rdbuf();
+    return bytes.str();
+  }
+  CHECK_OR_RETURN(mode == DedupMode::kPixels, quiet);
+#if defined(HAS_WEBP2)
+  ASSIGN_OR_RETURN(const Image image,
+                   ReadStillImageOrAnimation(image_path.c_str(), WP2_ARGB_32,
+                                             quiet));
+  std::string content;
+  for (const Frame& frame : image) {
+    const WP2::ArgbBuffer& pixels = frame.pixels;
+    Append(pixels.width(), content);
+    Append(pixels.height(), content);
+    Append(pixels.format(), content);
+    Append(frame.duration_ms, content);
+    const size_t row_size =
+        static_cast<size_t>(pixels.width()) * WP2FormatBpp(pixels.format());
+    for (uint32_t y = 0; y < pixels.height(); ++y) {
+      content.append(static_cast<const char*>(pixels.GetRow(y)), row_size);
+    }
+    // Some codecs encode the source samples of YUV files rather than their RGB
+    // conversion.
+    if (frame.yuv != nullptr) {
+      Append(frame.yuv->bit_depth, content);
+      Append(frame.yuv->subsampling, content);
+      Append(frame.yuv->full_range, content);
+      for (const std::vector<uint8_t>& plane : frame.yuv->planes) {
+        content.append(plane.begin(), plane.end());
+      }
+    }
+  }
+  return content;
+#else
+  CHECK_OR_RETURN(false, quiet) << "Comparing pixels requires HAS_WEBP2";
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Cache
+
+// Identifies a version of a file.
+struct FileStamp {
+  uintmax_t size = 0;
+  int64_t modification_time = 0;  // in ticks of the filesystem clock
+
+  bool operator==(const FileStamp& other) const {
+    return size == other.size && modification_time == other.modification_time;
+  }
+};
+
+std::optional<FileStamp> GetFileStamp(const std::string& path) {
+  std::error_code error;
+  FileStamp stamp;
+  stamp.size = std::filesystem::file_size(path, error);
+  if (error) return std::nullopt;
+  stamp.modification_time =
+      std::filesystem::last_write_time(path, error).time_since_epoch().count();
+  if (error) return std::nullopt;
+  return stamp;
+}
+
+// Returns false if str is not exactly an integer that fits in value.
+template <typename T>
+bool ParseInteger(const std::string& str, T& value) {
+  const char* end = str.data() + str.size();
+  const std::from_chars_result result = std::from_chars(str.data(), end, value);
+  return result.ec == std::errc() && result.ptr == end;
+}
+
+struct CacheEntry {
+  FileStamp stamp;
+  uint64_t hash = 0;
+  // Path of the representative this file was found identical to, if any.
+  std::string same_as;
+};
+
+// Returns the entries of the cache file at path, one per line formatted as
+// "hash, size, modification time, image path, representative path". A missing
+// or malformed cache is ignored.
+std::unordered_map<std::string, CacheEntry> ReadCache(const std::string& path) {
+  std::unordered_map<std::string, CacheEntry> entries;
+  std::ifstream file(path);
+  if (!file.is_open()) return entries;
+  for (std::string line; std::getline(file, line);) {
+    const std::vector<std::string> tokens = Split(line, ',');
+    if (tokens.size() != 5) return {};
+    CacheEntry entry;
+    const StatusOr<std::string> image_path =
+        Unescape(tokens[3], /*quiet=*/true);
+    const StatusOr<std::string> same_as = Unescape(tokens[4], /*quiet=*/true);
+    if (image_path.status != Status::kOk || same_as.status != Status::kOk) {
+      return {};
+    }
+    if (!ParseInteger(tokens[0], entry.hash) ||
+        !ParseInteger(tokens[1], entry.stamp.size) ||
+        !ParseInteger(tokens[2], entry.stamp.modification_time)) {
+      return {};
+    }
+    entry.same_as = same_as.value;
+    entries[image_path.value] = entry;
+  }
+  return entries;
+}
+
+Status WriteCache(const std::string& path,
+                  const std::vector<std::string>& image_paths,
+                  const std::vector<std::optional<FileStamp>>& stamps,
+                  const std::vector<std::optional<uint64_t>>& hashes,
+                  const std::vector<std::vector<std::string>>& groups,
+                  bool quiet) {
+  std::unordered_map<std::string_view, std::string_view> representatives;
+  for (const std::vector<std::string>& group : groups) {
+    for (size_t i = 1; i < group.size(); ++i) {
+      representatives[group[i]] = group.front();
+    }
+  }
+  // Written to a temporary file first so that an interrupted run does not
+  // leave a truncated cache.
+  const std::string temporary_path = path + ".tmp";
+  {
+    std::ofstream file(temporary_path, std::ios::trunc);
+    CHECK_OR_RETURN(file.is_open(), quiet)
+        << "Could not open " << temporary_path << " for writing";
+    std::unordered_set<std::string_view> written_paths;
+    for (size_t i = 0; i < image_paths.size(); ++i) {
+      if (!stamps[i].has_value() || !hashes[i].has_value() ||
+          !written_paths.insert(image_paths[i]).second) {
+        continue;
+      }
+      const auto representative = representatives.find(image_paths[i]);
+      file << *hashes[i] << ", " << stamps[i]->size << ", "
+           << stamps[i]->modification_time << ", " << Escape(image_paths[i])
+           << ", "
+           << Escape(representative == representatives.end()
+                         ? std::string_view()
+                         : representative->second)
+           << std::endl;
+    }
+    CHECK_OR_RETURN(file.good(), quiet) << "Could not write " << temporary_path;
+  }
+  std::error_code error;
+  std::filesystem::rename(temporary_path, path, error);
+  CHECK_OR_RETURN(!error, quiet)
+      << "Could not rename " << temporary_path << " to " << path << ": "
+      << error.message();
+  return Status::kOk;
+}
+
+//------------------------------------------------------------------------------
+// Hashing
+
+struct HashContext {
+  const std::vector<std::string>* image_paths;
+  DedupMode mode;
+  // Empty if unreadable. Filled in advance with the cached hashes.
+  std::vector<std::optional<uint64_t>> hashes;
+  size_t next_image = 0;
+};
+
+class HashWorker : public Worker<HashContext, HashWorker> {
+ public:
+  using Worker<HashContext, HashWorker>::Worker;
+
+ private:
+  bool AssignTask(HashContext& context) override {
+    while (context.next_image < context.image_paths->size() &&
+           context.hashes[context.next_image].has_value()) {
+      ++context.next_image;
+    }
+    if (context.next_image >= context.image_paths->size()) return false;
+    context_ = &context;
+    image_ = context.next_image++;
+    return true;
+  }
+
+  void DoTask() override {
+    // Each worker writes to distinct elements of context_->hashes.
+    const StatusOr<std::string> content =
+        GetContent((*context_->image_paths)[image_], context_->mode,
+                   /*quiet=*/true);
+    if (content.status == Status::kOk) {
+      context_->hashes[image_] = Fnv1a().Update(content.value).hash();
+    }
+  }
+
+  HashContext* context_ = nullptr;
+  size_t image_ = 0;
+};
+
+// Identifies the task of image_path with the same settings as task, regardless
+// of its encoded path.
+std::string TaskKey(const TaskInput& task, const std::string& image_path) {
+  const CodecSettings& settings = task.codec_settings;
+  std::stringstream key;
+  key << static_cast<int>(settings.codec) << ","
+      << static_cast<int>(settings.chroma_subsampling) << "," << settings.effort
+      << "," << settings.quality << "," << task.rendition_width << ","
+      << Escape(settings.build) << "," << Escape(image_path);
+  return key.str();
+}
+
+}  // namespace
+
+StatusOr<std::vector<std::vector<std::string>>> GroupDuplicates(
+    const std::vector<std::string>& image_paths, DedupMode mode,
+    size_t num_threads, const std::string& cache_file_path, bool quiet) {
+  CHECK_OR_RETURN(mode != DedupMode::kNone, quiet);
+  HashContext context;
+  context.image_paths = &image_paths;
+  context.mode = mode;
+  context.hashes.resize(image_paths.size());
+  std::vector<std::optional<FileStamp>> stamps(image_paths.size());
+  // Entries of the files that did not change since they were cached.
+  std::unordered_map<std::string, CacheEntry> cache;
+  if (!cache_file_path.empty()) {
+    std::unordered_map<std::string, CacheEntry> entries =
+        ReadCache(cache_file_path);
+    for (size_t i = 0; i < image_paths.size(); ++i) {
+      // Taken before hashing, so that a file modified meanwhile is hashed
+      // again next time.
+      stamps[i] = GetFileStamp(image_paths[i]);
+      const auto entry = entries.find(image_paths[i]);
+      if (stamps[i].has_value() && entry != entries.end() &&
+          entry->second.stamp == *stamps[i]) {
+        context.hashes[i] = entry->second.hash;
+        cache[image_paths[i]] = entry->second;
+      }
+    }
+  }
+  WorkerPool<HashContext, HashWorker> pool(
+      std::max<size_t>(1, std::min(num_threads, image_paths.size())));
+  pool.Run(context);
+
+  std::vector<std::vector<std::string>> groups;
+  // Indices in groups of the representatives with the same hash.
+  std::unordered_map<uint64_t, std::vector<size_t>> groups_by_hash;
+  for (size_t i = 0; i < image_paths.size(); ++i) {
+    const std::string& image_path = image_paths[i];
+    if (!context.hashes[i].has_value()) {
+      groups.push_back({image_path});
+      continue;
+    }
+    std::vector<size_t>& candidates = groups_by_hash[*context.hashes[i]];
+    bool is_duplicate = false;
+    if (!candidates.empty()) {
+      // Rule out hash collisions. Only duplicates and collisions are read
+      // twice, unless they were already compared when cached.
+      const auto entry = cache.find(image_path);
+      for (const size_t group : candidates) {
+        const std::string& representative = groups[group].front();
+        if (entry != cache.end() && entry->second.same_as == representative &&
+            cache.count(representative) != 0) {
+          groups[group].push_back(image_path);
+          is_duplicate = true;
+          break;
+        }
+      }
+      std::optional<std::string> content;
+      for (size_t c = 0; c < candidates.size() && !is_duplicate; ++c) {
+        if (!content.has_value()) {
+          ASSIGN_OR_RETURN(content, GetContent(image_path, mode, quiet));
+        }
+        const std::string& representative = groups[candidates[c]].front();
+        ASSIGN_OR_RETURN(const std::string representative_content,
+                         GetContent(representative, mode, quiet));
+        if (*content == representative_content) {
+          groups[candidates[c]].push_back(image_path);
+          is_duplicate = true;
+        }
+      }
+    }
+    if (!is_duplicate) {
+      candidates.push_back(groups.size());
+      groups.push_back({image_path});
+    }
+  }
+  if (!cache_file_path.empty()) {
+    OK_OR_RETURN(WriteCache(cache_file_path, image_paths, stamps,
+                            context.hashes, groups, quiet));
+  }
+  return groups;
+}
+
+void CopyResultsToDuplicates(
+    const std::vector<std::vector<std::string>>& groups,
+    std::vector<TaskOutput>& tasks) {
+  std::unordered_map<std::string_view, const std::vector<std::string>*>
+      duplicates;
+  for (const std::vector<std::string>& group : groups) {
+    if (group.size() > 1) duplicates[group.front()] = &group;
+  }
+  if (duplicates.empty()) return;
+
+  const size_t num_tasks = tasks.size();
+  std::unordered_set<std::string> evaluated_tasks;
+  for (size_t t = 0; t < num_tasks; ++t) {
+    evaluated_tasks.insert(TaskKey(tasks[t].task_input,
+                                   tasks[t].task_input.image_path));
+  }
+  size_t num_copies = 0;
+  for (size_t t = 0; t < num_tasks; ++t) {
+    const auto it = duplicates.find(tasks[t].task_input.image_path);
+    if (it != duplicates.end()) num_copies += it->second->size() - 1;
+  }
+  // Avoids invalidating tasks[t] while appending its copies.
+  tasks.reserve(num_tasks + num_copies);
+  for (size_t t = 0; t < num_tasks; ++t) {
+    const auto it = duplicates.find(tasks[t].task_input.image_path);
+    if (it == duplicates.end()) continue;
+    for (size_t d = 1; d < it->second->size(); ++d) {
+      const std::string& duplicate = (*it->second)[d];
+      if (evaluated_tasks.count(TaskKey(tasks[t].task_input, duplicate)) != 0) {
+        continue;
+      }
+      tasks.push_back(tasks[t]);
+      tasks.back().task_input.image_path = duplicate;
+    }
+  }
+}
+
+}  // namespace codec_compare_gen
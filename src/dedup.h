@@ -0,0 +1,52 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_DEDUP_H_
+#define SRC_DEDUP_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "src/base.h"
+#include "src/task.h"
+
+namespace codec_compare_gen {
+
+// Groups the image_paths whose contents are identical according to mode. Each
+// group starts with its representative, the first of its paths in image_paths.
+// Groups are ordered by representative as in image_paths, so the groups of
+// unique images contain a single path. The contents are hashed by num_threads
+// threads (at least one), then paths with equal hashes are compared in full.
+// Files that cannot be read are considered unique, so that their failure is
+// reported by the task evaluating them.
+// If cache_file_path is not empty, the hashes of the files whose size and
+// modification time did not change since they were written to that file are
+// reused, as well as the full comparisons between such files, and the file is
+// rewritten with the hashes of all image_paths.
+StatusOr<std::vector<std::vector<std::string>>> GroupDuplicates(
+    const std::vector<std::string>& image_paths, DedupMode mode,
+    size_t num_threads, const std::string& cache_file_path, bool quiet);
+
+// Appends to tasks a copy of each task of a representative in groups, for each
+// of its duplicates. Only TaskInput::image_path differs in the copies. The
+// duplicates that already have a task with the same settings, for example
+// evaluated by a run without deduplication, keep it instead of a copy.
+void CopyResultsToDuplicates(
+    const std::vector<std::vector<std::string>>& groups,
+    std::vector<TaskOutput>& tasks);
+
+}  // namespace codec_compare_gen
+
+#endif  // SRC_DEDUP_H_
@@ -0,0 +1,340 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/diff.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "src/base.h"
+#include "src/codec.h"
+#include "src/codec_plugin.h"
+#include "src/framework.h"
+#include "src/serialization.h"
+#include "src/task.h"
+
+namespace codec_compare_gen {
+
+namespace {
+
+// Repetitions of the same task in a run.
+struct ReducedTask {
+  const TaskOutput* task;  // First repetition.
+  std::vector<double> encoding_durations;
+  std::vector<double> decoding_durations;
+};
+
+std::string TaskKey(const TaskInput& input) {
+  // The encoded path is ignored on purpose. Runs may use different folders.
+  const CodecSettings& settings = input.codec_settings;
+  std::string key = std::to_string(static_cast<int>(settings.codec)) + "," +
+                    std::to_string(static_cast<int>(
+                        settings.chroma_subsampling)) +
+                    "," + std::to_string(settings.effort) + "," +
+                    std::to_string(settings.quality) + ",";
+  key += settings.build;
+  key.push_back('\0');
+  key += input.image_path;
+  if (input.rendition_width != 0) {
+    key.push_back('\0');
+    key += std::to_string(input.rendition_width);
+  }
+  return key;
+}
+
+std::unordered_map<std::string, ReducedTask> ReduceRepetitions(
+    const std::vector<TaskOutput>& tasks) {
+  std::unordered_map<std::string, ReducedTask> reduced_tasks;
+  reduced_tasks.reserve(tasks.size());
+  for (const TaskOutput& task : tasks) {
+    ReducedTask& reduced = reduced_tasks[TaskKey(task.task_input)];
+    if (reduced.task == nullptr) reduced.task = &task;
+    reduced.encoding_durations.push_back(task.encoding_duration);
+    reduced.decoding_durations.push_back(task.decoding_duration);
+  }
+  return reduced_tasks;
+}
+
+// Median is less sensitive than the mean to a repetition hit by a hiccup.
+double Median(std::vector<double>& values) {
+  const size_t middle = values.size() / 2;
+  std::nth_element(values.begin(), values.begin() + middle, values.end());
+  if (values.size() % 2 == 1) return values[middle];
+  const double upper = values[middle];
+  return (*std::max_element(values.begin(), values.begin() + middle) + upper) /
+         2;
+}
+
+// Returns log(a/b), avoiding infinities for very short durations.
+double LogRatio(double a, double b) {
+  constexpr double kEpsilon = 1e-9;
+  return std::log(std::max(a, kEpsilon)) - std::log(std::max(b, kEpsilon));
+}
+
+struct ImageLogRatios {
+  double encoded_size = 0;
+  double encoding_duration = 0;
+  double decoding_duration = 0;
+  size_t count = 0;
+  // Same as encoded_size but without the size-quality tradeoffs.
+  double encoded_size_at_same_quality = 0;
+  size_t count_at_same_quality = 0;
+};
+
+struct SettingsAccumulator {
+  CodecSettings codec_settings;
+  uint32_t rendition_width = 0;
+  std::unordered_map<std::string, ImageLogRatios> images;
+  size_t num_tasks = 0;
+  size_t num_size_changes = 0;
+  size_t num_size_quality_tradeoffs = 0;
+  double distortion_sums[kNumDistortionMetrics] = {};
+  size_t distortion_counts[kNumDistortionMetrics] = {};
+};
+
+MeasurementDiff ToMeasurementDiff(const std::vector<double>& log_ratios,
+                                  double threshold, double significance,
+                                  bool needs_significance) {
+  MeasurementDiff diff;
+  double sum = 0;
+  for (const double log_ratio : log_ratios) sum += log_ratio;
+  diff.ratio = log_ratios.empty() ? 1 : std::exp(sum / log_ratios.size());
+  diff.p_value = WilcoxonSignedRankPValue(log_ratios);
+  diff.regression = diff.ratio > 1 + threshold &&
+                    (!needs_significance || diff.p_value < significance);
+  return diff;
+}
+
+std::string RatioToPercentString(double ratio) {
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(2) << std::showpos
+     << (ratio - 1) * 100 << "%";
+  return ss.str();
+}
+
+std::string ToString(const MeasurementDiff& diff) {
+  std::stringstream ss;
+  ss << RatioToPercentString(diff.ratio) << " (p=" << std::setprecision(2)
+     << diff.p_value << ")";
+  if (diff.regression) ss << " REGRESSION";
+  return ss.str();
+}
+
+}  // namespace
+
+double WilcoxonSignedRankPValue(const std::vector<double>& differences) {
+  std::vector<double> magnitudes;
+  magnitudes.reserve(differences.size());
+  for (const double difference : differences) {
+    if (difference != 0) magnitudes.push_back(difference);
+  }
+  const double n = static_cast<double>(magnitudes.size());
+  if (magnitudes.empty()) return 1;
+  std::sort(magnitudes.begin(), magnitudes.end(), [](double a, double b) {
+    return std::abs(a) < std::abs(b);
+  });
+
+  // Sum the ranks of the positive differences. Ties get their average rank.
+  double positive_rank_sum = 0;
+  double tie_correction = 0;
+  for (size_t first = 0; first < magnitudes.size();) {
+    size_t last = first + 1;
+    while (last < magnitudes.size() &&
+           std::abs(magnitudes[last]) == std::abs(magnitudes[first])) {
+      ++last;
+    }
+    const double rank = (first + 1 + last) / 2.;  // Ranks start at 1.
+    for (size_t i = first; i < last; ++i) {
+      if (magnitudes[i] > 0) positive_rank_sum += rank;
+    }
+    const double num_ties = static_cast<double>(last - first);
+    tie_correction += num_ties * num_ties * num_ties - num_ties;
+    first = last;
+  }
+
+  const double mean = n * (n + 1) / 4;
+  const double variance =
+      n * (n + 1) * (2 * n + 1) / 24 - tie_correction / 48;
+  if (variance <= 0) return 1;
+  const double deviation =
+      std::max(0., std::abs(positive_rank_sum - mean) - 0.5);
+  return std::erfc(deviation / std::sqrt(variance) / std::sqrt(2.));
+}
+
+std::string SettingsDiff::ToString() const {
+  std::stringstream ss;
+  ss << CodecName(codec_settings.codec) << " "
+     << SubsamplingToString(codec_settings.chroma_subsampling) << " effort "
+     << codec_settings.effort;
+  if (!codec_settings.build.empty()) {
+    ss << " " << CodecBuildName(codec_settings.build);
+  }
+  if (rendition_width != 0) ss << " " << rendition_width << "px wide";
+  ss << " over " << num_images << " images (" << num_tasks << " tasks, "
+     << num_size_changes << " size changes, " << num_size_quality_tradeoffs
+     << " traded for PSNR)" << std::endl
+     << "  encoded size:      "
+     << ::codec_compare_gen::ToString(encoded_size) << std::endl
+     << "  encoding duration: "
+     << ::codec_compare_gen::ToString(encoding_duration) << std::endl
+     << "  decoding duration: "
+     << ::codec_compare_gen::ToString(decoding_duration) << std::endl
+     << "  distortion deltas:";
+  for (size_t m = 0; m < kNumDistortionMetrics; ++m) {
+    ss << " " << kDistortionMetricToStr[m] << " " << std::showpos
+       << distortion_deltas[m] << std::noshowpos;
+  }
+  return ss.str();
+}
+
+StatusOr<Diff> DiffTaskOutputs(const std::vector<TaskOutput>& before,
+                               const std::vector<TaskOutput>& after,
+                               const DiffThresholds& thresholds, bool quiet) {
+  const std::unordered_map<std::string, ReducedTask> reduced_before =
+      ReduceRepetitions(before);
+  std::unordered_map<std::string, ReducedTask> reduced_after =
+      ReduceRepetitions(after);
+
+  Diff diff;
+  // Renditions are kept apart, so that adding one is not seen as a change.
+  std::map<std::tuple<Codec, Subsampling, int, std::string, uint32_t>,
+           SettingsAccumulator>
+      accumulators;
+  size_t num_matched = 0;
+  for (const auto& [key, reduced] : reduced_before) {
+    const auto it = reduced_after.find(key);
+    if (it == reduced_after.end()) {
+      ++diff.num_unmatched_before;
+      continue;
+    }
+    ++num_matched;
+    const TaskOutput& a = *reduced.task;
+    const TaskOutput& b = *it->second.task;
+    CHECK_OR_RETURN(a.image_width == b.image_width &&
+                        a.image_height == b.image_height &&
+                        a.num_frames == b.num_frames,
+                    quiet)
+        << "Image dimensions differ between " << a.Serialize() << " and "
+        << b.Serialize();
+
+    const CodecSettings& settings = a.task_input.codec_settings;
+    SettingsAccumulator& accumulator =
+        accumulators[{settings.codec, settings.chroma_subsampling,
+                      settings.effort, settings.build,
+                      a.task_input.rendition_width}];
+    accumulator.codec_settings = settings;
+    accumulator.rendition_width = a.task_input.rendition_width;
+    ++accumulator.num_tasks;
+    if (a.encoded_size != b.encoded_size) ++accumulator.num_size_changes;
+
+    std::vector<double> encoding_durations = reduced.encoding_durations;
+    std::vector<double> decoding_durations = reduced.decoding_durations;
+    ImageLogRatios& image = accumulator.images[a.task_input.image_path];
+    const double size_log_ratio =
+        LogRatio(static_cast<double>(b.encoded_size),
+                 static_cast<double>(a.encoded_size));
+    image.encoded_size += size_log_ratio;
+    const float psnr_before =
+        a.distortions[static_cast<size_t>(DistortionMetric::kLibwebp2Psnr)];
+    const float psnr_after =
+        b.distortions[static_cast<size_t>(DistortionMetric::kLibwebp2Psnr)];
+    if (size_log_ratio > 0 && psnr_after > psnr_before &&
+        psnr_after < kNoDistortion) {
+      ++accumulator.num_size_quality_tradeoffs;
+    } else {
+      image.encoded_size_at_same_quality += size_log_ratio;
+      ++image.count_at_same_quality;
+    }
+    image.encoding_duration +=
+        LogRatio(Median(it->second.encoding_durations),
+                 Median(encoding_durations));
+    image.decoding_duration +=
+        LogRatio(Median(it->second.decoding_durations),
+                 Median(decoding_durations));
+    ++image.count;
+
+    for (size_t m = 0; m < kNumDistortionMetrics; ++m) {
+      // Skip lossless pairs and lossy versus lossless pairs.
+      if (a.distortions[m] >= kNoDistortion ||
+          b.distortions[m] >= kNoDistortion) {
+        continue;
+      }
+      accumulator.distortion_sums[m] += b.distortions[m] - a.distortions[m];
+      ++accumulator.distortion_counts[m];
+    }
+  }
+  diff.num_unmatched_after = reduced_after.size() - num_matched;
+
+  for (const auto& [key, accumulator] : accumulators) {
+    SettingsDiff settings_diff;
+    settings_diff.codec_settings = accumulator.codec_settings;
+    settings_diff.rendition_width = accumulator.rendition_width;
+    settings_diff.num_images = accumulator.images.size();
+    settings_diff.num_tasks = accumulator.num_tasks;
+    settings_diff.num_size_changes = accumulator.num_size_changes;
+    settings_diff.num_size_quality_tradeoffs =
+        accumulator.num_size_quality_tradeoffs;
+
+    // Each image counts once in the statistical tests, whatever its number of
+    // qualities.
+    std::vector<double> sizes, sizes_at_same_quality, encoding_durations,
+        decoding_durations;
+    for (const auto& [image_path, image] : accumulator.images) {
+      sizes.push_back(image.encoded_size / image.count);
+      if (image.count_at_same_quality != 0) {
+        sizes_at_same_quality.push_back(image.encoded_size_at_same_quality /
+                                        image.count_at_same_quality);
+      }
+      encoding_durations.push_back(image.encoding_duration / image.count);
+      decoding_durations.push_back(image.decoding_duration / image.count);
+    }
+    // Sizes are deterministic so any change above the threshold counts, unless
+    // it bought a better PSNR.
+    settings_diff.encoded_size =
+        ToMeasurementDiff(sizes, thresholds.max_size_increase,
+                          thresholds.significance,
+                          /*needs_significance=*/false);
+    settings_diff.encoded_size.regression =
+        ToMeasurementDiff(sizes_at_same_quality, thresholds.max_size_increase,
+                          thresholds.significance,
+                          /*needs_significance=*/false)
+            .regression;
+    settings_diff.encoding_duration =
+        ToMeasurementDiff(encoding_durations, thresholds.max_encoding_slowdown,
+                          thresholds.significance,
+                          /*needs_significance=*/true);
+    settings_diff.decoding_duration =
+        ToMeasurementDiff(decoding_durations, thresholds.max_decoding_slowdown,
+                          thresholds.significance,
+                          /*needs_significance=*/true);
+    for (size_t m = 0; m < kNumDistortionMetrics; ++m) {
+      if (accumulator.distortion_counts[m] > 0) {
+        settings_diff.distortion_deltas[m] =
+            accumulator.distortion_sums[m] / accumulator.distortion_counts[m];
+      }
+    }
+    diff.settings.push_back(settings_diff);
+  }
+  return diff;
+}
+
+}  // namespace codec_compare_gen
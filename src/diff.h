@@ -0,0 +1,92 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_DIFF_H_
+#define SRC_DIFF_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "src/base.h"
+#include "src/framework.h"
+#include "src/task.h"
+
+namespace codec_compare_gen {
+
+// Differences above which a change is considered a regression.
+struct DiffThresholds {
+  double max_size_increase = 0.001;     // 0.1%
+  double max_encoding_slowdown = 0.05;  // 5%
+  double max_decoding_slowdown = 0.05;  // 5%
+  // Timing changes with a higher p-value are considered noise.
+  double significance = 0.01;
+};
+
+// Change of one measurement between two runs, paired by image.
+struct MeasurementDiff {
+  // Geometric mean of the after/before ratios. Above 1 means bigger or slower.
+  double ratio = 1;
+  // Two-sided p-value of the Wilcoxon signed-rank test over images.
+  double p_value = 1;
+  bool regression = false;
+};
+
+// Changes between two runs of the same codec, chroma subsampling, effort,
+// build and rendition width, over the images and qualities present in both
+// runs.
+struct SettingsDiff {
+  CodecSettings codec_settings;  // quality is irrelevant.
+  uint32_t rendition_width = 0;  // See TaskInput::rendition_width.
+  size_t num_images = 0;
+  size_t num_tasks = 0;  // Pairs of image,quality.
+  size_t num_size_changes = 0;
+  // Pairs whose size increased while their PSNR improved. They are not
+  // considered for the encoded_size regression, as the encoder traded bytes
+  // for quality at the same setting.
+  size_t num_size_quality_tradeoffs = 0;
+  MeasurementDiff encoded_size;
+  MeasurementDiff encoding_duration;
+  MeasurementDiff decoding_duration;
+  // Mean of the after-before differences, in DistortionMetric order.
+  double distortion_deltas[kNumDistortionMetrics] = {};
+
+  bool regression() const {
+    return encoded_size.regression || encoding_duration.regression ||
+           decoding_duration.regression;
+  }
+  std::string ToString() const;
+};
+
+struct Diff {
+  std::vector<SettingsDiff> settings;
+  size_t num_unmatched_before = 0;  // Tasks only present in before.
+  size_t num_unmatched_after = 0;   // Tasks only present in after.
+};
+
+// Matches the tasks of two runs by codec settings and image path. Repetitions
+// are reduced to their median durations before pairing.
+StatusOr<Diff> DiffTaskOutputs(const std::vector<TaskOutput>& before,
+                               const std::vector<TaskOutput>& after,
+                               const DiffThresholds& thresholds, bool quiet);
+
+// Returns the two-sided p-value of the Wilcoxon signed-rank test of the
+// hypothesis that the differences are symmetric around zero. Uses the normal
+// approximation, with tie and continuity corrections.
+double WilcoxonSignedRankPValue(const std::vector<double>& differences);
+
+}  // namespace codec_compare_gen
+
+#endif  // SRC_DIFF_H_
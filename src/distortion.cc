@@ -15,6 +15,7 @@
 #include "src/distortion.h"
 
 #include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
@@ -24,6 +25,7 @@
 #include <memory>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include "src/base.h"
 #include "src/codec.h"
@@ -154,12 +156,12 @@ StatusOr<std::string> GetBinaryDistortion(const std::string& reference_path,
                                           const TaskInput& task,
                                           const std::string& metric_binary_path,
                                           size_t thread_id, bool quiet) {
-  CHECK_OR_RETURN(!reference_path.empty(), quiet);
   CHECK_OR_RETURN(!metric_binary_path.empty(), quiet);
 
   // Create a PNG file containing the original pixels of the current frame if
-  // not PNG (could be a GIF with multiple frames for example).
-  const bool maybeAnimated = !EndsWith(reference_path, ".png");
+  // not on disk or not PNG (could be a GIF with multiple frames for example).
+  const bool maybeAnimated =
+      reference_path.empty() || !EndsWith(reference_path, ".png");
   std::string temp_reference_path;
   std::string_view final_reference_path = reference_path;
   if (maybeAnimated) {
@@ -284,39 +286,33 @@ StatusOr<float> GetDistortion(
   return Status::kUnknownError;
 }
 
-}  // namespace
+// Frames of a and b displayed at the same time.
+struct FramePair {
+  size_t a_index;
+  size_t b_index;
+  uint32_t duration_ms;  // 1 for still images.
+};
 
-StatusOr<float> GetAverageDistortion(
-    const std::string& a_path, const Image& a, const std::string& b_path,
-    const Image& b, const TaskInput& task,
-    const std::string& metric_binary_folder_path, DistortionMetric metric,
-    size_t thread_id, bool quiet) {
+// Returns the consecutive FramePairs covering the whole animations a and b.
+StatusOr<std::vector<FramePair>> AlignFrames(const Image& a, const Image& b,
+                                             bool quiet) {
   CHECK_OR_RETURN(!a.empty() && !b.empty(), quiet);
   if (a.size() == 1 && b.size() == 1) {
-    return GetDistortion(a_path, a.front().pixels, b_path, b.front().pixels,
-                         task, metric_binary_folder_path, metric, thread_id,
-                         quiet);
+    return std::vector<FramePair>{{0, 0, /*duration_ms=*/1}};
   }
 
   const uint32_t a_duration_ms = GetDurationMs(a);
   CHECK_OR_RETURN(a_duration_ms > 0, quiet);
   CHECK_OR_RETURN(a_duration_ms == GetDurationMs(b), quiet);
 
-  float distortion_sum = 0;
+  std::vector<FramePair> pairs;
   size_t a_index = 0, b_index = 0;
   uint32_t previous_time = 0, a_time = 0, b_time = 0;  // milliseconds
   do {
-    ASSIGN_OR_RETURN(
-        const float distortion,
-        GetDistortion(a_path, a[a_index].pixels, b_path, b[b_index].pixels,
-                      task, metric_binary_folder_path, metric, thread_id,
-                      quiet));
-
     const uint32_t next_a_time = a_time + a[a_index].duration_ms;
     const uint32_t next_b_time = b_time + b[b_index].duration_ms;
     const uint32_t current_time = std::min(next_a_time, next_b_time);
-    // Weigh the distortion by frame duration.
-    distortion_sum += distortion * (current_time - previous_time);
+    pairs.push_back({a_index, b_index, current_time - previous_time});
 
     if (current_time >= next_a_time) {
       ++a_index;
@@ -330,7 +326,170 @@ StatusOr<float> GetAverageDistortion(
   } while (a_index < a.size() && b_index < b.size());
   CHECK_OR_RETURN(a_index == a.size() && b_index == b.size(), quiet);
   CHECK_OR_RETURN(a_time == b_time && a_time == a_duration_ms, quiet);
-  return distortion_sum / a_duration_ms;
+  return pairs;
+}
+
+// Evaluates a systematic sample of tiles of large frames for the metrics
+// computed in-process. The binaries are given whole frames.
+StatusOr<SampledDistortion> GetSampledFrameDistortion(
+    const std::string& reference_path, const WP2::ArgbBuffer& reference,
+    const std::string& image_path, const WP2::ArgbBuffer& image,
+    const TaskInput& task, const std::string& metric_binary_folder_path,
+    DistortionMetric metric, size_t thread_id, bool quiet) {
+  const bool is_psnr = metric == DistortionMetric::kLibwebp2Psnr;
+  const bool in_process = is_psnr || metric == DistortionMetric::kLibwebp2Ssim;
+  const uint32_t num_columns =
+      (reference.width() + kSampledTileSize - 1) / kSampledTileSize;
+  const uint32_t num_rows =
+      (reference.height() + kSampledTileSize - 1) / kSampledTileSize;
+  const size_t num_tiles = static_cast<size_t>(num_columns) * num_rows;
+  if (!in_process || num_tiles <= kNumSampledTiles) {
+    SampledDistortion distortion;
+    ASSIGN_OR_RETURN(distortion.value,
+                     GetDistortion(reference_path, reference, image_path, image,
+                                   task, metric_binary_folder_path, metric,
+                                   thread_id, quiet));
+    return distortion;
+  }
+  CHECK_OR_RETURN(image.width() == reference.width() &&
+                      image.height() == reference.height(),
+                  quiet);
+
+  // PSNR is averaged as mean squared errors, proportional to 10^(-PSNR/10).
+  double weighted_sum = 0, weight_sum = 0;
+  double values[kNumSampledTiles], weights[kNumSampledTiles];
+  for (size_t i = 0; i < kNumSampledTiles; ++i) {
+    const size_t tile = (2 * i + 1) * num_tiles / (2 * kNumSampledTiles);
+    const uint32_t x = static_cast<uint32_t>(tile % num_columns) *
+                       kSampledTileSize;
+    const uint32_t y = static_cast<uint32_t>(tile / num_columns) *
+                       kSampledTileSize;
+    const WP2::Rectangle window(
+        x, y, std::min(kSampledTileSize, reference.width() - x),
+        std::min(kSampledTileSize, reference.height() - y));
+    WP2::ArgbBuffer reference_tile(reference.format());
+    WP2::ArgbBuffer image_tile(image.format());
+    CHECK_OR_RETURN(
+        reference_tile.SetView(reference, window) == WP2_STATUS_OK &&
+            image_tile.SetView(image, window) == WP2_STATUS_OK,
+        quiet);
+    ASSIGN_OR_RETURN(const float tile_distortion,
+                     GetDistortion(reference_path, reference_tile, image_path,
+                                   image_tile, task, metric_binary_folder_path,
+                                   metric, thread_id, quiet));
+    values[i] = is_psnr ? std::pow(10.0, -tile_distortion / 10.0)
+                        : tile_distortion;
+    weights[i] = static_cast<double>(window.width) * window.height;
+    weighted_sum += values[i] * weights[i];
+    weight_sum += weights[i];
+  }
+  const double mean = weighted_sum / weight_sum;
+  double variance = 0;
+  for (size_t i = 0; i < kNumSampledTiles; ++i) {
+    variance += weights[i] * (values[i] - mean) * (values[i] - mean);
+  }
+  variance = variance / weight_sum * kNumSampledTiles / (kNumSampledTiles - 1);
+  // With the finite population correction.
+  const double standard_error = std::sqrt(
+      (1 - static_cast<double>(kNumSampledTiles) / num_tiles) * variance /
+      kNumSampledTiles);
+
+  SampledDistortion distortion;
+  distortion.sampled = true;
+  if (is_psnr) {
+    distortion.value = static_cast<float>(-10 * std::log10(mean));
+    // First-order propagation of the error through the logarithm.
+    distortion.error =
+        static_cast<float>(10 / std::log(10.0) * standard_error / mean);
+  } else {
+    distortion.value = static_cast<float>(mean);
+    distortion.error = static_cast<float>(standard_error);
+  }
+  return distortion;
+}
+
+}  // namespace
+
+StatusOr<float> GetAverageDistortion(
+    const std::string& a_path, const Image& a, const std::string& b_path,
+    const Image& b, const TaskInput& task,
+    const std::string& metric_binary_folder_path, DistortionMetric metric,
+    size_t thread_id, bool quiet) {
+  ASSIGN_OR_RETURN(const std::vector<FramePair> pairs,
+                   AlignFrames(a, b, quiet));
+  float distortion_sum = 0;
+  uint32_t duration_ms = 0;
+  for (const FramePair& pair : pairs) {
+    ASSIGN_OR_RETURN(const float distortion,
+                     GetDistortion(a_path, a[pair.a_index].pixels, b_path,
+                                   b[pair.b_index].pixels, task,
+                                   metric_binary_folder_path, metric, thread_id,
+                                   quiet));
+    // Weigh the distortion by frame duration.
+    distortion_sum += distortion * pair.duration_ms;
+    duration_ms += pair.duration_ms;
+  }
+  return distortion_sum / duration_ms;
+}
+
+StatusOr<SampledDistortion> GetSampledDistortion(
+    const std::string& a_path, const Image& a, const std::string& b_path,
+    const Image& b, const TaskInput& task,
+    const std::string& metric_binary_folder_path, DistortionMetric metric,
+    size_t thread_id, bool quiet) {
+  ASSIGN_OR_RETURN(const std::vector<FramePair> pairs,
+                   AlignFrames(a, b, quiet));
+  const auto get_distortion =
+      [&](const FramePair& pair) -> StatusOr<SampledDistortion> {
+    return GetSampledFrameDistortion(
+        a_path, a[pair.a_index].pixels, b_path, b[pair.b_index].pixels, task,
+        metric_binary_folder_path, metric, thread_id, quiet);
+  };
+  uint32_t duration_ms = 0;
+  for (const FramePair& pair : pairs) duration_ms += pair.duration_ms;
+
+  SampledDistortion result;
+  double value = 0, variance = 0;
+  if (pairs.size() <= kNumSampledFramePairs) {
+    for (const FramePair& pair : pairs) {
+      ASSIGN_OR_RETURN(const SampledDistortion distortion,
+                       get_distortion(pair));
+      const double weight = static_cast<double>(pair.duration_ms) / duration_ms;
+      value += weight * distortion.value;
+      variance += weight * weight * distortion.error * distortion.error;
+      result.sampled |= distortion.sampled;
+    }
+  } else {
+    // One frame pair per stratum, displayed at the middle of that stratum.
+    double samples[kNumSampledFramePairs];
+    size_t pair_index = 0;
+    uint64_t pair_end_ms = pairs.front().duration_ms;
+    for (size_t s = 0; s < kNumSampledFramePairs; ++s) {
+      const uint64_t time_ms = (2 * s + 1) *
+                               static_cast<uint64_t>(duration_ms) /
+                               (2 * kNumSampledFramePairs);
+      while (time_ms >= pair_end_ms) {
+        pair_end_ms += pairs[++pair_index].duration_ms;
+      }
+      ASSIGN_OR_RETURN(const SampledDistortion distortion,
+                       get_distortion(pairs[pair_index]));
+      samples[s] = distortion.value;
+      value += distortion.value / kNumSampledFramePairs;
+      variance += distortion.error * distortion.error /
+                  (kNumSampledFramePairs * kNumSampledFramePairs);
+    }
+    // Variance between strata estimated by collapsing them in pairs.
+    static_assert(kNumSampledFramePairs % 2 == 0);
+    for (size_t s = 0; s < kNumSampledFramePairs; s += 2) {
+      const double difference = samples[s] - samples[s + 1];
+      variance += difference * difference /
+                  (kNumSampledFramePairs * kNumSampledFramePairs);
+    }
+    result.sampled = true;
+  }
+  result.value = static_cast<float>(value);
+  result.error = static_cast<float>(std::sqrt(variance));
+  return result;
 }
 
 StatusOr<bool> PixelEquality(const WP2::ArgbBuffer& a, const WP2::ArgbBuffer& b,
@@ -388,6 +547,12 @@ StatusOr<float> GetAverageDistortion(const std::string&, const Image&,
                                      DistortionMetric, size_t, bool quiet) {
   CHECK_OR_RETURN(false, quiet) << "Computing distortions requires HAS_WEBP2";
 }
+StatusOr<SampledDistortion> GetSampledDistortion(
+    const std::string&, const Image&, const std::string&, const Image&,
+    const TaskInput&, const std::string&, DistortionMetric, size_t,
+    bool quiet) {
+  CHECK_OR_RETURN(false, quiet) << "Computing distortions requires HAS_WEBP2";
+}
 StatusOr<bool> PixelEquality(const Image&, const Image&, bool quiet) {
   CHECK_OR_RETURN(false, quiet) << "Equality check requires HAS_WEBP2";
 }
@@ -16,6 +16,7 @@
 #define SRC_DISTORTION_H_
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
 
 #include "src/base.h"
@@ -29,13 +30,39 @@
 namespace codec_compare_gen {
 
 // Computes the average distortion between the given frame sequences.
-// They must have the same total duration.
+// They must have the same total duration. a_path and b_path are the files the
+// frame sequences were read from, or empty if they only exist in memory. The
+// metric binaries are given temporary PNG files unless both are PNG files.
 StatusOr<float> GetAverageDistortion(
     const std::string& a_path, const Image& a, const std::string& b_path,
     const Image& b, const TaskInput& task,
     const std::string& metric_binary_folder_path, DistortionMetric metric,
     size_t thread_id, bool quiet);
 
+// Number of frame pairs evaluated by GetSampledDistortion() in animations.
+constexpr size_t kNumSampledFramePairs = 8;
+// Size in pixels of the square tiles of a frame, and number of tiles evaluated
+// by GetSampledDistortion() in larger frames, for the libwebp2 metrics.
+constexpr uint32_t kSampledTileSize = 256;
+constexpr size_t kNumSampledTiles = 16;
+
+struct SampledDistortion {
+  float value = 0;
+  float error = 0;       // Estimated standard error of value.
+  bool sampled = false;  // False if all frames and pixels were evaluated.
+};
+
+// Same as GetAverageDistortion() but only evaluates a subset of the frames of
+// animations, at the middle of kNumSampledFramePairs strata of equal duration,
+// and for the metrics computed in-process, a subset of kNumSampledTiles tiles
+// of larger frames, evenly spread in raster order. The sampling is
+// deterministic.
+StatusOr<SampledDistortion> GetSampledDistortion(
+    const std::string& a_path, const Image& a, const std::string& b_path,
+    const Image& b, const TaskInput& task,
+    const std::string& metric_binary_folder_path, DistortionMetric metric,
+    size_t thread_id, bool quiet);
+
 // Returns true if all pixels match between the two given frame sequences.
 // They must have the same total duration.
 StatusOr<bool> PixelEquality(const Image& a, const Image& b, bool quiet);
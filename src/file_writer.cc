@@ -0,0 +1,195 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/file_writer.h"
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "src/base.h"
+#include "src/timer.h"
+
+#if defined(HAS_WEBP2)
+#include "third_party/libwebp2/src/wp2/base.h"
+#endif
+
+namespace codec_compare_gen {
+
+namespace {
+
+Status WriteFile(const std::string& file_path, const uint8_t* bytes,
+                 size_t size, bool quiet) {
+  const int fd = open(file_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  CHECK_OR_RETURN(fd >= 0, quiet)
+      << "Could not open " << file_path << ": " << std::strerror(errno);
+  size_t offset = 0;
+  while (offset < size) {
+    const ssize_t num_bytes = pwrite(fd, bytes + offset, size - offset,
+                                     static_cast<off_t>(offset));
+    if (num_bytes < 0 && errno == EINTR) continue;
+    if (num_bytes <= 0) {
+      const int error = errno;
+      close(fd);
+      CHECK_OR_RETURN(false, quiet)
+          << "Could not write " << file_path << ": " << std::strerror(error);
+    }
+    offset += static_cast<size_t>(num_bytes);
+  }
+  CHECK_OR_RETURN(close(fd) == 0, quiet)
+      << "Could not close " << file_path << ": " << std::strerror(errno);
+  return Status::kOk;
+}
+
+}  // namespace
+
+FileWriter::FileWriter(bool quiet, size_t max_pending_bytes)
+    : quiet_(quiet),
+      max_pending_bytes_(max_pending_bytes),
+      thread_(&FileWriter::Run, this) {}
+
+FileWriter::~FileWriter() { Finish(); }
+
+#if defined(HAS_WEBP2)
+std::future<Status> FileWriter::Write(const std::string& file_path,
+                                      WP2::Data&& data) {
+  PendingFile file;
+  file.path = file_path;
+  file.bytes = data.bytes;
+  file.size = data.size;
+  file.data = std::move(data);
+  std::future<Status> written = file.written.get_future();
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    assert(!finishing_);
+    // A file larger than the limit is still accepted once the queue is empty.
+    space_available_.wait(lock, [this, &file]() {
+      return num_pending_bytes_ == 0 ||
+             num_pending_bytes_ + file.size <= max_pending_bytes_;
+    });
+    num_pending_bytes_ += file.size;
+    pending_files_.push_back(std::move(file));
+  }
+  wake_up_.notify_one();
+  return written;
+}
+#endif
+
+Status FileWriter::Finish() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finishing_ = true;
+  }
+  wake_up_.notify_one();
+  if (thread_.joinable()) thread_.join();
+  std::lock_guard<std::mutex> lock(mutex_);
+  return status_;
+}
+
+void FileWriter::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    wake_up_.wait(lock,
+                  [this]() { return finishing_ || !pending_files_.empty(); });
+    if (pending_files_.empty()) return;  // Finishing.
+    std::vector<PendingFile> batch;
+    batch.swap(pending_files_);
+    lock.unlock();
+
+    const Timer timer;
+    Status status = Status::kOk;
+    size_t num_files = 0, num_bytes = 0;
+    size_t num_batch_bytes = 0;
+    for (PendingFile& file : batch) {
+      Status file_status = CreateParentDirectory(file.path);
+      if (file_status == Status::kOk) {
+        file_status = WriteFile(file.path, file.bytes, file.size, quiet_);
+      }
+      if (file_status == Status::kOk) {
+        ++num_files;
+        num_bytes += file.size;
+      } else if (status == Status::kOk) {
+        status = file_status;
+      }
+      num_batch_bytes += file.size;
+      file.written.set_value(file_status);
+    }
+    const double duration = timer.seconds();
+    batch.clear();  // Free the buffers before taking the lock again.
+
+    lock.lock();
+    if (status_ == Status::kOk) status_ = status;
+    num_pending_bytes_ -= num_batch_bytes;
+    num_written_files_ += num_files;
+    num_written_bytes_ += num_bytes;
+    ++num_batches_;
+    write_duration_ += duration;
+    space_available_.notify_all();
+  }
+}
+
+Status FileWriter::CreateParentDirectory(const std::string& file_path) {
+  const std::string directory =
+      std::filesystem::path(file_path).parent_path().string();
+  if (directory.empty() || created_directories_.count(directory) != 0) {
+    return Status::kOk;
+  }
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+  CHECK_OR_RETURN(!error, quiet_)
+      << "Could not create " << directory << ": " << error.message();
+  created_directories_.insert(directory);
+  return Status::kOk;
+}
+
+size_t FileWriter::num_written_files() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_written_files_;
+}
+
+size_t FileWriter::num_written_bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_written_bytes_;
+}
+
+size_t FileWriter::num_batches() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_batches_;
+}
+
+double FileWriter::write_duration() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return write_duration_;
+}
+
+double FileWriter::throughput() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return write_duration_ > 0 ? num_written_bytes_ / write_duration_ : 0;
+}
+
+}  // namespace codec_compare_gen
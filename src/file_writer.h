@@ -0,0 +1,105 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_FILE_WRITER_H_
+#define SRC_FILE_WRITER_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "src/base.h"
+
+#if defined(HAS_WEBP2)
+#include "third_party/libwebp2/src/wp2/base.h"
+#endif
+
+namespace codec_compare_gen {
+
+// Writes files from a background thread so that the callers do not wait for the
+// disk, unless more than max_pending_bytes are queued. The files queued while a
+// batch is written make up the next batch. The missing parent directories of
+// the files are created along the way.
+class FileWriter {
+ public:
+  static constexpr size_t kDefaultMaxPendingBytes = size_t{256} << 20;
+
+  explicit FileWriter(bool quiet,
+                      size_t max_pending_bytes = kDefaultMaxPendingBytes);
+  FileWriter(const FileWriter&) = delete;
+  FileWriter& operator=(const FileWriter&) = delete;
+  ~FileWriter();  // Calls Finish().
+
+#if defined(HAS_WEBP2)
+  // Takes ownership of the data and queues it for writing. Blocks while the
+  // queued files that are not written yet exceed max_pending_bytes. The
+  // returned future is ready once the file is on disk (or failed to be). Must
+  // not be called after Finish().
+  std::future<Status> Write(const std::string& file_path, WP2::Data&& data);
+#endif
+
+  // Waits for all queued files to be written and stops the thread. Returns the
+  // status of the first failed write, if any.
+  Status Finish();
+
+  // Statistics about the files written so far.
+  size_t num_written_files() const;
+  size_t num_written_bytes() const;
+  size_t num_batches() const;
+  double write_duration() const;  // in seconds, spent in batches
+  // Bytes per second of write_duration(), 0 if nothing was written.
+  double throughput() const;
+
+ private:
+  struct PendingFile {
+    std::string path;
+    const uint8_t* bytes;
+    size_t size;
+    std::promise<Status> written;
+#if defined(HAS_WEBP2)
+    WP2::Data data;  // Owns the bytes.
+#endif
+  };
+
+  void Run();
+  // Creates the missing directories of the file_path once per directory.
+  Status CreateParentDirectory(const std::string& file_path);
+
+  const bool quiet_;
+  const size_t max_pending_bytes_;
+  mutable std::mutex mutex_;
+  std::condition_variable wake_up_;
+  std::condition_variable space_available_;  // Signaled after each batch.
+  std::vector<PendingFile> pending_files_;
+  size_t num_pending_bytes_ = 0;  // Queued or in the batch being written.
+  bool finishing_ = false;
+  Status status_ = Status::kOk;  // kOk or first encountered error.
+  size_t num_written_files_ = 0;
+  size_t num_written_bytes_ = 0;
+  size_t num_batches_ = 0;
+  double write_duration_ = 0;
+  // Only accessed by thread_.
+  std::unordered_set<std::string> created_directories_;
+  std::thread thread_;  // Last so that it starts after the fields above.
+};
+
+}  // namespace codec_compare_gen
+
+#endif  // SRC_FILE_WRITER_H_
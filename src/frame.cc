@@ -19,12 +19,15 @@
 #if defined(HAS_WEBP2)
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <utility>
+#include <vector>
 
 #include "src/base.h"
 #include "src/codec_webp.h"
 #include "src/distortion.h"
 #include "src/task.h"
+#include "src/yuv.h"
 #include "third_party/libwebp2/imageio/anim_image_dec.h"
 #include "third_party/libwebp2/imageio/image_enc.h"
 #include "third_party/libwebp2/src/wp2/base.h"
@@ -40,6 +43,16 @@ uint32_t GetDurationMs(const Image& image) {
   return duration_ms;
 }
 
+uint16_t ReduceSample(uint16_t sample, uint32_t bit_depth) {
+  const uint32_t max_value = (1u << bit_depth) - 1;
+  return static_cast<uint16_t>((sample * max_value + 32767u) / 65535u);
+}
+
+uint16_t ExpandSample(uint16_t sample, uint32_t bit_depth) {
+  const uint32_t max_value = (1u << bit_depth) - 1;
+  return static_cast<uint16_t>((sample * 65535u + max_value / 2) / max_value);
+}
+
 #if defined(HAS_WEBP2)
 
 StatusOr<Image> CloneAs(const Image& from, WP2SampleFormat format, bool quiet) {
@@ -53,6 +66,7 @@ StatusOr<Image> CloneAs(const Image& from, WP2SampleFormat format, bool quiet) {
     CHECK_OR_RETURN(WP2Formatbpc(to.back().pixels.format()) ==
                         WP2Formatbpc(frame.pixels.format()),
                     quiet);
+    to.back().yuv = frame.yuv;
   }
   return to;
 }
@@ -78,6 +92,64 @@ StatusOr<Image> SpreadTo8bit(const Image& from, bool quiet) {
   return to;
 }
 
+namespace {
+
+// Returns true if all samples of the frames round trip through bit_depth.
+bool FitsInBitDepth(const Image& image, uint32_t bit_depth) {
+  for (const Frame& frame : image) {
+    const WP2::ArgbBuffer& pixels = frame.pixels;
+    if (WP2Formatbpc(pixels.format()) <= 8) continue;
+    const uint32_t num_samples =
+        pixels.width() * WP2FormatNumChannels(pixels.format());
+    for (uint32_t y = 0; y < pixels.height(); ++y) {
+      const uint16_t* row = pixels.GetRow16(y);
+      for (uint32_t i = 0; i < num_samples; ++i) {
+        if (ExpandSample(ReduceSample(row[i], bit_depth), bit_depth) !=
+            row[i]) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+uint32_t GetSignificantBitDepth(const Image& image) {
+  // Each bit depth is checked separately because an 8-bit sample expanded to
+  // 16 bits does not necessarily round trip through 10 or 12 bits.
+  for (const uint32_t bit_depth : {8u, 10u, 12u}) {
+    if (FitsInBitDepth(image, bit_depth)) return bit_depth;
+  }
+  return 16;
+}
+
+StatusOr<Image> ReduceTo8bit(const Image& from, bool quiet) {
+  Image to;
+  to.reserve(from.size());
+  for (const Frame& frame : from) {
+    CHECK_OR_RETURN(WP2Formatbpc(frame.pixels.format()) == 16, quiet);
+    const WP2SampleFormat format = WP2FormatAtbpc(frame.pixels.format(), 8);
+    CHECK_OR_RETURN(format != WP2_FORMAT_NUM, quiet);
+    to.emplace_back(WP2::ArgbBuffer(format), frame.duration_ms);
+    WP2::ArgbBuffer& pixels = to.back().pixels;
+    CHECK_OR_RETURN(pixels.Resize(frame.pixels.width(),
+                                  frame.pixels.height()) == WP2_STATUS_OK,
+                    quiet);
+    const uint32_t num_samples =
+        pixels.width() * WP2FormatNumChannels(pixels.format());
+    for (uint32_t y = 0; y < pixels.height(); ++y) {
+      const uint16_t* src = frame.pixels.GetRow16(y);
+      uint8_t* dst = pixels.GetRow8(y);
+      for (uint32_t i = 0; i < num_samples; ++i) {
+        dst[i] = static_cast<uint8_t>(ReduceSample(src[i], /*bit_depth=*/8));
+      }
+    }
+  }
+  return to;
+}
+
 StatusOr<Image> MakeView(const Image& from, bool quiet) {
   Image to;
   to.reserve(from.size());
@@ -85,12 +157,61 @@ StatusOr<Image> MakeView(const Image& from, bool quiet) {
     to.emplace_back(WP2::ArgbBuffer(frame.pixels.format()), frame.duration_ms);
     CHECK_OR_RETURN(to.back().pixels.SetView(frame.pixels) == WP2_STATUS_OK,
                     quiet);
+    to.back().yuv = frame.yuv;
   }
   return to;
 }
 
+namespace {
+
+StatusOr<Image> ReadYuvImage(const char* file_path, WP2SampleFormat format,
+                             bool quiet) {
+  ASSIGN_OR_RETURN(YuvImage yuv, ReadYuvFile(file_path, quiet));
+  // The RGB reference keeps the bit depth of the samples. 10-bit ones are
+  // stored in 16-bit frames as 16-bit PNG files do (see ExpandSample()).
+  const std::vector<uint16_t> rgb = YuvToRgb(yuv, yuv.bit_depth);
+
+  const bool is_16bit = yuv.bit_depth > 8;
+  WP2::ArgbBuffer buffer(is_16bit ? WP2_ARGB_64 : WP2_ARGB_32);
+  CHECK_OR_RETURN(buffer.Resize(yuv.width, yuv.height) == WP2_STATUS_OK,
+                  quiet);
+  const uint16_t* sample = rgb.data();
+  for (uint32_t y = 0; y < yuv.height; ++y) {
+    if (is_16bit) {
+      uint16_t* argb = buffer.GetRow16(y);
+      for (uint32_t x = 0; x < yuv.width; ++x, sample += 3, argb += 4) {
+        argb[0] = 0xffffu;
+        for (int c = 0; c < 3; ++c) {
+          argb[1 + c] = ExpandSample(sample[c], yuv.bit_depth);
+        }
+      }
+    } else {
+      uint8_t* argb = buffer.GetRow8(y);
+      for (uint32_t x = 0; x < yuv.width; ++x, sample += 3, argb += 4) {
+        argb[0] = 0xffu;
+        for (int c = 0; c < 3; ++c) {
+          argb[1 + c] = static_cast<uint8_t>(sample[c]);
+        }
+      }
+    }
+  }
+
+  format = WP2FormatAtbpc(format, WP2Formatbpc(buffer.format()));
+  CHECK_OR_RETURN(format != WP2_FORMAT_NUM, quiet);
+  Image image;
+  image.emplace_back(WP2::ArgbBuffer(format), /*duration_ms=*/0);
+  CHECK_OR_RETURN(image.back().pixels.ConvertFrom(buffer) == WP2_STATUS_OK,
+                  quiet);
+  image.back().yuv = std::make_shared<const YuvImage>(std::move(yuv));
+  return image;
+}
+
+}  // namespace
+
 StatusOr<Image> ReadStillImageOrAnimation(const char* file_path,
                                           WP2SampleFormat format, bool quiet) {
+  if (IsYuvFile(file_path)) return ReadYuvImage(file_path, format, quiet);
+
   // Reuse libwebp2's wrapper for simplicity.
   Image image;
   {
@@ -16,10 +16,12 @@
 #define SRC_FRAME_H_
 
 #include <cstdint>
+#include <memory>
 #include <utility>
 #include <vector>
 
 #include "src/base.h"
+#include "src/yuv.h"
 
 #if defined(HAS_WEBP2)
 #include "third_party/libwebp2/src/wp2/base.h"
@@ -35,8 +37,14 @@ struct Frame {
       : pixels(std::move(pixels)), duration_ms(duration_ms) {};
 
   WP2::ArgbBuffer pixels;
+  // Source samples if the frame was read from a YUV file, for codecs that can
+  // encode them as is. The pixels are the RGB conversion of these samples.
+  std::shared_ptr<const YuvImage> yuv;
 #endif
   uint32_t duration_ms;  // 0 for still images.
+  // Seconds from the start of the decoding until this frame was output, for
+  // the decoders that output frames one by one. 0 if not measured.
+  double decoded_after = 0;
 };
 
 // Still or animated image.
@@ -44,17 +52,33 @@ using Image = std::vector<Frame>;
 
 uint32_t GetDurationMs(const Image& image);
 
+// Converts a 16-bit sample to the closest value in [0:2^bit_depth-1], and
+// back. A 16-bit sample round trips if it was expanded from that bit depth, as
+// tools do when storing 10-bit or 12-bit content in 16-bit PNG files.
+uint16_t ReduceSample(uint16_t sample, uint32_t bit_depth);
+uint16_t ExpandSample(uint16_t sample, uint32_t bit_depth);
+
 #if defined(HAS_WEBP2)
 
 // Makes a deep copy of the given frame sequence and converts the pixels to the
 // given format.
 StatusOr<Image> CloneAs(const Image& from, WP2SampleFormat format, bool quiet);
+// Considers 16-bit frames to be 8-bit and twice as wide. Only for codecs that
+// cannot encode the samples natively (see GetSignificantBitDepth()).
 StatusOr<Image> SpreadTo8bit(const Image& from, bool quiet);
 
+// Returns the lowest bit depth among 8, 10, 12 and 16 that all the samples of
+// the frames round trip through with ReduceSample() and ExpandSample().
+uint32_t GetSignificantBitDepth(const Image& image);
+// Makes a deep copy of the 16-bit frames with 8-bit samples, reduced with
+// ReduceSample(). This is lossless if GetSignificantBitDepth() is 8.
+StatusOr<Image> ReduceTo8bit(const Image& from, bool quiet);
+
 // Makes a shallow copy of the given frame sequence.
 StatusOr<Image> MakeView(const Image& from, bool quiet);
 
-// Reads a file into a frame sequence.
+// Reads a file into a frame sequence. YUV files (see IsYuvFile()) are converted
+// to RGB and their source samples are kept in Frame::yuv.
 StatusOr<Image> ReadStillImageOrAnimation(const char* file_path,
                                           WP2SampleFormat format, bool quiet);
 
@@ -25,6 +25,7 @@
 #include <iomanip>
 #include <iostream>
 #include <random>
+#include <set>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -33,12 +34,29 @@
 #include <vector>
 
 #include "src/base.h"
+#include "src/build_comparison.h"
 #include "src/codec.h"
+#include "src/columnar.h"
+#include "src/cost_model.h"
+#include "src/dedup.h"
+#include "src/file_writer.h"
+#include "src/image_info.h"
+#include "src/rendition.h"
 #include "src/result_json.h"
 #include "src/serialization.h"
+#include "src/shared_image_cache.h"
+#include "src/simd.h"
+#include "src/summary.h"
+#include "src/system_conditions.h"
 #include "src/task.h"
 #include "src/timer.h"
 #include "src/worker.h"
+#include "src/yuv.h"
+
+#if defined(HAS_WEBP2)
+#include "src/frame.h"
+#include "third_party/libwebp2/src/wp2/base.h"
+#endif
 
 using seconds = std::chrono::duration<double>;
 using chrono = std::chrono::high_resolution_clock;
@@ -55,7 +73,11 @@ struct WorkerContext {
   std::unordered_set<std::string> written_files;
   std::string completed_tasks_file_path;
   std::ofstream completed_tasks_file;
+  std::ofstream failures_file;  // See TaskFailure.
   std::string metric_binary_folder_path;
+  // The RenditionCache, FileWriter and SystemSampler are thread-safe on their
+  // own.
+  EncodeDecodeOptions encode_decode_options;
   size_t num_tasks = 0;
   size_t num_failures = 0;
 
@@ -74,6 +96,7 @@ class TaskWorker : public Worker<WorkerContext, TaskWorker> {
     if (context.remaining_tasks.empty()) return false;
     current_task_input_ = context.remaining_tasks.back();
     metric_binary_folder_path_ = context.metric_binary_folder_path;
+    encode_decode_options_ = context.encode_decode_options;
     if (context.load_encoded_from_disk) {
       encode_mode_ = EncodeMode::kLoadFromDisk;
     } else {
@@ -92,10 +115,16 @@ class TaskWorker : public Worker<WorkerContext, TaskWorker> {
   }
 
   void DoTask() override {
+    LastErrorMessage().clear();
+    const Timer timer;
     current_task_output_ =
         EncodeDecode(current_task_input_, metric_binary_folder_path_,
-                     worker_id_, encode_mode_, quiet_);
-    if (current_task_output_.status != Status::kOk) return;
+                     worker_id_, encode_mode_, encode_decode_options_, quiet_);
+    if (current_task_output_.status != Status::kOk) {
+      failure_ = {current_task_input_, timer.seconds(), LastErrorMessage()};
+      return;
+    }
+    current_task_output_.value.task_duration = timer.seconds();
     serialized_current_task_output_ = current_task_output_.value.Serialize();
   }
 
@@ -111,6 +140,13 @@ class TaskWorker : public Worker<WorkerContext, TaskWorker> {
       if (context.status == Status::kOk) {
         context.status = current_task_output_.status;
       }
+      if (encode_mode_ == EncodeMode::kEncodeAndSaveToDisk) {
+        // The file may be missing, so let a repetition write it.
+        context.written_files.erase(current_task_input_.encoded_path);
+      }
+      if (context.failures_file.is_open()) {
+        context.failures_file << failure_.Serialize() << std::endl;
+      }
       --context.num_tasks;
       ++context.num_failures;
       if (context.num_failures > kMaxNumFailures) {
@@ -146,7 +182,9 @@ class TaskWorker : public Worker<WorkerContext, TaskWorker> {
   TaskInput current_task_input_;
   std::string metric_binary_folder_path_;
   EncodeMode encode_mode_ = EncodeMode::kEncode;
+  EncodeDecodeOptions encode_decode_options_;
   StatusOr<TaskOutput> current_task_output_ = Status::kUnknownError;
+  TaskFailure failure_;  // Only set if current_task_output_ is an error.
   std::string serialized_current_task_output_;
   bool quiet_;
 };
@@ -156,24 +194,26 @@ StatusOr<std::vector<TaskOutput>> LoadTasks(
     const std::string& completed_tasks_file_path) {
   std::vector<TaskOutput> completed_tasks;
   if (std::filesystem::exists(completed_tasks_file_path)) {
-    std::ifstream previous_completed_tasks_file(completed_tasks_file_path);
-    if (!previous_completed_tasks_file.is_open()) {
-      std::cerr << "Error: Could not open " << completed_tasks_file_path
-                << " for reading" << std::endl;
-      return Status::kUnknownError;
+    ASSIGN_OR_RETURN(completed_tasks,
+                     ReadTaskOutputs(completed_tasks_file_path,
+                                     settings.discard_distortion_values,
+                                     1 + settings.num_extra_threads,
+                                     settings.quiet));
+    for (const TaskOutput& task_output : completed_tasks) {
+      CHECK_OR_RETURN(task_output.simd_level == settings.simd_level,
+                      settings.quiet)
+          << "SIMD level " << SimdLevelToString(task_output.simd_level)
+          << " in " << completed_tasks_file_path << " does not match "
+          << SimdLevelToString(settings.simd_level)
+          << ", use one progress file per SIMD level";
+      CHECK_OR_RETURN(task_output.decode_timing == settings.decode_timing,
+                      settings.quiet)
+          << "Decode timing " << DecodeTimingToString(task_output.decode_timing)
+          << " in " << completed_tasks_file_path << " does not match "
+          << DecodeTimingToString(settings.decode_timing)
+          << ", use one progress file per decode timing";
     }
 
-    std::string line;
-    while (std::getline(previous_completed_tasks_file, line)) {
-      ASSIGN_OR_RETURN(
-          const TaskOutput task_output,
-          settings.discard_distortion_values
-              ? TaskOutput::UnserializeNoDistortion(line, settings.quiet)
-              : TaskOutput::Unserialize(line, settings.quiet));
-      completed_tasks.push_back(task_output);
-    }
-    previous_completed_tasks_file.close();
-
     if (!settings.quiet) {
       std::cout << "Loaded " << completed_tasks.size() << " tasks from "
                 << completed_tasks_file_path << std::endl;
@@ -182,6 +222,15 @@ StatusOr<std::vector<TaskOutput>> LoadTasks(
   return completed_tasks;
 }
 
+// Returns a disabled cache if settings.shared_image_cache_size is 0.
+StatusOr<SharedImageCache> OpenSharedImageCache(
+    const ComparisonSettings& settings) {
+  if (settings.shared_image_cache_size == 0) return SharedImageCache();
+  return SharedImageCache::Open(
+      settings.shared_image_cache_name,
+      uint64_t{settings.shared_image_cache_size} << 20, settings.quiet);
+}
+
 Status ComputeDistortionInCompletedTasks(
     const ComparisonSettings& settings,
     std::vector<TaskOutput>& completed_tasks) {
@@ -207,6 +256,13 @@ Status ComputeDistortionInCompletedTasks(
   context.quiet = settings.quiet;
   context.num_tasks = context.remaining_tasks.size();
   context.metric_binary_folder_path = settings.metric_binary_folder_path;
+  context.encode_decode_options.quick_metrics = settings.quick_metrics;
+  ASSIGN_OR_RETURN(SharedImageCache shared_image_cache,
+                   OpenSharedImageCache(settings));
+  RenditionCache rendition_cache(
+      settings.image_cache_size,
+      shared_image_cache.enabled() ? &shared_image_cache : nullptr);
+  context.encode_decode_options.rendition_cache = &rendition_cache;
 
   WorkerPool<WorkerContext, TaskWorker> pool(1 + settings.num_extra_threads);
   pool.Run(context);
@@ -229,6 +285,11 @@ Status ComputeDistortionInCompletedTasks(
       std::copy(it->second->distortions,
                 it->second->distortions + kNumDistortionMetrics,
                 completed_task.distortions);
+      completed_task.approximate_distortions =
+          it->second->approximate_distortions;
+      std::copy(it->second->distortion_errors,
+                it->second->distortion_errors + kNumDistortionMetrics,
+                completed_task.distortion_errors);
     }
   }
 
@@ -238,6 +299,97 @@ Status ComputeDistortionInCompletedTasks(
   return Status::kOk;
 }
 
+// Removes the tasks matching predicate from completed_tasks and from the file
+// at completed_tasks_file_path, so that they are evaluated again. reason
+// describes them in the log. The original file is backed up unless backed_up
+// is already true, so that a second removal does not overwrite the backup with
+// the output of the first one.
+template <typename Predicate>
+Status RemoveCompletedTasksIf(const ComparisonSettings& settings,
+                              const std::string& completed_tasks_file_path,
+                              Predicate predicate, const char* reason,
+                              std::vector<TaskOutput>& completed_tasks,
+                              bool& backed_up) {
+  const size_t num_removed_tasks = static_cast<size_t>(std::count_if(
+      completed_tasks.begin(), completed_tasks.end(), predicate));
+  if (num_removed_tasks == 0) return Status::kOk;
+  completed_tasks.erase(std::remove_if(completed_tasks.begin(),
+                                       completed_tasks.end(), predicate),
+                        completed_tasks.end());
+  if (!settings.quiet) {
+    std::cout << "Evaluating again " << num_removed_tasks << " tasks " << reason
+              << std::endl;
+  }
+
+  // Backup the old CSV file and dump the kept entries.
+  if (!backed_up) {
+    std::filesystem::rename(completed_tasks_file_path,
+                            completed_tasks_file_path + ".bck");
+    backed_up = true;
+  }
+  std::ofstream completed_tasks_file(completed_tasks_file_path,
+                                     std::ios::trunc);
+  CHECK_OR_RETURN(completed_tasks_file.is_open(), settings.quiet)
+      << "Could not open " << completed_tasks_file_path << " for writing";
+  for (const TaskOutput& completed_task : completed_tasks) {
+    completed_tasks_file << completed_task.Serialize() << std::endl;
+  }
+  return Status::kOk;
+}
+
+// Removes the tasks whose distortions were estimated by a previous run with
+// ComparisonSettings::quick_metrics, so that they are evaluated again in full.
+Status RemoveApproximateTasks(const ComparisonSettings& settings,
+                              const std::string& completed_tasks_file_path,
+                              std::vector<TaskOutput>& completed_tasks,
+                              bool& backed_up) {
+  return RemoveCompletedTasksIf(
+      settings, completed_tasks_file_path,
+      [](const TaskOutput& task) { return task.approximate_distortions; },
+      "with approximate distortions", completed_tasks, backed_up);
+}
+
+// Removes the tasks that were timed under abnormal system conditions, so that
+// they are measured again. See ComparisonSettings::remeasure_abnormal_timings.
+Status RemoveAbnormalTasks(const ComparisonSettings& settings,
+                           const std::string& completed_tasks_file_path,
+                           std::vector<TaskOutput>& completed_tasks,
+                           bool& backed_up) {
+  return RemoveCompletedTasksIf(
+      settings, completed_tasks_file_path,
+      [](const TaskOutput& task) { return task.system_conditions.abnormal; },
+      "timed under abnormal system conditions", completed_tasks, backed_up);
+}
+
+// Orders tasks by settings, then by image.
+struct TaskInputComp {
+  bool operator()(const TaskInput& a, const TaskInput& b) const {
+    if (a.codec_settings.codec < b.codec_settings.codec) return true;
+    if (a.codec_settings.codec > b.codec_settings.codec) return false;
+    if (a.codec_settings.chroma_subsampling <
+        b.codec_settings.chroma_subsampling) {
+      return true;
+    }
+    if (a.codec_settings.chroma_subsampling >
+        b.codec_settings.chroma_subsampling) {
+      return false;
+    }
+    if (a.codec_settings.effort < b.codec_settings.effort) return true;
+    if (a.codec_settings.effort > b.codec_settings.effort) return false;
+    if (a.codec_settings.quality < b.codec_settings.quality) return true;
+    if (a.codec_settings.quality > b.codec_settings.quality) return false;
+    if (a.codec_settings.build < b.codec_settings.build) return true;
+    if (a.codec_settings.build > b.codec_settings.build) return false;
+    if (a.rendition_width < b.rendition_width) return true;
+    if (a.rendition_width > b.rendition_width) return false;
+    return a.image_path < b.image_path;
+    // Ignore encoded_path which should depend on other fields.
+  }
+  bool operator()(const TaskOutput& a, const TaskOutput& b) const {
+    return operator()(a.task_input, b.task_input);
+  }
+};
+
 Status RemoveCompletedTasksFromRemainingTasks(
     const ComparisonSettings& settings,
     const std::string& completed_tasks_file_path,
@@ -249,29 +401,7 @@ Status RemoveCompletedTasksFromRemainingTasks(
       << completed_tasks_file_path << " but only " << remaining_tasks.size()
       << " were planned according to input flags";
 
-  struct TaskInputComp {
-    bool operator()(const TaskInput& a, const TaskInput& b) const {
-      if (a.codec_settings.codec < b.codec_settings.codec) return true;
-      if (a.codec_settings.codec > b.codec_settings.codec) return false;
-      if (a.codec_settings.chroma_subsampling <
-          b.codec_settings.chroma_subsampling) {
-        return true;
-      }
-      if (a.codec_settings.chroma_subsampling >
-          b.codec_settings.chroma_subsampling) {
-        return false;
-      }
-      if (a.codec_settings.effort < b.codec_settings.effort) return true;
-      if (a.codec_settings.effort > b.codec_settings.effort) return false;
-      if (a.codec_settings.quality < b.codec_settings.quality) return true;
-      if (a.codec_settings.quality > b.codec_settings.quality) return false;
-      return a.image_path < b.image_path;
-      // Ignore encoded_path which should depend on other fields.
-    }
-    bool operator()(const TaskOutput& a, const TaskOutput& b) const {
-      return operator()(a.task_input, b.task_input);
-    }
-  } comp;
+  TaskInputComp comp;
 
   // Using sorted tasks speeds lookups up.
   // An unordered map may be faster but hash function and map manipulation are
@@ -301,13 +431,101 @@ Status RemoveCompletedTasksFromRemainingTasks(
   return Status::kOk;
 }
 
+// Removes the tasks listed in failures from remaining_tasks. Returns the number
+// of removed tasks.
+size_t RemoveFailedTasks(const std::vector<TaskFailure>& failures,
+                         std::vector<TaskInput>& remaining_tasks) {
+  std::set<TaskInput, TaskInputComp> failed_tasks;
+  for (const TaskFailure& failure : failures) {
+    failed_tasks.insert(failure.task_input);
+  }
+  const size_t num_remaining_tasks = remaining_tasks.size();
+  remaining_tasks.erase(
+      std::remove_if(remaining_tasks.begin(), remaining_tasks.end(),
+                     [&](const TaskInput& task) {
+                       return failed_tasks.count(task) != 0;
+                     }),
+      remaining_tasks.end());
+  return num_remaining_tasks - remaining_tasks.size();
+}
+
+// Returns file_path + ".bck", or + ".bck2", ".bck3" etc. if taken, so that
+// earlier backups are kept.
+std::string UnusedBackupPath(const std::string& file_path) {
+  std::string backup_path = file_path + ".bck";
+  for (size_t i = 2; std::filesystem::exists(backup_path); ++i) {
+    backup_path = file_path + ".bck" + std::to_string(i);
+  }
+  return backup_path;
+}
+
+// Removes the tasks that failed in a previous run from remaining_tasks, unless
+// settings.retry_failed_tasks in which case the failures file is backed up to
+// record new failures only. Returns the number of skipped tasks.
+StatusOr<size_t> SkipFailedTasks(const ComparisonSettings& settings,
+                                 const std::string& failures_file_path,
+                                 std::vector<TaskInput>& remaining_tasks) {
+  if (!std::filesystem::exists(failures_file_path)) return 0;
+  if (settings.retry_failed_tasks) {
+    const std::string backup_path = UnusedBackupPath(failures_file_path);
+    std::filesystem::rename(failures_file_path, backup_path);
+    if (!settings.quiet) {
+      std::cout << "Retrying the failed tasks, " << failures_file_path
+                << " was moved to " << backup_path << std::endl;
+    }
+    return 0;
+  }
+  ASSIGN_OR_RETURN(const std::vector<TaskFailure> failures,
+                   ReadTaskFailures(failures_file_path, settings.quiet));
+  size_t num_skipped_tasks = RemoveFailedTasks(failures, remaining_tasks);
+  if (!settings.quiet && num_skipped_tasks != 0) {
+    std::cout << "Skipping " << num_skipped_tasks
+              << " tasks that failed according to " << failures_file_path
+              << " (use --retry_failures to evaluate them again)"
+              << std::endl;
+  }
+  return num_skipped_tasks;
+}
+
+// Shuffles the images, then the tasks of each image, keeping the tasks of an
+// image adjacent.
+void ShuffleImagesThenTasks(std::vector<TaskInput>& tasks, std::mt19937& rng) {
+  std::unordered_map<std::string, size_t> image_indices;
+  std::vector<std::vector<TaskInput>> tasks_per_image;
+  for (TaskInput& task : tasks) {
+    const auto [it, inserted] =
+        image_indices.emplace(task.image_path, tasks_per_image.size());
+    if (inserted) tasks_per_image.emplace_back();
+    tasks_per_image[it->second].push_back(std::move(task));
+  }
+  std::shuffle(tasks_per_image.begin(), tasks_per_image.end(), rng);
+  tasks.clear();
+  for (std::vector<TaskInput>& image_tasks : tasks_per_image) {
+    std::shuffle(image_tasks.begin(), image_tasks.end(), rng);
+    tasks.insert(tasks.end(), std::make_move_iterator(image_tasks.begin()),
+                 std::make_move_iterator(image_tasks.end()));
+  }
+}
+
 Status ShuffleRemainingTasks(const ComparisonSettings& settings,
                              std::vector<TaskInput>& remaining_tasks) {
   if (settings.random_order) {
-    // Uniform distribution of tasks to get as fair timings as possible.
     std::random_device rd;
-    std::shuffle(remaining_tasks.begin(), remaining_tasks.end(),
-                 std::mt19937(rd()));
+    std::mt19937 rng(rd());
+    // Renditions and shared encoder inputs are only reused from the
+    // RenditionCache if the tasks of an image run close to each other.
+    const bool reuses_images =
+        std::any_of(remaining_tasks.begin(), remaining_tasks.end(),
+                    [](const TaskInput& task) {
+                      return task.rendition_width != 0 ||
+                             HasSharedEncoderInput(task.codec_settings);
+                    });
+    if (reuses_images) {
+      ShuffleImagesThenTasks(remaining_tasks, rng);
+    } else {
+      // Uniform distribution of tasks to get as fair timings as possible.
+      std::shuffle(remaining_tasks.begin(), remaining_tasks.end(), rng);
+    }
   } else {
     // The tasks will be assigned starting at the back of the vector.
     // Reverse the order to execute in the same order as given in args.
@@ -316,21 +534,232 @@ Status ShuffleRemainingTasks(const ComparisonSettings& settings,
   return Status::kOk;
 }
 
+void ReportDuplicates(const ComparisonSettings& settings,
+                      const std::vector<std::vector<std::string>>& groups) {
+  if (settings.quiet) return;
+  size_t num_duplicates = 0;
+  for (const std::vector<std::string>& group : groups) {
+    num_duplicates += group.size() - 1;
+  }
+  std::cout << "Found " << num_duplicates << " duplicate images (same "
+            << DedupModeToString(settings.dedup_mode) << ")";
+  if (settings.copy_results_to_duplicates) {
+    std::cout << ", reusing the results of the first image of each group"
+              << std::endl;
+    return;
+  }
+  std::cout << ", skipping them" << std::endl;
+  for (const std::vector<std::string>& group : groups) {
+    for (size_t i = 1; i < group.size(); ++i) {
+      std::cout << "  " << group[i] << " (same as " << group.front() << ")"
+                << std::endl;
+    }
+  }
+}
+
+// Returns the paths of the images to evaluate: all image_paths, or the
+// representative of each group of duplicates stored in duplicate_groups if
+// settings.dedup_mode is not kNone. The content hashes are cached next to the
+// progress file at completed_tasks_file_path, if any, to save reading all the
+// images again when resuming.
+StatusOr<std::vector<std::string>> DeduplicateImages(
+    const std::vector<std::string>& image_paths,
+    const ComparisonSettings& settings,
+    const std::string& completed_tasks_file_path,
+    std::vector<std::vector<std::string>>& duplicate_groups) {
+  if (settings.dedup_mode == DedupMode::kNone) {
+    return std::vector<std::string>(image_paths);
+  }
+  const std::string cache_file_path =
+      completed_tasks_file_path.empty()
+          ? ""
+          : completed_tasks_file_path + ".dedup_" +
+                DedupModeToString(settings.dedup_mode);
+  ASSIGN_OR_RETURN(duplicate_groups,
+                   GroupDuplicates(image_paths, settings.dedup_mode,
+                                   1 + settings.num_extra_threads,
+                                   cache_file_path, settings.quiet));
+  std::vector<std::string> unique_image_paths;
+  for (const std::vector<std::string>& group : duplicate_groups) {
+    unique_image_paths.push_back(group.front());
+  }
+  ReportDuplicates(settings, duplicate_groups);
+  return unique_image_paths;
+}
+
+// Moves the completed tasks of the duplicates in duplicate_groups out of
+// completed_tasks and returns them. Such tasks come from a progress file
+// written without deduplication. They are not planned but stay in the progress
+// file.
+std::vector<TaskOutput> ExtractTasksOfDuplicates(
+    const ComparisonSettings& settings,
+    const std::vector<std::vector<std::string>>& duplicate_groups,
+    std::vector<TaskOutput>& completed_tasks) {
+  std::unordered_set<std::string_view> duplicates;
+  for (const std::vector<std::string>& group : duplicate_groups) {
+    duplicates.insert(group.begin() + 1, group.end());
+  }
+  // The same path may be given twice.
+  for (const std::vector<std::string>& group : duplicate_groups) {
+    duplicates.erase(group.front());
+  }
+  const auto first_duplicate = std::stable_partition(
+      completed_tasks.begin(), completed_tasks.end(),
+      [&](const TaskOutput& task) {
+        return duplicates.count(task.task_input.image_path) == 0;
+      });
+  std::vector<TaskOutput> tasks_of_duplicates(first_duplicate,
+                                              completed_tasks.end());
+  completed_tasks.erase(first_duplicate, completed_tasks.end());
+  if (!settings.quiet && !tasks_of_duplicates.empty()) {
+    std::cout << "Keeping " << tasks_of_duplicates.size()
+              << " completed tasks of duplicate images" << std::endl;
+  }
+  return tasks_of_duplicates;
+}
+
+// Returns the dimensions of the image at image_path, from its headers if
+// possible and by decoding it otherwise. Unknown dimensions are left to 0.
+ImageInfo ProbeImage(const std::string& image_path) {
+  const StatusOr<ImageInfo> header_info =
+      ReadImageInfo(image_path, /*quiet=*/true);
+  ImageInfo info =
+      header_info.status == Status::kOk ? header_info.value : ImageInfo();
+  if (info.width != 0 && info.height != 0) return info;
+  if (IsYuvFile(image_path)) {
+    const StatusOr<YuvImage> yuv = ReadYuvFile(image_path, /*quiet=*/true);
+    if (yuv.status == Status::kOk) {
+      info.width = yuv.value.width;
+      info.height = yuv.value.height;
+      info.bit_depth = yuv.value.bit_depth;
+    }
+    return info;
+  }
+#if defined(HAS_WEBP2)
+  const StatusOr<Image> image = ReadStillImageOrAnimation(
+      image_path.c_str(), WP2_ARGB_32, /*quiet=*/true);
+  if (image.status == Status::kOk && !image.value.empty()) {
+    const WP2::ArgbBuffer& pixels = image.value.front().pixels;
+    info.width = pixels.width();
+    info.height = pixels.height();
+    info.bit_depth = WP2Formatbpc(pixels.format());
+    info.num_frames = static_cast<uint32_t>(image.value.size());
+    info.is_animation = info.num_frames > 1;
+  }
+#endif
+  return info;
+}
+
+// Prints the predicted cost of the tasks that Compare() would evaluate with
+// the same arguments, without evaluating any nor modifying any file.
+Status DryRun(const std::vector<std::string>& image_paths,
+              const ComparisonSettings& settings,
+              const std::string& completed_tasks_file_path) {
+  // Decoding the whole image set to compare pixels could take as long as a
+  // good part of the run itself, so only identical files are grouped.
+  ComparisonSettings dedup_settings = settings;
+  if (settings.dedup_mode == DedupMode::kPixels) {
+    dedup_settings.dedup_mode = DedupMode::kBytes;
+    if (!settings.quiet) {
+      std::cout << "Dry run: only identical files are considered duplicates, "
+                   "so the images with identical pixels in different files "
+                   "are all counted"
+                << std::endl;
+    }
+  }
+  std::vector<std::vector<std::string>> duplicate_groups;
+  ASSIGN_OR_RETURN(
+      const std::vector<std::string> planned_image_paths,
+      DeduplicateImages(image_paths, dedup_settings,
+                        /*completed_tasks_file_path=*/"", duplicate_groups));
+  ASSIGN_OR_RETURN(std::vector<TaskInput> remaining_tasks,
+                   PlanTasks(planned_image_paths, settings));
+  const size_t num_planned_tasks = remaining_tasks.size();
+  ASSIGN_OR_RETURN(std::vector<TaskOutput> completed_tasks,
+                   LoadTasks(settings, completed_tasks_file_path));
+  // The timings of all completed tasks are used for calibration, even of those
+  // evaluated again below, unless they were timed under abnormal conditions.
+  std::vector<TaskOutput> calibration_tasks;
+  for (const TaskOutput& task : completed_tasks) {
+    if (!task.system_conditions.abnormal) calibration_tasks.push_back(task);
+  }
+  for (const std::string& path : settings.calibration_file_paths) {
+    ASSIGN_OR_RETURN(const std::vector<TaskOutput> tasks,
+                     ReadTaskOutputs(path, /*discard_distortion_values=*/true,
+                                     1 + settings.num_extra_threads,
+                                     settings.quiet));
+    for (const TaskOutput& task : tasks) {
+      if (!task.system_conditions.abnormal) calibration_tasks.push_back(task);
+    }
+  }
+
+  // Same selection as Compare(), in memory only.
+  if (!settings.discard_distortion_values) {
+    completed_tasks.erase(
+        std::remove_if(completed_tasks.begin(), completed_tasks.end(),
+                       [&](const TaskOutput& task) {
+                         return (!settings.quick_metrics &&
+                                 task.approximate_distortions) ||
+                                (settings.remeasure_abnormal_timings &&
+                                 task.system_conditions.abnormal);
+                       }),
+        completed_tasks.end());
+  }
+  ExtractTasksOfDuplicates(settings, duplicate_groups, completed_tasks);
+  OK_OR_RETURN(RemoveCompletedTasksFromRemainingTasks(
+      settings, completed_tasks_file_path, completed_tasks, remaining_tasks));
+  const std::string failures_file_path =
+      completed_tasks_file_path + ".failures";
+  if (!completed_tasks_file_path.empty() && !settings.retry_failed_tasks &&
+      std::filesystem::exists(failures_file_path)) {
+    ASSIGN_OR_RETURN(const std::vector<TaskFailure> failures,
+                     ReadTaskFailures(failures_file_path, settings.quiet));
+    RemoveFailedTasks(failures, remaining_tasks);
+  }
+
+  std::unordered_map<std::string, ImageInfo> images;
+  for (const TaskInput& task : remaining_tasks) {
+    if (images.count(task.image_path) == 0) {
+      images[task.image_path] = ProbeImage(task.image_path);
+    }
+  }
+  const CostModel model(calibration_tasks);
+  const RunEstimate estimate = EstimateRun(remaining_tasks, num_planned_tasks,
+                                           images, model, settings);
+  std::cout << "Dry run calibrated on " << model.num_tasks()
+            << " completed tasks" << std::endl
+            << estimate.ToString() << std::endl;
+  return Status::kOk;
+}
+
 }  // namespace
 
 Status Compare(const std::vector<std::string>& image_paths,
                const ComparisonSettings& settings,
                const std::string& completed_tasks_file_path,
                const std::string& results_folder_path) {
+  if (settings.dry_run) {
+    return DryRun(image_paths, settings, completed_tasks_file_path);
+  }
+  OK_OR_RETURN(ApplySimdLevel(settings.simd_level, settings.quiet));
+  std::vector<std::vector<std::string>> duplicate_groups;
+  ASSIGN_OR_RETURN(
+      const std::vector<std::string> planned_image_paths,
+      DeduplicateImages(image_paths, settings, completed_tasks_file_path,
+                        duplicate_groups));
   WorkerContext context;
-  ASSIGN_OR_RETURN(context.remaining_tasks, PlanTasks(image_paths, settings));
+  ASSIGN_OR_RETURN(context.remaining_tasks,
+                   PlanTasks(planned_image_paths, settings));
   ASSIGN_OR_RETURN(context.completed_tasks,
                    LoadTasks(settings, completed_tasks_file_path));
+  // The progress file is backed up at most once per run, before any change.
+  bool completed_tasks_file_backed_up = false;
   if (settings.discard_distortion_values &&
       std::filesystem::exists(completed_tasks_file_path)) {
     // Backup the old CSV file.
     std::filesystem::rename(completed_tasks_file_path,
                             completed_tasks_file_path + ".bck");
+    completed_tasks_file_backed_up = true;
     OK_OR_RETURN(
         ComputeDistortionInCompletedTasks(settings, context.completed_tasks));
     // Dump the updated entries.
@@ -341,10 +770,34 @@ Status Compare(const std::vector<std::string>& image_paths,
     for (const TaskOutput& completed_task : context.completed_tasks) {
       completed_tasks_file << completed_task.Serialize() << std::endl;
     }
+  } else if (!settings.quick_metrics) {
+    OK_OR_RETURN(RemoveApproximateTasks(settings, completed_tasks_file_path,
+                                        context.completed_tasks,
+                                        completed_tasks_file_backed_up));
+  }
+  if (settings.remeasure_abnormal_timings &&
+      !settings.discard_distortion_values) {
+    OK_OR_RETURN(RemoveAbnormalTasks(settings, completed_tasks_file_path,
+                                     context.completed_tasks,
+                                     completed_tasks_file_backed_up));
   }
+  const std::vector<TaskOutput> tasks_of_duplicates = ExtractTasksOfDuplicates(
+      settings, duplicate_groups, context.completed_tasks);
   OK_OR_RETURN(RemoveCompletedTasksFromRemainingTasks(
       settings, completed_tasks_file_path, context.completed_tasks,
       context.remaining_tasks));
+  const std::string failures_file_path =
+      completed_tasks_file_path.empty()
+          ? ""
+          : completed_tasks_file_path + ".failures";
+  // Only the failures of this run count towards kMaxNumFailures, so that a run
+  // resumed after many failures can still complete.
+  size_t num_skipped_failed_tasks = 0;
+  if (!failures_file_path.empty()) {
+    ASSIGN_OR_RETURN(num_skipped_failed_tasks,
+                     SkipFailedTasks(settings, failures_file_path,
+                                     context.remaining_tasks));
+  }
   OK_OR_RETURN(ShuffleRemainingTasks(settings, context.remaining_tasks));
   context.quiet = settings.quiet;
   context.num_tasks =
@@ -355,8 +808,28 @@ Status Compare(const std::vector<std::string>& image_paths,
     context.completed_tasks_file.open(completed_tasks_file_path, std::ios::app);
     CHECK_OR_RETURN(context.completed_tasks_file.is_open(), settings.quiet)
         << "Could not open " << completed_tasks_file_path << " for writing";
+    context.failures_file.open(failures_file_path, std::ios::app);
+    CHECK_OR_RETURN(context.failures_file.is_open(), settings.quiet)
+        << "Could not open " << failures_file_path << " for writing";
   }
   context.metric_binary_folder_path = settings.metric_binary_folder_path;
+  context.encode_decode_options.decode_timing = settings.decode_timing;
+  context.encode_decode_options.quick_metrics = settings.quick_metrics;
+  ASSIGN_OR_RETURN(SharedImageCache shared_image_cache,
+                   OpenSharedImageCache(settings));
+  RenditionCache rendition_cache(
+      settings.image_cache_size,
+      shared_image_cache.enabled() ? &shared_image_cache : nullptr);
+  context.encode_decode_options.rendition_cache = &rendition_cache;
+  // Encoded images are written in the background.
+  FileWriter file_writer(settings.quiet);
+  context.encode_decode_options.file_writer = &file_writer;
+  // Samples the host in the background, if enabled.
+  SystemSampler system_sampler(settings.system_sampling_period,
+                               settings.system_condition_thresholds);
+  if (settings.system_sampling_period != 0) {
+    context.encode_decode_options.system_sampler = &system_sampler;
+  }
 
   if (!settings.quiet) {
     std::cout << "Starting " << context.remaining_tasks.size() << " tasks"
@@ -369,11 +842,34 @@ Status Compare(const std::vector<std::string>& image_paths,
   pool.Run(context);
   if (!completed_tasks_file_path.empty()) {
     context.completed_tasks_file.close();
+    context.failures_file.close();
+  }
+  OK_OR_RETURN(file_writer.Finish());
+  if (!settings.quiet) {
+    const auto is_abnormal = [](const TaskOutput& task) {
+      return task.system_conditions.abnormal;
+    };
+    const size_t num_abnormal_tasks = static_cast<size_t>(
+        std::count_if(context.completed_tasks.begin(),
+                      context.completed_tasks.end(), is_abnormal));
+    if (num_abnormal_tasks != 0) {
+      std::cout << num_abnormal_tasks
+                << " tasks were timed under abnormal system conditions (use "
+                   "--remeasure_abnormal_timings to evaluate them again)"
+                << std::endl;
+    }
   }
   if (context.num_failures > kMaxNumFailures ||
       context.num_completed_tasks_since_start == 0) {
     OK_OR_RETURN(context.status);
   }
+  if (settings.copy_results_to_duplicates) {
+    // Reported as evaluated rather than copied.
+    context.completed_tasks.insert(context.completed_tasks.end(),
+                                   tasks_of_duplicates.begin(),
+                                   tasks_of_duplicates.end());
+    CopyResultsToDuplicates(duplicate_groups, context.completed_tasks);
+  }
 
   std::vector<std::vector<TaskOutput>> results;
   ASSIGN_OR_RETURN(results, SplitByCodecSettingsAndAggregateByImageAndQuality(
@@ -381,28 +877,78 @@ Status Compare(const std::vector<std::string>& image_paths,
   const bool single_result = results.size() == 1 && results.front().size() == 1;
 
   if (!results_folder_path.empty()) {
-    for (const std::vector<TaskOutput>& tasks : results) {
-      const CodecSettings& codec_settings =
-          tasks.front().task_input.codec_settings;
-      const std::string batch_name =
-          CodecName(codec_settings.codec) + "_" +
-          SubsamplingToString(codec_settings.chroma_subsampling) + "_" +
-          std::to_string(codec_settings.effort);
-      OK_OR_RETURN(TasksToJson(
-          batch_name, codec_settings, tasks, settings.quiet,
-          std::filesystem::path(results_folder_path) / (batch_name + ".json")));
+    JsonOptions json_options;
+    json_options.compress = settings.compress_json;
+    json_options.num_images_per_chunk = settings.num_images_per_json_chunk;
+    json_options.skip_unchanged = !settings.regenerate_json;
+    ASSIGN_OR_RETURN(const size_t num_written_batches,
+                     BatchesToJson(results, results_folder_path, json_options,
+                                   settings.quiet));
+    if (!settings.quiet) {
+      std::cout << "Wrote " << num_written_batches << " of " << results.size()
+                << " JSON batches" << std::endl;
     }
   } else if (!single_result) {
     std::cout << "Warning: no JSON results folder path specified" << std::endl;
   }
 
+  if (!settings.columnar_file_path.empty()) {
+    OK_OR_RETURN(TasksToColumnarFile(
+        context.completed_tasks, settings.columnar_file_path, settings.quiet));
+  }
+  if (!settings.summary_file_path.empty()) {
+    SummarySettings summary_settings;
+    summary_settings.reference_batch_name =
+        settings.summary_reference_batch_name;
+    summary_settings.num_threads = 1 + settings.num_extra_threads;
+    ASSIGN_OR_RETURN(const Summary summary,
+                     Summarize(context.completed_tasks, summary_settings,
+                               settings.quiet));
+    OK_OR_RETURN(SummaryToJson(summary, settings.summary_file_path,
+                               settings.quiet));
+  }
+
+  ASSIGN_OR_RETURN(const std::vector<BuildComparison> build_comparisons,
+                   CompareBuilds(results, settings.quiet));
+  if (!results_folder_path.empty() && !build_comparisons.empty()) {
+    OK_OR_RETURN(BuildComparisonsToJson(
+        build_comparisons,
+        std::filesystem::path(results_folder_path) / "build_comparison.json",
+        settings.quiet));
+  }
+
   if (!settings.quiet) {
+    for (const BuildComparison& comparison : build_comparisons) {
+      std::cout << comparison.ToString() << std::endl;
+    }
     std::cout << "Took " << Timer::SecondsToString(timer.seconds())
               << std::endl;
+    if (!settings.rendition_widths.empty()) {
+      std::cout << "Decoded " << rendition_cache.num_decodings()
+                << " images and computed "
+                << rendition_cache.num_downscalings() << " renditions"
+                << std::endl;
+    }
+    if (file_writer.num_written_files() > 0) {
+      std::cout << "Wrote " << file_writer.num_written_files()
+                << " encoded files (" << file_writer.num_written_bytes()
+                << " bytes in " << file_writer.num_batches() << " batches, "
+                << file_writer.throughput() / (1 << 20) << " MiB/s)"
+                << std::endl;
+    }
+    if (rendition_cache.num_conversions() > 0) {
+      std::cout << "Shared " << rendition_cache.num_conversions()
+                << " RGB to YUV conversions across qualities" << std::endl;
+    }
     if (context.num_failures > 0) {
       std::cout << " /!\\ Warning: " << context.num_failures << " failures"
                 << std::endl;
     }
+    if (num_skipped_failed_tasks > 0) {
+      std::cout << " /!\\ Warning: " << num_skipped_failed_tasks
+                << " tasks skipped because they failed in a previous run"
+                << std::endl;
+    }
   }
 
   if (single_result) {
@@ -20,6 +20,7 @@
 #include <vector>
 
 #include "src/base.h"
+#include "src/system_conditions.h"
 
 namespace codec_compare_gen {
 
@@ -28,6 +29,14 @@ struct CodecSettings {
   Subsampling chroma_subsampling;
   int effort;
   int quality;  // kQualityLossless or in [0:100] (exact range depends on codec)
+  // Empty for the codec linked to libccgen, otherwise path to a codec plugin.
+  // See codec_plugin.h.
+  std::string build;
+  // Threads used by the codec library to encode or decode a single image, if
+  // it supports it (see CodecCapabilities). Not serialized: comparisons run
+  // single-threaded encodings and decodings in parallel instead (see
+  // ComparisonSettings::num_extra_threads and MeasureThreadScaling()).
+  uint32_t num_threads = 1;
 };
 
 struct ComparisonSettings {
@@ -38,8 +47,62 @@ struct ComparisonSettings {
                                  // 1 means encode/decode each image twice etc.
   uint32_t num_extra_threads = 0;  // 0 means single-threaded,
                                    // 1 and above means multi-threaded.
+  // Applied to the whole process. See ApplySimdLevel().
+  SimdLevel simd_level = SimdLevel::kNative;
+  DecodeTiming decode_timing = DecodeTiming::kWarm;
+  // Each image is encoded at each of these widths. Empty means the original
+  // size only. See TaskInput::rendition_width.
+  std::vector<uint32_t> rendition_widths;
+  // Maximum number of decoded images and renditions kept in memory to be
+  // shared by all tasks. 0 disables the cache. See RenditionCache.
+  uint32_t image_cache_size = 32;
+  // Maximum size in MiB of the decoded original images shared with the other
+  // ccgen processes of the host, as long as they are not in use. 0 disables
+  // the sharing. See SharedImageCache.
+  uint32_t shared_image_cache_size = 0;
+  std::string shared_image_cache_name = "ccgen";  // Same for all processes.
+  // If not kNone, only one representative of each group of identical input
+  // images is evaluated. See GroupDuplicates().
+  DedupMode dedup_mode = DedupMode::kNone;
+  // If true, the results of each representative are also reported for its
+  // duplicates. Otherwise the duplicates are listed and left out.
+  bool copy_results_to_duplicates = true;
   bool random_order = false;  // If true, input paths are randomly permuted.
   bool discard_distortion_values = false;  // If true, recompute distortions.
+  // If true, lossy distortions are estimated on a sample of the frames and
+  // pixels. See GetSampledDistortion(). The approximate results are evaluated
+  // again by the next run without quick_metrics.
+  bool quick_metrics = false;
+  // If not 0, the state of the host is sampled every that many milliseconds and
+  // attached to each task. See SystemSampler.
+  uint32_t system_sampling_period = 0;
+  // Beyond these, the sampled tasks are flagged as abnormal.
+  SystemConditionThresholds system_condition_thresholds;
+  // If true, the completed tasks that were timed under abnormal system
+  // conditions are evaluated again. See SystemConditions::abnormal. Ignored
+  // with discard_distortion_values, which keeps the timings.
+  bool remeasure_abnormal_timings = false;
+  // Failed tasks are recorded next to the progress file and skipped when
+  // resuming, unless this is true. See TaskFailure.
+  bool retry_failed_tasks = false;
+  // If not empty, the BD-rates and sizes at equal quality of the lossy results
+  // are written to this JSON file. See Summarize().
+  std::string summary_file_path;
+  std::string summary_reference_batch_name;  // See SummarySettings.
+  // See JsonOptions.
+  bool compress_json = false;
+  uint32_t num_images_per_json_chunk = 0;
+  // If false, the JSON files of the batches whose rows did not change since
+  // the previous run are not written again. See JsonOptions::skip_unchanged.
+  bool regenerate_json = false;
+  // If not empty, all results are also written to this columnar binary file.
+  // See columnar.h.
+  std::string columnar_file_path;
+  // If true, Compare() only prints the predicted cost of the remaining tasks
+  // (see EstimateRun()). The cost model is calibrated on the completed tasks
+  // of the progress file and of these other progress files.
+  bool dry_run = false;
+  std::vector<std::string> calibration_file_paths;
   bool quiet = true;  // If true, avoids logging to stdout and stderr.
 };
 
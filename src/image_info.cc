@@ -0,0 +1,174 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/image_info.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "src/base.h"
+
+namespace codec_compare_gen {
+
+namespace {
+
+uint32_t ReadLittleEndian(const uint8_t* bytes, size_t num_bytes) {
+  uint32_t value = 0;
+  for (size_t i = num_bytes; i > 0; --i) value = (value << 8) | bytes[i - 1];
+  return value;
+}
+
+uint32_t ReadBigEndian(const uint8_t* bytes, size_t num_bytes) {
+  uint32_t value = 0;
+  for (size_t i = 0; i < num_bytes; ++i) value = (value << 8) | bytes[i];
+  return value;
+}
+
+// Skips the data sub-blocks following a GIF extension or image descriptor.
+// Returns false if the file ends before the block terminator.
+bool SkipGifSubBlocks(std::ifstream& file) {
+  for (int size = file.get(); size != 0; size = file.get()) {
+    if (size == std::ifstream::traits_type::eof()) return false;
+    file.seekg(size, std::ios::cur);
+  }
+  return true;
+}
+
+// Skips the color table announced by the packed fields of a GIF logical screen
+// or image descriptor.
+void SkipGifColorTable(uint8_t packed_fields, std::ifstream& file) {
+  if (packed_fields & 0x80) {
+    file.seekg(3 * (2 << (packed_fields & 0x07)), std::ios::cur);
+  }
+}
+
+// Counts the image descriptors, until the end of the file or a malformed block.
+uint32_t CountGifFrames(std::ifstream& file) {
+  uint8_t logical_screen[7];  // Width, height, packed fields etc.
+  if (!file.read(reinterpret_cast<char*>(logical_screen), 7)) return 0;
+  SkipGifColorTable(logical_screen[4], file);
+  uint32_t num_frames = 0;
+  while (file.good()) {
+    const int introducer = file.get();
+    if (introducer == 0x2c) {  // Image descriptor
+      ++num_frames;
+      uint8_t descriptor[9];  // Position, size, packed fields.
+      if (!file.read(reinterpret_cast<char*>(descriptor), 9)) break;
+      SkipGifColorTable(descriptor[8], file);
+      file.get();  // LZW minimum code size
+      if (!SkipGifSubBlocks(file)) break;
+    } else if (introducer == 0x21) {  // Extension
+      file.get();                     // Label
+      if (!SkipGifSubBlocks(file)) break;
+    } else {  // Trailer, end of file or malformed.
+      break;
+    }
+  }
+  return num_frames;
+}
+
+// Counts the ANMF chunks of a WebP file, starting at the first chunk.
+uint32_t CountWebpFrames(std::ifstream& file) {
+  file.seekg(12);
+  uint32_t num_frames = 0;
+  uint8_t chunk_header[8];  // FourCC and payload size.
+  while (file.read(reinterpret_cast<char*>(chunk_header), 8)) {
+    if (std::memcmp(chunk_header, "ANMF", 4) == 0) ++num_frames;
+    const uint32_t size = ReadLittleEndian(chunk_header + 4, 4);
+    file.seekg(size + (size & 1), std::ios::cur);  // Padded to even sizes.
+  }
+  return num_frames;
+}
+
+// Reads the dimensions and precision of the first SOF marker segment.
+void ReadJpegFrameHeader(std::ifstream& file, ImageInfo& info) {
+  file.seekg(2);  // After SOI
+  while (file.get() == 0xff) {
+    int marker = file.get();
+    while (marker == 0xff) marker = file.get();  // Fill bytes
+    if (marker == 0x01 || (marker >= 0xd0 && marker <= 0xd8)) continue;
+    // End of file, EOI or SOS before any SOF.
+    if (marker < 0 || marker == 0xd9 || marker == 0xda) return;
+    uint8_t segment[7];  // Length, then precision, height and width for SOF.
+    if (!file.read(reinterpret_cast<char*>(segment), 2)) return;
+    const uint32_t length = ReadBigEndian(segment, 2);
+    if (marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 &&
+        marker != 0xcc) {  // Not DHT, JPG nor DAC
+      if (!file.read(reinterpret_cast<char*>(segment + 2), 5)) return;
+      info.bit_depth = std::max(8u, static_cast<uint32_t>(segment[2]));
+      info.height = ReadBigEndian(segment + 3, 2);
+      info.width = ReadBigEndian(segment + 5, 2);
+      return;
+    }
+    if (length < 2) return;
+    file.seekg(length - 2, std::ios::cur);
+  }
+}
+
+}  // namespace
+
+StatusOr<ImageInfo> ReadImageInfo(const std::string& path, bool quiet) {
+  std::ifstream file(path, std::ios::binary);
+  CHECK_OR_RETURN(file.is_open(), quiet) << "Could not open " << path;
+  ImageInfo info;
+  uint8_t header[30];  // Enough for the VP8X canvas size and the PNG IHDR.
+  file.read(reinterpret_cast<char*>(header), sizeof(header));
+  const size_t size = static_cast<size_t>(file.gcount());
+  file.clear();
+  if (size >= 10 && (std::memcmp(header, "GIF87a", 6) == 0 ||
+                     std::memcmp(header, "GIF89a", 6) == 0)) {
+    info.width = ReadLittleEndian(header + 6, 2);
+    info.height = ReadLittleEndian(header + 8, 2);
+    info.bit_depth = 8;
+    file.seekg(6);
+    info.num_frames = std::max(1u, CountGifFrames(file));
+    info.is_animation = info.num_frames > 1;
+  } else if (size >= 16 && std::memcmp(header, "RIFF", 4) == 0 &&
+             std::memcmp(header + 8, "WEBP", 4) == 0) {
+    info.bit_depth = 8;
+    if (size >= 30 && std::memcmp(header + 12, "VP8X", 4) == 0) {
+      info.is_animation = (header[20] & 0x02) != 0;  // Animation flag
+      info.width = 1 + ReadLittleEndian(header + 24, 3);
+      info.height = 1 + ReadLittleEndian(header + 27, 3);
+      if (info.is_animation) {
+        info.num_frames = std::max(1u, CountWebpFrames(file));
+      }
+    } else if (size >= 30 && std::memcmp(header + 12, "VP8 ", 4) == 0 &&
+               std::memcmp(header + 23, "\x9d\x01\x2a", 3) == 0) {
+      info.width = ReadLittleEndian(header + 26, 2) & 0x3fff;
+      info.height = ReadLittleEndian(header + 28, 2) & 0x3fff;
+    } else if (size >= 25 && std::memcmp(header + 12, "VP8L", 4) == 0 &&
+               header[20] == 0x2f) {
+      const uint32_t bits = ReadLittleEndian(header + 21, 4);
+      info.width = 1 + (bits & 0x3fff);
+      info.height = 1 + ((bits >> 14) & 0x3fff);
+    }
+  } else if (size >= 26 &&
+             std::memcmp(header, "\x89PNG\r\n\x1a\n", 8) == 0 &&
+             std::memcmp(header + 12, "IHDR", 4) == 0) {
+    info.width = ReadBigEndian(header + 16, 4);
+    info.height = ReadBigEndian(header + 20, 4);
+    // Palettes and fewer bits per sample are decoded to 8 bits.
+    info.bit_depth = std::max(8u, static_cast<uint32_t>(header[24]));
+  } else if (size >= 2 && header[0] == 0xff && header[1] == 0xd8) {
+    ReadJpegFrameHeader(file, info);
+  }
+  return info;
+}
+
+}  // namespace codec_compare_gen
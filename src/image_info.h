@@ -0,0 +1,46 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_IMAGE_INFO_H_
+#define SRC_IMAGE_INFO_H_
+
+#include <cstdint>
+#include <string>
+
+#include "src/base.h"
+
+namespace codec_compare_gen {
+
+// Properties of an input image file that can be known without decoding it.
+struct ImageInfo {
+  // True if the container declares more than one frame. Identical consecutive
+  // frames are still merged by ReadStillImageOrAnimation(), which may end up
+  // with a single frame.
+  bool is_animation = false;
+  // Dimensions of the canvas, 0 if unknown.
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t bit_depth = 0;   // Per sample, at least 8. 0 if unknown.
+  uint32_t num_frames = 1;  // Only counted in GIF and WebP files.
+};
+
+// Reads the headers of the GIF (block structure), WebP (chunks), PNG (IHDR
+// chunk) or JPEG (SOF marker) file at path. Other formats and malformed files
+// are reported as still images of unknown dimensions, so that the tasks
+// evaluating them fail with the decoder's error instead.
+StatusOr<ImageInfo> ReadImageInfo(const std::string& path, bool quiet);
+
+}  // namespace codec_compare_gen
+
+#endif  // SRC_IMAGE_INFO_H_
@@ -0,0 +1,332 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/rendition.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/base.h"
+#include "src/frame.h"
+#include "src/shared_image_cache.h"
+#include "src/yuv.h"
+
+#if defined(HAS_WEBP2)
+#include "third_party/libwebp2/src/wp2/base.h"
+#endif
+
+namespace codec_compare_gen {
+
+uint32_t RenditionHeight(uint32_t original_width, uint32_t original_height,
+                         uint32_t rendition_width) {
+  if (original_width == 0) return 1;
+  const uint64_t height =
+      (static_cast<uint64_t>(original_height) * rendition_width +
+       original_width / 2) /
+      original_width;
+  return static_cast<uint32_t>(std::max<uint64_t>(height, 1));
+}
+
+namespace {
+
+// Area coverage of the source samples by each destination sample. Each
+// destination sample has the same number of taps, padded with zero weights.
+struct AreaWeights {
+  size_t num_taps;
+  std::vector<uint32_t> first;  // First source index of each destination.
+  std::vector<float> weights;   // num_taps per destination, summing to 1.
+};
+
+AreaWeights GetAreaWeights(uint32_t src_size, uint32_t dst_size) {
+  const double scale = static_cast<double>(src_size) / dst_size;
+  AreaWeights area;
+  area.num_taps =
+      std::min<size_t>(static_cast<size_t>(std::ceil(scale)) + 1, src_size);
+  area.first.resize(dst_size);
+  area.weights.assign(dst_size * area.num_taps, 0.f);
+  for (uint32_t i = 0; i < dst_size; ++i) {
+    const double begin = i * scale;
+    const double end = std::min((i + 1) * scale, static_cast<double>(src_size));
+    // Keep all taps within the source so that the padding is safe to read.
+    const uint32_t first =
+        std::min(static_cast<uint32_t>(begin),
+                 src_size - static_cast<uint32_t>(area.num_taps));
+    area.first[i] = first;
+    for (size_t k = 0; k < area.num_taps; ++k) {
+      const double covered = std::min(end, first + k + 1.) -
+                             std::max(begin, static_cast<double>(first + k));
+      if (covered > 0) {
+        area.weights[i * area.num_taps + k] =
+            static_cast<float>(covered / (end - begin));
+      }
+    }
+  }
+  return area;
+}
+
+}  // namespace
+
+void DownscaleArea(const float* src, uint32_t src_width, uint32_t src_height,
+                   uint32_t num_channels, uint32_t dst_width,
+                   uint32_t dst_height, float* dst) {
+  const AreaWeights columns = GetAreaWeights(src_width, dst_width);
+  const AreaWeights rows = GetAreaWeights(src_height, dst_height);
+  const size_t src_stride = static_cast<size_t>(src_width) * num_channels;
+  const size_t dst_stride = static_cast<size_t>(dst_width) * num_channels;
+
+  // Horizontal pass on all source rows.
+  std::vector<float> narrow(src_height * dst_stride, 0.f);
+  for (uint32_t y = 0; y < src_height; ++y) {
+    const float* src_row = src + y * src_stride;
+    float* narrow_row = narrow.data() + y * dst_stride;
+    for (uint32_t x = 0; x < dst_width; ++x) {
+      const float* weights = columns.weights.data() + x * columns.num_taps;
+      const float* src_pixel = src_row + columns.first[x] * num_channels;
+      float* narrow_pixel = narrow_row + x * num_channels;
+      for (size_t k = 0; k < columns.num_taps; ++k) {
+        for (uint32_t c = 0; c < num_channels; ++c) {
+          narrow_pixel[c] += weights[k] * src_pixel[k * num_channels + c];
+        }
+      }
+    }
+  }
+
+  // Vertical pass, one whole destination row at a time.
+  for (uint32_t y = 0; y < dst_height; ++y) {
+    float* dst_row = dst + y * dst_stride;
+    std::fill(dst_row, dst_row + dst_stride, 0.f);
+    for (size_t k = 0; k < rows.num_taps; ++k) {
+      const float weight = rows.weights[y * rows.num_taps + k];
+      const float* narrow_row =
+          narrow.data() + (rows.first[y] + k) * dst_stride;
+      for (size_t i = 0; i < dst_stride; ++i) {
+        dst_row[i] += weight * narrow_row[i];
+      }
+    }
+  }
+}
+
+#if defined(HAS_WEBP2)
+
+StatusOr<Image> Downscale(const Image& image, uint32_t width, bool quiet) {
+  CHECK_OR_RETURN(!image.empty(), quiet);
+  const WP2::ArgbBuffer& first_frame = image.front().pixels;
+  CHECK_OR_RETURN(width > 0 && width <= first_frame.width(), quiet)
+      << "Cannot downscale " << first_frame.width() << " pixels wide frames to "
+      << width;
+  const uint32_t height =
+      RenditionHeight(first_frame.width(), first_frame.height(), width);
+  const bool is_16bit = WP2Formatbpc(first_frame.format()) > 8;
+  const WP2SampleFormat format = is_16bit ? WP2_ARGB_64 : WP2_ARGB_32;
+  const float max_value = is_16bit ? 65535.f : 255.f;
+  ASSIGN_OR_RETURN(const Image argb, first_frame.format() == format
+                                         ? MakeView(image, quiet)
+                                         : CloneAs(image, format, quiet));
+
+  Image downscaled;
+  downscaled.reserve(argb.size());
+  std::vector<float> src, dst(static_cast<size_t>(width) * height * 4);
+  for (const Frame& frame : argb) {
+    const WP2::ArgbBuffer& pixels = frame.pixels;
+    // Premultiplied by alpha so that transparent colors do not bleed.
+    src.resize(static_cast<size_t>(pixels.width()) * pixels.height() * 4);
+    float* sample = src.data();
+    for (uint32_t y = 0; y < pixels.height(); ++y) {
+      for (uint32_t x = 0; x < pixels.width(); ++x, sample += 4) {
+        for (uint32_t c = 0; c < 4; ++c) {
+          sample[c] = (is_16bit ? pixels.GetRow16(y)[x * 4 + c]
+                                : pixels.GetRow8(y)[x * 4 + c]) /
+                      max_value;
+        }
+        for (uint32_t c = 1; c < 4; ++c) sample[c] *= sample[0];
+      }
+    }
+    DownscaleArea(src.data(), pixels.width(), pixels.height(),
+                  /*num_channels=*/4, width, height, dst.data());
+
+    downscaled.emplace_back(WP2::ArgbBuffer(format), frame.duration_ms);
+    WP2::ArgbBuffer& output = downscaled.back().pixels;
+    CHECK_OR_RETURN(output.Resize(width, height) == WP2_STATUS_OK, quiet);
+    sample = dst.data();
+    for (uint32_t y = 0; y < height; ++y) {
+      for (uint32_t x = 0; x < width; ++x, sample += 4) {
+        const float alpha = sample[0];
+        for (uint32_t c = 0; c < 4; ++c) {
+          float value = sample[c];
+          if (c > 0) value = alpha > 0 ? value / alpha : 0;
+          value = std::clamp(value, 0.f, 1.f) * max_value + 0.5f;
+          if (is_16bit) {
+            output.GetRow16(y)[x * 4 + c] = static_cast<uint16_t>(value);
+          } else {
+            output.GetRow8(y)[x * 4 + c] = static_cast<uint8_t>(value);
+          }
+        }
+      }
+    }
+  }
+  return downscaled;
+}
+
+StatusOr<std::shared_ptr<const Image>> RenditionCache::Load(
+    const std::string& image_path, uint32_t rendition_width, bool quiet) {
+  if (rendition_width == 0 && shared_image_cache_ != nullptr &&
+      !IsYuvFile(image_path)) {
+    ASSIGN_OR_RETURN(std::shared_ptr<const Image> image,
+                     shared_image_cache_->Get(image_path, WP2_ARGB_32, quiet));
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++num_decodings_;
+    }
+    return image;
+  }
+  if (rendition_width == 0) {
+    ASSIGN_OR_RETURN(Image image,
+                     ReadStillImageOrAnimation(image_path.c_str(),
+                                               WP2_ARGB_32, quiet));
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++num_decodings_;
+    }
+    return std::shared_ptr<const Image>(
+        std::make_shared<const Image>(std::move(image)));
+  }
+
+  ASSIGN_OR_RETURN(std::shared_ptr<const Image> original,
+                   Get(image_path, /*rendition_width=*/0, quiet));
+  if (original->front().pixels.width() <= rendition_width) return original;
+  ASSIGN_OR_RETURN(Image rendition,
+                   Downscale(*original, rendition_width, quiet));
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++num_downscalings_;
+  }
+  return std::shared_ptr<const Image>(
+      std::make_shared<const Image>(std::move(rendition)));
+}
+
+StatusOr<std::shared_ptr<const Image>> RenditionCache::LoadConverted(
+    const std::string& image_path, uint32_t rendition_width,
+    const ImageConversion& convert, bool quiet) {
+  ASSIGN_OR_RETURN(std::shared_ptr<const Image> image,
+                   Get(image_path, rendition_width, quiet));
+  ASSIGN_OR_RETURN(Image converted, convert(*image, quiet));
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++num_conversions_;
+  }
+  return std::shared_ptr<const Image>(
+      std::make_shared<const Image>(std::move(converted)));
+}
+
+StatusOr<std::shared_ptr<const Image>> RenditionCache::GetOrLoad(
+    const std::string& key,
+    const std::function<StatusOr<std::shared_ptr<const Image>>()>& load) {
+  if (capacity_ == 0) return load();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  const auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second.second);
+    const std::shared_future<ImageOrError> entry = it->second.first;
+    lock.unlock();
+    // Waits for the first caller to load the image if it is not done yet.
+    const ImageOrError& image = entry.get();
+    if (image.status != Status::kOk) return image.status;
+    return std::shared_ptr<const Image>(image.image);
+  }
+  std::promise<ImageOrError> promise;
+  lru_.push_front(key);
+  entries_.emplace(key,
+                   std::make_pair(promise.get_future().share(), lru_.begin()));
+  while (lru_.size() > capacity_) {
+    // Callers still waiting for an evicted entry hold their own future.
+    entries_.erase(lru_.back());
+    lru_.pop_back();
+  }
+  lock.unlock();
+
+  // Failures are cached too, so that they are reported once per image.
+  StatusOr<std::shared_ptr<const Image>> image = load();
+  promise.set_value({image.status, image.value});
+  return image;
+}
+
+StatusOr<std::shared_ptr<const Image>> RenditionCache::Get(
+    const std::string& image_path, uint32_t rendition_width, bool quiet) {
+  std::string key = image_path;
+  key.push_back('\0');
+  key += std::to_string(rendition_width);
+  return GetOrLoad(key,
+                   [&]() { return Load(image_path, rendition_width, quiet); });
+}
+
+StatusOr<std::shared_ptr<const Image>> RenditionCache::GetConverted(
+    const std::string& image_path, uint32_t rendition_width,
+    const std::string& conversion_name, const ImageConversion& convert,
+    bool quiet) {
+  std::string key = image_path;
+  key.push_back('\0');
+  key += std::to_string(rendition_width);
+  key.push_back('\0');
+  key += conversion_name;
+  return GetOrLoad(key, [&]() {
+    return LoadConverted(image_path, rendition_width, convert, quiet);
+  });
+}
+
+#else
+
+StatusOr<std::shared_ptr<const Image>> RenditionCache::Load(
+    const std::string&, uint32_t, bool quiet) {
+  CHECK_OR_RETURN(false, quiet) << "Reading images requires HAS_WEBP2";
+}
+
+StatusOr<std::shared_ptr<const Image>> RenditionCache::Get(
+    const std::string& image_path, uint32_t rendition_width, bool quiet) {
+  return Load(image_path, rendition_width, quiet);
+}
+
+StatusOr<std::shared_ptr<const Image>> RenditionCache::GetConverted(
+    const std::string& image_path, uint32_t rendition_width,
+    const std::string&, const ImageConversion&, bool quiet) {
+  return Load(image_path, rendition_width, quiet);
+}
+
+#endif  // HAS_WEBP2
+
+size_t RenditionCache::num_decodings() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_decodings_;
+}
+
+size_t RenditionCache::num_downscalings() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_downscalings_;
+}
+
+size_t RenditionCache::num_conversions() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_conversions_;
+}
+
+}  // namespace codec_compare_gen
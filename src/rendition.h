@@ -0,0 +1,129 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_RENDITION_H_
+#define SRC_RENDITION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "src/base.h"
+#include "src/frame.h"
+#include "src/shared_image_cache.h"
+
+namespace codec_compare_gen {
+
+// Returns the height of a rendition of the given width, keeping the aspect
+// ratio of the original dimensions. Returns at least 1.
+uint32_t RenditionHeight(uint32_t original_width, uint32_t original_height,
+                         uint32_t rendition_width);
+
+// Downscales src_width*src_height pixels of num_channels interleaved samples
+// into dst_width*dst_height pixels by averaging the covered source area. The
+// filter is separable and both passes run over contiguous rows with fixed
+// numbers of taps so that the compiler vectorizes them. dst_width and
+// dst_height cannot be larger than src_width and src_height.
+void DownscaleArea(const float* src, uint32_t src_width, uint32_t src_height,
+                   uint32_t num_channels, uint32_t dst_width,
+                   uint32_t dst_height, float* dst);
+
+#if defined(HAS_WEBP2)
+// Returns a copy of the frames downscaled to the given width. The color
+// channels are averaged premultiplied by alpha. The output format is
+// WP2_ARGB_32 or WP2_ARGB_64 depending on the bit depth of the input.
+StatusOr<Image> Downscale(const Image& image, uint32_t width, bool quiet);
+#endif
+
+// Derives a frame sequence from another one, for example by converting its
+// samples to the input representation of an encoder.
+using ImageConversion =
+    std::function<StatusOr<Image>(const Image& image, bool quiet)>;
+
+// Thread-safe cache of decoded original images and of their renditions, shared
+// by all the tasks of a comparison. Each image file is decoded once as long as
+// it stays in the cache, and each rendition is computed from the cached
+// original image.
+class RenditionCache {
+ public:
+  // Keeps at most capacity images (originals and renditions alike) in memory,
+  // evicting the least recently used ones. 0 disables caching.
+  explicit RenditionCache(size_t capacity) : capacity_(capacity) {}
+  // Same but the original images are mapped from shared_image_cache, if not
+  // null, rather than decoded by this process. YUV files are still decoded.
+  RenditionCache(size_t capacity, SharedImageCache* shared_image_cache)
+      : capacity_(capacity), shared_image_cache_(shared_image_cache) {}
+
+  // Returns the image at image_path as WP2_ARGB_32 (or WP2_ARGB_64 for 16-bit
+  // images), downscaled to rendition_width if not 0. Renditions are never
+  // upscaled: the original image is returned if it is not wider than
+  // rendition_width. Concurrent calls for the same image wait for the first one
+  // to decode it.
+  StatusOr<std::shared_ptr<const Image>> Get(const std::string& image_path,
+                                             uint32_t rendition_width,
+                                             bool quiet);
+
+  // Returns convert() applied to Get(image_path, rendition_width, quiet). The
+  // result is computed once per conversion_name as long as it stays in the
+  // cache, so that the encodings of all settings share it.
+  StatusOr<std::shared_ptr<const Image>> GetConverted(
+      const std::string& image_path, uint32_t rendition_width,
+      const std::string& conversion_name, const ImageConversion& convert,
+      bool quiet);
+
+  // Number of image files decoded (or mapped from the SharedImageCache), of
+  // renditions computed and of conversions done so far.
+  size_t num_decodings() const;
+  size_t num_downscalings() const;
+  size_t num_conversions() const;
+
+ private:
+  struct ImageOrError {  // Copyable StatusOr for std::shared_future.
+    Status status;
+    std::shared_ptr<const Image> image;
+  };
+  StatusOr<std::shared_ptr<const Image>> Load(const std::string& image_path,
+                                              uint32_t rendition_width,
+                                              bool quiet);
+  StatusOr<std::shared_ptr<const Image>> LoadConverted(
+      const std::string& image_path, uint32_t rendition_width,
+      const ImageConversion& convert, bool quiet);
+  // Returns the entry at key, calling load() to fill it if it is missing.
+  StatusOr<std::shared_ptr<const Image>> GetOrLoad(
+      const std::string& key,
+      const std::function<StatusOr<std::shared_ptr<const Image>>()>& load);
+
+  const size_t capacity_;
+  SharedImageCache* const shared_image_cache_ = nullptr;  // Thread-safe.
+  mutable std::mutex mutex_;
+  // Most recently used first. Same keys as entries_.
+  std::list<std::string> lru_;
+  std::unordered_map<std::string, std::pair<std::shared_future<ImageOrError>,
+                                            std::list<std::string>::iterator>>
+      entries_;
+  size_t num_decodings_ = 0;
+  size_t num_downscalings_ = 0;
+  size_t num_conversions_ = 0;
+};
+
+}  // namespace codec_compare_gen
+
+#endif  // SRC_RENDITION_H_
@@ -14,17 +14,28 @@
 
 #include "src/result_json.h"
 
+#include <cstddef>
+#include <cstdint>
 #include <ctime>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <ostream>
 #include <sstream>
+#include <streambuf>
 #include <string>
+#include <system_error>
 #include <vector>
 
+#if defined(HAS_ZLIB)
+#include <zlib.h>
+#endif
+
 #include "src/base.h"
 #include "src/codec.h"
+#include "src/codec_plugin.h"
 #include "src/framework.h"
 #include "src/serialization.h"
 #include "src/task.h"
@@ -33,6 +44,13 @@ namespace codec_compare_gen {
 
 namespace {
 
+constexpr const char kBuildCommand[] =
+    "git clone -b v0.4.1 --depth 1"
+    " https://github.com/webmproject/codec-compare-gen.git &&"
+    " cd codec-compare-gen && ./deps.sh &&"
+    " cmake -S . -B build -DCMAKE_CXX_COMPILER=clang++ &&"
+    " cmake --build build && cd ..";
+
 std::string DateTime() {
   const std::time_t time = std::time(nullptr);
   const std::tm localtime = *std::localtime(&time);
@@ -71,41 +89,99 @@ std::string GetImagePathCommonPrefix(const std::vector<TaskOutput>& tasks,
   return prefix;
 }
 
-}  // namespace
+#if defined(HAS_ZLIB)
+// Output stream buffer compressing to a gzip file, which browsers can decode.
+class GzipStreamBuf : public std::streambuf {
+ public:
+  explicit GzipStreamBuf(const std::string& path)
+      : file_(gzopen(path.c_str(), "wb")) {
+    setp(buffer_, buffer_ + sizeof(buffer_));
+  }
+  ~GzipStreamBuf() override { Close(); }
 
-Status TasksToJson(const std::string& batch_name, CodecSettings settings,
-                   const std::vector<TaskOutput>& tasks, bool quiet,
-                   const std::string& results_file_path) {
+  bool is_open() const { return file_ != nullptr; }
+  // Returns false if anything failed since the creation of this buffer.
+  bool Close() {
+    if (file_ == nullptr) return ok_;
+    ok_ &= Flush();
+    ok_ &= gzclose(file_) == Z_OK;
+    file_ = nullptr;
+    return ok_;
+  }
+
+ protected:
+  int overflow(int c) override {
+    if (!Flush()) return traits_type::eof();
+    if (c != traits_type::eof()) {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+  int sync() override { return Flush() ? 0 : -1; }
+
+ private:
+  bool Flush() {
+    const int size = static_cast<int>(pptr() - pbase());
+    if (size > 0 &&
+        (file_ == nullptr || gzwrite(file_, pbase(), size) != size)) {
+      ok_ = false;
+      return false;
+    }
+    setp(buffer_, buffer_ + sizeof(buffer_));
+    return true;
+  }
+
+  gzFile file_;
+  char buffer_[1 << 16];
+  bool ok_ = true;
+};
+#endif  // HAS_ZLIB
+
+// Writes the tasks as a self-contained JSON document.
+Status WriteJson(std::ostream& file, const std::string& batch_name,
+                 const CodecSettings& settings, const std::string& version,
+                 const std::vector<TaskOutput>& tasks, bool quiet) {
   bool lossless = true;
   bool has_encoded_path = true;
+  bool has_bitstream_breakdown = false;  // See AnalyzeBitstream().
+  bool has_frame_decoding_durations = false;
+  bool has_approximate_distortions = false;  // See GetSampledDistortion().
+  const SimdLevel simd_level =
+      tasks.empty() ? SimdLevel::kNative : tasks.front().simd_level;
+  const DecodeTiming decode_timing =
+      tasks.empty() ? DecodeTiming::kWarm : tasks.front().decode_timing;
+  const uint32_t rendition_width =
+      tasks.empty() ? 0 : tasks.front().task_input.rendition_width;
   for (size_t i = 0; i < tasks.size(); ++i) {
     const CodecSettings& codec_settings = tasks[i].task_input.codec_settings;
     CHECK_OR_RETURN(
         codec_settings.codec == settings.codec &&
             codec_settings.chroma_subsampling == settings.chroma_subsampling &&
-            codec_settings.effort == settings.effort,
+            codec_settings.effort == settings.effort &&
+            codec_settings.build == settings.build,
         quiet)
         << "Codec settings do not match";
+    CHECK_OR_RETURN(tasks[i].simd_level == simd_level, quiet)
+        << "SIMD levels do not match";
+    CHECK_OR_RETURN(tasks[i].decode_timing == decode_timing, quiet)
+        << "Decode timings do not match";
+    CHECK_OR_RETURN(tasks[i].task_input.rendition_width == rendition_width,
+                    quiet)
+        << "Rendition widths do not match";
     lossless &= codec_settings.quality == kQualityLossless;
     has_encoded_path &= !tasks[i].task_input.encoded_path.empty();
+    has_bitstream_breakdown |= tasks[i].header_size > 0;
+    has_frame_decoding_durations |= tasks[i].first_frame_decoding_duration > 0;
+    has_approximate_distortions |= tasks[i].approximate_distortions;
   }
 
   // See EncodeDecode().
   const bool has_decoded_path =
       has_encoded_path && !CodecIsSupportedByBrowsers(settings.codec);
 
-  std::ofstream file(results_file_path, std::ios::trunc);
-  CHECK_OR_RETURN(file.is_open(), quiet) << "Failed to open results file at "
-                                         << results_file_path << " for writing";
-
   const std::string image_prefix =
       GetImagePathCommonPrefix(tasks, /*get_encoded_path=*/false);
-  const std::string build_cmd =
-      "git clone -b v0.4.1 --depth 1"
-      " https://github.com/webmproject/codec-compare-gen.git &&"
-      " cd codec-compare-gen && ./deps.sh &&"
-      " cmake -S . -B build -DCMAKE_CXX_COMPILER=clang++ &&"
-      " cmake --build build && cd ..";
   std::string encoding_cmd = "codec-compare-gen/build/ccgen --codec " +
                              CodecName(settings.codec) + " " +
                              SubsamplingToString(settings.chroma_subsampling) +
@@ -116,6 +192,18 @@ Status TasksToJson(const std::string& batch_name, CodecSettings settings,
     encoding_cmd += " --lossy --quality ${quality}";
     encoding_cmd += " --metric_binary_folder codec-compare-gen/third_party/";
   }
+  if (simd_level != SimdLevel::kNative) {
+    encoding_cmd += " --simd_level " + SimdLevelToString(simd_level);
+  }
+  if (decode_timing != DecodeTiming::kWarm) {
+    encoding_cmd += " --decode_timing " + DecodeTimingToString(decode_timing);
+  }
+  if (!settings.build.empty()) {
+    encoding_cmd += " --codec_build " + settings.build;
+  }
+  if (rendition_width != 0) {
+    encoding_cmd += " --rendition_width " + std::to_string(rendition_width);
+  }
   encoding_cmd += " -- ${original_path}";
   const std::string encoded_prefix =
       GetImagePathCommonPrefix(tasks, /*get_encoded_path=*/true);
@@ -129,6 +217,18 @@ Status TasksToJson(const std::string& batch_name, CodecSettings settings,
     {"original_path": "Path to the original image"},
     {"build_command": "The command used to generate the codec binaries"},
     {"encoding_cmd": "The command used to encode the original image"})json";
+  if (simd_level != SimdLevel::kNative) {
+    file << R"json(,
+    {"simd_level": "Highest SIMD instruction set the codecs were allowed to use"})json";
+  }
+  if (decode_timing != DecodeTiming::kWarm) {
+    file << R"json(,
+    {"decode_timing": "State of the CPU caches when measuring decoding durations: cold (evicted before decoding) or steady (average of repeated decodings)"})json";
+  }
+  if (rendition_width != 0) {
+    file << R"json(,
+    {"rendition_width": "Width in pixels the original image was downscaled to before encoding, if it was wider"})json";
+  }
   if (has_encoded_path) {
     file << R"json(,
     {"encoded_path": "Path to the encoded image"})json";
@@ -145,15 +245,30 @@ Status TasksToJson(const std::string& batch_name, CodecSettings settings,
     )json"
        << Escape(CodecName(settings.codec)) << R"json(,
     )json"
-       << Escape(CodecVersion(settings.codec)) << R"json(,
+       << Escape(version) << R"json(,
     )json"
        << Escape(DateTime()) << R"json(,
     )json"
        << Escape(image_prefix + "${original_name}") << R"json(,
     )json"
-       << Escape(build_cmd) << R"json(,
+       << Escape(kBuildCommand) << R"json(,
     )json"
        << Escape(encoding_cmd);
+  if (simd_level != SimdLevel::kNative) {
+    file << R"json(,
+    )json"
+         << Escape(SimdLevelToString(simd_level));
+  }
+  if (decode_timing != DecodeTiming::kWarm) {
+    file << R"json(,
+    )json"
+         << Escape(DecodeTimingToString(decode_timing));
+  }
+  if (rendition_width != 0) {
+    file << R"json(,
+    )json"
+         << Escape(std::to_string(rendition_width));
+  }
   if (has_encoded_path) {
     file << R"json(,
     )json"
@@ -193,6 +308,20 @@ Status TasksToJson(const std::string& batch_name, CodecSettings settings,
     {"encoding_time": "Encoding duration in seconds. Warning: Timings are environment-dependent and inaccurate."},
     {"decoding_time": "Decoding duration in seconds. Warning: Timings are environment-dependent and inaccurate."},
     {"dec_time_no_col_conv": "Decoding duration in seconds without color conversion. Warning: Only different from regular decoding for codecs without built-in conversion."})json";
+  if (has_bitstream_breakdown) {
+    file << R"json(,
+    {"header_size": "Bytes of encoded_size spent on the container structure and on the image and coding headers"},
+    {"metadata_size": "Bytes of encoded_size spent on the ICC profile, Exif, XMP and comments"},
+    {"alpha_size": "Bytes of encoded_size spent on a separately coded alpha plane"})json";
+  }
+  if (has_frame_decoding_durations) {
+    file << R"json(,
+    {"first_frame_dec_time": "Duration in seconds from the start of the decoding until the first frame of the animation is available. 0 for still images."},
+    {"frame_dec_time_p50": "Median decoding duration in seconds of a frame of the animation. 0 for still images."},
+    {"frame_dec_time_p99": "99th percentile decoding duration in seconds of a frame of the animation. 0 for still images."},
+    {"frame_dec_time_max": "Longest decoding duration in seconds of a frame of the animation. 0 for still images."},
+    {"decoding_fps": "Decoded frames per second of the animation. 0 for still images."})json";
+  }
   if (!lossless) {
     static_assert(kNumDistortionMetrics == 7);
     // In DistortionMetric order.
@@ -204,6 +333,16 @@ Status TasksToJson(const std::string& batch_name, CodecSettings settings,
     {"ssimulacra": "Distortion metric SSIMULACRA (libjxl implementation). See https://en.wikipedia.org/wiki/Structural_similarity#SSIMULACRA. Warning: There is no scientific consensus on which objective distortion metric to use."},
     {"ssimulacra2": "Distortion metric SSIMULACRA2 (libjxl implementation). See https://en.wikipedia.org/wiki/Structural_similarity#SSIMULACRA. Warning: There is no scientific consensus on which objective distortion metric to use."},
     {"p3norm": "Distortion metric P3-norm (libjxl implementation). See https://en.wikipedia.org/wiki/Norm_(mathematics)#p-norm. Warning: There is no scientific consensus on which objective distortion metric to use."})json";
+    if (has_approximate_distortions) {
+      file << R"json(,
+    {"approximate": "1 if the distortion metrics were estimated on a sample of the frames and pixels (--quick_metrics), 0 if they were computed on the whole image"})json";
+      for (size_t m = 0; m < kNumDistortionMetrics; ++m) {
+        const std::string metric =
+            DistortionMetricToString(static_cast<DistortionMetric>(m));
+        file << ",\n    {\"" << metric << "_error\": \"Standard error of the "
+             << metric << " estimate. 0 if approximate is 0.\"}";
+      }
+    }
   }
   file << R"json(
   ],
@@ -236,10 +375,28 @@ Status TasksToJson(const std::string& batch_name, CodecSettings settings,
     file << task.encoding_duration << ",";
     file << task.decoding_duration << ",";
     file << (task.decoding_duration - task.decoding_color_conversion_duration);
+    if (has_bitstream_breakdown) {
+      file << "," << task.header_size << "," << task.metadata_size << ","
+           << task.alpha_size;
+    }
+    if (has_frame_decoding_durations) {
+      const bool is_animation = task.first_frame_decoding_duration > 0;
+      file << "," << task.first_frame_decoding_duration << ","
+           << task.frame_decoding_duration_p50 << ","
+           << task.frame_decoding_duration_p99 << ","
+           << task.frame_decoding_duration_max << ","
+           << (is_animation ? task.num_frames / task.decoding_duration : 0);
+    }
     if (!lossless) {
       for (const float distortion : task.distortions) {
         file << "," << distortion;
       }
+      if (has_approximate_distortions) {
+        file << "," << (task.approximate_distortions ? 1 : 0);
+        for (const float error : task.distortion_errors) {
+          file << "," << error;
+        }
+      }
     }
     file << "]";
     if (i + 1 < tasks.size()) file << ",";
@@ -247,8 +404,261 @@ Status TasksToJson(const std::string& batch_name, CodecSettings settings,
   }
 
   file << "  ]" << std::endl << "}" << std::endl;
+  return Status::kOk;
+}
+
+// Opens the file at path, gzip-compressed if compress is true, and calls
+// write() with it.
+Status WriteJsonFile(const std::string& path, bool compress, bool quiet,
+                     const std::function<Status(std::ostream&)>& write) {
+  if (compress) {
+#if defined(HAS_ZLIB)
+    GzipStreamBuf buffer(path);
+    CHECK_OR_RETURN(buffer.is_open(), quiet)
+        << "Failed to open results file at " << path << " for writing";
+    std::ostream file(&buffer);
+    OK_OR_RETURN(write(file));
+    file.flush();
+    CHECK_OR_RETURN(file.good() && buffer.Close(), quiet)
+        << "Failed to write " << path;
+    return Status::kOk;
+#else
+    CHECK_OR_RETURN(false, quiet) << "Compression requires zlib";
+#endif
+  }
+  std::ofstream file(path, std::ios::trunc);
+  CHECK_OR_RETURN(file.is_open(), quiet)
+      << "Failed to open results file at " << path << " for writing";
+  OK_OR_RETURN(write(file));
   file.close();
+  CHECK_OR_RETURN(!file.fail(), quiet) << "Failed to write " << path;
   return Status::kOk;
 }
 
+// Writes either a single JSON file or chunks and their index. Appends the
+// paths of the written files to written_paths.
+Status WriteJsonFiles(const std::string& batch_name,
+                      const CodecSettings& settings,
+                      const std::string& version,
+                      const std::vector<TaskOutput>& tasks, bool quiet,
+                      const std::string& results_file_path,
+                      const JsonOptions& options,
+                      std::vector<std::string>& written_paths) {
+  const std::string extension = options.compress ? ".json.gz" : ".json";
+
+  if (options.num_images_per_chunk == 0) {
+    written_paths.push_back(options.compress ? results_file_path + ".gz"
+                                             : results_file_path);
+    return WriteJsonFile(
+        written_paths.back(), options.compress, quiet,
+        [&](std::ostream& file) {
+          return WriteJson(file, batch_name, settings, version, tasks, quiet);
+        });
+  }
+
+  // Split the rows into groups of consecutive images. Only one chunk is held
+  // in memory at a time.
+  std::filesystem::path stem(results_file_path);
+  if (stem.extension() == ".json") stem.replace_extension();
+  const std::string image_prefix =
+      GetImagePathCommonPrefix(tasks, /*get_encoded_path=*/false);
+  std::stringstream chunk_entries;
+  size_t num_chunks = 0;
+  for (size_t begin = 0; begin < tasks.size();) {
+    std::vector<TaskOutput> chunk;
+    std::vector<std::string> image_names;
+    size_t end = begin;
+    while (end < tasks.size()) {
+      const std::string& image_path = tasks[end].task_input.image_path;
+      if (image_names.empty() ||
+          image_path != tasks[end - 1].task_input.image_path) {
+        if (image_names.size() == options.num_images_per_chunk) break;
+        image_names.push_back(image_path.substr(image_prefix.size()));
+      }
+      chunk.push_back(tasks[end++]);
+    }
+    const std::string chunk_file_name = stem.filename().string() + ".chunk" +
+                                        std::to_string(num_chunks) + extension;
+    written_paths.push_back((stem.parent_path() / chunk_file_name).string());
+    OK_OR_RETURN(WriteJsonFile(
+        written_paths.back(), options.compress, quiet,
+        [&](std::ostream& file) {
+          return WriteJson(file, batch_name, settings, version, chunk, quiet);
+        }));
+
+    chunk_entries << (num_chunks == 0 ? "" : ",") << R"json(
+    {"path": )json" << Escape(chunk_file_name)
+                  << R"json(, "num_rows": )json" << chunk.size()
+                  << R"json(, "original_names": [)json";
+    for (size_t i = 0; i < image_names.size(); ++i) {
+      chunk_entries << (i == 0 ? "" : ", ") << Escape(image_names[i]);
+    }
+    chunk_entries << "]}";
+    ++num_chunks;
+    begin = end;
+  }
+
+  written_paths.push_back(stem.string() + ".index.json");
+  return WriteJsonFile(
+      written_paths.back(), /*compress=*/false, quiet,
+      [&](std::ostream& file) {
+        file << R"json({
+  "name": )json" << Escape(batch_name)
+             << R"json(,
+  "original_path": )json"
+             << Escape(image_prefix + "${original_name}") << R"json(,
+  "num_rows": )json" << tasks.size()
+             << R"json(,
+  "chunks": [)json" << chunk_entries.str()
+             << R"json(
+  ]
+}
+)json";
+        return Status::kOk;
+      });
+}
+
+std::string HashToString(uint64_t hash) {
+  return (std::ostringstream() << std::hex << std::setfill('0') << std::setw(16)
+                               << hash)
+      .str();
+}
+
+// Fnv1a of a sequence of strings.
+class Fingerprint {
+ public:
+  Fingerprint& operator<<(const std::string& bytes) {
+    hash_.Update(bytes);
+    // Separator so that concatenations of different strings differ.
+    hash_.Update("\xff");
+    return *this;
+  }
+  std::string ToString() const { return HashToString(hash_.hash()); }
+
+ private:
+  Fnv1a hash_;
+};
+
+// Returns a digest of everything the JSON files depend on, except for the
+// time of generation.
+std::string JsonFingerprint(const std::string& batch_name,
+                            const std::string& version,
+                            const std::vector<TaskOutput>& tasks,
+                            const JsonOptions& options) {
+  Fingerprint fingerprint;
+  fingerprint << kBuildCommand << batch_name << version
+              << std::to_string(options.compress)
+              << std::to_string(options.num_images_per_chunk);
+  for (const TaskOutput& task : tasks) fingerprint << task.Serialize();
+  return fingerprint.ToString();
+}
+
+// Returns true if the fingerprint file at fingerprint_path starts with
+// fingerprint and if all the files it lists are still as they were written.
+bool FilesMatchFingerprint(const std::string& fingerprint_path,
+                           const std::string& fingerprint) {
+  std::ifstream file(fingerprint_path);
+  std::string line;
+  if (!std::getline(file, line) || line != fingerprint) return false;
+  size_t num_files = 0;
+  while (std::getline(file, line)) {
+    // "{hash} {file name}"
+    const size_t space = line.find(' ');
+    if (space == std::string::npos) return false;
+    const StatusOr<uint64_t> hash = HashFile(
+        (std::filesystem::path(fingerprint_path).parent_path() /
+         line.substr(space + 1))
+            .string(),
+        /*quiet=*/true);
+    if (hash.status != Status::kOk ||
+        HashToString(hash.value) != line.substr(0, space)) {
+      return false;
+    }
+    ++num_files;
+  }
+  return num_files != 0;
+}
+
+// Writes the JSON files unless options.skip_unchanged and they already match
+// the tasks. Returns true if anything was written.
+StatusOr<bool> WriteJsonFilesIfChanged(const std::string& batch_name,
+                                       const CodecSettings& settings,
+                                       const std::vector<TaskOutput>& tasks,
+                                       bool quiet,
+                                       const std::string& results_file_path,
+                                       const JsonOptions& options) {
+  std::string version = CodecVersion(settings.codec);
+  if (!settings.build.empty()) {
+    ASSIGN_OR_RETURN(version,
+                     CodecPluginVersion(settings.build, settings.codec, quiet));
+  }
+  std::filesystem::path stem(results_file_path);
+  if (stem.extension() == ".json") stem.replace_extension();
+  const std::string fingerprint_path = stem.string() + ".fingerprint";
+  const std::string fingerprint =
+      JsonFingerprint(batch_name, version, tasks, options);
+  if (options.skip_unchanged &&
+      FilesMatchFingerprint(fingerprint_path, fingerprint)) {
+    return false;
+  }
+  // Do not leave a matching fingerprint next to partially written files.
+  std::error_code error;
+  std::filesystem::remove(fingerprint_path, error);
+
+  std::vector<std::string> written_paths;
+  OK_OR_RETURN(WriteJsonFiles(batch_name, settings, version, tasks, quiet,
+                              results_file_path, options, written_paths));
+  // Detects deleted or edited files at the next call.
+  std::vector<uint64_t> hashes;
+  for (const std::string& path : written_paths) {
+    ASSIGN_OR_RETURN(const uint64_t hash, HashFile(path, quiet));
+    hashes.push_back(hash);
+  }
+  OK_OR_RETURN(WriteJsonFile(
+      fingerprint_path, /*compress=*/false, quiet, [&](std::ostream& file) {
+        file << fingerprint << std::endl;
+        for (size_t i = 0; i < written_paths.size(); ++i) {
+          file << HashToString(hashes[i]) << " "
+               << std::filesystem::path(written_paths[i]).filename().string()
+               << std::endl;
+        }
+        return Status::kOk;
+      }));
+  return true;
+}
+
+}  // namespace
+
+Status TasksToJson(const std::string& batch_name, CodecSettings settings,
+                   const std::vector<TaskOutput>& tasks, bool quiet,
+                   const std::string& results_file_path,
+                   const JsonOptions& options) {
+  return WriteJsonFilesIfChanged(batch_name, settings, tasks, quiet,
+                                 results_file_path, options)
+      .status;
+}
+
+StatusOr<size_t> BatchesToJson(
+    const std::vector<std::vector<TaskOutput>>& batches,
+    const std::string& results_folder_path, const JsonOptions& options,
+    bool quiet) {
+  size_t num_written_batches = 0;
+  for (const std::vector<TaskOutput>& tasks : batches) {
+    if (tasks.empty()) continue;
+    const CodecSettings& codec_settings =
+        tasks.front().task_input.codec_settings;
+    const std::string batch_name =
+        BatchName(codec_settings, tasks.front().task_input.rendition_width,
+                  tasks.front().simd_level, tasks.front().decode_timing);
+    ASSIGN_OR_RETURN(
+        const bool written,
+        WriteJsonFilesIfChanged(
+            batch_name, codec_settings, tasks, quiet,
+            std::filesystem::path(results_folder_path) / (batch_name + ".json"),
+            options));
+    if (written) ++num_written_batches;
+  }
+  return num_written_batches;
+}
+
 }  // namespace codec_compare_gen
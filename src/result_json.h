@@ -15,6 +15,7 @@
 #ifndef SRC_RESULT_JSON_H_
 #define SRC_RESULT_JSON_H_
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -24,9 +25,38 @@
 
 namespace codec_compare_gen {
 
+struct JsonOptions {
+  // If true, ".gz" is appended to the file names and the content is
+  // gzip-compressed.
+  bool compress = false;
+  // If not 0, the rows are split into chunks of at most that many consecutive
+  // images, each a self-contained "{batch}.chunk{i}.json" document listed in
+  // "{batch}.index.json" instead of results_file_path.
+  size_t num_images_per_chunk = 0;
+  // If true, the files are left untouched if the fingerprint of the batch
+  // matches the "{batch}.fingerprint" file stored next to them by the previous
+  // call. The fingerprint covers the rows, the codec version and the options,
+  // but not the generation time. The files are written again if any of them
+  // was deleted or modified since, according to the hashes of their content
+  // listed in the "{batch}.fingerprint" file.
+  bool skip_unchanged = false;
+};
+
+// The document is written while being formatted. The tasks should be sorted by
+// original image path for chunks to contain distinct images.
 Status TasksToJson(const std::string& batch_name, CodecSettings settings,
                    const std::vector<TaskOutput>& tasks, bool quiet,
-                   const std::string& results_file_path);
+                   const std::string& results_file_path,
+                   const JsonOptions& options);
+
+// Calls TasksToJson() for each batch returned by
+// SplitByCodecSettingsAndAggregateByImageAndQuality(), with
+// "{results_folder_path}/{BatchName()}.json" as results_file_path. Returns the
+// number of batches actually written.
+StatusOr<size_t> BatchesToJson(
+    const std::vector<std::vector<TaskOutput>>& batches,
+    const std::string& results_folder_path, const JsonOptions& options,
+    bool quiet);
 
 }  // namespace codec_compare_gen
 
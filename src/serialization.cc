@@ -16,6 +16,8 @@
 
 #include <cctype>
 #include <cstddef>
+#include <cstdint>
+#include <fstream>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -41,28 +43,29 @@ std::string Trim(std::string_view str) {
 }
 
 std::vector<std::string> Split(std::string_view str, char delimiter) {
-  std::vector<std::string> tokens(1);
+  std::vector<std::string> tokens;
   bool is_escaped = false;
   bool in_literal_string = false;
+  size_t token_start = 0;
   for (size_t i = 0; i < str.size(); ++i) {
     if (str[i] == delimiter && !in_literal_string) {
-      tokens.push_back("");
+      tokens.push_back(Trim(str.substr(token_start, i - token_start)));
+      token_start = i + 1;
       continue;
     }
     if (str[i] == '"' && !is_escaped) {
       in_literal_string = !in_literal_string;
     }
     is_escaped = (!is_escaped && str[i] == '\\');
-    tokens.back().push_back(str[i]);
   }
-  for (std::string& token : tokens) token = Trim(token);
+  tokens.push_back(Trim(str.substr(token_start)));
   return tokens;
 }
 
 std::string Escape(std::string_view str) {
   std::string escaped_str("\"");
   for (size_t i = 0; i < str.size(); ++i) {
-    if (str[i] == '"') {
+    if (str[i] == '"' || str[i] == '\\') {
       escaped_str.push_back('\\');
     }
     escaped_str.push_back(str[i]);
@@ -73,22 +76,45 @@ std::string Escape(std::string_view str) {
 
 StatusOr<std::string> Unescape(std::string_view escaped_str, bool quiet) {
   CHECK_OR_RETURN(escaped_str.size() >= 2 && escaped_str.front() == '"' &&
-                      escaped_str.back() == '"' &&
-                      escaped_str[escaped_str.size() - 2] != '\\',
+                      escaped_str.back() == '"',
                   quiet)
       << escaped_str << " is not properly escaped";
+  const size_t end = escaped_str.size() - 1;  // Closing quote.
   std::string str;
-  for (size_t i = 1; i + 1 < escaped_str.size(); ++i) {
-    if (escaped_str[i] == '\\' && escaped_str[i + 1] == '"') {
-      str.push_back('"');
-      ++i;
-    } else {
-      str.push_back(escaped_str[i]);
+  for (size_t i = 1; i < end; ++i) {
+    if (escaped_str[i] == '\\') {
+      // The closing quote cannot be escaped.
+      CHECK_OR_RETURN(i + 1 < end, quiet)
+          << escaped_str << " is not properly escaped";
+      // Other backslashes are kept as is, as written by older versions.
+      if (escaped_str[i + 1] == '"' || escaped_str[i + 1] == '\\') ++i;
     }
+    str.push_back(escaped_str[i]);
   }
   return str;
 }
 
+Fnv1a& Fnv1a::Update(const void* bytes, size_t size) {
+  const uint8_t* const begin = static_cast<const uint8_t*>(bytes);
+  for (const uint8_t* byte = begin; byte < begin + size; ++byte) {
+    hash_ = (hash_ ^ *byte) * 0x100000001b3u;
+  }
+  return *this;
+}
+
+StatusOr<uint64_t> HashFile(const std::string& file_path, bool quiet) {
+  std::ifstream file(file_path, std::ios::binary);
+  CHECK_OR_RETURN(file.is_open(), quiet) << "Cannot open " << file_path;
+  Fnv1a hash;
+  std::vector<char> buffer(1 << 16);
+  while (file) {
+    file.read(buffer.data(), buffer.size());
+    hash.Update(buffer.data(), static_cast<size_t>(file.gcount()));
+  }
+  CHECK_OR_RETURN(file.eof(), quiet) << "Cannot read " << file_path;
+  return hash.hash();
+}
+
 std::string SubsamplingToString(Subsampling chroma_subsampling) {
   switch (chroma_subsampling) {
     case Subsampling::k444:
@@ -108,4 +134,92 @@ StatusOr<Subsampling> SubsamplingFromString(std::string_view str, bool quiet) {
   return Status::kUnknownError;
 }
 
+std::string SimdLevelToString(SimdLevel simd_level) {
+  switch (simd_level) {
+    case SimdLevel::kNone:
+      return "none";
+    case SimdLevel::kSse2:
+      return "sse2";
+    case SimdLevel::kSse4:
+      return "sse4";
+    case SimdLevel::kAvx2:
+      return "avx2";
+    case SimdLevel::kNative:
+      break;
+  }
+  return "native";
+}
+StatusOr<SimdLevel> SimdLevelFromString(std::string_view str, bool quiet) {
+  if (str == "none") return SimdLevel::kNone;
+  if (str == "sse2") return SimdLevel::kSse2;
+  if (str == "sse4") return SimdLevel::kSse4;
+  if (str == "avx2") return SimdLevel::kAvx2;
+  CHECK_OR_RETURN(str == "native", quiet)
+      << "Unknown SIMD level \"" << str << "\"";
+  return SimdLevel::kNative;
+}
+
+std::string DecodeTimingToString(DecodeTiming decode_timing) {
+  switch (decode_timing) {
+    case DecodeTiming::kCold:
+      return "cold";
+    case DecodeTiming::kSteady:
+      return "steady";
+    case DecodeTiming::kWarm:
+      break;
+  }
+  return "warm";
+}
+StatusOr<DecodeTiming> DecodeTimingFromString(std::string_view str,
+                                              bool quiet) {
+  if (str == "cold") return DecodeTiming::kCold;
+  if (str == "steady") return DecodeTiming::kSteady;
+  CHECK_OR_RETURN(str == "warm", quiet)
+      << "Unknown decode timing \"" << str << "\"";
+  return DecodeTiming::kWarm;
+}
+
+std::string DedupModeToString(DedupMode dedup_mode) {
+  switch (dedup_mode) {
+    case DedupMode::kBytes:
+      return "bytes";
+    case DedupMode::kPixels:
+      return "pixels";
+    case DedupMode::kNone:
+      break;
+  }
+  return "none";
+}
+StatusOr<DedupMode> DedupModeFromString(std::string_view str, bool quiet) {
+  if (str == "bytes") return DedupMode::kBytes;
+  if (str == "pixels") return DedupMode::kPixels;
+  CHECK_OR_RETURN(str == "none", quiet)
+      << "Unknown deduplication mode \"" << str << "\"";
+  return DedupMode::kNone;
+}
+
+namespace {
+// Same as the field names in TasksToJson().
+constexpr const char* kDistortionMetricNames[] = {
+    "psnr",       "ssim",        "dssim", "butteraugli",
+    "ssimulacra", "ssimulacra2", "p3norm"};
+static_assert(sizeof(kDistortionMetricNames) /
+                  sizeof(kDistortionMetricNames[0]) ==
+              kNumDistortionMetrics);
+}  // namespace
+
+std::string DistortionMetricToString(DistortionMetric metric) {
+  return kDistortionMetricNames[static_cast<size_t>(metric)];
+}
+StatusOr<DistortionMetric> DistortionMetricFromString(std::string_view str,
+                                                      bool quiet) {
+  for (size_t m = 0; m < kNumDistortionMetrics; ++m) {
+    if (str == kDistortionMetricNames[m]) {
+      return static_cast<DistortionMetric>(m);
+    }
+  }
+  CHECK_OR_RETURN(false, quiet) << "Unknown metric \"" << str << "\"";
+  return Status::kUnknownError;
+}
+
 }  // namespace codec_compare_gen
@@ -15,6 +15,8 @@
 #ifndef SRC_SERIALIZATION_H_
 #define SRC_SERIALIZATION_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -32,14 +34,44 @@ std::string Trim(std::string_view str);
 // Keeps escaped tokens as is. Example: "a,b",c gives two tokens.
 std::vector<std::string> Split(std::string_view str, char delimiter);
 
-// Escapes the quotes in the input string and adds leading and trailing quotes.
+// Escapes the quotes and backslashes in the input string and adds leading and
+// trailing quotes.
 std::string Escape(std::string_view str);
-// Removes leading and trailing quotes and replaces each \" by ".
+// Removes leading and trailing quotes and replaces each \" by " and each \\ by
+// \.
 StatusOr<std::string> Unescape(std::string_view escaped_str, bool quiet);
 
+// 64-bit FNV-1a hash, fast but not cryptographic. Bytes can be fed in several
+// calls, which give the same hash as feeding them all at once.
+class Fnv1a {
+ public:
+  Fnv1a& Update(const void* bytes, size_t size);
+  Fnv1a& Update(std::string_view bytes) {
+    return Update(bytes.data(), bytes.size());
+  }
+  uint64_t hash() const { return hash_; }
+
+ private:
+  uint64_t hash_ = 0xcbf29ce484222325u;
+};
+
+// Returns the Fnv1a hash of the content of the file at file_path.
+StatusOr<uint64_t> HashFile(const std::string& file_path, bool quiet);
+
 // Enum/string conversions.
 std::string SubsamplingToString(Subsampling chroma_subsampling);
 StatusOr<Subsampling> SubsamplingFromString(std::string_view str, bool quiet);
+std::string SimdLevelToString(SimdLevel simd_level);
+StatusOr<SimdLevel> SimdLevelFromString(std::string_view str, bool quiet);
+std::string DecodeTimingToString(DecodeTiming decode_timing);
+StatusOr<DecodeTiming> DecodeTimingFromString(std::string_view str,
+                                              bool quiet);
+std::string DedupModeToString(DedupMode dedup_mode);
+StatusOr<DedupMode> DedupModeFromString(std::string_view str, bool quiet);
+// Lowercase metric names, as used in the JSON outputs.
+std::string DistortionMetricToString(DistortionMetric metric);
+StatusOr<DistortionMetric> DistortionMetricFromString(std::string_view str,
+                                                      bool quiet);
 
 }  // namespace codec_compare_gen
 
@@ -0,0 +1,638 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/shared_image_cache.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "src/base.h"
+#include "src/frame.h"
+#include "src/serialization.h"
+#include "src/yuv.h"
+
+#if defined(HAS_WEBP2)
+#include "third_party/libwebp2/src/wp2/base.h"
+#endif
+
+namespace codec_compare_gen {
+
+namespace {
+
+constexpr uint32_t kIndexMagic = 0x78646963;    // "cidx"
+constexpr uint32_t kSegmentMagic = 0x676d6963;  // "cimg"
+constexpr uint32_t kVersion = 2;
+constexpr size_t kMaxNumEntries = 1024;
+// Number of processes that can reference the same segment at once.
+constexpr size_t kMaxNumHolders = 32;
+// So that the segment names fit in IndexEntry::segment_name.
+constexpr size_t kMaxNameLength = 32;
+constexpr size_t kSegmentNameSize = 64;
+constexpr size_t kRowAlignment = 64;
+// The creator of the index initializes it right after creating it.
+constexpr std::chrono::seconds kMaxInitializationWait(10);
+constexpr std::chrono::milliseconds kPollingPeriod(2);
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "Atomics in shared memory must be address-free");
+
+// The structs below are laid out in shared memory, zero-initialized by
+// ftruncate().
+
+struct Holder {
+  pid_t pid;  // 0 if unused.
+  uint32_t num_references;
+};
+
+struct IndexEntry {
+  char segment_name[kSegmentNameSize];  // Empty if the entry is unused.
+  uint64_t size;       // In bytes. 0 until the segment is published.
+  uint64_t last_use;   // SharedIndex::clock at the last reference change.
+  pid_t publisher;     // Process decoding the image until it is published.
+  // Processes referencing the segment, including the publisher. The references
+  // of the processes that die without releasing them are dropped by
+  // ReapDeadProcesses().
+  Holder holders[kMaxNumHolders];
+};
+
+struct SharedIndex {
+  uint32_t magic;
+  uint32_t version;
+  std::atomic<uint32_t> initialized;
+  pthread_mutex_t mutex;  // Process-shared. Guards the fields below.
+  uint64_t clock;
+  IndexEntry entries[kMaxNumEntries];
+};
+
+struct SegmentHeader {
+  uint32_t magic;
+  uint32_t num_frames;  // Followed by as many SegmentFrame, then the pixels.
+};
+
+struct SegmentFrame {
+  uint32_t width;
+  uint32_t height;
+  uint32_t format;  // WP2SampleFormat.
+  uint32_t stride;
+  uint32_t duration_ms;
+  uint64_t offset;  // Of the first row, from the start of the segment.
+};
+
+uint64_t Align(uint64_t size) {
+  return (size + kRowAlignment - 1) / kRowAlignment * kRowAlignment;
+}
+
+std::string IndexName(const std::string& name) {
+  return "/" + name + "_index";
+}
+
+// Polls done() until it returns true or kMaxInitializationWait elapses.
+template <typename Predicate>
+bool WaitUntil(const Predicate& done) {
+  const auto deadline =
+      std::chrono::steady_clock::now() + kMaxInitializationWait;
+  while (!done()) {
+    if (std::chrono::steady_clock::now() > deadline) return false;
+    std::this_thread::sleep_for(kPollingPeriod);
+  }
+  return true;
+}
+
+// Returns false if the process does not exist anymore. Process identifiers are
+// only meaningful within a PID namespace, like the index in /dev/shm usually.
+bool IsAlive(pid_t pid) { return kill(pid, 0) == 0 || errno == EPERM; }
+
+bool IsInUse(const IndexEntry& entry) {
+  for (const Holder& holder : entry.holders) {
+    if (holder.num_references != 0) return true;
+  }
+  return false;
+}
+
+// Locks a process-shared mutex for the lifetime of the object.
+class SharedLock {
+ public:
+  explicit SharedLock(pthread_mutex_t& mutex) : mutex_(mutex) {
+    if (pthread_mutex_lock(&mutex_) == EOWNERDEAD) {
+      // A process died while holding the lock. Each modification of the index
+      // is small enough to leave it usable.
+#if defined(__linux__)
+      pthread_mutex_consistent(&mutex_);
+#endif
+    }
+  }
+  ~SharedLock() { pthread_mutex_unlock(&mutex_); }
+
+ private:
+  pthread_mutex_t& mutex_;
+};
+
+}  // namespace
+
+class SharedImageCache::Index {
+ public:
+  Index(SharedIndex* shared, std::string name, uint64_t max_size)
+      : shared_(shared), name_(std::move(name)), max_size_(max_size) {}
+  ~Index() { munmap(shared_, sizeof(SharedIndex)); }
+
+  std::string SegmentName(uint64_t hash, uint32_t format) const {
+    std::stringstream segment_name;
+    segment_name << "/" << name_ << "_" << std::hex << std::setfill('0')
+                 << std::setw(16) << hash << "_" << std::dec << format;
+    return segment_name.str();
+  }
+
+  // Adds a reference to the entry of segment_name, creating it if missing, in
+  // which case is_new is set to true and the caller must publish the segment.
+  // Returns false if the index is full of segments in use, or if too many
+  // processes reference the segment.
+  bool Acquire(const std::string& segment_name, bool& is_new) {
+    SharedLock lock(shared_->mutex);
+    const pid_t pid = getpid();
+    IndexEntry* entry = Find(segment_name);
+    is_new = entry == nullptr;
+    if (is_new) {
+      entry = FindUnused();
+      if (entry == nullptr) return false;
+      std::strncpy(entry->segment_name, segment_name.c_str(),
+                   kSegmentNameSize - 1);
+      entry->publisher = pid;
+    }
+    Holder* holder = FindHolder(*entry, pid);
+    if (holder == nullptr) {  // Cannot be new.
+      ReapDeadProcesses();
+      // The entry itself may have been reaped if its publisher died.
+      entry = Find(segment_name);
+      if (entry == nullptr) return false;
+      holder = FindHolder(*entry, pid);
+      if (holder == nullptr) return false;
+    }
+    holder->pid = pid;
+    ++holder->num_references;
+    entry->last_use = ++shared_->clock;
+    return true;
+  }
+
+  // Returns the size of the segment once it is published, or nothing if its
+  // publication was abandoned, including by a publisher that died.
+  std::optional<uint64_t> WaitForPublication(const std::string& segment_name) {
+    while (true) {
+      {
+        SharedLock lock(shared_->mutex);
+        IndexEntry* entry = Find(segment_name);
+        if (entry == nullptr) return std::nullopt;
+        if (entry->size != 0) return entry->size;
+        if (!IsAlive(entry->publisher)) {
+          Unlink(*entry);
+          return std::nullopt;
+        }
+      }
+      // Decoding a large animation can take a while.
+      std::this_thread::sleep_for(kPollingPeriod);
+    }
+  }
+
+  void Publish(const std::string& segment_name, uint64_t size) {
+    SharedLock lock(shared_->mutex);
+    IndexEntry* entry = Find(segment_name);
+    if (entry != nullptr) {
+      entry->size = size;
+      entry->publisher = 0;
+    }
+    EvictAboveMaxSize();
+  }
+
+  // Removes the entry of a segment that could not be published. The processes
+  // waiting for it decode the image locally.
+  void Abandon(const std::string& segment_name) {
+    SharedLock lock(shared_->mutex);
+    IndexEntry* entry = Find(segment_name);
+    if (entry != nullptr) Unlink(*entry);
+  }
+
+  void Release(const std::string& segment_name) {
+    SharedLock lock(shared_->mutex);
+    IndexEntry* entry = Find(segment_name);
+    if (entry == nullptr) return;
+    for (Holder& holder : entry->holders) {
+      if (holder.pid == getpid() && holder.num_references > 0) {
+        if (--holder.num_references == 0) holder.pid = 0;
+        break;
+      }
+    }
+    entry->last_use = ++shared_->clock;
+    EvictAboveMaxSize();
+  }
+
+  void RemoveAll() {
+    SharedLock lock(shared_->mutex);
+    for (IndexEntry& entry : shared_->entries) {
+      if (entry.segment_name[0] != '\0') Unlink(entry);
+    }
+  }
+
+  std::atomic<size_t> num_decodings{0};
+  std::atomic<size_t> num_mappings{0};
+
+ private:
+  // The functions below expect shared_->mutex to be locked.
+
+  IndexEntry* Find(const std::string& segment_name) {
+    for (IndexEntry& entry : shared_->entries) {
+      if (segment_name == entry.segment_name) return &entry;
+    }
+    return nullptr;
+  }
+
+  // Returns the holder of pid in the entry, or an unused one, or null.
+  static Holder* FindHolder(IndexEntry& entry, pid_t pid) {
+    Holder* unused = nullptr;
+    for (Holder& holder : entry.holders) {
+      if (holder.pid == pid) return &holder;
+      if (holder.pid == 0 && unused == nullptr) unused = &holder;
+    }
+    return unused;
+  }
+
+  // Drops the references of the processes that died without releasing them,
+  // and the entries of the segments that they died publishing.
+  void ReapDeadProcesses() {
+    for (IndexEntry& entry : shared_->entries) {
+      if (entry.segment_name[0] == '\0') continue;
+      if (entry.size == 0 && !IsAlive(entry.publisher)) {
+        Unlink(entry);
+        continue;
+      }
+      for (Holder& holder : entry.holders) {
+        if (holder.pid != 0 && !IsAlive(holder.pid)) holder = Holder();
+      }
+    }
+  }
+
+  // Returns an unused entry, evicting a segment if needed.
+  IndexEntry* FindUnused() {
+    for (int attempt = 0; attempt < 2; ++attempt) {
+      for (IndexEntry& entry : shared_->entries) {
+        if (entry.segment_name[0] == '\0') return &entry;
+      }
+      if (attempt == 0) ReapDeadProcesses();
+    }
+    IndexEntry* lru = FindLeastRecentlyUsed();
+    if (lru != nullptr) Unlink(*lru);
+    return lru;
+  }
+
+  // Returns the least recently used published segment that is not in use.
+  IndexEntry* FindLeastRecentlyUsed() {
+    IndexEntry* lru = nullptr;
+    for (IndexEntry& entry : shared_->entries) {
+      if (entry.segment_name[0] != '\0' && entry.size != 0 &&
+          !IsInUse(entry) &&
+          (lru == nullptr || entry.last_use < lru->last_use)) {
+        lru = &entry;
+      }
+    }
+    return lru;
+  }
+
+  void EvictAboveMaxSize() {
+    uint64_t total_size = 0;
+    for (const IndexEntry& entry : shared_->entries) total_size += entry.size;
+    if (total_size <= max_size_) return;
+    // Only checked when needed because each check is a system call.
+    ReapDeadProcesses();
+    while (total_size > max_size_) {
+      IndexEntry* lru = FindLeastRecentlyUsed();
+      if (lru == nullptr) return;  // Everything left is in use.
+      total_size -= lru->size;
+      Unlink(*lru);
+    }
+  }
+
+  // The mappings of the segment stay valid until they are unmapped.
+  void Unlink(IndexEntry& entry) {
+    shm_unlink(entry.segment_name);
+    std::memset(&entry, 0, sizeof(entry));
+  }
+
+  SharedIndex* const shared_;
+  const std::string name_;
+  const uint64_t max_size_;
+};
+
+StatusOr<SharedImageCache> SharedImageCache::Open(const std::string& name,
+                                                  uint64_t max_size,
+                                                  bool quiet) {
+  CHECK_OR_RETURN(!name.empty() && name.size() <= kMaxNameLength &&
+                      name.find('/') == std::string::npos,
+                  quiet)
+      << "Invalid shared image cache name \"" << name << "\"";
+  // The segments are files of the tmpfs mounted at /dev/shm on Linux. Keep
+  // them within its size so that the eviction kicks in before it is full.
+  struct statvfs shm_stat;
+  if (statvfs("/dev/shm", &shm_stat) == 0) {
+    const uint64_t shm_size =
+        static_cast<uint64_t>(shm_stat.f_blocks) * shm_stat.f_frsize;
+    if (max_size > shm_size) {
+      if (!quiet) {
+        std::cout << "Warning: the shared image cache is limited to the "
+                  << (shm_size >> 20) << " MiB of /dev/shm" << std::endl;
+      }
+      max_size = shm_size;
+    }
+  }
+  const std::string index_name = IndexName(name);
+  bool is_creator = true;
+  int fd = shm_open(index_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0 && errno == EEXIST) {
+    is_creator = false;
+    fd = shm_open(index_name.c_str(), O_RDWR, 0);
+  }
+  CHECK_OR_RETURN(fd >= 0, quiet)
+      << "Could not open the shared memory object " << index_name;
+  bool has_size;
+  if (is_creator) {
+    has_size = ftruncate(fd, sizeof(SharedIndex)) == 0;
+  } else {  // The creator may not have resized it yet.
+    has_size = WaitUntil([fd]() {
+      struct stat index_stat;
+      return fstat(fd, &index_stat) == 0 &&
+             static_cast<size_t>(index_stat.st_size) >= sizeof(SharedIndex);
+    });
+  }
+  void* data = has_size ? mmap(nullptr, sizeof(SharedIndex),
+                               PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                        : MAP_FAILED;
+  close(fd);
+  CHECK_OR_RETURN(data != MAP_FAILED, quiet)
+      << "Could not map " << index_name << " in memory";
+
+  SharedImageCache cache;
+  SharedIndex* shared = static_cast<SharedIndex*>(data);
+  cache.index_ = std::make_shared<Index>(shared, name, max_size);
+  if (is_creator) {
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+#if defined(__linux__)
+    pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+#endif
+    const bool initialized =
+        pthread_mutex_init(&shared->mutex, &attributes) == 0;
+    pthread_mutexattr_destroy(&attributes);
+    CHECK_OR_RETURN(initialized, quiet) << "Could not initialize a mutex";
+    shared->magic = kIndexMagic;
+    shared->version = kVersion;
+    shared->initialized.store(1, std::memory_order_release);
+  } else {
+    CHECK_OR_RETURN(WaitUntil([shared]() {
+                      return shared->initialized.load(
+                                 std::memory_order_acquire) != 0;
+                    }),
+                    quiet)
+        << "The shared memory object " << index_name
+        << " was left uninitialized, remove it";
+  }
+  CHECK_OR_RETURN(shared->magic == kIndexMagic && shared->version == kVersion,
+                  quiet)
+      << "The shared memory object " << index_name
+      << " was created by another version of ccgen, remove it";
+  return cache;
+}
+
+Status SharedImageCache::Remove(const std::string& name, bool quiet) {
+  const std::string index_name = IndexName(name);
+  const int fd = shm_open(index_name.c_str(), O_RDWR, 0);
+  if (fd < 0 && errno == ENOENT) return Status::kOk;
+  CHECK_OR_RETURN(fd >= 0, quiet)
+      << "Could not open the shared memory object " << index_name;
+  struct stat index_stat;
+  const bool has_size =
+      fstat(fd, &index_stat) == 0 &&
+      static_cast<size_t>(index_stat.st_size) >= sizeof(SharedIndex);
+  void* data = has_size ? mmap(nullptr, sizeof(SharedIndex),
+                               PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                        : MAP_FAILED;
+  close(fd);
+  if (data != MAP_FAILED) {
+    Index index(static_cast<SharedIndex*>(data), name, /*max_size=*/0);
+    if (static_cast<SharedIndex*>(data)->initialized.load(
+            std::memory_order_acquire) != 0) {
+      index.RemoveAll();
+    }
+  }
+  CHECK_OR_RETURN(shm_unlink(index_name.c_str()) == 0, quiet)
+      << "Could not remove the shared memory object " << index_name;
+  return Status::kOk;
+}
+
+size_t SharedImageCache::num_decodings() const {
+  return index_ == nullptr ? 0 : index_->num_decodings.load();
+}
+
+size_t SharedImageCache::num_mappings() const {
+  return index_ == nullptr ? 0 : index_->num_mappings.load();
+}
+
+#if defined(HAS_WEBP2)
+
+namespace {
+
+// Creates the segment and copies the image into it. Returns its size.
+StatusOr<uint64_t> WriteSegment(const std::string& segment_name,
+                                const Image& image, bool quiet) {
+  CHECK_OR_RETURN(!image.empty(), quiet);
+  std::vector<SegmentFrame> frames;
+  uint64_t size = Align(sizeof(SegmentHeader) +
+                        image.size() * sizeof(SegmentFrame));
+  for (const Frame& frame : image) {
+    const WP2::ArgbBuffer& pixels = frame.pixels;
+    SegmentFrame segment_frame;
+    segment_frame.width = pixels.width();
+    segment_frame.height = pixels.height();
+    segment_frame.format = pixels.format();
+    segment_frame.stride = pixels.width() * WP2FormatBpp(pixels.format());
+    segment_frame.duration_ms = frame.duration_ms;
+    segment_frame.offset = size;
+    size += Align(static_cast<uint64_t>(segment_frame.stride) *
+                  segment_frame.height);
+    frames.push_back(segment_frame);
+  }
+
+  int fd = shm_open(segment_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0 && errno == EEXIST) {
+    // Left over by a process that died while publishing it, or by a removed
+    // index.
+    shm_unlink(segment_name.c_str());
+    fd = shm_open(segment_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  }
+  CHECK_OR_RETURN(fd >= 0, quiet)
+      << "Could not create the shared memory object " << segment_name;
+  // Reserve the pages now: writing to a sparse segment that the tmpfs cannot
+  // back would raise SIGBUS instead of returning an error.
+  const bool has_size = ftruncate(fd, static_cast<off_t>(size)) == 0 &&
+                        posix_fallocate(fd, 0, static_cast<off_t>(size)) == 0;
+  void* data = has_size ? mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                               MAP_SHARED, fd, 0)
+                        : MAP_FAILED;
+  close(fd);
+  if (data == MAP_FAILED) shm_unlink(segment_name.c_str());
+  CHECK_OR_RETURN(data != MAP_FAILED, quiet)
+      << "Could not allocate " << size << " bytes of shared memory";
+
+  uint8_t* bytes = static_cast<uint8_t*>(data);
+  const SegmentHeader header = {kSegmentMagic,
+                                static_cast<uint32_t>(frames.size())};
+  std::memcpy(bytes, &header, sizeof(header));
+  std::memcpy(bytes + sizeof(header), frames.data(),
+              frames.size() * sizeof(SegmentFrame));
+  for (size_t f = 0; f < image.size(); ++f) {
+    for (uint32_t y = 0; y < frames[f].height; ++y) {
+      std::memcpy(bytes + frames[f].offset + y * frames[f].stride,
+                  image[f].pixels.GetRow(y), frames[f].stride);
+    }
+  }
+  munmap(data, size);
+  return size;
+}
+
+}  // namespace
+
+StatusOr<std::shared_ptr<const Image>> SharedImageCache::MapSegment(
+    const std::string& segment_name, uint64_t size, bool quiet) const {
+  const int fd = shm_open(segment_name.c_str(), O_RDONLY, 0);
+  struct stat segment_stat;
+  const bool has_size = fd >= 0 && fstat(fd, &segment_stat) == 0 &&
+                        static_cast<uint64_t>(segment_stat.st_size) == size;
+  void* data = has_size ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0)
+                        : MAP_FAILED;
+  if (fd >= 0) close(fd);
+  if (data == MAP_FAILED) index_->Release(segment_name);
+  CHECK_OR_RETURN(data != MAP_FAILED, quiet)
+      << "Could not map " << segment_name << " in memory";
+
+  // From now on the deleter releases the reference, even on failure.
+  const std::shared_ptr<Index> index = index_;
+  std::shared_ptr<Image> image(
+      new Image(), [index, segment_name, data, size](Image* image) {
+        delete image;
+        munmap(data, size);
+        index->Release(segment_name);
+      });
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  SegmentHeader header;
+  std::memcpy(&header, bytes, sizeof(header));
+  CHECK_OR_RETURN(header.magic == kSegmentMagic && header.num_frames > 0 &&
+                      sizeof(header) + header.num_frames *
+                                           sizeof(SegmentFrame) <=
+                          size,
+                  quiet)
+      << "Corrupted shared memory object " << segment_name;
+  image->reserve(header.num_frames);
+  for (uint32_t f = 0; f < header.num_frames; ++f) {
+    SegmentFrame frame;
+    std::memcpy(&frame, bytes + sizeof(header) + f * sizeof(SegmentFrame),
+                sizeof(frame));
+    const WP2SampleFormat format = static_cast<WP2SampleFormat>(frame.format);
+    CHECK_OR_RETURN(
+        frame.format < WP2_FORMAT_NUM &&
+            static_cast<uint64_t>(frame.width) * WP2FormatBpp(format) <=
+                frame.stride &&
+            frame.offset + static_cast<uint64_t>(frame.stride) *
+                               frame.height <=
+                size,
+        quiet)
+        << "Corrupted shared memory object " << segment_name;
+    image->emplace_back(WP2::ArgbBuffer(format), frame.duration_ms);
+    // Read-only view: the pixels must not be modified through the buffer.
+    CHECK_OR_RETURN(image->back().pixels.SetExternal(
+                        frame.width, frame.height,
+                        const_cast<uint8_t*>(bytes + frame.offset),
+                        frame.stride) == WP2_STATUS_OK,
+                    quiet);
+  }
+  ++index_->num_mappings;
+  return std::shared_ptr<const Image>(std::move(image));
+}
+
+StatusOr<std::shared_ptr<const Image>> SharedImageCache::Get(
+    const std::string& image_path, WP2SampleFormat format, bool quiet) {
+  CHECK_OR_RETURN(enabled(), quiet);
+  CHECK_OR_RETURN(!IsYuvFile(image_path), quiet)
+      << "YUV files cannot be shared (" << image_path << ")";
+  ASSIGN_OR_RETURN(const uint64_t hash, HashFile(image_path, quiet));
+  const std::string segment_name = index_->SegmentName(hash, format);
+
+  bool is_new = false;
+  const bool is_acquired = index_->Acquire(segment_name, is_new);
+  std::optional<uint64_t> size;
+  if (is_acquired && is_new) {
+    StatusOr<Image> image =
+        ReadStillImageOrAnimation(image_path.c_str(), format, quiet);
+    if (image.status != Status::kOk) index_->Abandon(segment_name);
+    OK_OR_RETURN(image.status);
+    ++index_->num_decodings;
+    const StatusOr<uint64_t> segment_size =
+        WriteSegment(segment_name, image.value, /*quiet=*/true);
+    if (segment_size.status != Status::kOk) {
+      index_->Abandon(segment_name);
+      return std::shared_ptr<const Image>(
+          std::make_shared<const Image>(std::move(image.value)));
+    }
+    index_->Publish(segment_name, segment_size.value);
+    size = segment_size.value;
+  } else if (is_acquired) {
+    size = index_->WaitForPublication(segment_name);
+    if (!size.has_value()) index_->Release(segment_name);
+  }
+
+  if (size.has_value()) {
+    StatusOr<std::shared_ptr<const Image>> image =
+        MapSegment(segment_name, size.value(), /*quiet=*/true);
+    if (image.status == Status::kOk) return image;
+  }
+  // Not shared, for example because the index is full of images in use.
+  ASSIGN_OR_RETURN(Image image,
+                   ReadStillImageOrAnimation(image_path.c_str(), format,
+                                             quiet));
+  ++index_->num_decodings;
+  return std::shared_ptr<const Image>(
+      std::make_shared<const Image>(std::move(image)));
+}
+
+#endif  // HAS_WEBP2
+
+}  // namespace codec_compare_gen
@@ -0,0 +1,88 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_SHARED_IMAGE_CACHE_H_
+#define SRC_SHARED_IMAGE_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "src/base.h"
+#include "src/frame.h"
+
+#if defined(HAS_WEBP2)
+#include "third_party/libwebp2/src/wp2/base.h"
+#endif
+
+namespace codec_compare_gen {
+
+// Cache of decoded original images in POSIX shared memory, shared by all the
+// ccgen processes of a host. Each image is decoded by the first process that
+// needs it and published as a segment named after a hash of the file content
+// and the pixel format. Other processes map the segment read-only instead of
+// decoding the file again, so the pixels are resident in memory only once per
+// host. A shared index counts the references to each segment per process, so
+// that the references of a process that dies without releasing them, and the
+// segments it was decoding, can be dropped. Unreferenced segments are unlinked
+// in least recently used order when the total size of the segments exceeds the
+// limit. Segments outlive the processes until they are evicted or removed with
+// Remove().
+class SharedImageCache {
+ public:
+  SharedImageCache() = default;  // Disabled.
+
+  // Opens the cache called name, creating it if no process did. The total size
+  // of the segments is kept under max_size bytes as long as they are not in
+  // use. Processes sharing a cache should use the same max_size. It is capped
+  // to the size of /dev/shm if any.
+  static StatusOr<SharedImageCache> Open(const std::string& name,
+                                         uint64_t max_size, bool quiet);
+  // Unlinks the index and all the segments of the cache called name. The
+  // images mapped by running processes stay valid.
+  static Status Remove(const std::string& name, bool quiet);
+
+  bool enabled() const { return index_ != nullptr; }
+
+#if defined(HAS_WEBP2)
+  // Returns the image at image_path decoded as by ReadStillImageOrAnimation(),
+  // mapped read-only from shared memory. Waits for another process decoding
+  // the same image. Falls back to decoding the image locally if it cannot be
+  // published, for example if the index is full of images in use or if the
+  // shared memory cannot hold the segment. YUV files
+  // are not supported (see IsYuvFile()) because Frame::yuv is not shared.
+  StatusOr<std::shared_ptr<const Image>> Get(const std::string& image_path,
+                                             WP2SampleFormat format,
+                                             bool quiet);
+#endif
+
+  // Number of images decoded and of segments mapped by this process so far.
+  size_t num_decodings() const;
+  size_t num_mappings() const;
+
+ private:
+  class Index;  // Mapping of the shared index.
+#if defined(HAS_WEBP2)
+  // Maps the published segment read-only. The reference to the segment is
+  // released when the returned image is destroyed, or right away on failure.
+  StatusOr<std::shared_ptr<const Image>> MapSegment(
+      const std::string& segment_name, uint64_t size, bool quiet) const;
+#endif
+  std::shared_ptr<Index> index_;  // Kept alive by the returned images.
+};
+
+}  // namespace codec_compare_gen
+
+#endif  // SRC_SHARED_IMAGE_CACHE_H_
@@ -0,0 +1,216 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/simd.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+#include "src/base.h"
+#include "src/serialization.h"
+
+#if defined(HAS_JPEGXL)
+#include "hwy/targets.h"
+#endif
+
+#if defined(HAS_WEBP2)
+#include "third_party/libwebp2/src/dsp/dsp.h"
+#endif
+
+#if defined(HAS_AVIF)
+#include "avif/avif.h"
+
+// Exported by dav1d (src/cpu.h) but not declared in its public headers. Weak
+// so that libavif builds without dav1d still link.
+extern "C" {
+__attribute__((weak)) void dav1d_set_cpu_flags_mask(unsigned mask);
+}
+#endif
+
+#if defined(HAS_WEBP)
+// Same opaque declaration as in libwebp's examples/cwebp.c to avoid depending
+// on the private header src/dsp/cpu.h.
+extern "C" {
+typedef int (*VP8CPUInfo)(int feature);
+extern VP8CPUInfo VP8GetCPUInfo;
+// From libwebp's sharpyuv/sharpyuv.h. Weak because libsharpyuv only exists
+// since libwebp 1.3.0, before which sharp YUV was part of libwebp itself.
+__attribute__((weak)) void SharpYuvInit(VP8CPUInfo cpu_info_func);
+}
+#endif
+
+namespace codec_compare_gen {
+
+namespace {
+
+std::mutex simd_level_mutex;
+bool simd_level_is_applied = false;
+SimdLevel applied_simd_level = SimdLevel::kNative;
+
+#if defined(HAS_WEBP)
+// Mirrors CPUFeature in libwebp/src/dsp/cpu.h.
+enum WebpCpuFeature { kSSE2, kSSE3, kSlowSSSE3, kSSE4_1, kAVX, kAVX2 };
+
+VP8CPUInfo native_webp_cpu_info = nullptr;
+
+int CappedWebpCpuInfo(int feature) {
+  if (native_webp_cpu_info == nullptr) return 0;
+  const int max_feature = applied_simd_level == SimdLevel::kSse2   ? kSSE2
+                          : applied_simd_level == SimdLevel::kSse4 ? kSSE4_1
+                                                                   : kAVX2;
+  if (feature >= kSSE2 && feature <= kAVX2 && feature > max_feature) return 0;
+  return native_webp_cpu_info(feature);
+}
+#endif  // HAS_WEBP
+
+#if defined(HAS_WEBP2)
+WP2CPUInfo native_webp2_cpu_info = nullptr;
+
+bool CappedWebp2CpuInfo(WP2CPUFeature feature) {
+  if (native_webp2_cpu_info == nullptr) return false;
+  const WP2CPUFeature max_feature =
+      applied_simd_level == SimdLevel::kSse2   ? ::kSSE2
+      : applied_simd_level == SimdLevel::kSse4 ? ::kSSE4_2
+                                               : ::kAVX2;
+  if (feature >= ::kSSE2 && feature <= ::kAVX2 && feature > max_feature) {
+    return false;
+  }
+  return native_webp2_cpu_info(feature);
+}
+#endif  // HAS_WEBP2
+
+void SetEnv(const char* name, const char* value) {
+  setenv(name, value, /*overwrite=*/1);
+}
+
+}  // namespace
+
+Status ApplySimdLevel(SimdLevel simd_level, bool quiet) {
+  std::lock_guard<std::mutex> lock(simd_level_mutex);
+  if (simd_level_is_applied) {
+    CHECK_OR_RETURN(simd_level == applied_simd_level, quiet)
+        << "SIMD level " << SimdLevelToString(applied_simd_level)
+        << " was already applied to this process, cannot switch to "
+        << SimdLevelToString(simd_level);
+    return Status::kOk;
+  }
+#if defined(HAS_AVIF)
+  if (simd_level != SimdLevel::kNative && dav1d_set_cpu_flags_mask == nullptr) {
+    // The symbol is hidden in shared builds of dav1d. The recorded level would
+    // not match the AVIF decoding timings.
+    const char* decoder_name =
+        avifCodecName(AVIF_CODEC_CHOICE_AUTO, AVIF_CODEC_FLAG_CAN_DECODE);
+    CHECK_OR_RETURN(decoder_name == nullptr ||
+                        std::strcmp(decoder_name, "dav1d") != 0,
+                    quiet)
+        << "Cannot apply SIMD level " << SimdLevelToString(simd_level)
+        << " to dav1d: dav1d_set_cpu_flags_mask() is not exported. Link dav1d "
+           "statically or use --simd_level native";
+  }
+#endif
+  simd_level_is_applied = true;
+  applied_simd_level = simd_level;
+  if (simd_level == SimdLevel::kNative) return Status::kOk;
+
+  // libjpeg-turbo and mozjpeg (simd/x86_64/jsimd.c). There is no SSE4 path.
+  if (simd_level == SimdLevel::kNone) {
+    SetEnv("JSIMD_FORCENONE", "1");
+  } else if (simd_level != SimdLevel::kAvx2) {
+    SetEnv("JSIMD_FORCESSE2", "1");
+  }
+
+  // libaom (aom_ports/x86.h). HAS_MMX|HAS_SSE|HAS_SSE2 is 0x7, adding
+  // HAS_SSE3|HAS_SSSE3|HAS_SSE4_1|HAS_SSE4_2 gives 0x13F and adding HAS_AVX and
+  // HAS_AVX2 gives 0x1FF.
+  SetEnv("AOM_SIMD_CAPS_MASK", simd_level == SimdLevel::kNone   ? "0x0"
+                               : simd_level == SimdLevel::kSse2 ? "0x7"
+                               : simd_level == SimdLevel::kSse4 ? "0x13F"
+                                                                : "0x1FF");
+
+  // libyuv as used by libavif (source/cpu_id.cc).
+  if (simd_level == SimdLevel::kNone) {
+    SetEnv("LIBYUV_DISABLE_ASM", "1");
+  } else {
+    if (simd_level == SimdLevel::kSse2) {
+      SetEnv("LIBYUV_DISABLE_SSSE3", "1");
+      SetEnv("LIBYUV_DISABLE_SSE41", "1");
+      SetEnv("LIBYUV_DISABLE_SSE42", "1");
+    }
+    if (simd_level != SimdLevel::kAvx2) {
+      SetEnv("LIBYUV_DISABLE_AVX", "1");
+      SetEnv("LIBYUV_DISABLE_AVX2", "1");
+      SetEnv("LIBYUV_DISABLE_FMA3", "1");
+    }
+    SetEnv("LIBYUV_DISABLE_AVX512BW", "1");
+    SetEnv("LIBYUV_DISABLE_AVX512VL", "1");
+  }
+
+#if defined(HAS_WEBP)
+  // libwebp reads VP8GetCPUInfo each time its DSP functions are initialized.
+  native_webp_cpu_info = VP8GetCPUInfo;
+  VP8GetCPUInfo =
+      simd_level == SimdLevel::kNone ? nullptr : &CappedWebpCpuInfo;
+  // libsharpyuv keeps its own CPU info hook, with the same features as libwebp.
+  // It is used by WebPPictureSharpARGBToYUVA() and by libavif.
+  if (SharpYuvInit != nullptr) SharpYuvInit(VP8GetCPUInfo);
+#endif
+
+#if defined(HAS_WEBP2)
+  // libwebp2 reads WP2GetCPUInfo each time its DSP functions are initialized.
+  native_webp2_cpu_info = WP2GetCPUInfo;
+  WP2GetCPUInfo =
+      simd_level == SimdLevel::kNone ? nullptr : &CappedWebp2CpuInfo;
+#endif
+
+#if defined(HAS_AVIF)
+  // dav1d as used by libavif (src/x86/cpu.h). DAV1D_X86_CPU_FLAG_SSE2 is 0x1,
+  // adding SSSE3 and SSE41 gives 0x7 and adding AVX2 gives 0xF. AVX-512 is
+  // left out at all levels, as for libyuv.
+  if (dav1d_set_cpu_flags_mask != nullptr) {
+    dav1d_set_cpu_flags_mask(simd_level == SimdLevel::kNone   ? 0x0
+                             : simd_level == SimdLevel::kSse2 ? 0x1
+                             : simd_level == SimdLevel::kSse4 ? 0x7
+                                                              : 0xF);
+  }
+#endif
+
+#if defined(HAS_JPEGXL)
+  // Only affects the Highway copy statically linked for jpegli. The static
+  // target, the instruction set the library was compiled for (SSE2 or SSSE3 by
+  // default on x86-64), cannot be disabled at runtime, so kNone and kSse2 both
+  // fall back to it. Only building with HWY_COMPILE_ONLY_SCALAR removes it.
+  int64_t allowed_targets = HWY_STATIC_TARGET | HWY_EMU128 | HWY_SCALAR;
+  if (simd_level == SimdLevel::kSse4 || simd_level == SimdLevel::kAvx2) {
+    allowed_targets |= HWY_SSSE3 | HWY_SSE4;
+  }
+  if (simd_level == SimdLevel::kAvx2) allowed_targets |= HWY_AVX2;
+  hwy::DisableTargets(~allowed_targets);
+  if (!quiet) {
+    std::cout << "Warning: SIMD level " << SimdLevelToString(simd_level)
+              << " is not applied to libjxl, whose timings stay native"
+              << std::endl;
+  }
+#endif
+  return Status::kOk;
+}
+
+SimdLevel GetSimdLevel() {
+  std::lock_guard<std::mutex> lock(simd_level_mutex);
+  return applied_simd_level;
+}
+
+}  // namespace codec_compare_gen
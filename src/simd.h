@@ -0,0 +1,40 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_SIMD_H_
+#define SRC_SIMD_H_
+
+#include "src/base.h"
+
+namespace codec_compare_gen {
+
+// Caps the instruction set extensions selected by the runtime dispatch of the
+// codec libraries, through their environment variables or CPU info hooks.
+// Most libraries detect the CPU features only once, so this must be called
+// before any encoding or decoding happens in the current process, and only one
+// level can be used per process. To compare levels, run one process per level.
+// Returns an error if a linked library cannot be capped at all (dav1d built as
+// a shared library hides its hook), so that the level recorded in TaskOutput is
+// the applied one. Known gaps: libjxl embeds its own copy of Highway without
+// any hook reachable from here (a warning is printed), and jpegli keeps the
+// baseline instruction set it was compiled for with SimdLevel::kNone (see
+// hwy::DisableTargets()).
+Status ApplySimdLevel(SimdLevel simd_level, bool quiet);
+
+// Returns the level given to ApplySimdLevel(), or kNative if never called.
+SimdLevel GetSimdLevel();
+
+}  // namespace codec_compare_gen
+
+#endif  // SRC_SIMD_H_
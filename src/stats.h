@@ -0,0 +1,39 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_STATS_H_
+#define SRC_STATS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace codec_compare_gen {
+
+// Returns the value at the given fraction (in [0:1]) of the sorted values,
+// using the nearest-rank method. Returns 0 if values is empty.
+inline double Percentile(const std::vector<double>& sorted_values,
+                         double fraction) {
+  if (sorted_values.empty()) return 0;
+  const size_t rank = static_cast<size_t>(
+      std::ceil(fraction * static_cast<double>(sorted_values.size())));
+  const size_t index =
+      std::min(std::max<size_t>(rank, 1), sorted_values.size()) - 1;
+  return sorted_values[index];
+}
+
+}  // namespace codec_compare_gen
+
+#endif  // SRC_STATS_H_
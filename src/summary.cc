@@ -0,0 +1,520 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/summary.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/base.h"
+#include "src/codec.h"
+#include "src/codec_plugin.h"
+#include "src/framework.h"
+#include "src/serialization.h"
+#include "src/task.h"
+#include "src/worker.h"
+
+namespace codec_compare_gen {
+
+//------------------------------------------------------------------------------
+// Rate-distortion curves
+
+RateDistortionCurve::RateDistortionCurve(
+    std::vector<std::pair<double, double>> points) {
+  std::sort(points.begin(), points.end());
+  for (size_t i = 0; i < points.size();) {
+    // Average the rates of the points sharing the same distortion.
+    size_t end = i + 1;
+    double sum = points[i].second;
+    while (end < points.size() && points[end].first == points[i].first) {
+      sum += points[end++].second;
+    }
+    x_.push_back(points[i].first);
+    y_.push_back(sum / static_cast<double>(end - i));
+    i = end;
+  }
+  if (empty()) return;
+
+  const size_t n = x_.size();
+  std::vector<double> secants(n - 1);
+  for (size_t k = 0; k + 1 < n; ++k) {
+    secants[k] = (y_[k + 1] - y_[k]) / (x_[k + 1] - x_[k]);
+  }
+  slopes_.resize(n);
+  slopes_.front() = secants.front();
+  slopes_.back() = secants.back();
+  for (size_t k = 1; k + 1 < n; ++k) {
+    if (secants[k - 1] * secants[k] <= 0) {
+      slopes_[k] = 0;  // Local extremum. Keep the curve monotone.
+    } else {
+      // Weighted harmonic mean of the neighboring secants.
+      const double h0 = x_[k] - x_[k - 1];
+      const double h1 = x_[k + 1] - x_[k];
+      const double w0 = 2 * h1 + h0;
+      const double w1 = h1 + 2 * h0;
+      slopes_[k] = (w0 + w1) / (w0 / secants[k - 1] + w1 / secants[k]);
+    }
+  }
+}
+
+double RateDistortionCurve::Interpolate(double distortion) const {
+  const size_t k = std::min<size_t>(
+      std::max<std::ptrdiff_t>(
+          std::upper_bound(x_.begin(), x_.end(), distortion) - x_.begin() - 1,
+          0),
+      x_.size() - 2);
+  const double h = x_[k + 1] - x_[k];
+  const double s = (distortion - x_[k]) / h;
+  const double s2 = s * s;
+  const double s3 = s2 * s;
+  return (2 * s3 - 3 * s2 + 1) * y_[k] + (s3 - 2 * s2 + s) * h * slopes_[k] +
+         (-2 * s3 + 3 * s2) * y_[k + 1] + (s3 - s2) * h * slopes_[k + 1];
+}
+
+double RateDistortionCurve::Integrate(double from, double to) const {
+  double sum = 0;
+  for (size_t k = 0; k + 1 < x_.size(); ++k) {
+    const double a = std::max(from, x_[k]);
+    const double b = std::min(to, x_[k + 1]);
+    if (b <= a) continue;
+    // Simpson's rule is exact for cubic polynomials.
+    sum += (b - a) / 6 *
+           (Interpolate(a) + 4 * Interpolate((a + b) / 2) + Interpolate(b));
+  }
+  return sum;
+}
+
+double BjontegaardDelta(const RateDistortionCurve& reference,
+                        const RateDistortionCurve& curve) {
+  if (reference.empty() || curve.empty()) {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  const double from =
+      std::max(reference.min_distortion(), curve.min_distortion());
+  const double to =
+      std::min(reference.max_distortion(), curve.max_distortion());
+  if (!(to > from)) return std::numeric_limits<double>::quiet_NaN();
+  return (curve.Integrate(from, to) - reference.Integrate(from, to)) /
+         (to - from);
+}
+
+std::vector<size_t> ParetoOptimal(
+    const std::vector<std::pair<double, double>>& costs) {
+  std::vector<size_t> indices(costs.size());
+  for (size_t i = 0; i < indices.size(); ++i) indices[i] = i;
+  std::sort(indices.begin(), indices.end(),
+            [&](size_t a, size_t b) { return costs[a] < costs[b]; });
+  std::vector<size_t> optimal;
+  for (const size_t i : indices) {
+    // Any dominating pair comes first in this order.
+    if (optimal.empty() || costs[i].second < costs[optimal.back()].second) {
+      optimal.push_back(i);
+    }
+  }
+  return optimal;
+}
+
+//------------------------------------------------------------------------------
+// Summary
+
+namespace {
+
+double BitsPerPixel(const TaskOutput& task) {
+  const double num_pixels = static_cast<double>(task.image_width) *
+                            task.image_height * task.num_frames;
+  return num_pixels == 0 ? 0 : task.encoded_size * 8. / num_pixels;
+}
+
+double EncodingDuration(const TaskOutput& task) {
+  return task.encoding_duration;
+}
+
+double InterpolateOrNaN(const RateDistortionCurve& curve, double distortion) {
+  return !curve.empty() && distortion >= curve.min_distortion() &&
+                 distortion <= curve.max_distortion()
+             ? curve.Interpolate(distortion)
+             : std::numeric_limits<double>::quiet_NaN();
+}
+
+// Results of one batch for one image.
+struct ImageSummary {
+  bool present = false;
+  // Bjontegaard delta with the reference batch, in DistortionMetric order.
+  double bd_log_deltas[kNumDistortionMetrics];
+  // log(bits per pixel) and log(seconds) at each equal quality target.
+  std::vector<double> log_bpp_at_equal_quality;
+  std::vector<double> log_encoding_duration_at_equal_quality;
+};
+
+// Shared among all SummaryWorkers. Guarded by a mutex in WorkerPool.
+struct SummaryContext {
+  // Aggregated lossy tasks per batch, sorted by image path then quality.
+  const std::vector<std::vector<TaskOutput>>* batches;
+  size_t reference_batch = 0;
+  const std::vector<std::pair<DistortionMetric, double>>* targets;
+  // [image][batch] range of tasks in batches, empty if missing.
+  std::vector<std::vector<std::pair<size_t, size_t>>> ranges;
+  // [image][batch]
+  std::vector<std::vector<ImageSummary>> image_summaries;
+  size_t next_image = 0;
+};
+
+class SummaryWorker : public Worker<SummaryContext, SummaryWorker> {
+ public:
+  using Worker<SummaryContext, SummaryWorker>::Worker;
+
+ private:
+  bool AssignTask(SummaryContext& context) override {
+    if (context.next_image >= context.ranges.size()) return false;
+    context_ = &context;
+    image_ = context.next_image++;
+    return true;
+  }
+
+  void DoTask() override {
+    // Each worker writes to distinct elements of context_->image_summaries.
+    const size_t num_batches = context_->ranges[image_].size();
+    std::vector<ImageSummary>& summaries = context_->image_summaries[image_];
+    summaries.resize(num_batches);
+
+    // [batch][metric]
+    std::vector<std::vector<RateDistortionCurve>> curves(num_batches);
+    for (size_t b = 0; b < num_batches; ++b) {
+      const auto [begin, end] = context_->ranges[image_][b];
+      if (begin == end) continue;
+      for (size_t m = 0; m < kNumDistortionMetrics; ++m) {
+        curves[b].push_back(FitCurve(b, m, BitsPerPixel));
+      }
+    }
+
+    for (size_t b = 0; b < num_batches; ++b) {
+      if (curves[b].empty()) continue;
+      ImageSummary& summary = summaries[b];
+      summary.present = true;
+      for (size_t m = 0; m < kNumDistortionMetrics; ++m) {
+        summary.bd_log_deltas[m] =
+            curves[context_->reference_batch].empty()
+                ? std::numeric_limits<double>::quiet_NaN()
+                : BjontegaardDelta(curves[context_->reference_batch][m],
+                                   curves[b][m]);
+      }
+      for (const auto& [metric, distortion] : *context_->targets) {
+        const size_t m = static_cast<size_t>(metric);
+        summary.log_bpp_at_equal_quality.push_back(
+            InterpolateOrNaN(curves[b][m], distortion));
+        summary.log_encoding_duration_at_equal_quality.push_back(
+            InterpolateOrNaN(FitCurve(b, m, EncodingDuration), distortion));
+      }
+    }
+  }
+
+  // Returns the curve of log(get_value()) as a function of the metric, for
+  // the current image in the given batch.
+  RateDistortionCurve FitCurve(size_t batch, size_t metric,
+                               double (*get_value)(const TaskOutput&)) const {
+    const auto [begin, end] = context_->ranges[image_][batch];
+    std::vector<std::pair<double, double>> points;
+    for (size_t t = begin; t < end; ++t) {
+      const TaskOutput& task = (*context_->batches)[batch][t];
+      // Skip pixel-equivalent results, which have no distortion.
+      if (!(task.distortions[metric] < kNoDistortion)) continue;
+      const double value = get_value(task);
+      if (!(value > 0)) continue;
+      points.emplace_back(task.distortions[metric], std::log(value));
+    }
+    return RateDistortionCurve(std::move(points));
+  }
+
+  SummaryContext* context_ = nullptr;
+  size_t image_ = 0;
+};
+
+// Returns the geometric mean given the sum of the logarithms, or NaN if empty.
+double GeometricMean(double log_sum, size_t count) {
+  return count == 0 ? std::numeric_limits<double>::quiet_NaN()
+                    : std::exp(log_sum / static_cast<double>(count));
+}
+
+}  // namespace
+
+StatusOr<Summary> Summarize(const std::vector<TaskOutput>& tasks,
+                            const SummarySettings& settings, bool quiet) {
+  std::vector<TaskOutput> lossy_tasks;
+  for (const TaskOutput& task : tasks) {
+    if (task.task_input.codec_settings.quality != kQualityLossless) {
+      lossy_tasks.push_back(task);
+    }
+  }
+  std::vector<std::vector<TaskOutput>> batches;
+  ASSIGN_OR_RETURN(batches, SplitByCodecSettingsAndAggregateByImageAndQuality(
+                                lossy_tasks, quiet));
+  CHECK_OR_RETURN(!batches.empty(), quiet) << "No lossy result to summarize";
+
+  Summary summary;
+  summary.equal_quality_targets = settings.equal_quality_targets;
+  SummaryContext context;
+  context.batches = &batches;
+  context.targets = &summary.equal_quality_targets;
+  bool found_reference = false;
+  for (size_t b = 0; b < batches.size(); ++b) {
+    const TaskOutput& first = batches[b].front();
+    summary.batches.emplace_back();
+    BatchSummary& batch = summary.batches.back();
+    batch.codec_settings = first.task_input.codec_settings;
+    batch.batch_name =
+        BatchName(batch.codec_settings, first.task_input.rendition_width,
+                  first.simd_level, first.decode_timing);
+    if (batch.batch_name == settings.reference_batch_name) {
+      context.reference_batch = b;
+      found_reference = true;
+    }
+  }
+  CHECK_OR_RETURN(found_reference || settings.reference_batch_name.empty(),
+                  quiet)
+      << "Reference batch " << settings.reference_batch_name << " not found";
+  summary.reference_batch_name =
+      summary.batches[context.reference_batch].batch_name;
+
+  std::map<std::string, size_t> image_indices;
+  for (const std::vector<TaskOutput>& batch : batches) {
+    for (const TaskOutput& task : batch) {
+      image_indices.emplace(task.task_input.image_path, 0);
+    }
+  }
+  size_t num_images = 0;
+  for (auto& [image_path, index] : image_indices) index = num_images++;
+  context.ranges.assign(num_images, std::vector<std::pair<size_t, size_t>>(
+                                        batches.size(), {0, 0}));
+  for (size_t b = 0; b < batches.size(); ++b) {
+    const std::vector<TaskOutput>& batch = batches[b];
+    for (size_t begin = 0; begin < batch.size();) {
+      const std::string& image_path = batch[begin].task_input.image_path;
+      size_t end = begin + 1;
+      while (end < batch.size() &&
+             batch[end].task_input.image_path == image_path) {
+        ++end;
+      }
+      context.ranges[image_indices[image_path]][b] = {begin, end};
+      begin = end;
+    }
+  }
+  context.image_summaries.resize(num_images);
+
+  WorkerPool<SummaryContext, SummaryWorker> pool(
+      std::max<size_t>(1, std::min(settings.num_threads, num_images)));
+  pool.Run(context);
+
+  const size_t num_targets = summary.equal_quality_targets.size();
+  for (size_t b = 0; b < batches.size(); ++b) {
+    BatchSummary& batch = summary.batches[b];
+    double bd_sums[kNumDistortionMetrics] = {};
+    std::vector<double> bpp_sums(num_targets, 0);
+    batch.equal_quality_num_images.assign(num_targets, 0);
+    for (const std::vector<ImageSummary>& image_summaries :
+         context.image_summaries) {
+      const ImageSummary& image_summary = image_summaries[b];
+      if (!image_summary.present) continue;
+      ++batch.num_images;
+      for (size_t m = 0; m < kNumDistortionMetrics; ++m) {
+        if (std::isnan(image_summary.bd_log_deltas[m])) continue;
+        bd_sums[m] += image_summary.bd_log_deltas[m];
+        ++batch.bd_rate_num_images[m];
+      }
+      for (size_t t = 0; t < num_targets; ++t) {
+        if (std::isnan(image_summary.log_bpp_at_equal_quality[t])) continue;
+        bpp_sums[t] += image_summary.log_bpp_at_equal_quality[t];
+        ++batch.equal_quality_num_images[t];
+      }
+    }
+    for (size_t m = 0; m < kNumDistortionMetrics; ++m) {
+      batch.bd_rates[m] =
+          GeometricMean(bd_sums[m], batch.bd_rate_num_images[m]) - 1;
+    }
+    for (size_t t = 0; t < num_targets; ++t) {
+      batch.bpp_at_equal_quality.push_back(
+          GeometricMean(bpp_sums[t], batch.equal_quality_num_images[t]));
+    }
+  }
+
+  // Compare the efforts and chroma subsamplings of each codec and build.
+  std::map<std::pair<Codec, std::string>, std::vector<size_t>> codec_batches;
+  for (size_t b = 0; b < batches.size(); ++b) {
+    const CodecSettings& codec_settings = summary.batches[b].codec_settings;
+    codec_batches[{codec_settings.codec, codec_settings.build}].push_back(b);
+  }
+  for (const auto& [codec_and_build, batch_indices] : codec_batches) {
+    if (batch_indices.size() < 2) continue;
+    for (size_t t = 0; t < num_targets; ++t) {
+      ParetoFrontier frontier;
+      frontier.codec = codec_and_build.first;
+      frontier.build = codec_and_build.second;
+      frontier.name = CodecName(frontier.codec);
+      if (!frontier.build.empty()) {
+        frontier.name += "_" + CodecBuildName(frontier.build);
+      }
+      frontier.target = t;
+      frontier.num_batches = batch_indices.size();
+      // Only the images reaching the target in all batches are comparable.
+      std::vector<std::pair<double, double>> log_sums(batch_indices.size());
+      for (const std::vector<ImageSummary>& image_summaries :
+           context.image_summaries) {
+        bool comparable = true;
+        for (const size_t b : batch_indices) {
+          const ImageSummary& image_summary = image_summaries[b];
+          comparable &=
+              image_summary.present &&
+              !std::isnan(image_summary.log_bpp_at_equal_quality[t]) &&
+              !std::isnan(
+                  image_summary.log_encoding_duration_at_equal_quality[t]);
+        }
+        if (!comparable) continue;
+        ++frontier.num_images;
+        for (size_t i = 0; i < batch_indices.size(); ++i) {
+          const ImageSummary& image_summary = image_summaries[batch_indices[i]];
+          log_sums[i].first +=
+              image_summary.log_encoding_duration_at_equal_quality[t];
+          log_sums[i].second += image_summary.log_bpp_at_equal_quality[t];
+        }
+      }
+      if (frontier.num_images == 0) continue;
+
+      std::vector<std::pair<double, double>> costs;
+      for (const auto& [duration_log_sum, bpp_log_sum] : log_sums) {
+        costs.emplace_back(
+            GeometricMean(duration_log_sum, frontier.num_images),
+            GeometricMean(bpp_log_sum, frontier.num_images));
+      }
+      std::vector<size_t> hull;  // Indices in frontier.points.
+      for (const size_t i : ParetoOptimal(costs)) {
+        frontier.points.push_back(
+            {batch_indices[i], costs[i].first, costs[i].second});
+        // Andrew's monotone chain, in the log domain.
+        auto log_point = [&](size_t p) {
+          return std::make_pair(std::log(frontier.points[p].encoding_duration),
+                                std::log(frontier.points[p].bpp));
+        };
+        const auto [x, y] = log_point(frontier.points.size() - 1);
+        while (hull.size() >= 2) {
+          const auto [x0, y0] = log_point(hull[hull.size() - 2]);
+          const auto [x1, y1] = log_point(hull.back());
+          if ((x1 - x0) * (y - y0) - (y1 - y0) * (x - x0) > 0) break;
+          hull.pop_back();
+        }
+        hull.push_back(frontier.points.size() - 1);
+      }
+      for (const size_t p : hull) frontier.points[p].convex_hull = true;
+      summary.pareto_frontiers.push_back(std::move(frontier));
+    }
+  }
+  return summary;
+}
+
+//------------------------------------------------------------------------------
+// Serialization
+
+namespace {
+
+// JSON has no representation of NaN or infinity.
+std::string NumberToJson(double value) {
+  return std::isfinite(value) ? std::to_string(value) : "null";
+}
+
+}  // namespace
+
+Status SummaryToJson(const Summary& summary, const std::string& file_path,
+                     bool quiet) {
+  std::ofstream file(file_path, std::ios::trunc);
+  CHECK_OR_RETURN(file.is_open(), quiet)
+      << "Failed to open summary file at " << file_path << " for writing";
+
+  file << "{" << std::endl
+       << "  \"reference\": " << Escape(summary.reference_batch_name) << ","
+       << std::endl
+       << "  \"metrics\": [";
+  for (size_t m = 0; m < kNumDistortionMetrics; ++m) {
+    file << (m == 0 ? "" : ", ")
+         << Escape(DistortionMetricToString(static_cast<DistortionMetric>(m)));
+  }
+  file << "]," << std::endl << "  \"equal_quality_targets\": [";
+  for (size_t t = 0; t < summary.equal_quality_targets.size(); ++t) {
+    const auto& [metric, distortion] = summary.equal_quality_targets[t];
+    file << (t == 0 ? "" : ", ")
+         << "{\"metric\": " << Escape(DistortionMetricToString(metric))
+         << ", \"value\": " << distortion << "}";
+  }
+  file << "]," << std::endl << "  \"batches\": [" << std::endl;
+  for (size_t b = 0; b < summary.batches.size(); ++b) {
+    const BatchSummary& batch = summary.batches[b];
+    const CodecSettings& settings = batch.codec_settings;
+    file << "    {\"name\": " << Escape(batch.batch_name)
+         << ", \"codec\": " << Escape(CodecName(settings.codec))
+         << ", \"chroma_subsampling\": "
+         << Escape(SubsamplingToString(settings.chroma_subsampling))
+         << ", \"effort\": " << settings.effort
+         << ", \"num_images\": " << batch.num_images << "," << std::endl
+         << "     \"bd_rate_percent\": [";
+    for (size_t m = 0; m < kNumDistortionMetrics; ++m) {
+      file << (m == 0 ? "" : ", ") << NumberToJson(batch.bd_rates[m] * 100);
+    }
+    file << "]," << std::endl << "     \"bd_rate_num_images\": [";
+    for (size_t m = 0; m < kNumDistortionMetrics; ++m) {
+      file << (m == 0 ? "" : ", ") << batch.bd_rate_num_images[m];
+    }
+    file << "]," << std::endl << "     \"bpp_at_equal_quality\": [";
+    for (size_t t = 0; t < batch.bpp_at_equal_quality.size(); ++t) {
+      file << (t == 0 ? "" : ", ")
+           << NumberToJson(batch.bpp_at_equal_quality[t]);
+    }
+    file << "]," << std::endl << "     \"equal_quality_num_images\": [";
+    for (size_t t = 0; t < batch.equal_quality_num_images.size(); ++t) {
+      file << (t == 0 ? "" : ", ") << batch.equal_quality_num_images[t];
+    }
+    file << "]}" << (b + 1 < summary.batches.size() ? "," : "") << std::endl;
+  }
+  file << "  ]," << std::endl << "  \"pareto_frontiers\": [" << std::endl;
+  for (size_t f = 0; f < summary.pareto_frontiers.size(); ++f) {
+    const ParetoFrontier& frontier = summary.pareto_frontiers[f];
+    file << "    {\"name\": " << Escape(frontier.name)
+         << ", \"codec\": " << Escape(CodecName(frontier.codec))
+         << ", \"build\": " << Escape(CodecBuildName(frontier.build))
+         << ", \"target\": " << frontier.target
+         << ", \"num_batches\": " << frontier.num_batches
+         << ", \"num_images\": " << frontier.num_images << "," << std::endl
+         << "     \"points\": [";
+    for (size_t p = 0; p < frontier.points.size(); ++p) {
+      const ParetoPoint& point = frontier.points[p];
+      file << (p == 0 ? "" : ", ") << "{\"name\": "
+           << Escape(summary.batches[point.batch].batch_name)
+           << ", \"encoding_time\": " << NumberToJson(point.encoding_duration)
+           << ", \"bpp\": " << NumberToJson(point.bpp)
+           << ", \"convex_hull\": " << (point.convex_hull ? "true" : "false")
+           << "}";
+    }
+    file << "]}" << (f + 1 < summary.pareto_frontiers.size() ? "," : "")
+         << std::endl;
+  }
+  file << "  ]" << std::endl << "}" << std::endl;
+  file.close();
+  CHECK_OR_RETURN(!file.fail(), quiet) << "Failed to write " << file_path;
+  return Status::kOk;
+}
+
+}  // namespace codec_compare_gen
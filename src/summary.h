@@ -0,0 +1,140 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_SUMMARY_H_
+#define SRC_SUMMARY_H_
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/base.h"
+#include "src/framework.h"
+#include "src/task.h"
+
+namespace codec_compare_gen {
+
+// Monotone piecewise cubic Hermite interpolation (Fritsch-Carlson) of the
+// logarithm of the bitrate (or of another cost such as the encoding duration)
+// as a function of a distortion metric value.
+class RateDistortionCurve {
+ public:
+  // Points are (distortion, log(bits per pixel)) pairs in any order. Points
+  // with the same distortion are averaged. The curve is empty if there are
+  // fewer than two distinct distortion values.
+  explicit RateDistortionCurve(std::vector<std::pair<double, double>> points);
+
+  bool empty() const { return x_.size() < 2; }
+  double min_distortion() const { return x_.front(); }
+  double max_distortion() const { return x_.back(); }
+
+  // Returns the log(bits per pixel) at the given distortion, which must be in
+  // [min_distortion():max_distortion()].
+  double Interpolate(double distortion) const;
+  // Returns the integral of the curve over [from:to], within the curve range.
+  double Integrate(double from, double to) const;
+
+ private:
+  std::vector<double> x_;       // Distortions, strictly increasing.
+  std::vector<double> y_;       // log(bits per pixel)
+  std::vector<double> slopes_;  // dy/dx at each point.
+};
+
+// Returns the average log(bits per pixel) difference of the curve with the
+// reference over their common distortion range (Bjontegaard delta rate in the
+// log domain), or NaN if the ranges do not overlap.
+double BjontegaardDelta(const RateDistortionCurve& reference,
+                        const RateDistortionCurve& curve);
+
+// Returns the indices of the (cost, cost) pairs that are not dominated by any
+// other pair, sorted by increasing first cost.
+std::vector<size_t> ParetoOptimal(
+    const std::vector<std::pair<double, double>>& costs);
+
+struct SummarySettings {
+  // Batch the BD-rates are relative to. See BatchName(). If empty, the first
+  // batch in codec settings order is used.
+  std::string reference_batch_name;
+  // Distortion values at which the bitrates are compared.
+  std::vector<std::pair<DistortionMetric, double>> equal_quality_targets = {
+      {DistortionMetric::kLibjxlSsimulacra2, 70},
+      {DistortionMetric::kLibjxlSsimulacra2, 80},
+      {DistortionMetric::kLibjxlSsimulacra2, 90},
+      {DistortionMetric::kLibjxlButteraugli, 1},
+      {DistortionMetric::kLibjxlButteraugli, 2},
+      {DistortionMetric::kLibjxlButteraugli, 3}};
+  size_t num_threads = 1;  // Images are processed in parallel.
+};
+
+// Lossy results of one codec, chroma subsampling, effort and build.
+struct BatchSummary {
+  std::string batch_name;
+  CodecSettings codec_settings;  // quality is irrelevant.
+  size_t num_images = 0;
+  // Bitrate change relative to the reference batch at equal distortion,
+  // averaged in the log domain over the images of both batches, in
+  // DistortionMetric order. -0.1 means 10% smaller. NaN if no curve overlaps.
+  double bd_rates[kNumDistortionMetrics];
+  size_t bd_rate_num_images[kNumDistortionMetrics] = {};
+  // Geometric mean of the interpolated bits per pixel at each of the
+  // SummarySettings::equal_quality_targets, over the images reaching it.
+  std::vector<double> bpp_at_equal_quality;
+  std::vector<size_t> equal_quality_num_images;
+};
+
+// Batch on the encoding duration versus size Pareto frontier of a codec.
+struct ParetoPoint {
+  size_t batch;  // Index in Summary::batches.
+  // Geometric means at equal quality.
+  double encoding_duration;  // in seconds
+  double bpp;                // in bits per pixel
+  // True if also on the lower convex hull of the frontier in the log domain,
+  // meaning no mix of two other batches gives a better trade-off.
+  bool convex_hull = false;
+};
+
+// Efforts and chroma subsamplings of a codec and build that are worth using at
+// an equal quality target.
+struct ParetoFrontier {
+  std::string name;  // Codec name, suffixed by the build name if any.
+  Codec codec;
+  std::string build;
+  size_t target;  // Index in Summary::equal_quality_targets.
+  size_t num_batches = 0;
+  size_t num_images = 0;  // Images reaching the target in all num_batches.
+  std::vector<ParetoPoint> points;  // Fastest first.
+};
+
+struct Summary {
+  std::string reference_batch_name;
+  std::vector<std::pair<DistortionMetric, double>> equal_quality_targets;
+  std::vector<BatchSummary> batches;  // In codec settings order.
+  // For each codec and build with multiple batches, and each target.
+  std::vector<ParetoFrontier> pareto_frontiers;
+};
+
+// Fits one rate-distortion curve per image, metric and batch to the lossy
+// tasks, averaging repetitions. Lossless tasks are ignored. The encoding
+// durations at equal quality are interpolated the same way to find the Pareto
+// frontiers.
+StatusOr<Summary> Summarize(const std::vector<TaskOutput>& tasks,
+                            const SummarySettings& settings, bool quiet);
+
+Status SummaryToJson(const Summary& summary, const std::string& file_path,
+                     bool quiet);
+
+}  // namespace codec_compare_gen
+
+#endif  // SRC_SUMMARY_H_
@@ -0,0 +1,257 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/system_conditions.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+
+namespace codec_compare_gen {
+
+namespace {
+
+// Enough for more than an hour of samples every 100 ms.
+constexpr size_t kMaxNumSamples = 1 << 16;
+
+constexpr char kCpuFolderPath[] = "/sys/devices/system/cpu";
+
+// Returns the first token of the file at path, or an empty string.
+std::string ReadFirstToken(const std::string& path) {
+  std::ifstream file(path);
+  std::string token;
+  file >> token;
+  return token;
+}
+
+double ToDouble(const std::string& token) {
+  return token.empty() ? 0 : std::strtod(token.c_str(), nullptr);
+}
+
+// Returns the number right after the first occurrence of key in the file at
+// path, whether key is a separate token ("procs_running 2") or a prefix
+// ("total=1234"). Returns 0 if not found.
+double ReadValueAfter(const std::string& path, const std::string& key) {
+  std::ifstream file(path);
+  std::string token;
+  while (file >> token) {
+    if (token == key) return file >> token ? ToDouble(token) : 0;
+    if (token.compare(0, key.size(), key) == 0) {
+      return ToDouble(token.substr(key.size()));
+    }
+  }
+  return 0;
+}
+
+// Returns the number of threads of this process that are running or runnable.
+uint32_t CountOwnRunnableThreads() {
+  uint32_t num_runnable_threads = 0;
+  std::error_code error;
+  for (const auto& entry :
+       std::filesystem::directory_iterator("/proc/self/task", error)) {
+    std::ifstream file(entry.path() / "stat");
+    std::string stat;
+    std::getline(file, stat);
+    // The state follows the thread name, which may contain ')' itself.
+    const size_t name_end = stat.rfind(')');
+    if (name_end != std::string::npos && name_end + 2 < stat.size() &&
+        stat[name_end + 2] == 'R') {
+      ++num_runnable_threads;
+    }
+  }
+  return num_runnable_threads;
+}
+
+// Returns the percentage of the duration between start and end (in
+// microseconds) spent stalled, given the total stall durations at both times.
+float StallPercentage(uint64_t stall_duration_at_start,
+                      uint64_t stall_duration_at_end, double duration) {
+  if (duration <= 0 || stall_duration_at_end <= stall_duration_at_start) {
+    return 0;
+  }
+  return static_cast<float>(std::min(
+      100., 100. * (stall_duration_at_end - stall_duration_at_start) /
+                duration));
+}
+
+}  // namespace
+
+SystemConditions WorstSystemConditions(const SystemConditions& a,
+                                       const SystemConditions& b) {
+  if (!a.sampled) return b;
+  if (!b.sampled) return a;
+  SystemConditions worst;
+  worst.sampled = true;
+  worst.cpu_frequency_ratio =
+      std::min(a.cpu_frequency_ratio, b.cpu_frequency_ratio);
+  worst.run_queue_length = std::max(a.run_queue_length, b.run_queue_length);
+  worst.cpu_pressure = std::max(a.cpu_pressure, b.cpu_pressure);
+  worst.memory_pressure = std::max(a.memory_pressure, b.memory_pressure);
+  worst.num_thermal_throttles =
+      std::max(a.num_thermal_throttles, b.num_thermal_throttles);
+  worst.abnormal = a.abnormal || b.abnormal;
+  return worst;
+}
+
+//------------------------------------------------------------------------------
+
+SystemSampler::SystemSampler(uint32_t period_ms,
+                             const SystemConditionThresholds& thresholds)
+    : period_ms_(period_ms),
+      thresholds_(thresholds),
+      num_cpus_(std::max(1u, std::thread::hardware_concurrency())) {
+  std::error_code error;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(kCpuFolderPath, error)) {
+    const std::string name = entry.path().filename().string();
+    if (name.size() <= 3 || name.compare(0, 3, "cpu") != 0 ||
+        !std::all_of(name.begin() + 3, name.end(),
+                     [](char c) { return std::isdigit(c); })) {
+      continue;
+    }
+    const std::filesystem::path cpufreq = entry.path() / "cpufreq";
+    const double max_frequency =
+        ToDouble(ReadFirstToken(cpufreq / "cpuinfo_max_freq"));
+    if (max_frequency > 0) {
+      cpu_frequency_paths_.push_back(cpufreq / "scaling_cur_freq");
+      cpu_max_frequencies_.push_back(max_frequency);
+    }
+    for (const char* counter :
+         {"core_throttle_count", "package_throttle_count"}) {
+      const std::filesystem::path path =
+          entry.path() / "thermal_throttle" / counter;
+      if (std::filesystem::exists(path, error)) {
+        thermal_throttle_paths_.push_back(path);
+      }
+    }
+  }
+  if (period_ms_ != 0) thread_ = std::thread(&SystemSampler::Run, this);
+}
+
+SystemSampler::~SystemSampler() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_up_.notify_one();
+  if (thread_.joinable()) thread_.join();
+}
+
+SystemSample SystemSampler::ReadSample() const {
+  SystemSample sample;
+  sample.time = std::chrono::steady_clock::now();
+  // The fastest CPU tells whether the host can run at full speed at all. The
+  // idle ones are usually clocked down.
+  for (size_t i = 0; i < cpu_frequency_paths_.size(); ++i) {
+    const double frequency = ToDouble(ReadFirstToken(cpu_frequency_paths_[i]));
+    const float ratio = static_cast<float>(frequency / cpu_max_frequencies_[i]);
+    sample.cpu_frequency_ratio =
+        i == 0 ? ratio : std::max(sample.cpu_frequency_ratio, ratio);
+  }
+  // procs_running includes the workers of this process, which would otherwise
+  // flag every task of a run using all CPUs.
+  const uint32_t num_runnable_threads =
+      static_cast<uint32_t>(ReadValueAfter("/proc/stat", "procs_running"));
+  const uint32_t num_own_runnable_threads = CountOwnRunnableThreads();
+  sample.run_queue_length =
+      num_runnable_threads > num_own_runnable_threads
+          ? num_runnable_threads - num_own_runnable_threads
+          : 0;
+  // The first line is "some", the share of time during which at least one
+  // thread was stalled. The averages over 10 seconds or more would mostly
+  // reflect what happened before short tasks.
+  sample.cpu_stall_duration =
+      static_cast<uint64_t>(ReadValueAfter("/proc/pressure/cpu", "total="));
+  sample.memory_stall_duration =
+      static_cast<uint64_t>(ReadValueAfter("/proc/pressure/memory", "total="));
+  for (const std::string& path : thermal_throttle_paths_) {
+    sample.num_thermal_throttles +=
+        static_cast<uint64_t>(ToDouble(ReadFirstToken(path)));
+  }
+  return sample;
+}
+
+void SystemSampler::AddSample(const SystemSample& sample) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (samples_.size() == kMaxNumSamples) samples_.pop_front();
+  samples_.push_back(sample);
+}
+
+SystemConditions SystemSampler::GetConditions(const SystemSample& start,
+                                              const SystemSample& end) const {
+  SystemConditions conditions;
+  conditions.sampled = true;
+  const auto add = [&](const SystemSample& sample) {
+    conditions.cpu_frequency_ratio =
+        std::min(conditions.cpu_frequency_ratio, sample.cpu_frequency_ratio);
+    conditions.run_queue_length =
+        std::max(conditions.run_queue_length, sample.run_queue_length);
+  };
+  add(start);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::upper_bound(
+        samples_.begin(), samples_.end(), start.time,
+        [](std::chrono::steady_clock::time_point time,
+           const SystemSample& sample) { return time < sample.time; });
+    for (; it != samples_.end() && it->time < end.time; ++it) add(*it);
+  }
+  add(end);
+
+  const double duration =
+      std::chrono::duration<double, std::micro>(end.time - start.time).count();
+  conditions.cpu_pressure = StallPercentage(
+      start.cpu_stall_duration, end.cpu_stall_duration, duration);
+  conditions.memory_pressure = StallPercentage(
+      start.memory_stall_duration, end.memory_stall_duration, duration);
+  if (end.num_thermal_throttles > start.num_thermal_throttles) {
+    conditions.num_thermal_throttles = static_cast<uint32_t>(
+        end.num_thermal_throttles - start.num_thermal_throttles);
+  }
+
+  const float num_cpus = static_cast<float>(num_cpus_);
+  conditions.abnormal =
+      conditions.cpu_frequency_ratio < thresholds_.min_cpu_frequency_ratio ||
+      conditions.run_queue_length >
+          thresholds_.max_run_queue_length_per_cpu * num_cpus ||
+      conditions.cpu_pressure > thresholds_.max_cpu_pressure ||
+      conditions.memory_pressure > thresholds_.max_memory_pressure ||
+      conditions.num_thermal_throttles > thresholds_.max_num_thermal_throttles;
+  return conditions;
+}
+
+size_t SystemSampler::num_samples() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return samples_.size();
+}
+
+void SystemSampler::Run() {
+  const std::chrono::milliseconds period(period_ms_);
+  while (true) {
+    AddSample(ReadSample());
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (wake_up_.wait_for(lock, period, [this] { return stopping_; })) return;
+  }
+}
+
+}  // namespace codec_compare_gen
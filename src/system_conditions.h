@@ -0,0 +1,124 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_SYSTEM_CONDITIONS_H_
+#define SRC_SYSTEM_CONDITIONS_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace codec_compare_gen {
+
+// State of the host while a task was encoded and decoded, as sampled by
+// SystemSampler. Reading the image and computing the distortions are not
+// covered.
+struct SystemConditions {
+  bool sampled = false;  // If false, the other fields have default values.
+  // Lowest ratio of the current to the maximum frequency of the fastest CPU.
+  // 1 if unknown.
+  float cpu_frequency_ratio = 1;
+  // Highest number of runnable threads of other processes. The threads of this
+  // process (workers, background writers etc.) are expected to run.
+  uint32_t run_queue_length = 0;
+  // Percentage of the sampled duration during which some threads were stalled
+  // waiting for a CPU or for memory (Linux Pressure Stall Information).
+  float cpu_pressure = 0;
+  float memory_pressure = 0;
+  uint32_t num_thermal_throttles = 0;  // Events during the sampled duration.
+  // True if any of the above crossed its SystemConditionThresholds.
+  bool abnormal = false;
+};
+
+// Returns the worst of each field of a and b. Used to aggregate repetitions.
+SystemConditions WorstSystemConditions(const SystemConditions& a,
+                                       const SystemConditions& b);
+
+// Beyond these, timings are considered contaminated by the environment.
+struct SystemConditionThresholds {
+  float min_cpu_frequency_ratio = 0.5f;
+  // Relative to the number of CPUs. Above 1, threads wait for a CPU.
+  float max_run_queue_length_per_cpu = 1;
+  float max_cpu_pressure = 20;     // in percent
+  float max_memory_pressure = 10;  // in percent
+  uint32_t max_num_thermal_throttles = 0;
+};
+
+// Instantaneous state of the host. See SystemConditions.
+struct SystemSample {
+  std::chrono::steady_clock::time_point time;
+  float cpu_frequency_ratio = 1;
+  uint32_t run_queue_length = 0;  // Excluding the threads of this process.
+  // Total durations since boot during which some threads were stalled.
+  uint64_t cpu_stall_duration = 0;     // in microseconds
+  uint64_t memory_stall_duration = 0;  // in microseconds
+  uint64_t num_thermal_throttles = 0;  // Since boot, summed over all CPUs.
+};
+
+// Records SystemSamples from /proc and /sys in a background thread, and
+// summarizes them between two samples read by each task. The values that
+// cannot be read (other platforms, restricted containers) keep their default
+// values. Thread-safe.
+class SystemSampler {
+ public:
+  // Samples every period_ms if it is not 0. Otherwise samples are only
+  // recorded by AddSample().
+  SystemSampler(uint32_t period_ms,
+                const SystemConditionThresholds& thresholds);
+  SystemSampler(const SystemSampler&) = delete;
+  SystemSampler& operator=(const SystemSampler&) = delete;
+  ~SystemSampler();  // Stops the thread.
+
+  // Reads the current state of the host.
+  SystemSample ReadSample() const;
+  // Records a sample. Samples must be added in chronological order. Only the
+  // most recent ones are kept.
+  void AddSample(const SystemSample& sample);
+
+  // Returns the worst conditions among start, end and the samples recorded
+  // between them. Stalls and throttles are counted from start to end. start
+  // and end are usually read with ReadSample() and not recorded.
+  SystemConditions GetConditions(const SystemSample& start,
+                                 const SystemSample& end) const;
+
+  size_t num_samples() const;
+  size_t num_cpus() const { return num_cpus_; }
+
+ private:
+  void Run();
+
+  const uint32_t period_ms_;
+  const SystemConditionThresholds thresholds_;
+  const size_t num_cpus_;
+  // Listed once. The current frequencies are paired with the maximum ones.
+  std::vector<std::string> cpu_frequency_paths_;
+  std::vector<double> cpu_max_frequencies_;
+  std::vector<std::string> thermal_throttle_paths_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_up_;
+  bool stopping_ = false;
+  std::deque<SystemSample> samples_;
+  std::thread thread_;  // Started once the fields above are set.
+};
+
+}  // namespace codec_compare_gen
+
+#endif  // SRC_SYSTEM_CONDITIONS_H_
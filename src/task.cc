@@ -18,18 +18,27 @@
 #include <cstdint>
 #include <cstdlib>
 #include <filesystem>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <map>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "src/base.h"
 #include "src/codec.h"
+#include "src/codec_plugin.h"
 #include "src/framework.h"
+#include "src/image_info.h"
 #include "src/serialization.h"
+#include "src/system_conditions.h"
+#include "src/worker.h"
 
 namespace codec_compare_gen {
 
@@ -37,7 +46,8 @@ namespace {
 
 std::string GetEncodedFilePath(const std::string& folder_path,
                                const std::string& image_path,
-                               const CodecSettings& codec_settings) {
+                               const CodecSettings& codec_settings,
+                               uint32_t rendition_width) {
   if (folder_path.empty()) return "";
 
   std::filesystem::path path(folder_path);
@@ -57,21 +67,33 @@ std::string GetEncodedFilePath(const std::string& folder_path,
   } else {
     ext << "q" << std::setfill('0') << std::setw(3) << codec_settings.quality;
   }
+  if (rendition_width != 0) {
+    ext << "." << rendition_width << "w";
+  }
+  if (!codec_settings.build.empty()) {
+    ext << "." << CodecBuildName(codec_settings.build);
+  }
   ext << "." << CodecExtension(codec_settings.codec);
   path.replace_extension(ext.str());
   return path;
 }
 
-bool operator==(const CodecSettings& a, const CodecSettings& b) {
+bool SameSettingsButBuild(const CodecSettings& a, const CodecSettings& b) {
   return a.codec == b.codec && a.chroma_subsampling == b.chroma_subsampling &&
-         a.effort == b.effort && a.quality == b.quality;
+         a.effort == b.effort && a.quality == b.quality &&
+         a.num_threads == b.num_threads;
+}
+
+bool operator==(const CodecSettings& a, const CodecSettings& b) {
+  return SameSettingsButBuild(a, b) && a.build == b.build;
 }
 
 }  // namespace
 
 bool operator==(const TaskInput& a, const TaskInput& b) {
   return a.codec_settings == b.codec_settings && a.image_path == b.image_path &&
-         a.encoded_path == b.encoded_path;
+         a.encoded_path == b.encoded_path &&
+         a.rendition_width == b.rendition_width;
 }
 
 //------------------------------------------------------------------------------
@@ -93,6 +115,45 @@ std::string TaskOutput::Serialize() const {
       ss << ", " << distortions[metric];
     }
   }
+  // Optional fields are appended as "key=value" tokens, only when they differ
+  // from their default value so that older progress files stay valid.
+  if (simd_level != SimdLevel::kNative) {
+    ss << ", simd=" << SimdLevelToString(simd_level);
+  }
+  if (decode_timing != DecodeTiming::kWarm) {
+    ss << ", decode=" << DecodeTimingToString(decode_timing);
+  }
+  if (encoding_color_conversion_duration > 0) {
+    ss << ", encode_conversion=" << encoding_color_conversion_duration;
+  }
+  if (header_size > 0) ss << ", header=" << header_size;
+  if (metadata_size > 0) ss << ", metadata=" << metadata_size;
+  if (alpha_size > 0) ss << ", alpha=" << alpha_size;
+  if (approximate_distortions) {
+    ss << ", approx=";
+    for (size_t metric = 0; metric < kNumDistortionMetrics; ++metric) {
+      ss << (metric == 0 ? "" : ":") << distortion_errors[metric];
+    }
+  }
+  if (system_conditions.sampled) {
+    const SystemConditions& c = system_conditions;
+    ss << ", system=" << c.cpu_frequency_ratio << ":" << c.run_queue_length
+       << ":" << c.cpu_pressure << ":" << c.memory_pressure << ":"
+       << c.num_thermal_throttles << ":" << (c.abnormal ? 1 : 0);
+  }
+  if (first_frame_decoding_duration > 0) {
+    ss << ", first_frame=" << first_frame_decoding_duration
+       << ", frame_p50=" << frame_decoding_duration_p50
+       << ", frame_p99=" << frame_decoding_duration_p99
+       << ", frame_max=" << frame_decoding_duration_max;
+  }
+  if (task_duration > 0) ss << ", task=" << task_duration;
+  if (!task_input.codec_settings.build.empty()) {
+    ss << ", build=" << Escape(task_input.codec_settings.build);
+  }
+  if (task_input.rendition_width != 0) {
+    ss << ", rendition=" << task_input.rendition_width;
+  }
   return ss.str();
 }
 
@@ -100,6 +161,99 @@ namespace {
 
 constexpr size_t kNumNonDistortionTokens = 14;
 
+// Moves the trailing "key=value" tokens from tokens to the returned vector.
+std::vector<std::string> SplitOptionalTokens(std::vector<std::string>& tokens) {
+  size_t num_tokens = tokens.size();
+  while (num_tokens > kNumNonDistortionTokens &&
+         tokens[num_tokens - 1].find('=') != std::string::npos) {
+    --num_tokens;
+  }
+  std::vector<std::string> optional_tokens(tokens.begin() + num_tokens,
+                                           tokens.end());
+  tokens.resize(num_tokens);
+  return optional_tokens;
+}
+
+Status UnserializeOptionalTokens(const std::string& serialized_task,
+                                 const std::vector<std::string>& tokens,
+                                 TaskOutput& task, bool quiet) {
+  for (const std::string& token : tokens) {
+    const size_t separator = token.find('=');
+    const std::string key = token.substr(0, separator);
+    const std::string value = token.substr(separator + 1);
+    if (key == "simd") {
+      ASSIGN_OR_RETURN(task.simd_level, SimdLevelFromString(value, quiet));
+    } else if (key == "decode") {
+      ASSIGN_OR_RETURN(task.decode_timing,
+                       DecodeTimingFromString(value, quiet));
+    } else if (key == "encode_conversion") {
+      task.encoding_color_conversion_duration = std::stod(value);
+      CHECK_OR_RETURN(task.encoding_color_conversion_duration > 0, quiet)
+          << "Bad encoding color conversion duration in \"" << serialized_task
+          << "\"";
+    } else if (key == "header" || key == "metadata" || key == "alpha") {
+      size_t& size = key == "header"     ? task.header_size
+                     : key == "metadata" ? task.metadata_size
+                                         : task.alpha_size;
+      size = std::stoul(value);
+      CHECK_OR_RETURN(size > 0, quiet)
+          << "Bad " << key << " size in \"" << serialized_task << "\"";
+    } else if (key == "first_frame" || key == "frame_p50" ||
+               key == "frame_p99" || key == "frame_max") {
+      double& duration =
+          key == "first_frame" ? task.first_frame_decoding_duration
+          : key == "frame_p50" ? task.frame_decoding_duration_p50
+          : key == "frame_p99" ? task.frame_decoding_duration_p99
+                               : task.frame_decoding_duration_max;
+      duration = std::stod(value);
+      CHECK_OR_RETURN(duration >= 0, quiet)
+          << "Bad " << key << " duration in \"" << serialized_task << "\"";
+    } else if (key == "task") {
+      task.task_duration = std::stod(value);
+      CHECK_OR_RETURN(task.task_duration > 0, quiet)
+          << "Bad task duration in \"" << serialized_task << "\"";
+    } else if (key == "approx") {
+      const std::vector<std::string> errors = Split(value, ':');
+      CHECK_OR_RETURN(errors.size() == kNumDistortionMetrics, quiet)
+          << "Bad distortion errors in \"" << serialized_task << "\"";
+      for (size_t metric = 0; metric < kNumDistortionMetrics; ++metric) {
+        task.distortion_errors[metric] = std::stof(errors[metric]);
+        CHECK_OR_RETURN(task.distortion_errors[metric] >= 0, quiet)
+            << "Bad distortion error in \"" << serialized_task << "\"";
+      }
+      task.approximate_distortions = true;
+    } else if (key == "system") {
+      const std::vector<std::string> values = Split(value, ':');
+      CHECK_OR_RETURN(values.size() == 6, quiet)
+          << "Bad system conditions in \"" << serialized_task << "\"";
+      SystemConditions& c = task.system_conditions;
+      c.sampled = true;
+      c.cpu_frequency_ratio = std::stof(values[0]);
+      c.run_queue_length = std::stoul(values[1]);
+      c.cpu_pressure = std::stof(values[2]);
+      c.memory_pressure = std::stof(values[3]);
+      c.num_thermal_throttles = std::stoul(values[4]);
+      c.abnormal = values[5] == "1";
+      CHECK_OR_RETURN(c.cpu_frequency_ratio >= 0 && c.cpu_pressure >= 0 &&
+                          c.memory_pressure >= 0 &&
+                          (values[5] == "0" || c.abnormal),
+                      quiet)
+          << "Bad system conditions in \"" << serialized_task << "\"";
+    } else if (key == "build") {
+      ASSIGN_OR_RETURN(task.task_input.codec_settings.build,
+                       Unescape(value, quiet));
+    } else if (key == "rendition") {
+      task.task_input.rendition_width = std::stoul(value);
+      CHECK_OR_RETURN(task.task_input.rendition_width > 0, quiet)
+          << "Bad rendition width in \"" << serialized_task << "\"";
+    } else {
+      CHECK_OR_RETURN(false, quiet)
+          << "Unknown field \"" << key << "\" in \"" << serialized_task << "\"";
+    }
+  }
+  return Status::kOk;
+}
+
 StatusOr<TaskOutput> UnserializeNoDistortion(
     const std::string& serialized_task, const std::vector<std::string> tokens,
     bool quiet) {
@@ -160,16 +314,25 @@ StatusOr<TaskOutput> UnserializeNoDistortion(
 
 StatusOr<TaskOutput> TaskOutput::UnserializeNoDistortion(
     const std::string& serialized_task, bool quiet) {
-  return ::codec_compare_gen::UnserializeNoDistortion(
-      serialized_task, Split(serialized_task, ','), quiet);
+  std::vector<std::string> tokens = Split(serialized_task, ',');
+  const std::vector<std::string> optional_tokens = SplitOptionalTokens(tokens);
+  ASSIGN_OR_RETURN(TaskOutput task,
+                   ::codec_compare_gen::UnserializeNoDistortion(serialized_task,
+                                                                tokens, quiet));
+  OK_OR_RETURN(
+      UnserializeOptionalTokens(serialized_task, optional_tokens, task, quiet));
+  return task;
 }
 
 StatusOr<TaskOutput> TaskOutput::Unserialize(const std::string& serialized_task,
                                              bool quiet) {
-  const std::vector<std::string> tokens = Split(serialized_task, ',');
+  std::vector<std::string> tokens = Split(serialized_task, ',');
+  const std::vector<std::string> optional_tokens = SplitOptionalTokens(tokens);
   ASSIGN_OR_RETURN(TaskOutput task,
                    ::codec_compare_gen::UnserializeNoDistortion(serialized_task,
                                                                 tokens, quiet));
+  OK_OR_RETURN(
+      UnserializeOptionalTokens(serialized_task, optional_tokens, task, quiet));
   if (tokens.size() == kNumNonDistortionTokens) {
     // Likely lossless.
     std::fill(task.distortions, task.distortions + kNumDistortionMetrics,
@@ -195,9 +358,198 @@ StatusOr<TaskOutput> TaskOutput::Unserialize(const std::string& serialized_task,
   return task;
 }
 
+namespace {
+
+// Lines are parsed in batches to limit the locking overhead.
+constexpr size_t kNumLinesPerParsingBatch = 4096;
+
+// Shared among all ParsingWorkers. Guarded by a mutex in WorkerPool.
+struct ParsingContext {
+  const std::vector<std::string_view>* lines;
+  std::vector<TaskOutput>* tasks;  // Same size as lines.
+  size_t next_line = 0;
+  bool discard_distortion_values = false;
+  bool quiet = true;
+  Status status = Status::kOk;  // kOk or first encountered error.
+};
+
+class ParsingWorker : public Worker<ParsingContext, ParsingWorker> {
+ public:
+  using Worker<ParsingContext, ParsingWorker>::Worker;
+
+ private:
+  bool AssignTask(ParsingContext& context) override {
+    if (context.status != Status::kOk ||
+        context.next_line >= context.lines->size()) {
+      return false;
+    }
+    context_ = &context;
+    first_line_ = context.next_line;
+    last_line_ =
+        std::min(first_line_ + kNumLinesPerParsingBatch, context.lines->size());
+    context.next_line = last_line_;
+    return true;
+  }
+
+  void DoTask() override {
+    // Each worker writes to distinct elements of context_->tasks.
+    status_ = Status::kOk;
+    for (size_t i = first_line_; i < last_line_; ++i) {
+      const std::string line((*context_->lines)[i]);
+      StatusOr<TaskOutput> task =
+          context_->discard_distortion_values
+              ? TaskOutput::UnserializeNoDistortion(line, context_->quiet)
+              : TaskOutput::Unserialize(line, context_->quiet);
+      if (task.status != Status::kOk) {
+        status_ = task.status;
+        return;
+      }
+      (*context_->tasks)[i] = std::move(task.value);
+    }
+  }
+
+  void EndTask(ParsingContext& context) override {
+    if (context.status == Status::kOk) context.status = status_;
+  }
+
+  ParsingContext* context_ = nullptr;
+  size_t first_line_ = 0;
+  size_t last_line_ = 0;
+  Status status_ = Status::kOk;
+};
+
+}  // namespace
+
+StatusOr<std::vector<TaskOutput>> ReadTaskOutputs(
+    const std::string& file_path, bool discard_distortion_values,
+    size_t num_threads, bool quiet) {
+  std::ifstream file(file_path, std::ios::binary);
+  CHECK_OR_RETURN(file.is_open(), quiet)
+      << "Could not open " << file_path << " for reading";
+  const std::string content((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+  CHECK_OR_RETURN(!file.bad(), quiet) << "Could not read " << file_path;
+
+  std::vector<std::string_view> lines;
+  for (size_t start = 0; start < content.size();) {
+    size_t end = content.find('\n', start);
+    if (end == std::string::npos) end = content.size();
+    lines.emplace_back(content.data() + start, end - start);
+    start = end + 1;
+  }
+
+  std::vector<TaskOutput> tasks(lines.size());
+  ParsingContext context;
+  context.lines = &lines;
+  context.tasks = &tasks;
+  context.discard_distortion_values = discard_distortion_values;
+  context.quiet = quiet;
+  WorkerPool<ParsingContext, ParsingWorker> pool(std::max<size_t>(
+      1, std::min(num_threads, lines.size() / kNumLinesPerParsingBatch + 1)));
+  pool.Run(context);
+  OK_OR_RETURN(context.status);
+  return tasks;
+}
+
+//------------------------------------------------------------------------------
+// Failure serialization
+
+namespace {
+constexpr size_t kNumFailureTokens = 8;
+}  // namespace
+
+std::string TaskFailure::Serialize() const {
+  // Keep one failure per line.
+  std::string single_line_error = error;
+  std::replace(single_line_error.begin(), single_line_error.end(), '\n', ' ');
+
+  std::stringstream ss;
+  ss << Escape(CodecName(task_input.codec_settings.codec)) << ", "
+     << SubsamplingToString(task_input.codec_settings.chroma_subsampling)
+     << ", " << task_input.codec_settings.effort << ", "
+     << task_input.codec_settings.quality << ", "
+     << Escape(task_input.image_path) << ", "
+     << Escape(task_input.encoded_path) << ", " << duration << ", "
+     << Escape(single_line_error);
+  // Same optional fields as TaskOutput::Serialize().
+  if (!task_input.codec_settings.build.empty()) {
+    ss << ", build=" << Escape(task_input.codec_settings.build);
+  }
+  if (task_input.rendition_width != 0) {
+    ss << ", rendition=" << task_input.rendition_width;
+  }
+  return ss.str();
+}
+
+StatusOr<TaskFailure> TaskFailure::Unserialize(
+    const std::string& serialized_failure, bool quiet) {
+  std::vector<std::string> tokens = Split(serialized_failure, ',');
+  CHECK_OR_RETURN(tokens.size() >= kNumFailureTokens, quiet)
+      << "Expected " << kNumFailureTokens << "+ tokens in \""
+      << serialized_failure << "\" but found " << tokens.size();
+  // The error message may contain '=' so the optional tokens are only looked
+  // for after the fixed ones.
+  const std::vector<std::string> optional_tokens(
+      tokens.begin() + kNumFailureTokens, tokens.end());
+  size_t t = 0;
+
+  TaskFailure failure;
+  CodecSettings& codec_settings = failure.task_input.codec_settings;
+  ASSIGN_OR_RETURN(const std::string codec_name, Unescape(tokens[t++], quiet));
+  ASSIGN_OR_RETURN(codec_settings.codec, CodecFromName(codec_name, quiet));
+  ASSIGN_OR_RETURN(codec_settings.chroma_subsampling,
+                   SubsamplingFromString(tokens[t++], quiet));
+  codec_settings.effort = std::stoul(tokens[t++]);
+  codec_settings.quality = std::stoi(tokens[t++]);
+  ASSIGN_OR_RETURN(failure.task_input.image_path,
+                   Unescape(tokens[t++], quiet));
+  ASSIGN_OR_RETURN(failure.task_input.encoded_path,
+                   Unescape(tokens[t++], quiet));
+  failure.duration = std::stod(tokens[t++]);
+  ASSIGN_OR_RETURN(failure.error, Unescape(tokens[t++], quiet));
+  CHECK_OR_RETURN(t == kNumFailureTokens, quiet);
+
+  TaskOutput task;
+  OK_OR_RETURN(UnserializeOptionalTokens(serialized_failure, optional_tokens,
+                                         task, quiet));
+  codec_settings.build = task.task_input.codec_settings.build;
+  failure.task_input.rendition_width = task.task_input.rendition_width;
+  return failure;
+}
+
+StatusOr<std::vector<TaskFailure>> ReadTaskFailures(
+    const std::string& file_path, bool quiet) {
+  std::ifstream file(file_path);
+  CHECK_OR_RETURN(file.is_open(), quiet)
+      << "Could not open " << file_path << " for reading";
+  std::vector<TaskFailure> failures;
+  for (std::string line; std::getline(file, line);) {
+    if (line.empty()) continue;
+    ASSIGN_OR_RETURN(TaskFailure failure,
+                     TaskFailure::Unserialize(line, quiet));
+    failures.push_back(std::move(failure));
+  }
+  CHECK_OR_RETURN(!file.bad(), quiet) << "Could not read " << file_path;
+  return failures;
+}
+
 //------------------------------------------------------------------------------
 // Task generation and aggregation
 
+namespace {
+
+// Returns true if the header of the image at image_path declares several
+// frames. The pixels are not decoded, so an animation whose frames are all
+// identical is counted too, even though ReadStillImageOrAnimation() would merge
+// them into a still image.
+bool IsAnimation(const std::string& image_path) {
+  const StatusOr<ImageInfo> info = ReadImageInfo(image_path, /*quiet=*/true);
+  // Unreadable files are reported by the tasks evaluating them.
+  return info.status == Status::kOk && info.value.is_animation;
+}
+
+}  // namespace
+
 StatusOr<std::vector<TaskInput>> PlanTasks(
     const std::vector<std::string>& image_paths,
     const ComparisonSettings& settings) {
@@ -205,17 +557,102 @@ StatusOr<std::vector<TaskInput>> PlanTasks(
       << "No specified input image file path";
   CHECK_OR_RETURN(!settings.codec_settings.empty(), settings.quiet)
       << "No specified codec";
+  // Unsupported settings are left out rather than failing the whole run.
+  std::vector<CodecSettings> all_settings;
+  bool all_codecs_support_animations = true;
+  for (const CodecSettings& codec_settings : settings.codec_settings) {
+    if (CheckCodecCapabilities(codec_settings, settings.quiet) != Status::kOk) {
+      continue;
+    }
+    all_settings.push_back(codec_settings);
+    all_codecs_support_animations &=
+        GetCodecCapabilities(codec_settings.codec).animation;
+  }
+  CHECK_OR_RETURN(!all_settings.empty(), settings.quiet)
+      << "None of the " << settings.codec_settings.size()
+      << " codec settings can be encoded";
+  if (all_settings.size() != settings.codec_settings.size() &&
+      !settings.quiet) {
+    std::cout << "Warning: skipping the "
+              << settings.codec_settings.size() - all_settings.size()
+              << " codec settings above that cannot be encoded" << std::endl;
+  }
+  // The images are only read if needed.
+  std::unordered_set<std::string> animations;
+  if (!all_codecs_support_animations) {
+    for (const std::string& image_path : image_paths) {
+      if (IsAnimation(image_path)) animations.insert(image_path);
+    }
+  }
+  size_t num_skipped_tasks = 0;
 
+  const std::vector<uint32_t> rendition_widths =
+      settings.rendition_widths.empty() ? std::vector<uint32_t>{0}
+                                        : settings.rendition_widths;
   std::vector<TaskInput> tasks;
-  tasks.reserve(settings.codec_settings.size() * image_paths.size() *
-                (1 + settings.num_repetitions));
-  for (const CodecSettings& codec_settings : settings.codec_settings) {
+  tasks.reserve(all_settings.size() * image_paths.size() *
+                rendition_widths.size() * (1 + settings.num_repetitions));
+  // Builds of the same codec settings are interleaved, so that they are
+  // evaluated under similar conditions even without random_order.
+  std::vector<std::pair<size_t, size_t>> same_settings_but_build;
+  for (size_t first = 0; first < all_settings.size();) {
+    size_t last = first + 1;
+    while (last < all_settings.size() &&
+           SameSettingsButBuild(all_settings[first], all_settings[last])) {
+      ++last;
+    }
+    same_settings_but_build.emplace_back(first, last);
+    first = last;
+  }
+  auto add_tasks = [&](const std::pair<size_t, size_t>& builds,
+                       const std::string& image_path,
+                       uint32_t rendition_width) {
+    for (uint32_t i = 0; i < 1 + settings.num_repetitions; ++i) {
+      for (size_t s = builds.first; s < builds.second; ++s) {
+        if (!GetCodecCapabilities(all_settings[s].codec).animation &&
+            animations.count(image_path) != 0) {
+          ++num_skipped_tasks;
+          continue;
+        }
+        tasks.push_back(TaskInput{
+            all_settings[s], image_path,
+            GetEncodedFilePath(settings.encoded_folder_path, image_path,
+                               all_settings[s], rendition_width),
+            rendition_width});
+      }
+    }
+  };
+
+  const bool shares_conversions = std::any_of(
+      all_settings.begin(), all_settings.end(), &HasSharedEncoderInput);
+  if (settings.rendition_widths.empty() && !shares_conversions) {
+    for (const auto& builds : same_settings_but_build) {
+      for (const std::string& image_path : image_paths) {
+        add_tasks(builds, image_path, /*rendition_width=*/0);
+      }
+    }
+  } else {
+    // All tasks of an image are adjacent so that its decoded pixels, its
+    // renditions and their conversions can be reused from the RenditionCache
+    // without random_order, however many images there are.
+    for (const std::string& image_path : image_paths) {
+      for (const uint32_t rendition_width : rendition_widths) {
+        for (const auto& builds : same_settings_but_build) {
+          add_tasks(builds, image_path, rendition_width);
+        }
+      }
+    }
+  }
+  if (num_skipped_tasks != 0 && !settings.quiet) {
+    std::cout << "Skipping " << num_skipped_tasks << " tasks of "
+              << animations.size()
+              << " animations for codecs that only encode still images:"
+              << std::endl;
+    std::unordered_set<std::string_view> reported_animations;
     for (const std::string& image_path : image_paths) {
-      const std::string encoded_file_path = GetEncodedFilePath(
-          settings.encoded_folder_path, image_path, codec_settings);
-      for (uint32_t i = 0; i < 1 + settings.num_repetitions; ++i) {
-        tasks.push_back(
-            TaskInput{codec_settings, image_path, encoded_file_path});
+      if (animations.count(image_path) != 0 &&
+          reported_animations.insert(image_path).second) {
+        std::cout << "  " << image_path << std::endl;
       }
     }
   }
@@ -239,6 +676,8 @@ bool TaskOutputsAreRepetitions(const TaskOutput& a, const TaskOutput& b) {
   if (a.bit_depth != b.bit_depth) return false;
   if (a.num_frames != b.num_frames) return false;
   if (a.encoded_size != b.encoded_size) return false;
+  if (a.simd_level != b.simd_level) return false;
+  if (a.decode_timing != b.decode_timing) return false;
   for (size_t metric = 0; metric < kNumDistortionMetrics; ++metric) {
     if (!SameDistortion(a.distortions[metric], b.distortions[metric])) {
       return false;
@@ -269,6 +708,19 @@ StatusOr<std::vector<TaskOutput>> AggregateResultsByImageAndQuality(
       task_output.decoding_duration += result.decoding_duration;
       task_output.decoding_color_conversion_duration +=
           result.decoding_color_conversion_duration;
+      task_output.encoding_color_conversion_duration +=
+          result.encoding_color_conversion_duration;
+      task_output.first_frame_decoding_duration +=
+          result.first_frame_decoding_duration;
+      task_output.frame_decoding_duration_p50 +=
+          result.frame_decoding_duration_p50;
+      task_output.frame_decoding_duration_p99 +=
+          result.frame_decoding_duration_p99;
+      task_output.frame_decoding_duration_max +=
+          result.frame_decoding_duration_max;
+      task_output.system_conditions = WorstSystemConditions(
+          task_output.system_conditions, result.system_conditions);
+      task_output.task_duration += result.task_duration;
       ++it->second.count;
     }
   }
@@ -282,6 +734,17 @@ StatusOr<std::vector<TaskOutput>> AggregateResultsByImageAndQuality(
       aggregated_results.back().decoding_duration /= aggregated_rows.count;
       aggregated_results.back().decoding_color_conversion_duration /=
           aggregated_rows.count;
+      aggregated_results.back().encoding_color_conversion_duration /=
+          aggregated_rows.count;
+      aggregated_results.back().first_frame_decoding_duration /=
+          aggregated_rows.count;
+      aggregated_results.back().frame_decoding_duration_p50 /=
+          aggregated_rows.count;
+      aggregated_results.back().frame_decoding_duration_p99 /=
+          aggregated_rows.count;
+      aggregated_results.back().frame_decoding_duration_max /=
+          aggregated_rows.count;
+      aggregated_results.back().task_duration /= aggregated_rows.count;
     }
   }
   return aggregated_results;
@@ -294,31 +757,39 @@ SplitByCodecSettingsAndAggregateByImageAndQuality(
     const std::vector<TaskOutput>& results, bool quiet) {
   std::vector<std::vector<TaskOutput>> aggregated_results;
 
-  auto cmp = [](const CodecSettings& a, const CodecSettings& b) {
+  auto cmp = [](const TaskInput& task_a, const TaskInput& task_b) {
     // Multiple qualities can coexist in the same aggregate (meaning in the same
-    // output JSON single file). Only split by codec, chroma subsampling and
-    // effort.
+    // output JSON single file). Only split by codec, chroma subsampling,
+    // effort, build and rendition width.
+    const CodecSettings& a = task_a.codec_settings;
+    const CodecSettings& b = task_b.codec_settings;
+    if (task_a.rendition_width != task_b.rendition_width) {
+      return task_a.rendition_width < task_b.rendition_width;
+    }
     return a.codec < b.codec ||
            (a.codec == b.codec &&
             a.chroma_subsampling < b.chroma_subsampling) ||
            (a.codec == b.codec &&
             a.chroma_subsampling == b.chroma_subsampling &&
-            a.effort < b.effort);
+            a.effort < b.effort) ||
+           (a.codec == b.codec &&
+            a.chroma_subsampling == b.chroma_subsampling &&
+            a.effort == b.effort && a.build < b.build);
   };
-  std::map<CodecSettings, std::vector<TaskOutput>, decltype(cmp)> map(cmp);
+  std::map<TaskInput, std::vector<TaskOutput>, decltype(cmp)> map(cmp);
   for (const TaskOutput& result : results) {
-    map[result.task_input.codec_settings].push_back(result);
+    map[result.task_input].push_back(result);
   }
 
   aggregated_results.reserve(map.size());
-  for (const auto& [codec_settings, results] : map) {
+  for (const auto& [task_input, results] : map) {
     aggregated_results.push_back({});
     std::vector<TaskOutput>& aggregate = aggregated_results.back();
     ASSIGN_OR_RETURN(aggregate,
                      AggregateResultsByImageAndQuality(results, quiet));
 
-    // codec, chroma subsampling and effort are the same in these results so
-    // only sort by original image name and quality.
+    // codec, chroma subsampling, effort, build and rendition width are the
+    // same in these results so only sort by original image name and quality.
     std::sort(aggregate.begin(), aggregate.end(),
               [](const TaskOutput& a, const TaskOutput& b) {
                 return a.task_input.image_path < b.task_input.image_path ||
@@ -330,4 +801,24 @@ SplitByCodecSettingsAndAggregateByImageAndQuality(
   return aggregated_results;
 }
 
+std::string BatchName(const CodecSettings& settings, uint32_t rendition_width,
+                      SimdLevel simd_level, DecodeTiming decode_timing) {
+  std::string batch_name = CodecName(settings.codec) + "_" +
+                           SubsamplingToString(settings.chroma_subsampling) +
+                           "_" + std::to_string(settings.effort);
+  if (!settings.build.empty()) {
+    batch_name += "_" + CodecBuildName(settings.build);
+  }
+  if (rendition_width != 0) {
+    batch_name += "_" + std::to_string(rendition_width) + "w";
+  }
+  if (simd_level != SimdLevel::kNative) {
+    batch_name += "_" + SimdLevelToString(simd_level);
+  }
+  if (decode_timing != DecodeTiming::kWarm) {
+    batch_name += "_" + DecodeTimingToString(decode_timing);
+  }
+  return batch_name;
+}
+
 }  // namespace codec_compare_gen
@@ -22,6 +22,7 @@
 
 #include "src/base.h"
 #include "src/framework.h"
+#include "src/system_conditions.h"
 
 namespace codec_compare_gen {
 
@@ -30,6 +31,10 @@ struct TaskInput {
   std::string image_path;    // Original image file path.
   std::string encoded_path;  // Encoded image file path.
                              // Can be empty to avoid saving to disk.
+  // 0 means the original image is encoded. Otherwise the original image is
+  // downscaled to that width (keeping its aspect ratio) before being encoded
+  // and used as the reference for the distortion metrics. See rendition.h.
+  uint32_t rendition_width = 0;
 };
 
 bool operator==(const TaskInput& a, const TaskInput& b);
@@ -48,6 +53,38 @@ struct TaskOutput {
 
   float distortions[kNumDistortionMetrics];
 
+  // Optional fields. See Serialize().
+  SimdLevel simd_level = SimdLevel::kNative;
+  DecodeTiming decode_timing = DecodeTiming::kWarm;
+  // Part of encoding_duration spent converting RGB samples to the input
+  // representation of the encoder. The conversion is computed once per image
+  // and shared by all qualities (see RenditionCache::GetConverted()), so this
+  // is what each encoding would have spent on it otherwise.
+  double encoding_color_conversion_duration = 0;  // in seconds
+  // Parts of encoded_size that are not payload. See AnalyzeBitstream().
+  size_t header_size = 0;
+  size_t metadata_size = 0;
+  size_t alpha_size = 0;
+  // Decoding durations of the frames of an animation, for the codecs whose
+  // decoder outputs frames one by one. 0 for still images.
+  double first_frame_decoding_duration = 0;  // in seconds, time to first frame
+  double frame_decoding_duration_p50 = 0;    // in seconds
+  double frame_decoding_duration_p99 = 0;    // in seconds
+  double frame_decoding_duration_max = 0;    // in seconds
+  // True if the distortions were estimated on a subset of the frames and
+  // pixels (see GetSampledDistortion()), with these standard errors. Such tasks
+  // are evaluated again by a run without ComparisonSettings::quick_metrics.
+  bool approximate_distortions = false;
+  float distortion_errors[kNumDistortionMetrics] = {0};
+  // State of the host during the encoding and decoding, if sampled (see
+  // ComparisonSettings::system_sampling_period). Tasks timed under abnormal
+  // conditions can be evaluated again.
+  SystemConditions system_conditions;
+  // Wall time of the whole task in its worker thread, including reading the
+  // image, computing the distortions and waiting for the encoded file to be
+  // written. 0 if unknown, as in older progress files.
+  double task_duration = 0;  // in seconds
+
   std::string Serialize() const;
   static StatusOr<TaskOutput> UnserializeNoDistortion(
       const std::string& serialized_task, bool quiet);
@@ -55,6 +92,33 @@ struct TaskOutput {
                                           bool quiet);
 };
 
+// Reads all the tasks serialized in a progress file, one per line. The lines
+// are parsed by num_threads threads (at least one).
+StatusOr<std::vector<TaskOutput>> ReadTaskOutputs(
+    const std::string& file_path, bool discard_distortion_values,
+    size_t num_threads, bool quiet);
+
+// Record of a task that failed, so that it is not evaluated again when resuming
+// from the same progress file.
+struct TaskFailure {
+  TaskInput task_input;
+  double duration;    // in seconds, until the failure
+  std::string error;  // See LastErrorMessage().
+
+  std::string Serialize() const;
+  static StatusOr<TaskFailure> Unserialize(
+      const std::string& serialized_failure, bool quiet);
+};
+
+// Reads all the failures serialized in a file, one per line.
+StatusOr<std::vector<TaskFailure>> ReadTaskFailures(
+    const std::string& file_path, bool quiet);
+
+// Returns the tasks evaluating each image with each codec setting. Skips the
+// codec settings that cannot be encoded, whatever the image (see
+// CheckCodecCapabilities()), and returns an error if none can. Skips the
+// animations for the codecs that only encode still images (see
+// ReadImageInfo()).
 StatusOr<std::vector<TaskInput>> PlanTasks(
     const std::vector<std::string>& image_paths,
     const ComparisonSettings& settings);
@@ -67,6 +131,12 @@ StatusOr<std::vector<std::vector<TaskOutput>>>
 SplitByCodecSettingsAndAggregateByImageAndQuality(
     const std::vector<TaskOutput>& results, bool quiet);
 
+// Returns the name identifying the results of a codec, chroma subsampling,
+// effort, build, rendition width, SIMD level and decode timing. Used as the
+// JSON results file stem.
+std::string BatchName(const CodecSettings& settings, uint32_t rendition_width,
+                      SimdLevel simd_level, DecodeTiming decode_timing);
+
 }  // namespace codec_compare_gen
 
 #endif  // SRC_TASK_H_
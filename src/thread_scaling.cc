@@ -0,0 +1,135 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/thread_scaling.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "src/base.h"
+#include "src/codec.h"
+#include "src/framework.h"
+#include "src/rendition.h"
+#include "src/simd.h"
+#include "src/task.h"
+
+namespace codec_compare_gen {
+
+StatusOr<std::vector<ThreadScaling>> MeasureThreadScaling(
+    const std::vector<TaskOutput>& tasks,
+    const ThreadScalingSettings& settings, bool quiet) {
+  CHECK_OR_RETURN(!settings.thread_counts.empty() &&
+                      settings.num_repetitions > 0,
+                  quiet);
+  // Distinct images grouped by batch, in order of first appearance.
+  std::vector<ThreadScaling> results;
+  std::vector<std::vector<TaskInput>> inputs;
+  std::vector<SimdLevel> simd_levels;
+  std::vector<DecodeTiming> decode_timings;
+  std::unordered_map<std::string, size_t> batch_indices;
+  std::unordered_set<std::string> image_paths_and_batch_names;
+  for (const TaskOutput& task : tasks) {
+    const CodecSettings& codec_settings = task.task_input.codec_settings;
+    if (!GetCodecCapabilities(codec_settings.codec).multithreading) {
+      continue;
+    }
+    const std::string batch_name =
+        BatchName(codec_settings, task.task_input.rendition_width,
+                  task.simd_level, task.decode_timing);
+    if (!image_paths_and_batch_names
+             .insert(task.task_input.image_path + "\n" + batch_name)
+             .second) {
+      continue;  // Repetition.
+    }
+    const auto [it, inserted] =
+        batch_indices.emplace(batch_name, results.size());
+    if (inserted) {
+      results.emplace_back();
+      results.back().batch_name = batch_name;
+      inputs.emplace_back();
+      simd_levels.push_back(task.simd_level);
+      decode_timings.push_back(task.decode_timing);
+    }
+    inputs[it->second].push_back(task.task_input);
+  }
+
+  // Only the last image is needed, at its original size and as a rendition.
+  RenditionCache rendition_cache(/*capacity=*/2);
+  EncodeDecodeOptions options;
+  options.compute_distortions = false;
+  options.rendition_cache = &rendition_cache;
+  for (size_t b = 0; b < results.size(); ++b) {
+    // Fails if the batches do not share the same level. See ApplySimdLevel().
+    OK_OR_RETURN(ApplySimdLevel(simd_levels[b], quiet));
+    options.decode_timing = decode_timings[b];
+    ThreadScaling& scaling = results[b];
+    scaling.num_images = inputs[b].size();
+    for (const size_t num_threads : settings.thread_counts) {
+      ThreadScalingPoint point = {};
+      point.num_threads = num_threads;
+      scaling.points.push_back(point);
+    }
+
+    for (TaskInput input : inputs[b]) {
+      input.encoded_path.clear();
+      for (ThreadScalingPoint& point : scaling.points) {
+        input.codec_settings.num_threads =
+            static_cast<uint32_t>(point.num_threads);
+        OK_OR_RETURN(CheckCodecCapabilities(input.codec_settings, quiet));
+        double encoding_duration = std::numeric_limits<double>::max();
+        double decoding_duration = std::numeric_limits<double>::max();
+        uint64_t encoded_size = 0;
+        for (size_t r = 0; r < settings.num_repetitions; ++r) {
+          ASSIGN_OR_RETURN(const TaskOutput task,
+                           EncodeDecode(input, /*metric_binary_folder_path=*/"",
+                                        /*thread_id=*/0, EncodeMode::kEncode,
+                                        options, quiet));
+          encoding_duration =
+              std::min(encoding_duration, task.encoding_duration);
+          decoding_duration =
+              std::min(decoding_duration, task.decoding_duration);
+          encoded_size = task.encoded_size;
+        }
+        point.encoding_duration += encoding_duration;
+        point.decoding_duration += decoding_duration;
+        point.encoded_size += encoded_size;
+      }
+    }
+
+    const ThreadScalingPoint& first = scaling.points.front();
+    for (ThreadScalingPoint& point : scaling.points) {
+      const double relative_num_threads =
+          static_cast<double>(point.num_threads) / first.num_threads;
+      point.encoding_speedup =
+          point.encoding_duration > 0
+              ? first.encoding_duration / point.encoding_duration
+              : 0;
+      point.decoding_speedup =
+          point.decoding_duration > 0
+              ? first.decoding_duration / point.decoding_duration
+              : 0;
+      point.encoding_efficiency = point.encoding_speedup / relative_num_threads;
+      point.decoding_efficiency = point.decoding_speedup / relative_num_threads;
+    }
+  }
+  return results;
+}
+
+}  // namespace codec_compare_gen
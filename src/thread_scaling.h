@@ -0,0 +1,74 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_THREAD_SCALING_H_
+#define SRC_THREAD_SCALING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "src/base.h"
+#include "src/task.h"
+
+namespace codec_compare_gen {
+
+struct ThreadScalingSettings {
+  // Values of CodecSettings::num_threads. The speedups are relative to the
+  // first one.
+  std::vector<size_t> thread_counts = {1};
+  // Each image is encoded and decoded that many times with each thread count.
+  // The fastest durations are kept.
+  size_t num_repetitions = 1;
+};
+
+// Encoding and decoding performance of one batch with some threads per image.
+struct ThreadScalingPoint {
+  size_t num_threads;
+  // Sums over the images of the fastest durations, in seconds.
+  double encoding_duration;
+  double decoding_duration;
+  // Durations with the first thread count divided by the durations above.
+  double encoding_speedup;
+  double decoding_speedup;
+  // Speedups divided by the relative number of threads. 1 is linear scaling.
+  double encoding_efficiency;
+  double decoding_efficiency;
+  // Sum over the images. Some encoders split the images into independently
+  // coded tiles when given several threads, which changes the bitstream.
+  uint64_t encoded_size;
+};
+
+struct ThreadScaling {
+  std::string batch_name;  // See BatchName().
+  size_t num_images = 0;
+  std::vector<ThreadScalingPoint> points;  // In thread_counts order.
+};
+
+// For each batch, encodes and decodes its distinct images one at a time, with
+// each number of threads given to the codec library. The image of each task is
+// evaluated with all thread counts before the next one, so that all counts are
+// equally affected by the state of the machine. Distortions are not computed.
+// The SIMD level and the decode timing of each batch are reproduced, so all
+// tasks must share the same SIMD level (see ApplySimdLevel()). The batches of
+// codecs that do not support multithreading (see CodecCapabilities) and of
+// plugins are skipped.
+StatusOr<std::vector<ThreadScaling>> MeasureThreadScaling(
+    const std::vector<TaskOutput>& tasks,
+    const ThreadScalingSettings& settings, bool quiet);
+
+}  // namespace codec_compare_gen
+
+#endif  // SRC_THREAD_SCALING_H_
@@ -0,0 +1,242 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/yuv.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "src/base.h"
+#include "src/serialization.h"
+
+namespace codec_compare_gen {
+
+namespace {
+
+StatusOr<std::string> ReadFile(const std::string& file_path, bool quiet) {
+  std::ifstream file(file_path, std::ios::binary);
+  CHECK_OR_RETURN(file.is_open(), quiet) << "Cannot open " << file_path;
+  std::stringstream bytes;
+  bytes << file.rdbuf();
+  return bytes.str();
+}
+
+bool ParseUint32(const std::string& str, uint32_t& value) {
+  if (str.empty() || str.size() > 9) return false;
+  value = 0;
+  for (const char c : str) {
+    if (c < '0' || c > '9') return false;
+    value = value * 10 + static_cast<uint32_t>(c - '0');
+  }
+  return true;
+}
+
+// Copies the planes of the first frame stored at the given offset.
+Status ReadPlanes(const std::string& bytes, size_t offset,
+                  const std::string& file_path, YuvImage& image, bool quiet) {
+  CHECK_OR_RETURN(image.width > 0 && image.height > 0, quiet)
+      << "Bad dimensions in " << file_path;
+  CHECK_OR_RETURN(image.bit_depth == 8 || image.bit_depth == 10, quiet)
+      << "Unsupported bit depth " << image.bit_depth << " in " << file_path;
+  for (size_t p = 0; p < 3; ++p) {
+    const size_t num_bytes =
+        static_cast<size_t>(image.RowBytes(p)) * image.PlaneHeight(p);
+    CHECK_OR_RETURN(offset + num_bytes <= bytes.size(), quiet)
+        << "Truncated frame in " << file_path;
+    image.planes[p].assign(bytes.begin() + offset,
+                           bytes.begin() + offset + num_bytes);
+    offset += num_bytes;
+  }
+  return Status::kOk;
+}
+
+// Returns the coordinate of the second nearest 4:2:0 chroma sample of a pixel
+// along one axis, clamped to the plane.
+uint32_t SecondNearestChroma(uint32_t luma_coordinate,
+                             uint32_t last_chroma_coordinate) {
+  const uint32_t nearest = luma_coordinate / 2;
+  if (luma_coordinate % 2 == 1) {
+    return std::min(nearest + 1, last_chroma_coordinate);
+  }
+  return nearest > 0 ? nearest - 1 : 0;
+}
+
+}  // namespace
+
+uint32_t YuvImage::PlaneWidth(size_t plane) const {
+  return (plane == 0 || subsampling == Subsampling::k444) ? width
+                                                          : (width + 1) / 2;
+}
+
+uint32_t YuvImage::PlaneHeight(size_t plane) const {
+  return (plane == 0 || subsampling == Subsampling::k444) ? height
+                                                          : (height + 1) / 2;
+}
+
+uint32_t YuvImage::Sample(size_t plane, uint32_t x, uint32_t y) const {
+  const size_t index = static_cast<size_t>(y) * PlaneWidth(plane) + x;
+  if (bit_depth <= 8) return planes[plane][index];
+  uint16_t sample;
+  std::memcpy(&sample, planes[plane].data() + index * 2, sizeof(sample));
+  return sample;
+}
+
+bool IsYuvFile(const std::string& file_path) {
+  return EndsWith(file_path, ".y4m") || EndsWith(file_path, ".yuv");
+}
+
+StatusOr<YuvImage> ReadY4m(const std::string& file_path, bool quiet) {
+  ASSIGN_OR_RETURN(const std::string bytes, ReadFile(file_path, quiet));
+  const size_t header_end = bytes.find('\n');
+  CHECK_OR_RETURN(header_end != std::string::npos &&
+                      bytes.compare(0, 10, "YUV4MPEG2 ") == 0,
+                  quiet)
+      << file_path << " is not a YUV4MPEG2 file";
+
+  YuvImage image;
+  std::istringstream header(bytes.substr(10, header_end - 10));
+  std::string token;
+  while (header >> token) {
+    const std::string value = token.substr(1);
+    if (token[0] == 'W') {
+      CHECK_OR_RETURN(ParseUint32(value, image.width), quiet)
+          << "Bad width " << token << " in " << file_path;
+    } else if (token[0] == 'H') {
+      CHECK_OR_RETURN(ParseUint32(value, image.height), quiet)
+          << "Bad height " << token << " in " << file_path;
+    } else if (token[0] == 'C') {
+      if (value == "420" || value == "420jpeg" || value == "420paldv" ||
+          value == "420mpeg2") {
+        image.subsampling = Subsampling::k420;
+      } else if (value == "444") {
+        image.subsampling = Subsampling::k444;
+      } else if (value == "420p10") {
+        image.subsampling = Subsampling::k420;
+        image.bit_depth = 10;
+      } else if (value == "444p10") {
+        image.subsampling = Subsampling::k444;
+        image.bit_depth = 10;
+      } else {
+        CHECK_OR_RETURN(false, quiet)
+            << "Unsupported color space " << token << " in " << file_path;
+      }
+    } else if (token == "XCOLORRANGE=FULL") {
+      image.full_range = true;
+    }
+    // Frame rate, interlacing, pixel aspect ratio and other extensions are
+    // irrelevant for a still image.
+  }
+
+  const size_t frame_header_end = bytes.find('\n', header_end + 1);
+  CHECK_OR_RETURN(frame_header_end != std::string::npos &&
+                      bytes.compare(header_end + 1, 5, "FRAME") == 0,
+                  quiet)
+      << "Missing frame in " << file_path;
+  OK_OR_RETURN(
+      ReadPlanes(bytes, frame_header_end + 1, file_path, image, quiet));
+  return image;
+}
+
+StatusOr<YuvImage> ReadRawYuv(const std::string& file_path, bool quiet) {
+  YuvImage image;
+  std::string stem = std::filesystem::path(file_path).stem().string();
+  std::replace(stem.begin(), stem.end(), '-', '_');
+  std::replace(stem.begin(), stem.end(), '.', '_');
+  std::istringstream tokens(stem);
+  std::string token;
+  while (std::getline(tokens, token, '_')) {
+    const size_t x = token.find('x');
+    if (x != std::string::npos &&
+        ParseUint32(token.substr(0, x), image.width) &&
+        ParseUint32(token.substr(x + 1), image.height)) {
+      continue;
+    }
+    if (token == "444") image.subsampling = Subsampling::k444;
+    if (token == "420") image.subsampling = Subsampling::k420;
+    if (token == "10bit") image.bit_depth = 10;
+    if (token == "full") image.full_range = true;
+  }
+  CHECK_OR_RETURN(image.width > 0 && image.height > 0, quiet)
+      << "Expected {width}x{height} in the file name of " << file_path;
+
+  ASSIGN_OR_RETURN(const std::string bytes, ReadFile(file_path, quiet));
+  OK_OR_RETURN(ReadPlanes(bytes, /*offset=*/0, file_path, image, quiet));
+  return image;
+}
+
+StatusOr<YuvImage> ReadYuvFile(const std::string& file_path, bool quiet) {
+  if (EndsWith(file_path, ".y4m")) return ReadY4m(file_path, quiet);
+  return ReadRawYuv(file_path, quiet);
+}
+
+std::vector<uint16_t> YuvToRgb(const YuvImage& image, uint32_t rgb_bit_depth) {
+  // BT.601 coefficients, as in libavif and libjpeg.
+  constexpr double kR = 0.299, kB = 0.114, kG = 1 - kR - kB;
+  const double max = (1u << image.bit_depth) - 1;
+  const double rgb_max = (1u << rgb_bit_depth) - 1;
+  const double half = 1u << (image.bit_depth - 1);
+  const double scale = 1u << (image.bit_depth - 8);
+  const double y_offset = image.full_range ? 0 : 16 * scale;
+  const double y_range = image.full_range ? max : 219 * scale;
+  const double uv_range = image.full_range ? max : 224 * scale;
+
+  // Chroma samples are centered between 2x2 luma samples (as in JPEG and the
+  // default Y4M C420 siting), so each pixel is at a quarter of the distance
+  // between its nearest chroma sample and the next one in each direction.
+  // That gives the 9/16, 3/16, 3/16 and 1/16 weights of the bilinear filter,
+  // known as the "fancy upsampling" of libjpeg. Borders are replicated.
+  const bool is_420 = image.subsampling == Subsampling::k420;
+  const uint32_t last_uv_x = image.PlaneWidth(1) - 1;
+  const uint32_t last_uv_y = image.PlaneHeight(1) - 1;
+  auto chroma = [&](size_t plane, uint32_t x, uint32_t y) -> double {
+    if (!is_420) return image.Sample(plane, x, y);
+    const uint32_t near_x = x / 2, near_y = y / 2;
+    const uint32_t far_x = SecondNearestChroma(x, last_uv_x);
+    const uint32_t far_y = SecondNearestChroma(y, last_uv_y);
+    return (9.0 * image.Sample(plane, near_x, near_y) +
+            3.0 * image.Sample(plane, far_x, near_y) +
+            3.0 * image.Sample(plane, near_x, far_y) +
+            image.Sample(plane, far_x, far_y)) /
+           16;
+  };
+
+  std::vector<uint16_t> rgb(static_cast<size_t>(image.width) * image.height *
+                            3);
+  size_t i = 0;
+  for (uint32_t y = 0; y < image.height; ++y) {
+    for (uint32_t x = 0; x < image.width; ++x) {
+      const double luma = (image.Sample(0, x, y) - y_offset) / y_range;
+      const double cb = (chroma(1, x, y) - half) / uv_range;
+      const double cr = (chroma(2, x, y) - half) / uv_range;
+      const double r = luma + 2 * (1 - kR) * cr;
+      const double b = luma + 2 * (1 - kB) * cb;
+      const double g = (luma - kR * r - kB * b) / kG;
+      for (const double channel : {r, g, b}) {
+        rgb[i++] = static_cast<uint16_t>(
+            std::lround(std::clamp(channel, 0.0, 1.0) * rgb_max));
+      }
+    }
+  }
+  return rgb;
+}
+
+}  // namespace codec_compare_gen
@@ -0,0 +1,74 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_YUV_H_
+#define SRC_YUV_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "src/base.h"
+
+namespace codec_compare_gen {
+
+// Planar Y'CbCr image with BT.601 matrix coefficients, as found in video frame
+// grabs.
+struct YuvImage {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t bit_depth = 8;                       // 8 or 10.
+  Subsampling subsampling = Subsampling::k420;  // k420 or k444.
+  bool full_range = false;  // Limited (studio swing) range otherwise.
+  // Y, U (Cb) and V (Cr) planes with tightly packed rows. Samples are uint8_t
+  // if bit_depth is 8 and native-endian uint16_t otherwise.
+  std::vector<uint8_t> planes[3];
+  // Time spent computing the planes from RGB samples, 0 if read from a file.
+  double conversion_duration = 0;
+
+  uint32_t PlaneWidth(size_t plane) const;
+  uint32_t PlaneHeight(size_t plane) const;
+  uint32_t BytesPerSample() const { return bit_depth > 8 ? 2 : 1; }
+  uint32_t RowBytes(size_t plane) const {
+    return PlaneWidth(plane) * BytesPerSample();
+  }
+  uint32_t Sample(size_t plane, uint32_t x, uint32_t y) const;
+};
+
+// Returns true if the file_path has a .y4m or .yuv extension.
+bool IsYuvFile(const std::string& file_path);
+
+// Reads the first frame of a YUV4MPEG2 file. Supported color spaces are C420,
+// C420jpeg, C420paldv, C420mpeg2, C444, C420p10 and C444p10. The range is
+// limited unless the XCOLORRANGE=FULL extension is present.
+StatusOr<YuvImage> ReadY4m(const std::string& file_path, bool quiet);
+
+// Reads the first frame of a headerless .yuv file. The dimensions must appear
+// in the file name as in "name_1920x1080.yuv". The file name may contain the
+// "444", "10bit" and "full" tokens separated by '_', '-' or '.' to describe
+// the samples. The default is 8-bit limited-range 4:2:0.
+StatusOr<YuvImage> ReadRawYuv(const std::string& file_path, bool quiet);
+
+// Calls ReadY4m() or ReadRawYuv() depending on the file extension.
+StatusOr<YuvImage> ReadYuvFile(const std::string& file_path, bool quiet);
+
+// Returns the interleaved R, G, B samples of the image, in [0:2^bit_depth-1].
+// 4:2:0 chroma is upsampled with a bilinear filter, assuming centered chroma
+// samples.
+std::vector<uint16_t> YuvToRgb(const YuvImage& image, uint32_t rgb_bit_depth);
+
+}  // namespace codec_compare_gen
+
+#endif  // SRC_YUV_H_
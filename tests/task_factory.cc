@@ -0,0 +1,44 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tests/task_factory.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "src/task.h"
+
+namespace codec_compare_gen {
+
+TaskOutput MakeFakeTaskOutput(const CodecSettings& codec_settings,
+                              const std::string& image_path,
+                              size_t encoded_size, double encoding_duration,
+                              double decoding_duration, float psnr,
+                              uint32_t image_width, uint32_t image_height) {
+  TaskOutput task = {};  // The fields without default value are zeroed.
+  task.task_input.codec_settings = codec_settings;
+  task.task_input.image_path = image_path;
+  task.image_width = image_width;
+  task.image_height = image_height;
+  task.bit_depth = 8;
+  task.num_frames = 1;
+  task.encoded_size = encoded_size;
+  task.encoding_duration = encoding_duration;
+  task.decoding_duration = decoding_duration;
+  task.distortions[0] = psnr;
+  return task;
+}
+
+}  // namespace codec_compare_gen
@@ -0,0 +1,39 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TESTS_TASK_FACTORY_H_
+#define TESTS_TASK_FACTORY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "src/task.h"
+
+namespace codec_compare_gen {
+
+// Returns a completed task of a single-frame 8-bit image, as if evaluated with
+// codec_settings. psnr is the first distortion. Used by the tests that feed
+// TaskOutputs to aggregations without encoding anything.
+TaskOutput MakeFakeTaskOutput(const CodecSettings& codec_settings,
+                              const std::string& image_path,
+                              size_t encoded_size = 0,
+                              double encoding_duration = 0,
+                              double decoding_duration = 0, float psnr = 0,
+                              uint32_t image_width = 8,
+                              uint32_t image_height = 8);
+
+}  // namespace codec_compare_gen
+
+#endif  // TESTS_TASK_FACTORY_H_
@@ -0,0 +1,212 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/bitstream.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace codec_compare_gen {
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+void Append(const Bytes& bytes, Bytes& output) {
+  output.insert(output.end(), bytes.begin(), bytes.end());
+}
+void AppendTag(const std::string& tag, Bytes& output) {
+  output.insert(output.end(), tag.begin(), tag.end());
+}
+void AppendBigEndian(uint32_t value, size_t num_bytes, Bytes& output) {
+  for (size_t i = num_bytes; i > 0; --i) {
+    output.push_back(static_cast<uint8_t>(value >> (8 * (i - 1))));
+  }
+}
+
+Bytes RiffChunk(const std::string& tag, const Bytes& content) {
+  Bytes chunk;
+  AppendTag(tag, chunk);
+  for (size_t i = 0; i < 4; ++i) chunk.push_back(content.size() >> (8 * i));
+  Append(content, chunk);
+  if (content.size() % 2 == 1) chunk.push_back(0);
+  return chunk;
+}
+
+Bytes Webp(const std::vector<Bytes>& chunks) {
+  Bytes content;
+  AppendTag("WEBP", content);
+  for (const Bytes& chunk : chunks) Append(chunk, content);
+  Bytes file = RiffChunk("RIFF", content);
+  return Bytes(file.begin(), file.begin() + 8 + content.size());
+}
+
+Bytes IsoBox(const std::string& type, const Bytes& content) {
+  Bytes box;
+  AppendBigEndian(8 + content.size(), 4, box);
+  AppendTag(type, box);
+  Append(content, box);
+  return box;
+}
+
+BitstreamBreakdown Analyze(const Bytes& bytes) {
+  const BitstreamBreakdown breakdown =
+      AnalyzeBitstream(bytes.data(), bytes.size());
+  EXPECT_EQ(breakdown.header_size + breakdown.metadata_size +
+                breakdown.alpha_size + breakdown.payload_size,
+            bytes.size());
+  return breakdown;
+}
+
+TEST(BitstreamTest, WebpSimple) {
+  const BitstreamBreakdown breakdown =
+      Analyze(Webp({RiffChunk("VP8 ", Bytes(15, 1))}));
+  EXPECT_EQ(breakdown.header_size, 12u + 8u + 10u);
+  EXPECT_EQ(breakdown.metadata_size, 0u);
+  EXPECT_EQ(breakdown.alpha_size, 0u);
+  EXPECT_EQ(breakdown.payload_size, 5u + 1u);  // With padding.
+}
+
+TEST(BitstreamTest, WebpExtended) {
+  const BitstreamBreakdown breakdown = Analyze(Webp(
+      {RiffChunk("VP8X", Bytes(10, 0)), RiffChunk("ICCP", Bytes(4, 1)),
+       RiffChunk("ALPH", Bytes(3, 2)), RiffChunk("VP8L", Bytes(7, 3)),
+       RiffChunk("EXIF", Bytes(2, 4))}));
+  EXPECT_EQ(breakdown.header_size, 12u + 5u * 8u + 10u + 5u);
+  EXPECT_EQ(breakdown.metadata_size, 4u + 2u);
+  EXPECT_EQ(breakdown.alpha_size, 3u + 1u);
+  EXPECT_EQ(breakdown.payload_size, 2u + 1u);
+}
+
+TEST(BitstreamTest, WebpAnimation) {
+  Bytes frame(16, 0);
+  Append(RiffChunk("ALPH", Bytes(2, 1)), frame);
+  Append(RiffChunk("VP8 ", Bytes(12, 2)), frame);
+  const BitstreamBreakdown breakdown =
+      Analyze(Webp({RiffChunk("VP8X", Bytes(10, 0)),
+                    RiffChunk("ANIM", Bytes(6, 0)), RiffChunk("ANMF", frame),
+                    RiffChunk("ANMF", frame)}));
+  EXPECT_EQ(breakdown.header_size,
+            12u + 2u * 8u + 10u + 6u + 2u * (8u + 16u + 8u + 8u + 10u));
+  EXPECT_EQ(breakdown.alpha_size, 2u * 2u);
+  EXPECT_EQ(breakdown.payload_size, 2u * 2u);
+}
+
+TEST(BitstreamTest, WebpTruncated) {
+  Bytes bytes = Webp({RiffChunk("VP8L", Bytes(20, 1))});
+  bytes.resize(bytes.size() - 4);
+  const BitstreamBreakdown breakdown = Analyze(bytes);
+  EXPECT_EQ(breakdown.header_size, 12u);
+  EXPECT_EQ(breakdown.payload_size, bytes.size() - 12u);
+}
+
+TEST(BitstreamTest, Avif) {
+  const Bytes ftyp = IsoBox("ftyp", Bytes(12, 0));
+  const Bytes colr = [] {
+    Bytes content;
+    AppendTag("prof", content);
+    Append(Bytes(10, 5), content);
+    return IsoBox("colr", content);
+  }();
+  // Color item 1, alpha item 2 and Exif item 3, in this order in mdat.
+  const uint32_t item_sizes[] = {10, 4, 6};
+  const auto meta = [&](uint32_t mdat_content_offset) {
+    Bytes iinf = {0, 0, 0, 0, 0, 3};  // Version 0, flags, entry count.
+    for (uint32_t item_id : {1, 2, 3}) {
+      Bytes infe = {2, 0, 0, 0};  // Version 2, flags.
+      AppendBigEndian(item_id, 2, infe);
+      AppendBigEndian(0, 2, infe);  // Protection index.
+      AppendTag(item_id == 3 ? "Exif" : "av01", infe);
+      infe.push_back(0);  // Empty item name.
+      Append(IsoBox("infe", infe), iinf);
+    }
+    Bytes iref = {0, 0, 0, 0};
+    Append(IsoBox("auxl", {0, 2, 0, 1, 0, 1}), iref);  // From 2 to item 1.
+    Bytes iloc = {0, 0, 0, 0, 0x44, 0x00, 0, 3};  // 32-bit offsets, lengths.
+    uint32_t offset = mdat_content_offset;
+    for (uint32_t item_id : {1, 2, 3}) {
+      AppendBigEndian(item_id, 2, iloc);
+      AppendBigEndian(0, 2, iloc);  // Data reference index.
+      AppendBigEndian(1, 2, iloc);  // Extent count.
+      AppendBigEndian(offset, 4, iloc);
+      AppendBigEndian(item_sizes[item_id - 1], 4, iloc);
+      offset += item_sizes[item_id - 1];
+    }
+    Bytes content = {0, 0, 0, 0};
+    Append(IsoBox("hdlr", Bytes(25, 0)), content);
+    Append(IsoBox("iinf", iinf), content);
+    Append(IsoBox("iref", iref), content);
+    Append(IsoBox("iloc", iloc), content);
+    Append(IsoBox("iprp", IsoBox("ipco", colr)), content);
+    return IsoBox("meta", content);
+  };
+  const size_t meta_size = meta(0).size();
+
+  Bytes bytes = ftyp;
+  Append(meta(ftyp.size() + meta_size + 8), bytes);
+  Append(IsoBox("mdat", Bytes(10 + 4 + 6, 7)), bytes);
+  const BitstreamBreakdown breakdown = Analyze(bytes);
+  EXPECT_EQ(breakdown.header_size, ftyp.size() + meta_size - colr.size() + 8);
+  EXPECT_EQ(breakdown.metadata_size, colr.size() + 6u);
+  EXPECT_EQ(breakdown.alpha_size, 4u);
+  EXPECT_EQ(breakdown.payload_size, 10u);
+}
+
+TEST(BitstreamTest, JpegXl) {
+  const BitstreamBreakdown codestream =
+      Analyze({0xFF, 0x0A, 1, 2, 3, 4, 5});
+  EXPECT_EQ(codestream.header_size, 2u);
+  EXPECT_EQ(codestream.payload_size, 5u);
+
+  Bytes bytes = IsoBox("JXL ", {0x0D, 0x0A, 0x87, 0x0A});
+  Append(IsoBox("ftyp", Bytes(12, 0)), bytes);
+  Append(IsoBox("Exif", Bytes(6, 1)), bytes);
+  Append(IsoBox("jxlc", {0xFF, 0x0A, 1, 2, 3, 4, 5, 6, 7, 8}), bytes);
+  const BitstreamBreakdown container = Analyze(bytes);
+  EXPECT_EQ(container.header_size, 12u + 20u + 8u + 8u + 2u);
+  EXPECT_EQ(container.metadata_size, 6u);
+  EXPECT_EQ(container.payload_size, 8u);
+}
+
+TEST(BitstreamTest, Jpeg) {
+  Bytes bytes = {0xFF, 0xD8};
+  Bytes app0 = {0xFF, 0xE0, 0, 16};
+  Append(Bytes(14, 0), app0);
+  Append(app0, bytes);
+  Bytes app1 = {0xFF, 0xE1, 0, 10};
+  Append(Bytes(8, 0), app1);
+  Append(app1, bytes);
+  Append(Bytes{0xFF, 0xDB, 0, 5, 0, 1, 2}, bytes);            // DQT
+  Append(Bytes{0xFF, 0xDA, 0, 8, 1, 1, 0, 0, 63, 0}, bytes);  // SOS
+  // Entropy-coded data with a stuffed byte and a restart marker.
+  Append(Bytes{0x01, 0xFF, 0x00, 0x02, 0xFF, 0xD0, 0x03}, bytes);
+  Append(Bytes{0xFF, 0xD9}, bytes);  // EOI
+  Append(Bytes{0xAB, 0xCD}, bytes);  // Trailing data.
+  const BitstreamBreakdown breakdown = Analyze(bytes);
+  EXPECT_EQ(breakdown.header_size, 2u + 18u + 7u + 10u + 2u);
+  EXPECT_EQ(breakdown.metadata_size, 12u);
+  EXPECT_EQ(breakdown.alpha_size, 0u);
+  EXPECT_EQ(breakdown.payload_size, 7u + 2u);
+}
+
+TEST(BitstreamTest, Unknown) {
+  EXPECT_EQ(Analyze({}).payload_size, 0u);
+  EXPECT_EQ(Analyze({0xF4, 0xFF, 0x6F, 1, 2}).payload_size, 5u);
+  EXPECT_EQ(Analyze({0xFF}).payload_size, 1u);
+}
+
+}  // namespace
+}  // namespace codec_compare_gen
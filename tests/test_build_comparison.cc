@@ -0,0 +1,113 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/build_comparison.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/base.h"
+#include "src/framework.h"
+#include "src/task.h"
+#include "tests/task_factory.h"
+
+namespace codec_compare_gen {
+namespace {
+
+constexpr Codec kAvif = Codec::kAvif;
+constexpr Subsampling k420 = Subsampling::k420;
+
+TaskOutput MakeTaskOutput(const std::string& build, const std::string& image,
+                          int quality, size_t encoded_size,
+                          double encoding_duration, double decoding_duration) {
+  return MakeFakeTaskOutput({kAvif, k420, /*effort=*/6, quality, build},
+                            image, encoded_size, encoding_duration,
+                            decoding_duration, /*psnr=*/30);
+}
+
+TEST(BuildComparisonTest, PairsByImageAndQuality) {
+  const std::vector<TaskOutput> results = {
+      MakeTaskOutput("", "A", 50, 100, 1.0, 0.1),
+      MakeTaskOutput("", "B", 50, 200, 2.0, 0.2),
+      MakeTaskOutput("", "C", 50, 300, 3.0, 0.3),  // No pair.
+      MakeTaskOutput("b.so", "A", 50, 110, 0.5, 0.1),
+      MakeTaskOutput("b.so", "B", 50, 220, 1.0, 0.2),
+      MakeTaskOutput("b.so", "A", 70, 400, 1.0, 0.1)};  // No pair.
+  const auto aggregate = SplitByCodecSettingsAndAggregateByImageAndQuality(
+      results, /*quiet=*/false);
+  ASSERT_EQ(aggregate.status, Status::kOk);
+  ASSERT_EQ(aggregate.value.size(), 2u);
+
+  const auto comparisons = CompareBuilds(aggregate.value, /*quiet=*/false);
+  ASSERT_EQ(comparisons.status, Status::kOk);
+  ASSERT_EQ(comparisons.value.size(), 1u);
+  const BuildComparison& comparison = comparisons.value.front();
+  EXPECT_EQ(comparison.reference_build, "");
+  EXPECT_EQ(comparison.build, "b.so");
+  EXPECT_EQ(comparison.num_pairs, 2u);
+  EXPECT_NEAR(comparison.encoded_size_ratio, 1.1, 1e-9);
+  EXPECT_NEAR(comparison.encoding_duration_ratio, 0.5, 1e-9);
+  EXPECT_NEAR(comparison.decoding_duration_ratio, 1.0, 1e-9);
+  EXPECT_NE(comparison.ToString().find("+10.00%"), std::string::npos);
+}
+
+TEST(BuildComparisonTest, Json) {
+  BuildComparison comparison;
+  comparison.codec_settings = {kAvif, k420, /*effort=*/6, /*quality=*/50};
+  comparison.build = "/path/to/b.so";
+  comparison.num_pairs = 2;
+  comparison.encoded_size_ratio = 1.5;
+  const std::string path =
+      std::filesystem::path(::testing::TempDir()) / "build_comparison.json";
+  ASSERT_EQ(BuildComparisonsToJson({comparison}, path, /*quiet=*/false),
+            Status::kOk);
+  std::stringstream json;
+  json << std::ifstream(path).rdbuf();
+  EXPECT_NE(json.str().find("\"reference_build\": \"linked\""),
+            std::string::npos);
+  EXPECT_NE(json.str().find("\"build\": \"b\""), std::string::npos);
+  EXPECT_NE(json.str().find("\"encoded_size_ratio\": 1.5"), std::string::npos);
+}
+
+TEST(BuildComparisonTest, SingleBuild) {
+  const std::vector<TaskOutput> results = {
+      MakeTaskOutput("a.so", "A", 50, 100, 1.0, 0.1)};
+  const auto aggregate = SplitByCodecSettingsAndAggregateByImageAndQuality(
+      results, /*quiet=*/false);
+  ASSERT_EQ(aggregate.status, Status::kOk);
+  const auto comparisons = CompareBuilds(aggregate.value, /*quiet=*/false);
+  ASSERT_EQ(comparisons.status, Status::kOk);
+  EXPECT_TRUE(comparisons.value.empty());
+}
+
+TEST(BuildComparisonTest, PlanTasksInterleavesBuilds) {
+  ComparisonSettings settings;
+  settings.codec_settings = {{kAvif, k420, /*effort=*/6, /*quality=*/50},
+                             {kAvif, k420, /*effort=*/6, /*quality=*/50, "b"}};
+  settings.num_repetitions = 1;
+  const auto tasks = PlanTasks({"A", "B"}, settings);
+  ASSERT_EQ(tasks.status, Status::kOk);
+  ASSERT_EQ(tasks.value.size(), 8u);
+  for (size_t i = 0; i < tasks.value.size(); ++i) {
+    EXPECT_EQ(tasks.value[i].codec_settings.build, i % 2 == 0 ? "" : "b");
+    EXPECT_EQ(tasks.value[i].image_path, i < 4 ? "A" : "B");
+  }
+}
+
+}  // namespace
+}  // namespace codec_compare_gen
@@ -12,15 +12,25 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <cstdint>
+#include <memory>
 #include <filesystem>
 #include <iostream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "src/base.h"
 #include "src/codec.h"
+#include "src/codec_jpegturbo.h"
+#include "src/codec_webp.h"
+#include "src/frame.h"
 #include "src/framework.h"
+#include "src/rendition.h"
 #include "src/task.h"
+#include "third_party/libwebp2/src/wp2/base.h"
 
 namespace codec_compare_gen {
 namespace {
@@ -30,10 +40,37 @@ const char* data_path = nullptr;
 
 Status EncodeDecodeTest(const TaskInput& input, bool quiet = false) {
   return EncodeDecode(input, /*metric_binary_folder_path=*/"", /*thread_id=*/0,
-                      EncodeMode::kEncode, quiet)
+                      EncodeMode::kEncode, {}, quiet)
       .status;
 }
 
+bool AreEqual(const WP2::Data& a, const WP2::Data& b) {
+  return a.size == b.size && std::equal(a.bytes, a.bytes + a.size, b.bytes);
+}
+
+// Encodes the image with and without its precomputed YUV samples.
+void ExpectSameEncoding(
+    const TaskInput& input, WP2SampleFormat format,
+    StatusOr<WP2::Data> (*encode)(const TaskInput&, const Image&, bool),
+    const ImageConversion& convert) {
+  StatusOr<Image> image =
+      ReadStillImageOrAnimation(input.image_path.c_str(), format,
+                                /*quiet=*/false);
+  ASSERT_EQ(image.status, Status::kOk);
+  const StatusOr<WP2::Data> expected =
+      encode(input, image.value, /*quiet=*/false);
+  ASSERT_EQ(expected.status, Status::kOk);
+
+  const StatusOr<Image> converted = convert(image.value, /*quiet=*/false);
+  ASSERT_EQ(converted.status, Status::kOk);
+  ASSERT_NE(converted.value.front().yuv, nullptr);
+  image.value.front().yuv = converted.value.front().yuv;
+  const StatusOr<WP2::Data> actual =
+      encode(input, image.value, /*quiet=*/false);
+  ASSERT_EQ(actual.status, Status::kOk);
+  EXPECT_TRUE(AreEqual(actual.value, expected.value));
+}
+
 //------------------------------------------------------------------------------
 
 TEST(CodecTest, Empty) {
@@ -101,6 +138,112 @@ TEST(CodecTest, WebPAnimatedLossless) {
   EXPECT_EQ(EncodeDecodeTest(input), Status::kOk);
 }
 
+TEST(CodecTest, WebPFrameDecodingDurations) {
+  TaskInput input;
+  input.codec_settings = {Codec::kWebp, kDef, /*effort=*/4, /*quality=*/25};
+  input.image_path = std::string(data_path) + "anim80x80.gif";
+  for (const DecodeTiming decode_timing :
+       {DecodeTiming::kWarm, DecodeTiming::kSteady}) {
+    EncodeDecodeOptions options;
+    options.decode_timing = decode_timing;
+    const StatusOr<TaskOutput> task =
+        EncodeDecode(input, /*metric_binary_folder_path=*/"", /*thread_id=*/0,
+                     EncodeMode::kEncode, options, /*quiet=*/false);
+    ASSERT_EQ(task.status, Status::kOk);
+    ASSERT_GT(task.value.num_frames, 1u);
+    EXPECT_GT(task.value.first_frame_decoding_duration, 0);
+    EXPECT_GT(task.value.frame_decoding_duration_p50, 0);
+    EXPECT_LE(task.value.frame_decoding_duration_p50,
+              task.value.frame_decoding_duration_p99);
+    EXPECT_LE(task.value.frame_decoding_duration_p99,
+              task.value.frame_decoding_duration_max);
+    EXPECT_LE(task.value.frame_decoding_duration_max,
+              task.value.decoding_duration);
+  }
+
+  // Still images have no frame timings.
+  input.image_path = std::string(data_path) + "gradient32x32.png";
+  const StatusOr<TaskOutput> task =
+      EncodeDecode(input, /*metric_binary_folder_path=*/"", /*thread_id=*/0,
+                   EncodeMode::kEncode, {}, /*quiet=*/false);
+  ASSERT_EQ(task.status, Status::kOk);
+  EXPECT_EQ(task.value.first_frame_decoding_duration, 0);
+  EXPECT_EQ(task.value.frame_decoding_duration_max, 0);
+}
+
+TEST(CodecTest, WebPSharedYuv) {
+  TaskInput input;
+  input.codec_settings = {Codec::kWebp, kDef, /*effort=*/4, /*quality=*/75};
+  input.image_path = std::string(data_path) + "gradient32x32.png";
+  ExpectSameEncoding(input, WebPPictureFormat(), &EncodeWebp, &WebpSharpYuv);
+
+  // The conversion is shared by all qualities.
+  RenditionCache cache(/*capacity=*/4);
+  EncodeDecodeOptions options;
+  options.rendition_cache = &cache;
+  for (const int quality : {0, 50, 100}) {
+    input.codec_settings.quality = quality;
+    const StatusOr<TaskOutput> task =
+        EncodeDecode(input, /*metric_binary_folder_path=*/"", /*thread_id=*/0,
+                     EncodeMode::kEncode, options, /*quiet=*/false);
+    ASSERT_EQ(task.status, Status::kOk);
+    EXPECT_GE(task.value.encoding_duration,
+              task.value.encoding_color_conversion_duration);
+  }
+  EXPECT_EQ(cache.num_conversions(), 1u);
+}
+
+TEST(CodecTest, WebPSharedYuvMoreImagesThanCacheCapacity) {
+  std::vector<std::string> image_paths;
+  for (int i = 0; i < 3; ++i) {
+    image_paths.push_back(std::filesystem::path(::testing::TempDir()) /
+                          ("shared_yuv" + std::to_string(i) + ".png"));
+    std::filesystem::copy_file(
+        std::string(data_path) + "gradient32x32.png", image_paths.back(),
+        std::filesystem::copy_options::overwrite_existing);
+  }
+  ComparisonSettings settings;
+  for (const int quality : {0, 50, 100}) {
+    settings.codec_settings.push_back(
+        {Codec::kWebp, kDef, /*effort=*/4, quality});
+  }
+  const StatusOr<std::vector<TaskInput>> tasks =
+      PlanTasks(image_paths, settings);
+  ASSERT_EQ(tasks.status, Status::kOk);
+
+  // Room for one original image and its conversion.
+  RenditionCache cache(/*capacity=*/2);
+  EncodeDecodeOptions options;
+  options.rendition_cache = &cache;
+  for (const TaskInput& input : tasks.value) {
+    ASSERT_EQ(EncodeDecode(input, /*metric_binary_folder_path=*/"",
+                           /*thread_id=*/0, EncodeMode::kEncode, options,
+                           /*quiet=*/false)
+                  .status,
+              Status::kOk);
+  }
+  EXPECT_EQ(cache.num_decodings(), image_paths.size());
+  EXPECT_EQ(cache.num_conversions(), image_paths.size());
+}
+
+TEST(CodecTest, WebPWithoutDistortions) {
+  TaskInput input;
+  input.codec_settings = {Codec::kWebp, kDef, /*effort=*/4, /*quality=*/25};
+  input.image_path = std::string(data_path) + "gradient32x32.png";
+  EncodeDecodeOptions options;
+  options.compute_distortions = false;
+  const StatusOr<TaskOutput> task =
+      EncodeDecode(input, /*metric_binary_folder_path=*/"", /*thread_id=*/0,
+                   EncodeMode::kEncode, options, /*quiet=*/false);
+  ASSERT_EQ(task.status, Status::kOk);
+  EXPECT_GT(task.value.encoded_size, 0u);
+  EXPECT_GT(task.value.decoding_duration, 0);
+  for (const float distortion : task.value.distortions) {
+    EXPECT_EQ(distortion, 0.f);
+  }
+  EXPECT_FALSE(task.value.approximate_distortions);
+}
+
 //------------------------------------------------------------------------------
 
 TEST(CodecTest, WebP2MinEffort) {
@@ -226,6 +369,33 @@ TEST(CodecTest, AvifLossless) {
   EXPECT_EQ(EncodeDecodeTest(input), Status::kOk);
 }
 
+TEST(CodecTest, AvifLosslessHighBitDepth) {
+  TaskInput input;
+  input.codec_settings = {Codec::kAvif, kDef, /*effort=*/9, kQualityLossless};
+  // 10-bit samples are encoded as YCgCo-Re, 12-bit samples as RGB.
+  for (const char* file_name :
+       {"gradient32x32_10bits.png", "gradient32x32_12bits.png"}) {
+    input.image_path = std::string(data_path) + file_name;
+    const StatusOr<TaskOutput> task =
+        EncodeDecode(input, "", 0, EncodeMode::kEncode, {}, /*quiet=*/false);
+    ASSERT_EQ(task.status, Status::kOk);
+    EXPECT_EQ(task.value.image_width, 32u);  // Not twice as wide.
+    EXPECT_EQ(task.value.bit_depth, 16u);
+  }
+}
+
+TEST(CodecTest, AvifY4m) {
+  TaskInput input;
+  input.codec_settings = {Codec::kAvif, kDef, /*effort=*/6, /*quality=*/75};
+  input.image_path = std::string(data_path) + "gradient16x16.y4m";
+  EXPECT_EQ(EncodeDecodeTest(input), Status::kOk);
+  // The 4:2:0 samples are converted to RGB first in that case.
+  input.codec_settings.chroma_subsampling = Subsampling::k444;
+  EXPECT_EQ(EncodeDecodeTest(input), Status::kOk);
+  input.codec_settings.quality = kQualityLossless;
+  EXPECT_EQ(EncodeDecodeTest(input), Status::kOk);
+}
+
 TEST(CodecTest, AvifAnimatedLossy) {
   TaskInput input;
   input.codec_settings = {Codec::kAvif, kDef, /*effort=*/6, /*quality=*/75};
@@ -321,6 +491,39 @@ TEST(CodecTest, JpegturboMaxQuality) {
   EXPECT_EQ(EncodeDecodeTest(input), Status::kOk);
 }
 
+TEST(CodecTest, JpegturboLossless) {
+  if (!JpegturboSupportsLossless()) GTEST_SKIP();
+  TaskInput input;
+  input.codec_settings = {Codec::kJpegturbo, kDef, /*effort=*/0,
+                          kQualityLossless};
+  for (const char* file_name :
+       {"gradient32x32.png", "gradient32x32_16bits.png"}) {
+    input.image_path = std::string(data_path) + file_name;
+    EXPECT_EQ(EncodeDecodeTest(input), Status::kOk);
+  }
+}
+
+TEST(CodecTest, JpegturboRawYuv) {
+  TaskInput input;
+  input.codec_settings = {Codec::kJpegturbo, Subsampling::k444, /*effort=*/0,
+                          /*quality=*/90};
+  input.image_path = std::string(data_path) + "gradient_16x16_444_full.yuv";
+  EXPECT_EQ(EncodeDecodeTest(input), Status::kOk);
+}
+
+TEST(CodecTest, JpegturboSharedYuv) {
+  TaskInput input;
+  input.image_path = std::string(data_path) + "gradient32x32.png";
+  for (const Subsampling subsampling : {Subsampling::k420, Subsampling::k444}) {
+    input.codec_settings = {Codec::kJpegturbo, subsampling, /*effort=*/0,
+                            /*quality=*/80};
+    ExpectSameEncoding(input, WP2_RGB_24, &EncodeJpegturbo,
+                       [subsampling](const Image& image, bool quiet) {
+                         return JpegturboYuv(image, subsampling, quiet);
+                       });
+  }
+}
+
 TEST(CodecTest, JpegturboAlphaAnimated) {
   TaskInput input;
   input.codec_settings = {Codec::kJpegturbo, kDef, /*effort=*/0,
@@ -392,11 +595,78 @@ TEST(CodecTest, EncodeToDiskAndLoadFromDisk) {
   input.image_path = std::string(data_path) + "alpha1x17.png";
   input.encoded_path =
       std::filesystem::path(::testing::TempDir()) / "alpha1x17_webp_e2q95.webp";
-  EXPECT_EQ(EncodeDecode(input, "", 0, EncodeMode::kEncodeAndSaveToDisk, false)
-                .status,
-            Status::kOk);
-  EXPECT_EQ(EncodeDecode(input, "", 0, EncodeMode::kLoadFromDisk, false).status,
-            Status::kOk);
+  EXPECT_EQ(
+      EncodeDecode(input, "", 0, EncodeMode::kEncodeAndSaveToDisk, {}, false)
+          .status,
+      Status::kOk);
+  EXPECT_EQ(
+      EncodeDecode(input, "", 0, EncodeMode::kLoadFromDisk, {}, false).status,
+      Status::kOk);
+}
+
+TEST(CodecTest, DecodeTimings) {
+  TaskInput input;
+  input.codec_settings = {Codec::kWebp, kDef, /*effort=*/2, /*quality=*/95};
+  input.image_path = std::string(data_path) + "gradient32x32.png";
+  for (DecodeTiming decode_timing :
+       {DecodeTiming::kWarm, DecodeTiming::kCold, DecodeTiming::kSteady}) {
+    EncodeDecodeOptions options;
+    options.decode_timing = decode_timing;
+    const StatusOr<TaskOutput> task =
+        EncodeDecode(input, "", 0, EncodeMode::kEncode, options, false);
+    ASSERT_EQ(task.status, Status::kOk);
+    EXPECT_EQ(task.value.decode_timing, decode_timing);
+    EXPECT_GT(task.value.decoding_duration, 0);
+  }
+}
+
+TEST(CodecTest, SignificantBitDepth) {
+  for (const auto& [file_name, bit_depth] :
+       std::vector<std::pair<const char*, uint32_t>>{
+           {"gradient32x32.png", 8},
+           {"alpha32x32_8bits_in_16bits.png", 8},
+           {"gradient32x32_10bits.png", 10},
+           {"gradient32x32_12bits.png", 12},
+           {"gradient32x32_16bits.png", 16}}) {
+    const StatusOr<Image> image = ReadStillImageOrAnimation(
+        (std::string(data_path) + file_name).c_str(), WP2_ARGB_32,
+        /*quiet=*/false);
+    ASSERT_EQ(image.status, Status::kOk);
+    EXPECT_EQ(GetSignificantBitDepth(image.value), bit_depth) << file_name;
+  }
+
+  // 8-bit samples stored as 16-bit ones are encoded as 8-bit frames, but the
+  // task records the bit depth of the source.
+  TaskInput input;
+  input.codec_settings = {Codec::kWebp, kDef, /*effort=*/0, kQualityLossless};
+  input.image_path = std::string(data_path) + "alpha32x32_8bits_in_16bits.png";
+  const StatusOr<TaskOutput> task =
+      EncodeDecode(input, "", 0, EncodeMode::kEncode, {}, /*quiet=*/false);
+  ASSERT_EQ(task.status, Status::kOk);
+  EXPECT_EQ(task.value.image_width, 32u);
+  EXPECT_EQ(task.value.bit_depth, 16u);
+}
+
+TEST(CodecTest, Renditions) {
+  RenditionCache rendition_cache(/*capacity=*/4);
+  EncodeDecodeOptions options;
+  options.rendition_cache = &rendition_cache;
+  TaskInput input;
+  input.image_path = std::string(data_path) + "anim80x80.gif";
+  for (const int quality : {kQualityLossless, 75}) {
+    input.codec_settings = {Codec::kWebp, kDef, /*effort=*/2, quality};
+    for (const uint32_t rendition_width : {0u, 40u, 160u}) {
+      input.rendition_width = rendition_width;
+      const StatusOr<TaskOutput> task =
+          EncodeDecode(input, "", 0, EncodeMode::kEncode, options, false);
+      ASSERT_EQ(task.status, Status::kOk);
+      // Renditions are never upscaled.
+      EXPECT_EQ(task.value.image_width, rendition_width == 40 ? 40u : 80u);
+      EXPECT_EQ(task.value.image_height, rendition_width == 40 ? 40u : 80u);
+    }
+  }
+  EXPECT_EQ(rendition_cache.num_decodings(), 1u);
+  EXPECT_EQ(rendition_cache.num_downscalings(), 1u);
 }
 
 TEST(CodecTest, EncodeToDiskAndLoadFromDiskAnimated) {
@@ -405,11 +675,13 @@ TEST(CodecTest, EncodeToDiskAndLoadFromDiskAnimated) {
   input.image_path = std::string(data_path) + "anim80x80.gif";
   input.encoded_path =
       std::filesystem::path(::testing::TempDir()) / "anim80x80_webp_e2q95.webp";
-  EXPECT_EQ(EncodeDecode(input, "", 0, EncodeMode::kEncodeAndSaveToDisk, false)
-                .status,
-            Status::kOk);
-  EXPECT_EQ(EncodeDecode(input, "", 0, EncodeMode::kLoadFromDisk, false).status,
-            Status::kOk);
+  EXPECT_EQ(
+      EncodeDecode(input, "", 0, EncodeMode::kEncodeAndSaveToDisk, {}, false)
+          .status,
+      Status::kOk);
+  EXPECT_EQ(
+      EncodeDecode(input, "", 0, EncodeMode::kLoadFromDisk, {}, false).status,
+      Status::kOk);
 }
 
 //------------------------------------------------------------------------------
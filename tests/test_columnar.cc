@@ -0,0 +1,151 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/columnar.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/base.h"
+#include "src/task.h"
+
+namespace codec_compare_gen {
+namespace {
+
+std::vector<TaskOutput> MakeTaskOutputs(size_t num_tasks) {
+  std::vector<TaskOutput> tasks;
+  for (size_t i = 0; i < num_tasks; ++i) {
+    TaskOutput task = {
+        {{Codec::kAvif, Subsampling::k420, /*effort=*/6,
+          static_cast<int>(i % 64), i % 2 ? "path/to/build.so" : ""},
+         "image" + std::to_string(i % 7) + ".png",
+         "encoded" + std::to_string(i) + ".avif",
+         /*rendition_width=*/i % 3 ? 320u : 0u},
+        /*image_width=*/static_cast<uint32_t>(100 + i),
+        /*image_height=*/50,
+        /*bit_depth=*/8,
+        /*num_frames=*/1,
+        /*encoded_size=*/1000 + i,
+        /*encoding_duration=*/0.5 * i,
+        /*decoding_duration=*/0.25,
+        /*decoding_color_conversion_duration=*/0.125,
+        {30, 0.9f, 0.01f, 1.5f, 0.02f, 80.5f, 0.7f}};
+    task.simd_level = SimdLevel::kSse4;
+    task.decode_timing = DecodeTiming::kCold;
+    task.encoding_color_conversion_duration = i % 2 ? 0.0625 : 0;
+    task.header_size = 20 + i % 3;
+    task.metadata_size = i % 2 ? 0 : 100;
+    task.task_duration = i % 3 ? 0.75 * i : 0;
+    if (i % 5 == 0) {
+      task.num_frames = 4;
+      task.first_frame_decoding_duration = 0.125;
+      task.frame_decoding_duration_p50 = 0.03125;
+      task.frame_decoding_duration_p99 = task.frame_decoding_duration_max =
+          0.0625;
+    }
+    if (i % 4 == 0) {
+      task.approximate_distortions = true;
+      task.distortion_errors[0] = 0.25f;
+      task.distortion_errors[5] = 1.5f;
+    }
+    if (i % 6 == 0) {
+      task.system_conditions = {/*sampled=*/true,
+                                /*cpu_frequency_ratio=*/0.75f,
+                                /*run_queue_length=*/3,
+                                /*cpu_pressure=*/1.25f,
+                                /*memory_pressure=*/0,
+                                /*num_thermal_throttles=*/i % 4 == 0 ? 1u : 0u,
+                                /*abnormal=*/i % 4 == 0};
+    }
+    tasks.push_back(task);
+  }
+  return tasks;
+}
+
+TEST(ColumnarTest, RoundTrip) {
+  const std::vector<TaskOutput> tasks = MakeTaskOutputs(1001);
+  const std::string path =
+      std::filesystem::path(::testing::TempDir()) / "tasks.ccgencol";
+  ASSERT_EQ(TasksToColumnarFile(tasks, path, /*quiet=*/false), Status::kOk);
+
+  StatusOr<ColumnarResults> results =
+      ColumnarResults::Open(path, /*quiet=*/false);
+  ASSERT_EQ(results.status, Status::kOk);
+  EXPECT_EQ(results.value.num_rows(), tasks.size());
+  EXPECT_EQ(results.value.num_strings(), 7u + 2u);  // Images and builds.
+
+  const StatusOr<const uint64_t*> sizes =
+      results.value.Column<uint64_t>("encoded_size", /*quiet=*/false);
+  ASSERT_EQ(sizes.status, Status::kOk);
+  uint64_t sum = 0;
+  for (size_t i = 0; i < results.value.num_rows(); ++i) sum += sizes.value[i];
+  EXPECT_EQ(sum, 1000u * 1001u + 1000u * 1001u / 2u);
+  const StatusOr<const uint32_t*> images =
+      results.value.Column<uint32_t>("image", /*quiet=*/false);
+  ASSERT_EQ(images.status, Status::kOk);
+  EXPECT_EQ(results.value.String(images.value[3]), "image3.png");
+
+  // Wrong type or name.
+  EXPECT_NE(results.value.Column<float>("encoded_size", /*quiet=*/true).status,
+            Status::kOk);
+  EXPECT_NE(results.value.Column<float>("psnr2", /*quiet=*/true).status,
+            Status::kOk);
+  for (const std::string& name : ColumnarColumnNames()) {
+    EXPECT_LT(name.size(), 32u);
+  }
+
+  const StatusOr<std::vector<TaskOutput>> round_trip =
+      results.value.ToTaskOutputs(/*quiet=*/false);
+  ASSERT_EQ(round_trip.status, Status::kOk);
+  ASSERT_EQ(round_trip.value.size(), tasks.size());
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    TaskOutput expected = tasks[i];
+    expected.task_input.encoded_path.clear();
+    EXPECT_EQ(round_trip.value[i].Serialize(), expected.Serialize());
+  }
+}
+
+TEST(ColumnarTest, Empty) {
+  const std::string path =
+      std::filesystem::path(::testing::TempDir()) / "empty.ccgencol";
+  ASSERT_EQ(TasksToColumnarFile({}, path, /*quiet=*/false), Status::kOk);
+  StatusOr<ColumnarResults> results =
+      ColumnarResults::Open(path, /*quiet=*/false);
+  ASSERT_EQ(results.status, Status::kOk);
+  EXPECT_EQ(results.value.num_rows(), 0u);
+  EXPECT_EQ(results.value.ToTaskOutputs(/*quiet=*/false).status, Status::kOk);
+}
+
+TEST(ColumnarTest, BadFile) {
+  const std::string path =
+      std::filesystem::path(::testing::TempDir()) / "bad.ccgencol";
+  EXPECT_NE(ColumnarResults::Open(path + "_missing", /*quiet=*/true).status,
+            Status::kOk);
+
+  ASSERT_EQ(TasksToColumnarFile(MakeTaskOutputs(10), path, /*quiet=*/false),
+            Status::kOk);
+  const std::uintmax_t size = std::filesystem::file_size(path);
+  std::filesystem::resize_file(path, size / 2);
+  EXPECT_NE(ColumnarResults::Open(path, /*quiet=*/true).status, Status::kOk);
+
+  std::ofstream(path, std::ios::trunc) << std::string(100, 'x');
+  EXPECT_NE(ColumnarResults::Open(path, /*quiet=*/true).status, Status::kOk);
+}
+
+}  // namespace
+}  // namespace codec_compare_gen
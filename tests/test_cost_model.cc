@@ -0,0 +1,160 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "src/cost_model.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/base.h"
+#include "src/framework.h"
+#include "src/image_info.h"
+#include "src/task.h"
+#include "tests/task_factory.h"
+
+namespace codec_compare_gen {
+namespace {
+
+TaskOutput MakeTaskOutput(const CodecSettings& settings, uint32_t width,
+                          uint32_t height, double encoding_duration,
+                          size_t encoded_size) {
+  return MakeFakeTaskOutput(settings, /*image_path=*/"", encoded_size,
+                            encoding_duration,
+                            /*decoding_duration=*/encoding_duration / 10,
+                            /*psnr=*/0, width, height);
+}
+
+const CodecSettings kWebpQ50 = {Codec::kWebp, Subsampling::k420,
+                                /*effort=*/4, /*quality=*/50};
+const CodecSettings kWebpQ90 = {Codec::kWebp, Subsampling::k420,
+                                /*effort=*/4, /*quality=*/90};
+const CodecSettings kWebpE6 = {Codec::kWebp, Subsampling::k420,
+                               /*effort=*/6, /*quality=*/50};
+const CodecSettings kJxl = {Codec::kJpegXl, Subsampling::k444,
+                            /*effort=*/7, /*quality=*/50};
+
+TEST(CostModelTest, Predict) {
+  const CostModel model({MakeTaskOutput(kWebpQ50, 100, 100, 1, 1000),
+                         MakeTaskOutput(kWebpQ50, 100, 300, 3, 5000),
+                         MakeTaskOutput(kWebpQ90, 100, 100, 2, 3000)});
+  EXPECT_EQ(model.num_tasks(), 3u);
+
+  TaskCost cost = model.Predict(kWebpQ50, 20000);
+  EXPECT_EQ(cost.calibration, CostCalibration::kSettings);
+  EXPECT_DOUBLE_EQ(cost.encoding_duration, 2);
+  EXPECT_DOUBLE_EQ(cost.decoding_duration, 0.2);
+  EXPECT_DOUBLE_EQ(cost.encoded_size, 3000);
+
+  cost = model.Predict({Codec::kWebp, Subsampling::k420, 4, 75}, 50000);
+  EXPECT_EQ(cost.calibration, CostCalibration::kEffort);
+  EXPECT_DOUBLE_EQ(cost.encoding_duration, 6);
+
+  cost = model.Predict(kWebpE6, 10000);
+  EXPECT_EQ(cost.calibration, CostCalibration::kCodec);
+  EXPECT_DOUBLE_EQ(cost.encoded_size, 1800);
+
+  // Lossless tasks are not predicted from lossy ones.
+  cost = model.Predict({Codec::kWebp, Subsampling::k444, 4, kQualityLossless},
+                       10000);
+  EXPECT_EQ(cost.calibration, CostCalibration::kNone);
+  EXPECT_EQ(model.Predict(kJxl, 10000).calibration, CostCalibration::kNone);
+}
+
+TEST(CostModelTest, EstimateRun) {
+  const CostModel model({MakeTaskOutput(kWebpQ50, 100, 100, 1, 1000),
+                         MakeTaskOutput(kWebpE6, 100, 100, 4, 2000)});
+  std::unordered_map<std::string, ImageInfo> images;
+  images["a.png"].width = 200;
+  images["a.png"].height = 100;
+  images["a.png"].bit_depth = 8;
+  images["b.gif"].width = 100;
+  images["b.gif"].height = 100;
+  images["b.gif"].bit_depth = 8;
+  images["b.gif"].num_frames = 3;
+  images["unknown.png"];
+
+  ComparisonSettings settings;
+  settings.num_extra_threads = 1;
+  settings.image_cache_size = 1;
+  const std::vector<TaskInput> tasks = {
+      {kWebpQ50, "a.png", "out/a_q50.webp"},
+      {kWebpQ50, "a.png", "out/a_q50.webp"},  // Repetition.
+      {kWebpQ50, "b.gif", "out/b_q50.webp"},
+      {kWebpQ50, "unknown.png", "out/unknown_q50.webp"},
+      {kWebpE6, "a.png", "out/a_e6.webp", /*rendition_width=*/100},
+      {kJxl, "a.png", "out/a.jxl"}};
+  const RunEstimate estimate =
+      EstimateRun(tasks, /*num_planned_tasks=*/10, images, model, settings);
+  EXPECT_EQ(estimate.num_planned_tasks, 10u);
+  EXPECT_EQ(estimate.num_remaining_tasks, 6u);
+  ASSERT_EQ(estimate.batches.size(), 3u);
+  EXPECT_EQ(estimate.batches[0].batch_name, "webp_420_4");
+  EXPECT_EQ(estimate.batches[0].num_tasks, 4u);
+  EXPECT_EQ(estimate.batches[0].num_unpredicted_tasks, 1u);
+  EXPECT_EQ(estimate.batches[0].calibration, CostCalibration::kSettings);
+  // 2 + 2 + 3 seconds of encoding, a tenth of that of decoding.
+  EXPECT_DOUBLE_EQ(estimate.batches[0].cpu_duration, 7 * 1.1);
+  EXPECT_DOUBLE_EQ(estimate.batches[0].encoded_size, 7000);
+  // The rendition is 100x50 pixels.
+  EXPECT_EQ(estimate.batches[1].batch_name, "webp_420_6_100w");
+  EXPECT_DOUBLE_EQ(estimate.batches[1].cpu_duration, 2 * 1.1);
+  EXPECT_EQ(estimate.batches[2].calibration, CostCalibration::kNone);
+  EXPECT_EQ(estimate.num_unpredicted_tasks, 2u);
+
+  EXPECT_DOUBLE_EQ(estimate.cpu_duration, 9 * 1.1);
+  EXPECT_DOUBLE_EQ(estimate.wall_duration, 9 * 1.1 / 2);
+  EXPECT_DOUBLE_EQ(estimate.disk_size, 2000 + 3000 + 1000);
+  EXPECT_DOUBLE_EQ(estimate.memory_per_worker, 3 * 30000 * 4 + 3000);
+  EXPECT_DOUBLE_EQ(estimate.shared_memory, 30000 * 4);
+  EXPECT_NE(estimate.ToString().find("webp_420_6_100w: 1 tasks"),
+            std::string::npos);
+
+  // Steady decode timing decodes each bitstream 9 times. A single thread
+  // cannot be faster than the longest task.
+  settings.decode_timing = DecodeTiming::kSteady;
+  settings.num_extra_threads = 100;
+  const RunEstimate steady =
+      EstimateRun({tasks[2]}, /*num_planned_tasks=*/1, images, model, settings);
+  EXPECT_DOUBLE_EQ(steady.cpu_duration, 3 * 1.9);
+  EXPECT_DOUBLE_EQ(steady.wall_duration, 3 * 1.9);
+}
+
+TEST(CostModelTest, TaskDuration) {
+  TaskOutput timed = MakeTaskOutput(kWebpQ50, 100, 100, 1, 1000);
+  timed.task_duration = 4;  // Also reading the image, computing distortions.
+  const CostModel model({timed, MakeTaskOutput(kWebpQ50, 100, 100, 1, 1000),
+                         MakeTaskOutput(kWebpE6, 100, 100, 2, 2000)});
+  EXPECT_DOUBLE_EQ(model.Predict(kWebpQ50, 20000).task_duration, 8);
+  EXPECT_EQ(model.Predict(kWebpE6, 20000).task_duration, 0);
+
+  std::unordered_map<std::string, ImageInfo> images;
+  images["a.png"].width = 100;
+  images["a.png"].height = 100;
+  images["a.png"].bit_depth = 8;
+  ComparisonSettings settings;
+  settings.num_extra_threads = 0;
+  const RunEstimate estimate =
+      EstimateRun({{kWebpQ50, "a.png", ""}, {kWebpE6, "a.png", ""}},
+                  /*num_planned_tasks=*/2, images, model, settings);
+  // Only encodings and decodings are CPU time.
+  EXPECT_DOUBLE_EQ(estimate.cpu_duration, 1.1 + 2 * 1.1);
+  EXPECT_DOUBLE_EQ(estimate.wall_duration, 4 + 2 * 1.1);
+  EXPECT_EQ(estimate.num_tasks_without_task_duration, 1u);
+}
+
+}  // namespace
+}  // namespace codec_compare_gen
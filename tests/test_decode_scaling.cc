@@ -0,0 +1,107 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/decode_scaling.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/base.h"
+#include "src/codec.h"
+#include "src/framework.h"
+#include "src/stats.h"
+#include "src/task.h"
+
+namespace codec_compare_gen {
+namespace {
+
+// Used to pass the data folder path to the GoogleTest suites.
+const char* data_path = nullptr;
+
+TEST(DecodeScalingTest, Percentile) {
+  EXPECT_EQ(Percentile({}, 0.5), 0);
+  EXPECT_EQ(Percentile({1, 2, 3, 4}, 0), 1);
+  EXPECT_EQ(Percentile({1, 2, 3, 4}, 0.5), 2);
+  EXPECT_EQ(Percentile({1, 2, 3, 4}, 0.51), 3);
+  EXPECT_EQ(Percentile({1, 2, 3, 4}, 1), 4);
+}
+
+TEST(DecodeScalingTest, ThreadCounts) {
+  EXPECT_EQ(DecodeScalingThreadCounts(0), std::vector<size_t>({1}));
+  EXPECT_EQ(DecodeScalingThreadCounts(1), std::vector<size_t>({1}));
+  EXPECT_EQ(DecodeScalingThreadCounts(4), std::vector<size_t>({1, 2, 4}));
+  EXPECT_EQ(DecodeScalingThreadCounts(6), std::vector<size_t>({1, 2, 4, 6}));
+}
+
+TEST(DecodeScalingTest, Measure) {
+  std::vector<TaskOutput> tasks;
+  for (int quality : {50, 90}) {
+    TaskInput input;
+    input.codec_settings = {Codec::kWebp, Subsampling::k420, /*effort=*/2,
+                            quality};
+    input.image_path = std::string(data_path) + "gradient32x32.png";
+    input.encoded_path =
+        std::filesystem::path(::testing::TempDir()) /
+        ("gradient32x32_q" + std::to_string(quality) + ".webp");
+    StatusOr<TaskOutput> task =
+        EncodeDecode(input, "", 0, EncodeMode::kEncodeAndSaveToDisk, {},
+                     /*quiet=*/false);
+    ASSERT_EQ(task.status, Status::kOk);
+    tasks.push_back(task.value);
+    tasks.push_back(task.value);  // Repetitions are decoded once per pass.
+  }
+
+  DecodeScalingSettings settings;
+  settings.thread_counts = {1, 3};
+  settings.num_passes = 2;
+  const StatusOr<std::vector<DecodeScaling>> results =
+      MeasureDecodeScaling(tasks, settings, /*quiet=*/false);
+  ASSERT_EQ(results.status, Status::kOk);
+  ASSERT_EQ(results.value.size(), 1u);
+  const DecodeScaling& scaling = results.value.front();
+  EXPECT_EQ(scaling.batch_name, "webp_420_2");
+  EXPECT_EQ(scaling.num_bitstreams, 2u);
+  ASSERT_EQ(scaling.points.size(), 2u);
+  EXPECT_EQ(scaling.points[0].num_decodings, 2u * 1u * 2u);
+  EXPECT_EQ(scaling.points[1].num_threads, 3u);
+  EXPECT_EQ(scaling.points[1].num_decodings, 2u * 3u * 2u);
+  for (const DecodeScalingPoint& point : scaling.points) {
+    EXPECT_GT(point.images_per_second, 0);
+    EXPECT_LE(point.latency_p50, point.latency_p90);
+    EXPECT_LE(point.latency_p90, point.latency_p99);
+  }
+
+  tasks.back().task_input.encoded_path.clear();
+  EXPECT_NE(MeasureDecodeScaling(tasks, settings, /*quiet=*/true).status,
+            Status::kOk);
+}
+
+}  // namespace
+}  // namespace codec_compare_gen
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  if (argc != 2) {
+    std::cerr << "There must be exactly one argument containing the path to "
+                 "the test data folder"
+              << std::endl;
+    return 1;
+  }
+  codec_compare_gen::data_path = argv[1];
+  return RUN_ALL_TESTS();
+}
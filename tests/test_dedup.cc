@@ -0,0 +1,184 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/dedup.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/base.h"
+#include "src/frame.h"
+#include "src/serialization.h"
+#include "src/task.h"
+#include "third_party/libwebp2/src/wp2/base.h"
+
+namespace codec_compare_gen {
+namespace {
+
+// Used to pass the data folder path to the GoogleTest suites.
+const char* data_path = nullptr;
+
+std::string TempPath(const std::string& file_name) {
+  return std::filesystem::path(::testing::TempDir()) / file_name;
+}
+
+using Groups = std::vector<std::vector<std::string>>;
+
+TEST(DedupTest, Bytes) {
+  const std::string gradient = std::string(data_path) + "gradient32x32.png";
+  const std::string alpha = std::string(data_path) + "alpha1x17.png";
+  const std::string copy = TempPath("copy.png");
+  std::filesystem::copy_file(
+      gradient, copy, std::filesystem::copy_options::overwrite_existing);
+
+  for (const size_t num_threads : {1, 3}) {
+    const StatusOr<Groups> groups =
+        GroupDuplicates({gradient, alpha, copy, "missing.png", "missing.png"},
+                        DedupMode::kBytes, num_threads,
+                        /*cache_file_path=*/"", /*quiet=*/false);
+    ASSERT_EQ(groups.status, Status::kOk);
+    EXPECT_EQ(groups.value, Groups({{gradient, copy},
+                                    {alpha},
+                                    {"missing.png"},
+                                    {"missing.png"}}));
+  }
+  EXPECT_NE(GroupDuplicates({gradient}, DedupMode::kNone, 1,
+                            /*cache_file_path=*/"", /*quiet=*/true)
+                .status,
+            Status::kOk);
+}
+
+TEST(DedupTest, Pixels) {
+  const std::string gradient = std::string(data_path) + "gradient32x32.png";
+  const StatusOr<Image> image = ReadStillImageOrAnimation(
+      gradient.c_str(), WP2_ARGB_32, /*quiet=*/false);
+  ASSERT_EQ(image.status, Status::kOk);
+  // Same pixels in a differently encoded file.
+  const std::string reencoded = TempPath("reencoded.png");
+  ASSERT_EQ(WriteStillImageOrAnimation(image.value, reencoded.c_str(),
+                                       /*quiet=*/false),
+            Status::kOk);
+  const std::string other = std::string(data_path) + "alpha1x17.png";
+
+  const StatusOr<Groups> groups =
+      GroupDuplicates({other, gradient, reencoded}, DedupMode::kPixels,
+                      /*num_threads=*/2, /*cache_file_path=*/"",
+                      /*quiet=*/false);
+  ASSERT_EQ(groups.status, Status::kOk);
+  EXPECT_EQ(groups.value, Groups({{other}, {gradient, reencoded}}));
+}
+
+TEST(DedupTest, Cache) {
+  const std::string gradient = TempPath("cached_gradient.png");
+  const std::string copy = TempPath("cached_copy.png");
+  const std::string other = TempPath("cached_other.png");
+  const auto overwrite = std::filesystem::copy_options::overwrite_existing;
+  std::filesystem::copy_file(std::string(data_path) + "gradient32x32.png",
+                             gradient, overwrite);
+  std::filesystem::copy_file(gradient, copy, overwrite);
+  std::filesystem::copy_file(std::string(data_path) + "alpha1x17.png", other,
+                             overwrite);
+  const std::string cache_path = TempPath("dedup_cache");
+  std::filesystem::remove(cache_path);
+
+  StatusOr<Groups> groups =
+      GroupDuplicates({gradient, other, copy}, DedupMode::kBytes,
+                      /*num_threads=*/2, cache_path, /*quiet=*/false);
+  ASSERT_EQ(groups.status, Status::kOk);
+  EXPECT_EQ(groups.value, Groups({{gradient, copy}, {other}}));
+
+  // Forge the cache as if other was identical to gradient, to check that the
+  // cached comparison is trusted.
+  std::vector<std::string> lines;
+  {
+    std::ifstream cache(cache_path);
+    for (std::string line; std::getline(cache, line);) lines.push_back(line);
+  }
+  ASSERT_EQ(lines.size(), 3u);
+  std::vector<std::string> gradient_tokens = Split(lines[0], ',');
+  std::vector<std::string> other_tokens = Split(lines[1], ',');
+  ASSERT_EQ(other_tokens.size(), 5u);
+  {
+    std::ofstream cache(cache_path, std::ios::trunc);
+    cache << lines[0] << std::endl
+          << gradient_tokens[0] << ", " << other_tokens[1] << ", "
+          << other_tokens[2] << ", " << other_tokens[3] << ", "
+          << Escape(gradient) << std::endl
+          << lines[2] << std::endl;
+  }
+  groups = GroupDuplicates({gradient, other, copy}, DedupMode::kBytes,
+                           /*num_threads=*/1, cache_path, /*quiet=*/false);
+  ASSERT_EQ(groups.status, Status::kOk);
+  EXPECT_EQ(groups.value, Groups({{gradient, other, copy}}));
+
+  // A modified file is hashed again.
+  std::filesystem::last_write_time(
+      other, std::filesystem::last_write_time(other) + std::chrono::hours(1));
+  groups = GroupDuplicates({gradient, other, copy}, DedupMode::kBytes,
+                           /*num_threads=*/1, cache_path, /*quiet=*/false);
+  ASSERT_EQ(groups.status, Status::kOk);
+  EXPECT_EQ(groups.value, Groups({{gradient, copy}, {other}}));
+}
+
+TEST(DedupTest, CopyResultsToDuplicates) {
+  std::vector<TaskOutput> tasks(3);
+  tasks[0].task_input.image_path = "a.png";
+  tasks[0].encoded_size = 10;
+  tasks[1].task_input.image_path = "b.png";
+  tasks[2].task_input.image_path = "a.png";
+  tasks[2].encoded_size = 20;
+
+  CopyResultsToDuplicates({{"a.png", "c.png", "d.png"}, {"b.png"}}, tasks);
+  ASSERT_EQ(tasks.size(), 7u);
+  EXPECT_EQ(tasks[3].task_input.image_path, "c.png");
+  EXPECT_EQ(tasks[3].encoded_size, 10u);
+  EXPECT_EQ(tasks[4].task_input.image_path, "d.png");
+  EXPECT_EQ(tasks[4].encoded_size, 10u);
+  EXPECT_EQ(tasks[5].task_input.image_path, "c.png");
+  EXPECT_EQ(tasks[5].encoded_size, 20u);
+  EXPECT_EQ(tasks[6].task_input.image_path, "d.png");
+
+  // Tasks already evaluated for a duplicate are not copied.
+  tasks.resize(3);
+  tasks.push_back(tasks[2]);
+  tasks.back().task_input.image_path = "c.png";
+  tasks.back().encoded_size = 30;
+  CopyResultsToDuplicates({{"a.png", "c.png"}, {"b.png"}}, tasks);
+  ASSERT_EQ(tasks.size(), 4u);
+  tasks[0].task_input.codec_settings.quality = 50;
+  CopyResultsToDuplicates({{"a.png", "c.png"}, {"b.png"}}, tasks);
+  ASSERT_EQ(tasks.size(), 5u);
+  EXPECT_EQ(tasks[4].task_input.image_path, "c.png");
+  EXPECT_EQ(tasks[4].encoded_size, 10u);
+}
+
+}  // namespace
+}  // namespace codec_compare_gen
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  if (argc != 2) {
+    std::cerr << "There must be exactly one argument containing the path to "
+                 "the test data folder"
+              << std::endl;
+    return 1;
+  }
+  codec_compare_gen::data_path = argv[1];
+  return RUN_ALL_TESTS();
+}
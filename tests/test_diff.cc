@@ -0,0 +1,140 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/diff.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/base.h"
+#include "src/task.h"
+#include "tests/task_factory.h"
+
+namespace codec_compare_gen {
+namespace {
+
+TaskOutput MakeTaskOutput(const std::string& image, int quality,
+                          size_t encoded_size, double encoding_duration,
+                          float psnr) {
+  return MakeFakeTaskOutput(
+      {Codec::kWebp, Subsampling::k420, /*effort=*/4, quality}, image,
+      encoded_size, encoding_duration, /*decoding_duration=*/0.1, psnr);
+}
+
+TEST(DiffTest, Wilcoxon) {
+  EXPECT_EQ(WilcoxonSignedRankPValue({}), 1);
+  EXPECT_EQ(WilcoxonSignedRankPValue({0, 0, 0}), 1);
+  // All 10 differences are positive: W+ = 55, normal approximation.
+  EXPECT_NEAR(
+      WilcoxonSignedRankPValue({1, 2, 3, 4, 5, 6, 7, 8, 9, 10}), 0.0059, 1e-4);
+  EXPECT_GT(WilcoxonSignedRankPValue({1, -2, 3, -4, 5, -6, 7, -8}), 0.5);
+}
+
+TEST(DiffTest, EncodingRegression) {
+  std::vector<TaskOutput> before, after;
+  for (int i = 0; i < 20; ++i) {
+    const std::string image = "image" + std::to_string(i);
+    for (int repetition = 0; repetition < 3; ++repetition) {
+      // The repetition with an outlier timing is ignored by the median.
+      const double hiccup = repetition == 2 ? 10 : 1;
+      before.push_back(MakeTaskOutput(image, 50, 100, 1.0 * hiccup, 30));
+      after.push_back(MakeTaskOutput(image, 50, 100, 1.2 * hiccup, 31));
+    }
+  }
+  before.push_back(MakeTaskOutput("only_before", 50, 100, 1.0, 30));
+
+  const StatusOr<Diff> diff =
+      DiffTaskOutputs(before, after, DiffThresholds(), /*quiet=*/false);
+  ASSERT_EQ(diff.status, Status::kOk);
+  EXPECT_EQ(diff.value.num_unmatched_before, 1u);
+  EXPECT_EQ(diff.value.num_unmatched_after, 0u);
+  ASSERT_EQ(diff.value.settings.size(), 1u);
+  const SettingsDiff& settings_diff = diff.value.settings.front();
+  EXPECT_EQ(settings_diff.num_images, 20u);
+  EXPECT_EQ(settings_diff.num_size_changes, 0u);
+  EXPECT_NEAR(settings_diff.encoding_duration.ratio, 1.2, 1e-9);
+  EXPECT_LT(settings_diff.encoding_duration.p_value, 0.01);
+  EXPECT_TRUE(settings_diff.encoding_duration.regression);
+  EXPECT_FALSE(settings_diff.encoded_size.regression);
+  EXPECT_FALSE(settings_diff.decoding_duration.regression);
+  EXPECT_TRUE(settings_diff.regression());
+  EXPECT_NEAR(settings_diff.distortion_deltas[0], 1, 1e-6);
+}
+
+TEST(DiffTest, NoiseIsNotARegression) {
+  std::vector<TaskOutput> before, after;
+  for (int i = 0; i < 20; ++i) {
+    const std::string image = "image" + std::to_string(i);
+    // Alternate between faster and slower.
+    const double factor = i % 2 == 0 ? 1.2 : 1 / 1.2;
+    before.push_back(MakeTaskOutput(image, 50, 100, 1.0, 30));
+    after.push_back(MakeTaskOutput(image, 50, 102, 1.0 * factor, 30));
+  }
+  const StatusOr<Diff> diff =
+      DiffTaskOutputs(before, after, DiffThresholds(), /*quiet=*/false);
+  ASSERT_EQ(diff.status, Status::kOk);
+  ASSERT_EQ(diff.value.settings.size(), 1u);
+  const SettingsDiff& settings_diff = diff.value.settings.front();
+  EXPECT_FALSE(settings_diff.encoding_duration.regression);
+  // Sizes are deterministic so a 2% increase is a regression.
+  EXPECT_EQ(settings_diff.num_size_changes, 20u);
+  EXPECT_TRUE(settings_diff.encoded_size.regression);
+}
+
+TEST(DiffTest, RenditionsAreKeptApart) {
+  std::vector<TaskOutput> before, after;
+  for (int i = 0; i < 10; ++i) {
+    const std::string image = "image" + std::to_string(i);
+    before.push_back(MakeTaskOutput(image, 50, 1000, 1.0, 30));
+    after.push_back(before.back());
+    // A new, smaller and faster rendition is not a change of the full size.
+    TaskOutput rendition = MakeTaskOutput(image, 50, 100, 0.1, 30);
+    rendition.task_input.rendition_width = 4;
+    before.push_back(rendition);
+    after.push_back(rendition);
+  }
+  const StatusOr<Diff> diff =
+      DiffTaskOutputs(before, after, DiffThresholds(), /*quiet=*/false);
+  ASSERT_EQ(diff.status, Status::kOk);
+  ASSERT_EQ(diff.value.settings.size(), 2u);
+  EXPECT_EQ(diff.value.settings[0].rendition_width, 0u);
+  EXPECT_EQ(diff.value.settings[1].rendition_width, 4u);
+  for (const SettingsDiff& settings_diff : diff.value.settings) {
+    EXPECT_EQ(settings_diff.num_tasks, 10u);
+    EXPECT_FALSE(settings_diff.regression());
+  }
+}
+
+TEST(DiffTest, SizeTradedForQualityIsNotARegression) {
+  std::vector<TaskOutput> before, after;
+  for (int i = 0; i < 10; ++i) {
+    const std::string image = "image" + std::to_string(i);
+    before.push_back(MakeTaskOutput(image, 50, 100, 1.0, 30));
+    after.push_back(MakeTaskOutput(image, 50, 110, 1.0, 32));
+  }
+  const StatusOr<Diff> diff =
+      DiffTaskOutputs(before, after, DiffThresholds(), /*quiet=*/false);
+  ASSERT_EQ(diff.status, Status::kOk);
+  ASSERT_EQ(diff.value.settings.size(), 1u);
+  const SettingsDiff& settings_diff = diff.value.settings.front();
+  EXPECT_NEAR(settings_diff.encoded_size.ratio, 1.1, 1e-9);
+  EXPECT_EQ(settings_diff.num_size_quality_tradeoffs, 10u);
+  EXPECT_FALSE(settings_diff.encoded_size.regression);
+  EXPECT_NEAR(settings_diff.distortion_deltas[0], 2, 1e-6);
+}
+
+}  // namespace
+}  // namespace codec_compare_gen
@@ -13,8 +13,10 @@
 // limitations under the License.
 
 #include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <string>
+#include <utility>
 
 #include "gtest/gtest.h"
 #include "src/base.h"
@@ -31,6 +33,24 @@ const char* data_path = nullptr;
 constexpr bool kQuiet = false;
 constexpr size_t kThreadId = 0;
 
+// Returns an opaque gradient, brightened by offset.
+Frame MakeFrame(uint32_t width, uint32_t height, uint8_t offset,
+                uint32_t duration_ms) {
+  WP2::ArgbBuffer pixels(WP2_ARGB_32);
+  EXPECT_EQ(pixels.Resize(width, height), WP2_STATUS_OK);
+  for (uint32_t y = 0; y < height; ++y) {
+    uint8_t* row = pixels.GetRow8(y);
+    for (uint32_t x = 0; x < width; ++x) {
+      row[x * 4 + 0] = 255;
+      for (uint32_t c = 1; c < 4; ++c) {
+        row[x * 4 + c] =
+            static_cast<uint8_t>(16 + (x * c + y) % 128 + offset);
+      }
+    }
+  }
+  return Frame(std::move(pixels), duration_ms);
+}
+
 //------------------------------------------------------------------------------
 
 TEST(DistortionTest, Same) {
@@ -122,6 +142,76 @@ TEST(DistortionTest, DifferentFrameCount) {
   EXPECT_GT(distortion.value, 20.0f);
 }
 
+TEST(DistortionTest, SampledAnimation) {
+  constexpr uint32_t kNumFrames = 20;
+  static_assert(kNumFrames > kNumSampledFramePairs);
+  Image reference, constant, varying;
+  for (uint32_t i = 0; i < kNumFrames; ++i) {
+    reference.push_back(MakeFrame(64, 48, 0, /*duration_ms=*/40));
+    constant.push_back(MakeFrame(64, 48, 3, /*duration_ms=*/40));
+    varying.push_back(MakeFrame(64, 48, 1 + i % 5, /*duration_ms=*/40));
+  }
+
+  for (const Image* image : {&constant, &varying}) {
+    const StatusOr<float> exact =
+        GetAverageDistortion("", reference, "", *image, {}, "",
+                             DistortionMetric::kLibwebp2Psnr, kThreadId,
+                             kQuiet);
+    ASSERT_EQ(exact.status, Status::kOk);
+    const StatusOr<SampledDistortion> sampled =
+        GetSampledDistortion("", reference, "", *image, {}, "",
+                             DistortionMetric::kLibwebp2Psnr, kThreadId,
+                             kQuiet);
+    ASSERT_EQ(sampled.status, Status::kOk);
+    EXPECT_TRUE(sampled.value.sampled);
+    if (image == &constant) {
+      EXPECT_NEAR(sampled.value.value, exact.value, 0.001f);
+      EXPECT_NEAR(sampled.value.error, 0, 0.001f);
+    } else {
+      EXPECT_NEAR(sampled.value.value, exact.value, 1.5f);
+      EXPECT_GT(sampled.value.error, 0);
+    }
+  }
+}
+
+TEST(DistortionTest, SampledTiles) {
+  // Enough tiles to be sampled.
+  constexpr uint32_t kSize = 5 * kSampledTileSize;
+  static_assert(5 * 5 > kNumSampledTiles);
+  Image reference, image;
+  reference.push_back(MakeFrame(kSize, kSize, 0, /*duration_ms=*/0));
+  image.push_back(MakeFrame(kSize, kSize, 2, /*duration_ms=*/0));
+
+  for (const DistortionMetric metric :
+       {DistortionMetric::kLibwebp2Psnr, DistortionMetric::kLibwebp2Ssim}) {
+    const StatusOr<float> exact = GetAverageDistortion(
+        "", reference, "", image, {}, "", metric, kThreadId, kQuiet);
+    ASSERT_EQ(exact.status, Status::kOk);
+    const StatusOr<SampledDistortion> sampled = GetSampledDistortion(
+        "", reference, "", image, {}, "", metric, kThreadId, kQuiet);
+    ASSERT_EQ(sampled.status, Status::kOk);
+    EXPECT_TRUE(sampled.value.sampled);
+    EXPECT_NEAR(sampled.value.value, exact.value, 0.5f);
+    EXPECT_GE(sampled.value.error, 0);
+  }
+
+  // Small images are evaluated as a whole.
+  Image small_reference, small_image;
+  small_reference.push_back(MakeFrame(64, 64, 0, /*duration_ms=*/0));
+  small_image.push_back(MakeFrame(64, 64, 2, /*duration_ms=*/0));
+  const StatusOr<float> exact =
+      GetAverageDistortion("", small_reference, "", small_image, {}, "",
+                           DistortionMetric::kLibwebp2Psnr, kThreadId, kQuiet);
+  ASSERT_EQ(exact.status, Status::kOk);
+  const StatusOr<SampledDistortion> sampled =
+      GetSampledDistortion("", small_reference, "", small_image, {}, "",
+                           DistortionMetric::kLibwebp2Psnr, kThreadId, kQuiet);
+  ASSERT_EQ(sampled.status, Status::kOk);
+  EXPECT_FALSE(sampled.value.sampled);
+  EXPECT_EQ(sampled.value.value, exact.value);
+  EXPECT_EQ(sampled.value.error, 0);
+}
+
 //------------------------------------------------------------------------------
 
 }  // namespace
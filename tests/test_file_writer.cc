@@ -0,0 +1,137 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/file_writer.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "src/base.h"
+#include "third_party/libwebp2/src/wp2/base.h"
+
+namespace codec_compare_gen {
+namespace {
+
+WP2::Data MakeData(const std::string& content) {
+  WP2::Data data;
+  EXPECT_EQ(data.CopyFrom(reinterpret_cast<const uint8_t*>(content.data()),
+                          content.size()),
+            WP2_STATUS_OK);
+  return data;
+}
+
+std::string ReadFile(const std::string& file_path) {
+  std::ifstream file(file_path, std::ios::binary);
+  std::stringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+TEST(FileWriterTest, Write) {
+  const std::filesystem::path folder =
+      std::filesystem::path(::testing::TempDir()) / "file_writer";
+  std::filesystem::remove_all(folder);
+  const std::string a = folder / "a.bin";
+  const std::string b = folder / "nested" / "b.bin";
+  const std::string empty = folder / "nested" / "empty.bin";
+
+  FileWriter writer(/*quiet=*/false);
+  writer.Write(a, MakeData("first"));
+  writer.Write(b, MakeData(std::string(100000, 'b')));
+  writer.Write(empty, WP2::Data());
+  writer.Write(a, MakeData("overwritten"));
+  ASSERT_EQ(writer.Finish(), Status::kOk);
+  EXPECT_EQ(writer.Finish(), Status::kOk);  // No-op.
+
+  EXPECT_EQ(ReadFile(a), "overwritten");
+  EXPECT_EQ(ReadFile(b), std::string(100000, 'b'));
+  EXPECT_TRUE(std::filesystem::exists(empty));
+  EXPECT_EQ(ReadFile(empty), "");
+  EXPECT_EQ(writer.num_written_files(), 4u);
+  EXPECT_EQ(writer.num_written_bytes(), 5u + 100000u + 11u);
+  EXPECT_GE(writer.num_batches(), 1u);
+  EXPECT_LE(writer.num_batches(), 4u);
+  EXPECT_GE(writer.throughput(), 0);
+}
+
+TEST(FileWriterTest, Failure) {
+  const std::filesystem::path folder =
+      std::filesystem::path(::testing::TempDir()) / "file_writer_failure";
+  std::filesystem::remove_all(folder);
+  std::filesystem::create_directories(folder);
+  const std::string not_a_folder = folder / "file";
+  std::ofstream(not_a_folder) << "content";
+
+  FileWriter writer(/*quiet=*/true);
+  writer.Write(not_a_folder + "/a.bin", MakeData("a"));
+  writer.Write(folder / "b.bin", MakeData("b"));
+  EXPECT_NE(writer.Finish(), Status::kOk);
+  // The other files are still written.
+  EXPECT_EQ(writer.num_written_files(), 1u);
+  EXPECT_EQ(ReadFile(folder / "b.bin"), "b");
+}
+
+TEST(FileWriterTest, Future) {
+  const std::filesystem::path folder =
+      std::filesystem::path(::testing::TempDir()) / "file_writer_future";
+  std::filesystem::remove_all(folder);
+  std::filesystem::create_directories(folder);
+  const std::string not_a_folder = folder / "file";
+  std::ofstream(not_a_folder) << "content";
+
+  FileWriter writer(/*quiet=*/true);
+  std::future<Status> a = writer.Write(folder / "a.bin", MakeData("a"));
+  std::future<Status> b = writer.Write(not_a_folder + "/b.bin", MakeData("b"));
+  EXPECT_EQ(a.get(), Status::kOk);
+  // The file is on disk once the future is ready, even before Finish().
+  EXPECT_EQ(ReadFile(folder / "a.bin"), "a");
+  EXPECT_NE(b.get(), Status::kOk);
+  EXPECT_NE(writer.Finish(), Status::kOk);
+}
+
+TEST(FileWriterTest, BoundedQueue) {
+  const std::filesystem::path folder =
+      std::filesystem::path(::testing::TempDir()) / "file_writer_bounded";
+  std::filesystem::remove_all(folder);
+
+  // Room for a single 10-byte file at a time.
+  FileWriter writer(/*quiet=*/false, /*max_pending_bytes=*/16);
+  for (size_t i = 0; i < 8; ++i) {
+    writer.Write(folder / (std::to_string(i) + ".bin"),
+                 MakeData(std::string(10, 'x')));
+    // Write() waited for the previous files to be written.
+    EXPECT_GE(writer.num_written_files(), i);
+  }
+  // Larger files than the limit are still written.
+  writer.Write(folder / "large.bin", MakeData(std::string(100, 'x')));
+  ASSERT_EQ(writer.Finish(), Status::kOk);
+  EXPECT_EQ(writer.num_written_files(), 9u);
+  EXPECT_EQ(ReadFile(folder / "large.bin"), std::string(100, 'x'));
+}
+
+TEST(FileWriterTest, NothingToWrite) {
+  FileWriter writer(/*quiet=*/false);
+  EXPECT_EQ(writer.Finish(), Status::kOk);
+  EXPECT_EQ(writer.num_written_files(), 0u);
+  EXPECT_EQ(writer.num_batches(), 0u);
+  EXPECT_EQ(writer.throughput(), 0);
+}
+
+}  // namespace
+}  // namespace codec_compare_gen
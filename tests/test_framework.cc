@@ -14,6 +14,7 @@
 
 #include <cstdint>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -21,6 +22,7 @@
 #include "gtest/gtest.h"
 #include "src/base.h"
 #include "src/framework.h"
+#include "src/task.h"
 
 namespace codec_compare_gen {
 namespace {
@@ -204,6 +206,145 @@ TEST_F(FrameworkTest, Incremental) {
 
 //------------------------------------------------------------------------------
 
+TEST_F(FrameworkTest, Failures) {
+  ComparisonSettings settings;
+  settings.codec_settings.push_back(
+      {Codec::kWebp, Subsampling::k444, /*effort=*/0, kQualityLossless});
+  const std::vector<std::string> images = {
+      std::string(data_path) + "gradient32x32.png",
+      TempPath("missing.png").string()};
+  const std::string progress_file_path = TempPath("completed_tasks.csv");
+  const std::string failures_file_path = progress_file_path + ".failures";
+
+  ASSERT_EQ(Compare(images, settings, progress_file_path, TempPath()),
+            Status::kOk);
+  StatusOr<std::vector<TaskFailure>> failures =
+      ReadTaskFailures(failures_file_path, /*quiet=*/false);
+  ASSERT_EQ(failures.status, Status::kOk);
+  ASSERT_EQ(failures.value.size(), 1u);
+  EXPECT_EQ(failures.value.front().task_input.image_path, images.back());
+  EXPECT_FALSE(failures.value.front().error.empty());
+
+  // The failed task is not evaluated again.
+  ASSERT_EQ(Compare(images, settings, progress_file_path, TempPath()),
+            Status::kOk);
+  failures = ReadTaskFailures(failures_file_path, /*quiet=*/false);
+  ASSERT_EQ(failures.status, Status::kOk);
+  EXPECT_EQ(failures.value.size(), 1u);
+
+  // Unless requested.
+  settings.retry_failed_tasks = true;
+  EXPECT_EQ(Compare(images, settings, progress_file_path, TempPath()),
+            Status::kUnknownError);  // Nothing else to evaluate.
+  EXPECT_TRUE(std::filesystem::exists(failures_file_path + ".bck"));
+  failures = ReadTaskFailures(failures_file_path, /*quiet=*/false);
+  ASSERT_EQ(failures.status, Status::kOk);
+  EXPECT_EQ(failures.value.size(), 1u);
+
+  // Earlier backups are kept.
+  EXPECT_EQ(Compare(images, settings, progress_file_path, TempPath()),
+            Status::kUnknownError);
+  EXPECT_TRUE(std::filesystem::exists(failures_file_path + ".bck"));
+  EXPECT_TRUE(std::filesystem::exists(failures_file_path + ".bck2"));
+}
+
+TEST_F(FrameworkTest, RemoveTasksWithOneBackup) {
+  ComparisonSettings settings;
+  settings.codec_settings.push_back(
+      {Codec::kWebp, Subsampling::k444, /*effort=*/0, kQualityLossless});
+  const std::vector<std::string> images = {
+      std::string(data_path) + "alpha1x17.png",
+      std::string(data_path) + "gradient32x32.png"};
+  const std::string progress_file_path = TempPath("completed_tasks.csv");
+  ASSERT_EQ(Compare(images, settings, progress_file_path, TempPath()),
+            Status::kOk);
+
+  // Mark one task as approximate and the other as timed abnormally.
+  StatusOr<std::vector<TaskOutput>> tasks =
+      ReadTaskOutputs(progress_file_path, /*discard_distortion_values=*/false,
+                      /*num_threads=*/1, /*quiet=*/false);
+  ASSERT_EQ(tasks.status, Status::kOk);
+  ASSERT_EQ(tasks.value.size(), 2u);
+  tasks.value[0].approximate_distortions = true;
+  tasks.value[1].system_conditions.sampled = true;
+  tasks.value[1].system_conditions.abnormal = true;
+  {
+    std::ofstream file(progress_file_path, std::ios::trunc);
+    for (const TaskOutput& task : tasks.value) {
+      file << task.Serialize() << std::endl;
+    }
+  }
+  const uintmax_t progress_file_size =
+      std::filesystem::file_size(progress_file_path);
+
+  // Both tasks are evaluated again, and the backup is the original file.
+  settings.remeasure_abnormal_timings = true;
+  ASSERT_EQ(Compare(images, settings, progress_file_path, TempPath()),
+            Status::kOk);
+  EXPECT_EQ(std::filesystem::file_size(progress_file_path + ".bck"),
+            progress_file_size);
+  tasks = ReadTaskOutputs(progress_file_path,
+                          /*discard_distortion_values=*/false,
+                          /*num_threads=*/1, /*quiet=*/false);
+  ASSERT_EQ(tasks.status, Status::kOk);
+  ASSERT_EQ(tasks.value.size(), 2u);
+  EXPECT_FALSE(tasks.value[0].approximate_distortions);
+  EXPECT_FALSE(tasks.value[1].approximate_distortions);
+}
+
+TEST_F(FrameworkTest, DryRun) {
+  ComparisonSettings settings;
+  settings.codec_settings.push_back(
+      {Codec::kWebp, Subsampling::k444, /*effort=*/0, kQualityLossless});
+  settings.dry_run = true;
+  const std::vector<std::string> images = {std::string(data_path) +
+                                           "gradient32x32.png"};
+  const std::string progress_file_path = TempPath("dry_run.csv");
+
+  EXPECT_EQ(Compare(images, settings, progress_file_path, TempPath()),
+            Status::kOk);
+  // Nothing was evaluated.
+  EXPECT_FALSE(std::filesystem::exists(progress_file_path));
+
+  // The estimate can be calibrated on the actual run.
+  settings.dry_run = false;
+  ASSERT_EQ(Compare(images, settings, progress_file_path, TempPath()),
+            Status::kOk);
+  settings.dry_run = true;
+  settings.calibration_file_paths = {progress_file_path};
+  EXPECT_EQ(Compare(images, settings, TempPath("dry_run_again.csv"),
+                    TempPath()),
+            Status::kOk);
+  EXPECT_FALSE(std::filesystem::exists(TempPath("dry_run_again.csv")));
+}
+
+TEST_F(FrameworkTest, ResumeWithDedup) {
+  ComparisonSettings settings;
+  settings.codec_settings.push_back(
+      {Codec::kWebp, Subsampling::k444, /*effort=*/0, kQualityLossless});
+  const std::string image = std::string(data_path) + "gradient32x32.png";
+  const std::string copy = TempPath("copy.png");
+  std::filesystem::copy_file(image, copy);
+  const std::string progress_file_path = TempPath("progress.csv");
+  ASSERT_EQ(Compare({image, copy}, settings, progress_file_path, TempPath()),
+            Status::kOk);
+  const uintmax_t progress_file_size =
+      std::filesystem::file_size(progress_file_path);
+
+  // The task of the duplicate evaluated without deduplication is kept.
+  settings.dedup_mode = DedupMode::kBytes;
+  ASSERT_EQ(Compare({image, copy}, settings, progress_file_path, TempPath()),
+            Status::kOk);
+  EXPECT_EQ(std::filesystem::file_size(progress_file_path),
+            progress_file_size);
+  EXPECT_TRUE(std::filesystem::exists(progress_file_path + ".dedup_bytes"));
+  // Same with the cached hashes.
+  ASSERT_EQ(Compare({image, copy}, settings, progress_file_path, TempPath()),
+            Status::kOk);
+  EXPECT_EQ(std::filesystem::file_size(progress_file_path),
+            progress_file_size);
+}
+
 TEST_F(FrameworkTest, InconvenientFilePaths) {
   ComparisonSettings settings;
   settings.codec_settings = {
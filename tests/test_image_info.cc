@@ -0,0 +1,127 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/image_info.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "src/base.h"
+
+namespace codec_compare_gen {
+namespace {
+
+// Used to pass the data folder path to the GoogleTest suites.
+const char* data_path = nullptr;
+
+bool IsAnimation(const std::string& path) {
+  const StatusOr<ImageInfo> info = ReadImageInfo(path, /*quiet=*/false);
+  EXPECT_EQ(info.status, Status::kOk);
+  return info.value.is_animation;
+}
+
+TEST(ImageInfoTest, Animations) {
+  EXPECT_TRUE(IsAnimation(std::string(data_path) + "anim80x80.gif"));
+  EXPECT_TRUE(IsAnimation(std::string(data_path) + "anim80x80.webp"));
+}
+
+TEST(ImageInfoTest, StillImages) {
+  EXPECT_FALSE(IsAnimation(std::string(data_path) + "gradient32x32.png"));
+  EXPECT_FALSE(IsAnimation(std::string(data_path) + "gradient16x16.y4m"));
+
+  // A GIF with a single frame.
+  const std::string path =
+      std::filesystem::path(::testing::TempDir()) / "still.gif";
+  {
+    std::ofstream file(path, std::ios::binary);
+    file << "GIF89a";
+    file.write("\x01\x00\x01\x00\x80\x00\x00", 7);  // Global color table.
+    file.write("\x00\x00\x00\xff\xff\xff", 6);
+    file.write("\x21\xf9\x04\x00\x00\x00\x00\x00", 8);  // Graphic control
+    file.write("\x2c\x00\x00\x00\x00\x01\x00\x01\x00\x00", 10);
+    file.write("\x02\x02\x44\x01\x00", 5);
+    file.write("\x3b", 1);
+  }
+  EXPECT_FALSE(IsAnimation(path));
+
+  // Truncated files are considered still images.
+  std::filesystem::resize_file(path, 20);
+  EXPECT_FALSE(IsAnimation(path));
+
+  EXPECT_NE(ReadImageInfo("missing.gif", /*quiet=*/true).status, Status::kOk);
+}
+
+ImageInfo GetInfo(const std::string& path) {
+  const StatusOr<ImageInfo> info = ReadImageInfo(path, /*quiet=*/false);
+  EXPECT_EQ(info.status, Status::kOk);
+  return info.value;
+}
+
+void ExpectDimensions(const ImageInfo& info, uint32_t width, uint32_t height,
+                      uint32_t bit_depth, uint32_t num_frames) {
+  EXPECT_EQ(info.width, width);
+  EXPECT_EQ(info.height, height);
+  EXPECT_EQ(info.bit_depth, bit_depth);
+  EXPECT_EQ(info.num_frames, num_frames);
+}
+
+TEST(ImageInfoTest, Dimensions) {
+  const std::string data(data_path);
+  ExpectDimensions(GetInfo(data + "gradient32x32.png"), 32, 32, 8, 1);
+  ExpectDimensions(GetInfo(data + "alpha1x17.png"), 1, 17, 8, 1);
+  ExpectDimensions(GetInfo(data + "gradient32x32_16bits.png"), 32, 32, 16, 1);
+  ExpectDimensions(GetInfo(data + "anim80x80.gif"), 80, 80, 8, 10);
+  ExpectDimensions(GetInfo(data + "anim80x80.webp"), 80, 80, 8, 10);
+  // Unknown format.
+  ExpectDimensions(GetInfo(data + "gradient16x16.y4m"), 0, 0, 0, 1);
+
+  const std::string jpeg_path =
+      std::filesystem::path(::testing::TempDir()) / "header.jpg";
+  {
+    std::ofstream file(jpeg_path, std::ios::binary);
+    file.write("\xff\xd8", 2);                                  // SOI
+    file.write("\xff\xe0\x00\x04\x00\x00", 6);                  // APP0
+    file.write("\xff\xc2\x00\x0b\x0c\x01\x2c\x02\x80\x01", 10);  // SOF2
+    file.write("\x01\x11\x00", 3);
+  }
+  ExpectDimensions(GetInfo(jpeg_path), 640, 300, 12, 1);
+
+  const std::string webp_path =
+      std::filesystem::path(::testing::TempDir()) / "header.webp";
+  {
+    std::ofstream file(webp_path, std::ios::binary);
+    file.write("RIFF\x12\x00\x00\x00WEBPVP8L\x05\x00\x00\x00\x2f", 21);
+    // Width 100 and height 50, minus one, on 14 bits each.
+    file.write("\x63\x40\x0c\x00\x00", 5);
+  }
+  ExpectDimensions(GetInfo(webp_path), 100, 50, 8, 1);
+}
+
+}  // namespace
+}  // namespace codec_compare_gen
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  if (argc != 2) {
+    std::cerr << "There must be exactly one argument containing the path to "
+                 "the test data folder"
+              << std::endl;
+    return 1;
+  }
+  codec_compare_gen::data_path = argv[1];
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,194 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/rendition.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/base.h"
+#include "src/frame.h"
+#include "src/shared_image_cache.h"
+#include "third_party/libwebp2/src/wp2/base.h"
+
+namespace codec_compare_gen {
+namespace {
+
+// Used to pass the data folder path to the GoogleTest suites.
+const char* data_path = nullptr;
+
+TEST(RenditionTest, RenditionHeight) {
+  EXPECT_EQ(RenditionHeight(1920, 1080, 320), 180u);
+  EXPECT_EQ(RenditionHeight(31, 32, 16), 17u);  // Rounded.
+  EXPECT_EQ(RenditionHeight(1000, 1, 10), 1u);  // At least one row.
+}
+
+TEST(RenditionTest, DownscaleAreaBox) {
+  // 4x2 single-channel image downscaled by 2 in both directions.
+  const std::vector<float> src = {0, 2, 4, 6,  //
+                                  2, 4, 6, 8};
+  std::vector<float> dst(2);
+  DownscaleArea(src.data(), 4, 2, /*num_channels=*/1, 2, 1, dst.data());
+  EXPECT_FLOAT_EQ(dst[0], 2.f);
+  EXPECT_FLOAT_EQ(dst[1], 6.f);
+}
+
+TEST(RenditionTest, DownscaleAreaPreservesMean) {
+  constexpr uint32_t kSrcWidth = 31, kSrcHeight = 17, kNumChannels = 3;
+  constexpr uint32_t kDstWidth = 7, kDstHeight = 4;
+  std::vector<float> src(kSrcWidth * kSrcHeight * kNumChannels);
+  for (size_t i = 0; i < src.size(); ++i) src[i] = (i * 37 % 101) / 100.f;
+  std::vector<float> dst(kDstWidth * kDstHeight * kNumChannels);
+  DownscaleArea(src.data(), kSrcWidth, kSrcHeight, kNumChannels, kDstWidth,
+                kDstHeight, dst.data());
+
+  double src_sum = 0, dst_sum = 0;
+  for (float sample : src) src_sum += sample;
+  for (float sample : dst) dst_sum += sample;
+  EXPECT_NEAR(src_sum / src.size(), dst_sum / dst.size(), 1e-4);
+
+  // A constant image stays constant.
+  std::fill(src.begin(), src.end(), 0.5f);
+  DownscaleArea(src.data(), kSrcWidth, kSrcHeight, kNumChannels, kDstWidth,
+                kDstHeight, dst.data());
+  for (float sample : dst) EXPECT_FLOAT_EQ(sample, 0.5f);
+}
+
+TEST(RenditionTest, Downscale) {
+  const StatusOr<Image> image = ReadStillImageOrAnimation(
+      (std::string(data_path) + "alpha31x32_16bits.png").c_str(), WP2_ARGB_64,
+      /*quiet=*/false);
+  ASSERT_EQ(image.status, Status::kOk);
+  const StatusOr<Image> rendition =
+      Downscale(image.value, /*width=*/16, /*quiet=*/false);
+  ASSERT_EQ(rendition.status, Status::kOk);
+  ASSERT_EQ(rendition.value.size(), 1u);
+  EXPECT_EQ(rendition.value.front().pixels.width(), 16u);
+  EXPECT_EQ(rendition.value.front().pixels.height(), 17u);
+  EXPECT_EQ(rendition.value.front().pixels.format(), WP2_ARGB_64);
+
+  EXPECT_NE(Downscale(image.value, /*width=*/32, /*quiet=*/true).status,
+            Status::kOk);
+}
+
+TEST(RenditionCacheTest, DecodesOnce) {
+  const std::string image_path = std::string(data_path) + "gradient32x32.png";
+  RenditionCache cache(/*capacity=*/8);
+  for (int i = 0; i < 2; ++i) {
+    for (const uint32_t width : {0u, 8u, 16u}) {
+      const StatusOr<std::shared_ptr<const Image>> image =
+          cache.Get(image_path, width, /*quiet=*/false);
+      ASSERT_EQ(image.status, Status::kOk);
+      EXPECT_EQ(image.value->front().pixels.width(), width == 0 ? 32u : width);
+    }
+  }
+  EXPECT_EQ(cache.num_decodings(), 1u);
+  EXPECT_EQ(cache.num_downscalings(), 2u);
+
+  // Renditions are never upscaled.
+  const StatusOr<std::shared_ptr<const Image>> original =
+      cache.Get(image_path, /*rendition_width=*/0, /*quiet=*/false);
+  const StatusOr<std::shared_ptr<const Image>> wide =
+      cache.Get(image_path, /*rendition_width=*/64, /*quiet=*/false);
+  ASSERT_EQ(wide.status, Status::kOk);
+  EXPECT_EQ(wide.value, original.value);
+  EXPECT_EQ(cache.num_downscalings(), 2u);
+
+  EXPECT_NE(cache.Get("missing.png", 16, /*quiet=*/true).status, Status::kOk);
+}
+
+TEST(RenditionCacheTest, Eviction) {
+  const std::string image_path = std::string(data_path) + "gradient32x32.png";
+  RenditionCache cache(/*capacity=*/1);
+  ASSERT_EQ(cache.Get(image_path, 0, /*quiet=*/false).status, Status::kOk);
+  ASSERT_EQ(cache.Get(image_path, 16, /*quiet=*/false).status, Status::kOk);
+  ASSERT_EQ(cache.Get(image_path, 0, /*quiet=*/false).status, Status::kOk);
+  EXPECT_EQ(cache.num_decodings(), 2u);  // The original evicted the rendition.
+
+  RenditionCache no_cache(/*capacity=*/0);
+  ASSERT_EQ(no_cache.Get(image_path, 0, /*quiet=*/false).status, Status::kOk);
+  ASSERT_EQ(no_cache.Get(image_path, 0, /*quiet=*/false).status, Status::kOk);
+  EXPECT_EQ(no_cache.num_decodings(), 2u);
+}
+
+TEST(RenditionCacheTest, SharedOriginals) {
+  const std::string image_path = std::string(data_path) + "gradient32x32.png";
+  const std::string name = "ccgen_test_" + std::to_string(getpid());
+  StatusOr<SharedImageCache> shared_cache =
+      SharedImageCache::Open(name, /*max_size=*/1 << 20, /*quiet=*/false);
+  ASSERT_EQ(shared_cache.status, Status::kOk);
+  for (int i = 0; i < 2; ++i) {
+    // Each RenditionCache stands for another process.
+    RenditionCache cache(/*capacity=*/8, &shared_cache.value);
+    const StatusOr<std::shared_ptr<const Image>> rendition =
+        cache.Get(image_path, /*rendition_width=*/16, /*quiet=*/false);
+    ASSERT_EQ(rendition.status, Status::kOk);
+    EXPECT_EQ(rendition.value->front().pixels.width(), 16u);
+  }
+  EXPECT_EQ(shared_cache.value.num_decodings(), 1u);
+  EXPECT_EQ(shared_cache.value.num_mappings(), 2u);
+  EXPECT_EQ(SharedImageCache::Remove(name, /*quiet=*/false), Status::kOk);
+}
+
+TEST(RenditionCacheTest, ConvertsOnce) {
+  const std::string image_path = std::string(data_path) + "gradient32x32.png";
+  RenditionCache cache(/*capacity=*/8);
+  size_t num_calls = 0;
+  const ImageConversion to_bgra = [&](const Image& image, bool quiet) {
+    ++num_calls;
+    return CloneAs(image, WP2_BGRA_32, quiet);
+  };
+  for (int i = 0; i < 3; ++i) {
+    const StatusOr<std::shared_ptr<const Image>> converted = cache.GetConverted(
+        image_path, /*rendition_width=*/16, "bgra", to_bgra, /*quiet=*/false);
+    ASSERT_EQ(converted.status, Status::kOk);
+    EXPECT_EQ(converted.value->front().pixels.format(), WP2_BGRA_32);
+    EXPECT_EQ(converted.value->front().pixels.width(), 16u);
+  }
+  EXPECT_EQ(num_calls, 1u);
+  EXPECT_EQ(cache.num_conversions(), 1u);
+  // The rendition it was computed from is cached too.
+  ASSERT_EQ(cache.Get(image_path, 16, /*quiet=*/false).status, Status::kOk);
+  EXPECT_EQ(cache.num_downscalings(), 1u);
+
+  // Conversions are keyed by name.
+  ASSERT_EQ(
+      cache.GetConverted(image_path, 16, "other", to_bgra, /*quiet=*/false)
+          .status,
+      Status::kOk);
+  EXPECT_EQ(cache.num_conversions(), 2u);
+}
+
+}  // namespace
+}  // namespace codec_compare_gen
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  if (argc != 2) {
+    std::cerr << "There must be exactly one argument containing the path to "
+                 "the test data folder"
+              << std::endl;
+    return 1;
+  }
+  codec_compare_gen::data_path = argv[1];
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,253 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/result_json.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/base.h"
+#include "src/framework.h"
+#include "src/task.h"
+
+namespace codec_compare_gen {
+namespace {
+
+const CodecSettings kSettings = {Codec::kWebp, Subsampling::k420,
+                                 /*effort=*/4, /*quality=*/0};
+
+std::vector<TaskOutput> MakeTaskOutputs(size_t num_images) {
+  std::vector<TaskOutput> tasks;
+  for (size_t i = 0; i < num_images; ++i) {
+    for (int quality : {10, 90}) {
+      CodecSettings settings = kSettings;
+      settings.quality = quality;
+      tasks.push_back({{settings, "dir/" + std::to_string(i) + "_image.png"},
+                       /*image_width=*/8,
+                       /*image_height=*/8,
+                       /*bit_depth=*/8,
+                       /*num_frames=*/1,
+                       /*encoded_size=*/100,
+                       /*encoding_duration=*/1,
+                       /*decoding_duration=*/0.1,
+                       /*decoding_color_conversion_duration=*/0,
+                       {30}});
+    }
+  }
+  return tasks;
+}
+
+std::string ReadFile(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::string((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+}
+
+TEST(ResultJsonTest, SingleFile) {
+  const std::filesystem::path folder =
+      std::filesystem::path(::testing::TempDir()) / "single";
+  std::filesystem::create_directories(folder);
+  ASSERT_EQ(TasksToJson("webp_420_4", kSettings, MakeTaskOutputs(3),
+                        /*quiet=*/false, folder / "webp_420_4.json",
+                        JsonOptions()),
+            Status::kOk);
+  const std::string json = ReadFile(folder / "webp_420_4.json");
+  EXPECT_NE(json.find("\"field_values\""), std::string::npos);
+  EXPECT_NE(json.find("\"2_image.png\""), std::string::npos);
+  EXPECT_EQ(json.find("\"header_size\""), std::string::npos);
+}
+
+TEST(ResultJsonTest, BitstreamBreakdown) {
+  const std::filesystem::path folder =
+      std::filesystem::path(::testing::TempDir()) / "breakdown";
+  std::filesystem::create_directories(folder);
+  std::vector<TaskOutput> tasks = MakeTaskOutputs(2);
+  for (TaskOutput& task : tasks) {
+    task.header_size = 26;
+    task.metadata_size = 12;
+  }
+  ASSERT_EQ(TasksToJson("webp_420_4", kSettings, tasks, /*quiet=*/false,
+                        folder / "webp_420_4.json", JsonOptions()),
+            Status::kOk);
+  const std::string json = ReadFile(folder / "webp_420_4.json");
+  EXPECT_NE(json.find("\"header_size\""), std::string::npos);
+  EXPECT_NE(json.find(",0.1,26,12,0,30,"), std::string::npos);
+}
+
+TEST(ResultJsonTest, ApproximateDistortions) {
+  const std::filesystem::path folder =
+      std::filesystem::path(::testing::TempDir()) / "approximate";
+  std::filesystem::create_directories(folder);
+  std::vector<TaskOutput> tasks = MakeTaskOutputs(2);
+  tasks[0].approximate_distortions = true;
+  tasks[0].distortion_errors[0] = 0.5f;
+  ASSERT_EQ(TasksToJson("webp_420_4", kSettings, tasks, /*quiet=*/false,
+                        folder / "webp_420_4.json", JsonOptions()),
+            Status::kOk);
+  const std::string json = ReadFile(folder / "webp_420_4.json");
+  EXPECT_NE(json.find("\"psnr_error\""), std::string::npos);
+  EXPECT_NE(json.find(",30,0,0,0,0,0,0,1,0.5,0,0,0,0,0,0]"), std::string::npos);
+  EXPECT_NE(json.find(",30,0,0,0,0,0,0,0,0,0,0,0,0,0,0]"), std::string::npos);
+}
+
+TEST(ResultJsonTest, Chunks) {
+  const std::filesystem::path folder =
+      std::filesystem::path(::testing::TempDir()) / "chunks";
+  std::filesystem::create_directories(folder);
+  JsonOptions options;
+  options.num_images_per_chunk = 2;
+  ASSERT_EQ(TasksToJson("webp_420_4", kSettings, MakeTaskOutputs(5),
+                        /*quiet=*/false, folder / "webp_420_4.json", options),
+            Status::kOk);
+  EXPECT_FALSE(std::filesystem::exists(folder / "webp_420_4.json"));
+
+  const std::string index = ReadFile(folder / "webp_420_4.index.json");
+  EXPECT_NE(index.find("\"num_rows\": 10"), std::string::npos);
+  EXPECT_NE(index.find("\"original_names\": [\"4_image.png\"]"),
+            std::string::npos);
+  const std::string chunks[] = {ReadFile(folder / "webp_420_4.chunk0.json"),
+                                ReadFile(folder / "webp_420_4.chunk1.json"),
+                                ReadFile(folder / "webp_420_4.chunk2.json")};
+  EXPECT_NE(chunks[0].find("\"1_image.png\""), std::string::npos);
+  EXPECT_EQ(chunks[0].find("\"2_image.png\""), std::string::npos);
+  EXPECT_NE(chunks[2].find("\"4_image.png\""), std::string::npos);
+  EXPECT_FALSE(std::filesystem::exists(folder / "webp_420_4.chunk3.json"));
+}
+
+TEST(ResultJsonTest, SkipUnchanged) {
+  const std::filesystem::path folder =
+      std::filesystem::path(::testing::TempDir()) / "skip_unchanged";
+  std::filesystem::remove_all(folder);  // Fingerprints of previous runs.
+  std::filesystem::create_directories(folder);
+  const std::filesystem::path path = folder / "webp_420_4.json";
+  JsonOptions options;
+  options.skip_unchanged = true;
+  std::vector<TaskOutput> tasks = MakeTaskOutputs(3);
+  ASSERT_EQ(TasksToJson("webp_420_4", kSettings, tasks, /*quiet=*/false, path,
+                        options),
+            Status::kOk);
+  EXPECT_TRUE(std::filesystem::exists(folder / "webp_420_4.fingerprint"));
+
+  // Same rows: the file is left untouched.
+  const std::string content = ReadFile(path);
+  const std::filesystem::file_time_type write_time =
+      std::filesystem::last_write_time(path);
+  ASSERT_EQ(TasksToJson("webp_420_4", kSettings, tasks, /*quiet=*/false, path,
+                        options),
+            Status::kOk);
+  EXPECT_EQ(std::filesystem::last_write_time(path), write_time);
+
+  // Unless it was edited since.
+  std::ofstream(path, std::ios::trunc) << "edited";
+  ASSERT_EQ(TasksToJson("webp_420_4", kSettings, tasks, /*quiet=*/false, path,
+                        options),
+            Status::kOk);
+  EXPECT_NE(ReadFile(path), "edited");
+
+  // Forced regeneration.
+  options.skip_unchanged = false;
+  const std::filesystem::file_time_type rewrite_time =
+      std::filesystem::last_write_time(path);
+  ASSERT_EQ(TasksToJson("webp_420_4", kSettings, tasks, /*quiet=*/false, path,
+                        options),
+            Status::kOk);
+  EXPECT_NE(std::filesystem::last_write_time(path), rewrite_time);
+
+  // Different rows.
+  options.skip_unchanged = true;
+  tasks.back().encoded_size += 1;
+  ASSERT_EQ(TasksToJson("webp_420_4", kSettings, tasks, /*quiet=*/false, path,
+                        options),
+            Status::kOk);
+  EXPECT_NE(ReadFile(path), content);
+}
+
+TEST(ResultJsonTest, BatchesToJson) {
+  const std::filesystem::path folder =
+      std::filesystem::path(::testing::TempDir()) / "batches";
+  std::filesystem::remove_all(folder);  // Fingerprints of previous runs.
+  std::filesystem::create_directories(folder);
+  std::vector<TaskOutput> other_batch = MakeTaskOutputs(2);
+  for (TaskOutput& task : other_batch) {
+    task.task_input.codec_settings.effort = 6;
+  }
+  std::vector<std::vector<TaskOutput>> batches = {MakeTaskOutputs(2),
+                                                  other_batch};
+  JsonOptions options;
+  options.skip_unchanged = true;
+  StatusOr<size_t> num_written = BatchesToJson(batches, folder.string(),
+                                               options, /*quiet=*/false);
+  ASSERT_EQ(num_written.status, Status::kOk);
+  EXPECT_EQ(num_written.value, 2u);
+  EXPECT_TRUE(std::filesystem::exists(folder / "webp_420_4.json"));
+  EXPECT_TRUE(std::filesystem::exists(folder / "webp_420_6.json"));
+
+  batches.back().back().encoding_duration = 2;
+  num_written =
+      BatchesToJson(batches, folder.string(), options, /*quiet=*/false);
+  ASSERT_EQ(num_written.status, Status::kOk);
+  EXPECT_EQ(num_written.value, 1u);
+
+  // A missing file is written again.
+  std::filesystem::remove(folder / "webp_420_4.json");
+  num_written =
+      BatchesToJson(batches, folder.string(), options, /*quiet=*/false);
+  ASSERT_EQ(num_written.status, Status::kOk);
+  EXPECT_EQ(num_written.value, 1u);
+  EXPECT_TRUE(std::filesystem::exists(folder / "webp_420_4.json"));
+
+  // Same for a chunk.
+  options.num_images_per_chunk = 1;
+  num_written =
+      BatchesToJson(batches, folder.string(), options, /*quiet=*/false);
+  ASSERT_EQ(num_written.status, Status::kOk);
+  EXPECT_EQ(num_written.value, 2u);
+  std::filesystem::remove(folder / "webp_420_6.chunk1.json");
+  num_written =
+      BatchesToJson(batches, folder.string(), options, /*quiet=*/false);
+  ASSERT_EQ(num_written.status, Status::kOk);
+  EXPECT_EQ(num_written.value, 1u);
+  EXPECT_TRUE(std::filesystem::exists(folder / "webp_420_6.chunk1.json"));
+}
+
+#if defined(HAS_ZLIB)
+TEST(ResultJsonTest, Compressed) {
+  const std::filesystem::path folder =
+      std::filesystem::path(::testing::TempDir()) / "compressed";
+  std::filesystem::create_directories(folder);
+  JsonOptions options;
+  options.compress = true;
+  ASSERT_EQ(TasksToJson("webp_420_4", kSettings, MakeTaskOutputs(1000),
+                        /*quiet=*/false, folder / "webp_420_4.json", options),
+            Status::kOk);
+  const std::string gzip = ReadFile(folder / "webp_420_4.json.gz");
+  ASSERT_GT(gzip.size(), 2u);
+  EXPECT_EQ(static_cast<unsigned char>(gzip[0]), 0x1f);  // gzip magic number
+  EXPECT_EQ(static_cast<unsigned char>(gzip[1]), 0x8b);
+
+  // Compare with the uncompressed output.
+  ASSERT_EQ(TasksToJson("webp_420_4", kSettings, MakeTaskOutputs(1000),
+                        /*quiet=*/false, folder / "webp_420_4.json",
+                        JsonOptions()),
+            Status::kOk);
+  EXPECT_LT(gzip.size() * 5, ReadFile(folder / "webp_420_4.json").size());
+}
+#endif  // HAS_ZLIB
+
+}  // namespace
+}  // namespace codec_compare_gen
@@ -12,6 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <filesystem>
+#include <fstream>
 #include <string>
 #include <vector>
 
@@ -43,6 +45,7 @@ TEST(SerializationTest, Escape) {
   EXPECT_EQ(Escape(""), "\"\"");
   EXPECT_EQ(Escape("a"), "\"a\"");
   EXPECT_EQ(Escape("\"a\""), "\"\\\"a\\\"\"");
+  EXPECT_EQ(Escape("a\\"), "\"a\\\\\"");
 }
 
 TEST(SerializationTest, Unescape) {
@@ -59,6 +62,35 @@ TEST(SerializationTest, Unescape) {
   EXPECT_EQ(Unescape("\"\"", kQuiet).value, "");
   EXPECT_EQ(Unescape("\" \"", kQuiet).value, " ");
   EXPECT_EQ(Unescape("\" a \"", kQuiet).value, " a ");
+  EXPECT_EQ(Unescape("\"a\\b\"", kQuiet).value, "a\\b");  // Lone backslash.
+}
+
+TEST(SerializationTest, EscapeRoundTrip) {
+  for (const char* str : {"", "a", "\"", "\\", "\\\"", "a\\", "C:\\dir\\",
+                          "\"a, b\"\\", "\\\\\"\""}) {
+    const std::string escaped = Escape(str);
+    const StatusOr<std::string> unescaped = Unescape(escaped, /*quiet=*/false);
+    ASSERT_EQ(unescaped.status, Status::kOk) << escaped;
+    EXPECT_EQ(unescaped.value, str);
+    EXPECT_EQ(Split(escaped + ", x", ','),
+              std::vector<std::string>({escaped, "x"}));
+  }
+}
+
+TEST(SerializationTest, Fnv1a) {
+  EXPECT_EQ(Fnv1a().hash(), 0xcbf29ce484222325u);
+  EXPECT_EQ(Fnv1a().Update("a").hash(), 0xaf63dc4c8601ec8cu);
+  EXPECT_EQ(Fnv1a().Update("ab").Update("c").hash(),
+            Fnv1a().Update("abc").hash());
+  EXPECT_NE(Fnv1a().Update("abc").hash(), Fnv1a().Update("acb").hash());
+
+  const std::string path =
+      std::filesystem::path(::testing::TempDir()) / "fnv1a.txt";
+  std::ofstream(path) << "abc";
+  const StatusOr<uint64_t> hash = HashFile(path, /*quiet=*/false);
+  ASSERT_EQ(hash.status, Status::kOk);
+  EXPECT_EQ(hash.value, Fnv1a().Update("abc").hash());
+  EXPECT_NE(HashFile(path + ".missing", /*quiet=*/true).status, Status::kOk);
 }
 
 TEST(SerializationTest, Subsampling) {
@@ -73,5 +105,54 @@ TEST(SerializationTest, Subsampling) {
             Status::kUnknownError);
 }
 
+TEST(SerializationTest, SimdLevel) {
+  for (SimdLevel simd_level : {SimdLevel::kNative, SimdLevel::kNone,
+                               SimdLevel::kSse2, SimdLevel::kSse4,
+                               SimdLevel::kAvx2}) {
+    EXPECT_EQ(simd_level, SimdLevelFromString(SimdLevelToString(simd_level),
+                                              /*quiet=*/false)
+                              .value);
+  }
+  EXPECT_EQ(SimdLevelFromString("mmx", /*quiet=*/true).status,
+            Status::kUnknownError);
+}
+
+TEST(SerializationTest, DecodeTiming) {
+  for (DecodeTiming decode_timing :
+       {DecodeTiming::kWarm, DecodeTiming::kCold, DecodeTiming::kSteady}) {
+    EXPECT_EQ(decode_timing,
+              DecodeTimingFromString(DecodeTimingToString(decode_timing),
+                                     /*quiet=*/false)
+                  .value);
+  }
+  EXPECT_EQ(DecodeTimingFromString("hot", /*quiet=*/true).status,
+            Status::kUnknownError);
+}
+
+TEST(SerializationTest, DedupMode) {
+  for (DedupMode dedup_mode :
+       {DedupMode::kNone, DedupMode::kBytes, DedupMode::kPixels}) {
+    EXPECT_EQ(dedup_mode,
+              DedupModeFromString(DedupModeToString(dedup_mode),
+                                  /*quiet=*/false)
+                  .value);
+  }
+  EXPECT_EQ(DedupModeFromString("names", /*quiet=*/true).status,
+            Status::kUnknownError);
+}
+
+TEST(SerializationTest, DistortionMetric) {
+  for (size_t m = 0; m < kNumDistortionMetrics; ++m) {
+    const DistortionMetric metric = static_cast<DistortionMetric>(m);
+    EXPECT_EQ(metric, DistortionMetricFromString(
+                          DistortionMetricToString(metric), /*quiet=*/false)
+                          .value);
+  }
+  EXPECT_EQ(DistortionMetricToString(DistortionMetric::kLibjxlSsimulacra2),
+            "ssimulacra2");
+  EXPECT_EQ(DistortionMetricFromString("PSNR", /*quiet=*/true).status,
+            Status::kUnknownError);
+}
+
 }  // namespace
 }  // namespace codec_compare_gen
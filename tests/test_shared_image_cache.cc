@@ -0,0 +1,214 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/shared_image_cache.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "src/base.h"
+#include "src/frame.h"
+#include "third_party/libwebp2/src/wp2/base.h"
+
+namespace codec_compare_gen {
+namespace {
+
+// Used to pass the data folder path to the GoogleTest suites.
+const char* data_path = nullptr;
+
+// Shared memory objects are visible to the whole host.
+std::string UniqueName(const std::string& suffix) {
+  return "ccgen_test_" + std::to_string(getpid()) + "_" + suffix;
+}
+
+void ExpectSamePixels(const Image& a, const Image& b) {
+  ASSERT_EQ(a.size(), b.size());
+  for (size_t f = 0; f < a.size(); ++f) {
+    const WP2::ArgbBuffer& pixels = a[f].pixels;
+    ASSERT_EQ(pixels.format(), b[f].pixels.format());
+    ASSERT_EQ(pixels.width(), b[f].pixels.width());
+    ASSERT_EQ(pixels.height(), b[f].pixels.height());
+    EXPECT_EQ(a[f].duration_ms, b[f].duration_ms);
+    const size_t row_size = pixels.width() * WP2FormatBpp(pixels.format());
+    for (uint32_t y = 0; y < pixels.height(); ++y) {
+      ASSERT_EQ(
+          std::memcmp(pixels.GetRow(y), b[f].pixels.GetRow(y), row_size), 0);
+    }
+  }
+}
+
+TEST(SharedImageCacheTest, MapsImagesDecodedByOtherProcesses) {
+  const std::string name = UniqueName("map");
+  // Two caches with the same name behave like two processes.
+  StatusOr<SharedImageCache> first =
+      SharedImageCache::Open(name, /*max_size=*/1 << 30, /*quiet=*/false);
+  StatusOr<SharedImageCache> second =
+      SharedImageCache::Open(name, /*max_size=*/1 << 30, /*quiet=*/false);
+  ASSERT_EQ(first.status, Status::kOk);
+  ASSERT_EQ(second.status, Status::kOk);
+
+  for (const char* file_name : {"gradient32x32.png", "anim80x80.gif"}) {
+    const std::string image_path = std::string(data_path) + file_name;
+    const StatusOr<Image> expected = ReadStillImageOrAnimation(
+        image_path.c_str(), WP2_ARGB_32, /*quiet=*/false);
+    ASSERT_EQ(expected.status, Status::kOk);
+    const StatusOr<std::shared_ptr<const Image>> published =
+        first.value.Get(image_path, WP2_ARGB_32, /*quiet=*/false);
+    ASSERT_EQ(published.status, Status::kOk);
+    const StatusOr<std::shared_ptr<const Image>> mapped =
+        second.value.Get(image_path, WP2_ARGB_32, /*quiet=*/false);
+    ASSERT_EQ(mapped.status, Status::kOk);
+    ExpectSamePixels(*published.value, expected.value);
+    ExpectSamePixels(*mapped.value, expected.value);
+  }
+  EXPECT_EQ(first.value.num_decodings(), 2u);
+  EXPECT_EQ(first.value.num_mappings(), 2u);
+  EXPECT_EQ(second.value.num_decodings(), 0u);
+  EXPECT_EQ(second.value.num_mappings(), 2u);
+
+  // Keyed by content, not by path.
+  const std::string copy_path = ::testing::TempDir() + "/" + name + ".png";
+  std::filesystem::copy_file(std::string(data_path) + "gradient32x32.png",
+                             copy_path,
+                             std::filesystem::copy_options::overwrite_existing);
+  ASSERT_EQ(second.value.Get(copy_path, WP2_ARGB_32, /*quiet=*/false).status,
+            Status::kOk);
+  EXPECT_EQ(second.value.num_decodings(), 0u);
+  // Keyed by format.
+  ASSERT_EQ(second.value.Get(copy_path, WP2_BGRA_32, /*quiet=*/false).status,
+            Status::kOk);
+  EXPECT_EQ(second.value.num_decodings(), 1u);
+
+  EXPECT_EQ(SharedImageCache::Remove(name, /*quiet=*/false), Status::kOk);
+}
+
+TEST(SharedImageCacheTest, EvictsImagesNotInUse) {
+  const std::string name = UniqueName("evict");
+  const std::string image_path = std::string(data_path) + "gradient32x32.png";
+  StatusOr<std::shared_ptr<const Image>> image = Status::kUnknownError;
+  {
+    StatusOr<SharedImageCache> first =
+        SharedImageCache::Open(name, /*max_size=*/0, /*quiet=*/false);
+    StatusOr<SharedImageCache> second =
+        SharedImageCache::Open(name, /*max_size=*/0, /*quiet=*/false);
+    ASSERT_EQ(first.status, Status::kOk);
+    ASSERT_EQ(second.status, Status::kOk);
+    image = first.value.Get(image_path, WP2_ARGB_32, /*quiet=*/false);
+    ASSERT_EQ(image.status, Status::kOk);
+    // Still in use, so not evicted despite max_size.
+    ASSERT_EQ(second.value.Get(image_path, WP2_ARGB_32, /*quiet=*/false).status,
+              Status::kOk);
+    EXPECT_EQ(second.value.num_decodings(), 0u);
+  }
+  // The mapping outlives the caches.
+  const StatusOr<Image> expected = ReadStillImageOrAnimation(
+      image_path.c_str(), WP2_ARGB_32, /*quiet=*/false);
+  ASSERT_EQ(expected.status, Status::kOk);
+  ExpectSamePixels(*image.value, expected.value);
+  image.value.reset();
+
+  // Evicted once released.
+  StatusOr<SharedImageCache> third =
+      SharedImageCache::Open(name, /*max_size=*/0, /*quiet=*/false);
+  ASSERT_EQ(third.status, Status::kOk);
+  ASSERT_EQ(third.value.Get(image_path, WP2_ARGB_32, /*quiet=*/false).status,
+            Status::kOk);
+  EXPECT_EQ(third.value.num_decodings(), 1u);
+  EXPECT_EQ(SharedImageCache::Remove(name, /*quiet=*/false), Status::kOk);
+}
+
+TEST(SharedImageCacheTest, ReapsReferencesOfDeadProcesses) {
+  const std::string name = UniqueName("reap");
+  const std::string image_path = std::string(data_path) + "gradient32x32.png";
+  const pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    // Exits while referencing the image, as if it crashed.
+    StatusOr<SharedImageCache> cache =
+        SharedImageCache::Open(name, /*max_size=*/1 << 20, /*quiet=*/true);
+    if (cache.status != Status::kOk) _exit(1);
+    const StatusOr<std::shared_ptr<const Image>> image =
+        cache.value.Get(image_path, WP2_ARGB_32, /*quiet=*/true);
+    _exit(image.status == Status::kOk ? 0 : 1);
+  }
+  int child_status = 0;
+  ASSERT_EQ(waitpid(child, &child_status, 0), child);
+  ASSERT_TRUE(WIFEXITED(child_status));
+  ASSERT_EQ(WEXITSTATUS(child_status), 0);
+
+  StatusOr<SharedImageCache> cache =
+      SharedImageCache::Open(name, /*max_size=*/0, /*quiet=*/false);
+  ASSERT_EQ(cache.status, Status::kOk);
+  // Still published by the dead process, then evicted once released because
+  // the reference of the dead process is dropped.
+  ASSERT_EQ(cache.value.Get(image_path, WP2_ARGB_32, /*quiet=*/false).status,
+            Status::kOk);
+  EXPECT_EQ(cache.value.num_decodings(), 0u);
+  ASSERT_EQ(cache.value.Get(image_path, WP2_ARGB_32, /*quiet=*/false).status,
+            Status::kOk);
+  EXPECT_EQ(cache.value.num_decodings(), 1u);
+  EXPECT_EQ(SharedImageCache::Remove(name, /*quiet=*/false), Status::kOk);
+}
+
+TEST(SharedImageCacheTest, InvalidInputs) {
+  EXPECT_NE(SharedImageCache::Open("", 0, /*quiet=*/true).status, Status::kOk);
+  EXPECT_NE(SharedImageCache::Open("a/b", 0, /*quiet=*/true).status,
+            Status::kOk);
+  const std::string name = UniqueName("invalid");
+  StatusOr<SharedImageCache> cache =
+      SharedImageCache::Open(name, /*max_size=*/1 << 20, /*quiet=*/false);
+  ASSERT_EQ(cache.status, Status::kOk);
+  EXPECT_NE(cache.value.Get("missing.png", WP2_ARGB_32, /*quiet=*/true).status,
+            Status::kOk);
+  // Failed decodings are not counted.
+  const std::filesystem::path corrupt_path =
+      std::filesystem::path(::testing::TempDir()) / (name + ".png");
+  std::ofstream(corrupt_path) << "not a PNG";
+  EXPECT_NE(cache.value.Get(corrupt_path.string(), WP2_ARGB_32, /*quiet=*/true)
+                .status,
+            Status::kOk);
+  EXPECT_EQ(cache.value.num_decodings(), 0u);
+  std::filesystem::remove(corrupt_path);
+  EXPECT_NE(SharedImageCache().Get(std::string(data_path) + "gradient32x32.png",
+                                   WP2_ARGB_32, /*quiet=*/true)
+                .status,
+            Status::kOk);
+  EXPECT_EQ(SharedImageCache::Remove(name, /*quiet=*/false), Status::kOk);
+  // Nothing left to remove.
+  EXPECT_EQ(SharedImageCache::Remove(name, /*quiet=*/false), Status::kOk);
+}
+
+}  // namespace
+}  // namespace codec_compare_gen
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  if (argc != 2) {
+    std::cerr << "There must be exactly one argument containing the path to "
+                 "the test data folder"
+              << std::endl;
+    return 1;
+  }
+  codec_compare_gen::data_path = argv[1];
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,212 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/summary.h"
+
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/base.h"
+#include "src/task.h"
+#include "tests/task_factory.h"
+
+namespace codec_compare_gen {
+namespace {
+
+TaskOutput MakeTaskOutput(int effort, const std::string& image, int quality,
+                          size_t encoded_size, float psnr) {
+  return MakeFakeTaskOutput(
+      {Codec::kWebp, Subsampling::k420, effort, quality}, image, encoded_size,
+      /*encoding_duration=*/1, /*decoding_duration=*/0.1, psnr);
+}
+
+TEST(SummaryTest, RateDistortionCurve) {
+  // Collinear points are interpolated exactly.
+  const RateDistortionCurve line({{3, 6}, {1, 2}, {2, 4}, {2, 4}, {4, 8}});
+  ASSERT_FALSE(line.empty());
+  EXPECT_EQ(line.min_distortion(), 1);
+  EXPECT_EQ(line.max_distortion(), 4);
+  EXPECT_NEAR(line.Interpolate(2.5), 5, 1e-9);
+  EXPECT_NEAR(line.Integrate(1, 4), 15, 1e-9);
+  EXPECT_NEAR(line.Integrate(0, 2), 3, 1e-9);
+
+  // Monotone data gives a monotone curve.
+  const RateDistortionCurve steps({{0, 0}, {1, 0}, {2, 1}, {3, 1}});
+  for (double x = 0; x <= 3; x += 0.125) {
+    EXPECT_LE(steps.Interpolate(x), steps.Interpolate(x + 0.125) + 1e-9);
+  }
+
+  EXPECT_TRUE(RateDistortionCurve({{1, 2}, {1, 3}}).empty());
+  EXPECT_FALSE(std::isnan(BjontegaardDelta(line, steps)));
+  EXPECT_TRUE(std::isnan(BjontegaardDelta(
+      line, RateDistortionCurve({{5, 0}, {6, 1}}))));
+}
+
+TEST(SummaryTest, BdRateAndEqualQuality) {
+  std::vector<TaskOutput> tasks;
+  for (int i = 0; i < 5; ++i) {
+    const std::string image = "image" + std::to_string(i);
+    for (int quality = 10; quality <= 90; quality += 10) {
+      const float psnr = 20 + quality / 2.f + i;
+      const double size = 1000 * std::exp(quality / 20.);
+      tasks.push_back(MakeTaskOutput(4, image, quality,
+                                     static_cast<size_t>(size), psnr));
+      // Effort 6 is 20% smaller at equal quality.
+      tasks.push_back(MakeTaskOutput(6, image, quality,
+                                     static_cast<size_t>(size * 0.8), psnr));
+    }
+    tasks.push_back(MakeTaskOutput(6, image, kQualityLossless, 1000000, 99));
+  }
+
+  SummarySettings settings;
+  settings.equal_quality_targets = {{DistortionMetric::kLibwebp2Psnr, 45},
+                                    {DistortionMetric::kLibwebp2Psnr, 200}};
+  settings.num_threads = 3;
+  const StatusOr<Summary> summary =
+      Summarize(tasks, settings, /*quiet=*/false);
+  ASSERT_EQ(summary.status, Status::kOk);
+  EXPECT_EQ(summary.value.reference_batch_name, "webp_420_4");
+  ASSERT_EQ(summary.value.batches.size(), 2u);
+
+  const BatchSummary& reference = summary.value.batches[0];
+  const BatchSummary& batch = summary.value.batches[1];
+  EXPECT_EQ(batch.batch_name, "webp_420_6");
+  EXPECT_EQ(batch.num_images, 5u);
+  EXPECT_NEAR(reference.bd_rates[0], 0, 1e-9);
+  EXPECT_NEAR(batch.bd_rates[0], -0.2, 1e-3);
+  EXPECT_EQ(batch.bd_rate_num_images[0], 5u);
+  // Other metrics have a single distinct value so no curve.
+  EXPECT_TRUE(std::isnan(batch.bd_rates[1]));
+  EXPECT_EQ(batch.bd_rate_num_images[1], 0u);
+
+  // Image i reaches PSNR 45 at quality 50 - 2 * i.
+  double log_bpp_sum = 0;
+  for (int i = 0; i < 5; ++i) {
+    log_bpp_sum += std::log(1000 * std::exp((50 - 2 * i) / 20.) * 8 / 64);
+  }
+  ASSERT_EQ(reference.bpp_at_equal_quality.size(), 2u);
+  EXPECT_NEAR(reference.bpp_at_equal_quality[0], std::exp(log_bpp_sum / 5),
+              reference.bpp_at_equal_quality[0] * 1e-2);
+  EXPECT_EQ(reference.equal_quality_num_images[0], 5u);
+  EXPECT_TRUE(std::isnan(reference.bpp_at_equal_quality[1]));
+  EXPECT_EQ(reference.equal_quality_num_images[1], 0u);
+
+  const std::string path =
+      std::filesystem::path(::testing::TempDir()) / "summary.json";
+  ASSERT_EQ(SummaryToJson(summary.value, path, /*quiet=*/false), Status::kOk);
+  std::ifstream file(path);
+  const std::string json((std::istreambuf_iterator<char>(file)),
+                         std::istreambuf_iterator<char>());
+  EXPECT_NE(json.find("\"reference\": \"webp_420_4\""), std::string::npos);
+  EXPECT_NE(json.find("\"bd_rate_percent\": [-"), std::string::npos);
+  EXPECT_NE(json.find("null"), std::string::npos);
+}
+
+TEST(SummaryTest, ParetoOptimal) {
+  EXPECT_EQ(ParetoOptimal({}), std::vector<size_t>());
+  EXPECT_EQ(ParetoOptimal({{3, 1}, {1, 3}, {2, 2}, {2, 3}, {1, 4}, {3, 1}}),
+            std::vector<size_t>({1, 2, 0}));
+}
+
+TEST(SummaryTest, ParetoFrontier) {
+  // {effort, encoding duration, size}
+  constexpr double kEfforts[][3] = {
+      {2, 1, 100}, {3, 1.5, 95}, {4, 2, 80}, {5, 3, 90}, {6, 4, 79}};
+  std::vector<TaskOutput> tasks;
+  for (int i = 0; i < 3; ++i) {
+    const std::string image = "image" + std::to_string(i);
+    for (int quality = 10; quality <= 90; quality += 10) {
+      for (const auto& [effort, duration, size] : kEfforts) {
+        tasks.push_back(MakeTaskOutput(
+            static_cast<int>(effort), image, quality,
+            static_cast<size_t>(size * quality), 20 + quality / 2.f));
+        tasks.back().encoding_duration = duration * (i + 1);
+      }
+    }
+  }
+  // A single batch of another codec has no frontier.
+  tasks.push_back(MakeTaskOutput(4, "image0", 50, 100, 30));
+  tasks.back().task_input.codec_settings.codec = Codec::kAvif;
+  tasks.push_back(MakeTaskOutput(4, "image0", 60, 200, 40));
+  tasks.back().task_input.codec_settings.codec = Codec::kAvif;
+
+  SummarySettings settings;
+  settings.equal_quality_targets = {{DistortionMetric::kLibwebp2Psnr, 40}};
+  const StatusOr<Summary> summary =
+      Summarize(tasks, settings, /*quiet=*/false);
+  ASSERT_EQ(summary.status, Status::kOk);
+  ASSERT_EQ(summary.value.pareto_frontiers.size(), 1u);
+  const ParetoFrontier& frontier = summary.value.pareto_frontiers.front();
+  EXPECT_EQ(frontier.codec, Codec::kWebp);
+  EXPECT_EQ(frontier.num_batches, 5u);
+  EXPECT_EQ(frontier.num_images, 3u);
+
+  // Effort 5 is dominated by effort 4. Effort 3 is on the frontier but a mix
+  // of efforts 2 and 4 is better.
+  std::vector<std::string> names;
+  std::vector<bool> convex_hull;
+  for (const ParetoPoint& point : frontier.points) {
+    names.push_back(summary.value.batches[point.batch].batch_name);
+    convex_hull.push_back(point.convex_hull);
+  }
+  EXPECT_EQ(names, std::vector<std::string>({"webp_420_2", "webp_420_3",
+                                             "webp_420_4", "webp_420_6"}));
+  EXPECT_EQ(convex_hull, std::vector<bool>({true, false, true, true}));
+  EXPECT_NEAR(frontier.points[0].encoding_duration, std::cbrt(6), 1e-6);
+  EXPECT_NEAR(frontier.points[2].bpp, 80 * 40 * 8 / 64., 1e-3);
+  EXPECT_EQ(frontier.name, "webp");
+
+  // Each build of the same codec has its own frontier.
+  const size_t num_tasks = tasks.size();
+  for (size_t t = 0; t < num_tasks; ++t) {
+    tasks.push_back(tasks[t]);
+    tasks.back().task_input.codec_settings.build = "path/to/b.so";
+  }
+  const StatusOr<Summary> builds = Summarize(tasks, settings, /*quiet=*/false);
+  ASSERT_EQ(builds.status, Status::kOk);
+  ASSERT_EQ(builds.value.pareto_frontiers.size(), 2u);
+  EXPECT_EQ(builds.value.pareto_frontiers[0].name, "webp");
+  EXPECT_EQ(builds.value.pareto_frontiers[1].name, "webp_b");
+  const std::string path =
+      std::filesystem::path(::testing::TempDir()) / "builds.json";
+  ASSERT_EQ(SummaryToJson(builds.value, path, /*quiet=*/false), Status::kOk);
+  std::ifstream file(path);
+  const std::string json((std::istreambuf_iterator<char>(file)),
+                         std::istreambuf_iterator<char>());
+  EXPECT_NE(json.find("{\"name\": \"webp_b\", \"codec\": \"webp\", "
+                      "\"build\": \"b\""),
+            std::string::npos);
+}
+
+TEST(SummaryTest, UnknownReference) {
+  SummarySettings settings;
+  settings.reference_batch_name = "avif_420_6";
+  EXPECT_NE(Summarize({MakeTaskOutput(4, "image", 50, 100, 30),
+                       MakeTaskOutput(4, "image", 60, 200, 40)},
+                      settings, /*quiet=*/true)
+                .status,
+            Status::kOk);
+  EXPECT_NE(Summarize({}, SummarySettings(), /*quiet=*/true).status,
+            Status::kOk);
+}
+
+}  // namespace
+}  // namespace codec_compare_gen
@@ -0,0 +1,153 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "src/system_conditions.h"
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+namespace codec_compare_gen {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using std::chrono::milliseconds;
+
+SystemSample MakeSample(Clock::time_point time, uint32_t run_queue_length,
+                        uint64_t num_thermal_throttles) {
+  SystemSample sample;
+  sample.time = time;
+  sample.run_queue_length = run_queue_length;
+  sample.num_thermal_throttles = num_thermal_throttles;
+  return sample;
+}
+
+TEST(SystemSamplerTest, Window) {
+  SystemConditionThresholds thresholds;
+  thresholds.max_run_queue_length_per_cpu = 1e6f;
+  SystemSampler sampler(/*period_ms=*/0, thresholds);
+  const Clock::time_point t0 = Clock::now();
+  sampler.AddSample(MakeSample(t0 + milliseconds(10), 3, 5));
+  sampler.AddSample(MakeSample(t0 + milliseconds(20), 2, 5));
+  sampler.AddSample(MakeSample(t0 + milliseconds(30), 9, 7));
+  EXPECT_EQ(sampler.num_samples(), 3u);
+
+  // Only the recorded samples between start and end count.
+  SystemConditions conditions =
+      sampler.GetConditions(MakeSample(t0 + milliseconds(15), 1, 5),
+                            MakeSample(t0 + milliseconds(25), 1, 5));
+  EXPECT_TRUE(conditions.sampled);
+  EXPECT_EQ(conditions.run_queue_length, 2u);
+  EXPECT_EQ(conditions.num_thermal_throttles, 0u);
+  EXPECT_FALSE(conditions.abnormal);
+
+  // Throttles are counted from start to end.
+  conditions = sampler.GetConditions(MakeSample(t0 + milliseconds(5), 1, 4),
+                                     MakeSample(t0 + milliseconds(35), 1, 7));
+  EXPECT_EQ(conditions.run_queue_length, 9u);
+  EXPECT_EQ(conditions.num_thermal_throttles, 3u);
+  EXPECT_TRUE(conditions.abnormal);
+
+  // Without any recorded sample in between.
+  conditions = sampler.GetConditions(MakeSample(t0 - milliseconds(20), 4, 0),
+                                     MakeSample(t0 - milliseconds(10), 1, 0));
+  EXPECT_TRUE(conditions.sampled);
+  EXPECT_EQ(conditions.run_queue_length, 4u);
+}
+
+TEST(SystemSamplerTest, Stalls) {
+  SystemSampler sampler(/*period_ms=*/0, SystemConditionThresholds());
+  const Clock::time_point t0 = Clock::now();
+  SystemSample start = MakeSample(t0, 1, 0);
+  start.cpu_stall_duration = 1000000;
+  start.memory_stall_duration = 2000000;
+  SystemSample end = MakeSample(t0 + milliseconds(100), 1, 0);
+  end.cpu_stall_duration = start.cpu_stall_duration + 5000;  // 5 ms
+  end.memory_stall_duration = start.memory_stall_duration + 50000;  // 50 ms
+  const SystemConditions conditions = sampler.GetConditions(start, end);
+  EXPECT_FLOAT_EQ(conditions.cpu_pressure, 5);
+  EXPECT_FLOAT_EQ(conditions.memory_pressure, 50);
+  EXPECT_TRUE(conditions.abnormal);
+
+  // Stalls before start do not count.
+  end.memory_stall_duration = start.memory_stall_duration;
+  EXPECT_EQ(sampler.GetConditions(start, end).memory_pressure, 0);
+  EXPECT_FALSE(sampler.GetConditions(start, end).abnormal);
+  EXPECT_EQ(sampler.GetConditions(start, start).cpu_pressure, 0);
+}
+
+TEST(SystemSamplerTest, Thresholds) {
+  SystemSampler sampler(/*period_ms=*/0, SystemConditionThresholds());
+  const Clock::time_point t0 = Clock::now();
+  const SystemSample start = MakeSample(t0, 0, 0);
+  SystemSample end = MakeSample(t0 + milliseconds(10), 0, 0);
+  EXPECT_FALSE(sampler.GetConditions(start, end).abnormal);
+
+  SystemSample sample = MakeSample(t0 + milliseconds(5), 0, 0);
+  sample.run_queue_length = static_cast<uint32_t>(sampler.num_cpus() + 1);
+  sampler.AddSample(sample);
+  EXPECT_TRUE(sampler.GetConditions(start, end).abnormal);
+
+  end.time += milliseconds(10);
+  end.cpu_frequency_ratio = 0.25f;
+  EXPECT_TRUE(sampler.GetConditions(MakeSample(t0 + milliseconds(15), 0, 0),
+                                    end)
+                  .abnormal);
+}
+
+TEST(SystemSamplerTest, Background) {
+  SystemSampler sampler(/*period_ms=*/1, SystemConditionThresholds());
+  const SystemSample start = sampler.ReadSample();
+  while (sampler.num_samples() < 3) {
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+  const SystemConditions conditions =
+      sampler.GetConditions(start, sampler.ReadSample());
+  EXPECT_TRUE(conditions.sampled);
+  EXPECT_GE(conditions.cpu_frequency_ratio, 0);
+  EXPECT_GE(conditions.cpu_pressure, 0);
+  EXPECT_LE(conditions.cpu_pressure, 100);
+}
+
+TEST(SystemConditionsTest, Worst) {
+  const SystemConditions a = {/*sampled=*/true,
+                              /*cpu_frequency_ratio=*/0.5f,
+                              /*run_queue_length=*/4,
+                              /*cpu_pressure=*/0,
+                              /*memory_pressure=*/2,
+                              /*num_thermal_throttles=*/0,
+                              /*abnormal=*/false};
+  const SystemConditions b = {/*sampled=*/true,
+                              /*cpu_frequency_ratio=*/0.25f,
+                              /*run_queue_length=*/2,
+                              /*cpu_pressure=*/1,
+                              /*memory_pressure=*/0,
+                              /*num_thermal_throttles=*/1,
+                              /*abnormal=*/true};
+  const SystemConditions worst = WorstSystemConditions(a, b);
+  EXPECT_EQ(worst.cpu_frequency_ratio, 0.25f);
+  EXPECT_EQ(worst.run_queue_length, 4u);
+  EXPECT_EQ(worst.cpu_pressure, 1);
+  EXPECT_EQ(worst.memory_pressure, 2);
+  EXPECT_EQ(worst.num_thermal_throttles, 1u);
+  EXPECT_TRUE(worst.abnormal);
+  EXPECT_FALSE(WorstSystemConditions(a, SystemConditions()).abnormal);
+  EXPECT_EQ(WorstSystemConditions(SystemConditions(), b).cpu_pressure, 1);
+}
+
+}  // namespace
+}  // namespace codec_compare_gen
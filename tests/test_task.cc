@@ -15,7 +15,10 @@
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <filesystem>
+#include <fstream>
 #include <random>
+#include <string>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -54,6 +57,174 @@ constexpr Codec kWebp = Codec::kWebp;
 constexpr Codec kWebp2 = Codec::kWebp2;
 constexpr Subsampling kDef = Subsampling::kDefault;
 
+TEST(TaskOutputTest, SerializeOptionalFields) {
+  TaskOutput task = {{{kWebp, Subsampling::k420, /*effort=*/4, /*quality=*/50},
+                      "a=b.png",
+                      "a=b.webp"},
+                     1,
+                     2,
+                     8,
+                     3,
+                     100,
+                     0.5,
+                     0.25,
+                     0,
+                     {30, 0.9f, 0.1f, 2, 3, 4, 5}};
+  task.simd_level = SimdLevel::kSse4;
+  task.decode_timing = DecodeTiming::kSteady;
+  task.encoding_color_conversion_duration = 0.125;
+  task.header_size = 30;
+  task.metadata_size = 20;
+  task.alpha_size = 10;
+  task.first_frame_decoding_duration = 0.0625;
+  task.frame_decoding_duration_p50 = 0.015625;
+  task.frame_decoding_duration_p99 = 0.03125;
+  task.frame_decoding_duration_max = 0.0625;
+  task.approximate_distortions = true;
+  task.distortion_errors[0] = 0.5f;
+  task.distortion_errors[6] = 0.25f;
+  task.system_conditions = {/*sampled=*/true,
+                            /*cpu_frequency_ratio=*/0.375f,
+                            /*run_queue_length=*/4,
+                            /*cpu_pressure=*/12.5f,
+                            /*memory_pressure=*/0.25f,
+                            /*num_thermal_throttles=*/2,
+                            /*abnormal=*/true};
+  task.task_duration = 1.5;
+  task.task_input.codec_settings.build = "plugins/webp,1.5.so";
+  task.task_input.rendition_width = 320;
+  const std::string serialized = task.Serialize();
+  const StatusOr<TaskOutput> unserialized =
+      TaskOutput::Unserialize(serialized, /*quiet=*/false);
+  ASSERT_EQ(unserialized.status, Status::kOk);
+  EXPECT_EQ(unserialized.value.task_input, task.task_input);
+  EXPECT_EQ(unserialized.value.simd_level, SimdLevel::kSse4);
+  EXPECT_EQ(unserialized.value.decode_timing, DecodeTiming::kSteady);
+  EXPECT_EQ(unserialized.value.encoding_color_conversion_duration, 0.125);
+  EXPECT_EQ(unserialized.value.header_size, 30u);
+  EXPECT_EQ(unserialized.value.metadata_size, 20u);
+  EXPECT_EQ(unserialized.value.alpha_size, 10u);
+  EXPECT_EQ(unserialized.value.first_frame_decoding_duration, 0.0625);
+  EXPECT_EQ(unserialized.value.frame_decoding_duration_p50, 0.015625);
+  EXPECT_EQ(unserialized.value.frame_decoding_duration_p99, 0.03125);
+  EXPECT_EQ(unserialized.value.frame_decoding_duration_max, 0.0625);
+  EXPECT_TRUE(unserialized.value.approximate_distortions);
+  EXPECT_EQ(unserialized.value.distortion_errors[0], 0.5f);
+  EXPECT_EQ(unserialized.value.distortion_errors[6], 0.25f);
+  EXPECT_EQ(unserialized.value.distortions[6], 5);
+  EXPECT_TRUE(unserialized.value.system_conditions.sampled);
+  EXPECT_EQ(unserialized.value.system_conditions.cpu_frequency_ratio, 0.375f);
+  EXPECT_EQ(unserialized.value.system_conditions.run_queue_length, 4u);
+  EXPECT_EQ(unserialized.value.system_conditions.memory_pressure, 0.25f);
+  EXPECT_EQ(unserialized.value.system_conditions.num_thermal_throttles, 2u);
+  EXPECT_TRUE(unserialized.value.system_conditions.abnormal);
+  EXPECT_EQ(unserialized.value.task_duration, 1.5);
+  EXPECT_EQ(unserialized.value.Serialize(), serialized);
+
+  // Optional fields are omitted when they have their default value.
+  task.simd_level = SimdLevel::kNative;
+  EXPECT_EQ(task.Serialize().find("simd="), std::string::npos);
+  task.decode_timing = DecodeTiming::kWarm;
+  EXPECT_EQ(task.Serialize().find("decode="), std::string::npos);
+  task.encoding_color_conversion_duration = 0;
+  EXPECT_EQ(task.Serialize().find("encode_conversion="), std::string::npos);
+  task.header_size = task.metadata_size = task.alpha_size = 0;
+  EXPECT_EQ(task.Serialize().find("header="), std::string::npos);
+  EXPECT_EQ(task.Serialize().find("metadata="), std::string::npos);
+  EXPECT_EQ(task.Serialize().find("alpha="), std::string::npos);
+  task.approximate_distortions = false;
+  EXPECT_EQ(task.Serialize().find("approx="), std::string::npos);
+  task.first_frame_decoding_duration = 0;
+  EXPECT_EQ(task.Serialize().find("frame_max="), std::string::npos);
+  task.system_conditions = SystemConditions();
+  EXPECT_EQ(task.Serialize().find("system="), std::string::npos);
+  task.task_duration = 0;
+  EXPECT_EQ(task.Serialize().find("task="), std::string::npos);
+  task.task_input.codec_settings.build.clear();
+  EXPECT_EQ(task.Serialize().find("build="), std::string::npos);
+  task.task_input.rendition_width = 0;
+  EXPECT_EQ(task.Serialize().find("rendition="), std::string::npos);
+
+  EXPECT_EQ(TaskOutput::Unserialize(serialized + ", unknown=1", /*quiet=*/true)
+                .status,
+            Status::kUnknownError);
+  EXPECT_EQ(TaskOutput::Unserialize(serialized + ", approx=1:2", /*quiet=*/true)
+                .status,
+            Status::kUnknownError);
+  EXPECT_EQ(TaskOutput::Unserialize(serialized + ", system=1:0:0:0:0:0:2",
+                                    /*quiet=*/true)
+                .status,
+            Status::kUnknownError);
+}
+
+TEST(TaskOutputTest, ReadTaskOutputs) {
+  const std::string file_path =
+      (std::filesystem::temp_directory_path() / "test_read_task_outputs.csv")
+          .string();
+  constexpr int kNumTasks = 10000;  // Enough for multiple parsing batches.
+  {
+    std::ofstream file(file_path, std::ios::trunc);
+    for (int i = 0; i < kNumTasks; ++i) {
+      const TaskOutput task = {
+          {{kWebp, Subsampling::k420, /*effort=*/4, /*quality=*/i % 100},
+           "image.png"},
+          1, 2, 8, 3, static_cast<size_t>(i + 1), 0.5, 0.25, 0,
+          {30, 0.9f, 0.1f, 2, 3, 4, 5}};
+      file << task.Serialize() << std::endl;
+    }
+  }
+  const StatusOr<std::vector<TaskOutput>> tasks =
+      ReadTaskOutputs(file_path, /*discard_distortion_values=*/false,
+                      /*num_threads=*/4, /*quiet=*/false);
+  ASSERT_EQ(tasks.status, Status::kOk);
+  ASSERT_EQ(tasks.value.size(), kNumTasks);
+  for (int i = 0; i < kNumTasks; ++i) {
+    EXPECT_EQ(tasks.value[i].encoded_size, i + 1);
+  }
+
+  std::ofstream(file_path, std::ios::app) << "not a task" << std::endl;
+  EXPECT_EQ(ReadTaskOutputs(file_path, /*discard_distortion_values=*/false,
+                            /*num_threads=*/4, /*quiet=*/true)
+                .status,
+            Status::kUnknownError);
+  std::filesystem::remove(file_path);
+}
+
+TEST(TaskFailureTest, Serialize) {
+  TaskFailure failure = {{{kWebp, Subsampling::k420, /*effort=*/4,
+                           /*quality=*/50, "plugins/webp,1.5.so"},
+                          "a=b.png",
+                          "a=b.webp",
+                          /*rendition_width=*/320},
+                         12.5,
+                         "(codec.cc:1) \"quoted\", a=b\nsecond line"};
+  const std::string serialized = failure.Serialize();
+  EXPECT_EQ(serialized.find('\n'), std::string::npos);
+  const StatusOr<TaskFailure> unserialized =
+      TaskFailure::Unserialize(serialized, /*quiet=*/false);
+  ASSERT_EQ(unserialized.status, Status::kOk);
+  EXPECT_EQ(unserialized.value.task_input, failure.task_input);
+  EXPECT_EQ(unserialized.value.duration, 12.5);
+  EXPECT_EQ(unserialized.value.error,
+            "(codec.cc:1) \"quoted\", a=b second line");
+
+  failure.task_input.codec_settings.build.clear();
+  failure.task_input.rendition_width = 0;
+  EXPECT_EQ(failure.Serialize().find("build="), std::string::npos);
+  EXPECT_EQ(failure.Serialize().find("rendition="), std::string::npos);
+
+  failure.error = "Could not open C:\\images\\";
+  const StatusOr<TaskFailure> trailing_backslash =
+      TaskFailure::Unserialize(failure.Serialize(), /*quiet=*/false);
+  ASSERT_EQ(trailing_backslash.status, Status::kOk);
+  EXPECT_EQ(trailing_backslash.value.error, failure.error);
+
+  EXPECT_NE(TaskFailure::Unserialize("webp, 420, 4", /*quiet=*/true).status,
+            Status::kOk);
+  EXPECT_NE(ReadTaskFailures("missing.failures", /*quiet=*/true).status,
+            Status::kOk);
+}
+
 TEST(SplitByCodecSettingsAndAggregateByImageTest, Simple) {
   const std::vector<TaskOutput> results = {
       {{{kWebp, kDef, /*effort=*/0, /*quality=*/0}, "img"}, 1, 2, 8, 3, 0}};
@@ -121,5 +292,146 @@ TEST(SplitByCodecSettingsAndAggregateByImageTest, Multiple) {
        {{{{kWebp2, kDef, 0, 0}, "A"}, 8, 9, 8, 1, 5u, 9.5, 9.5, 4.5, {24.0}}}});
 }
 
+TEST(SplitByCodecSettingsAndAggregateByImageTest, RenditionWidths) {
+  const std::vector<TaskOutput> results = {
+      {{{kWebp, kDef, 0, 0}, "A", "", /*rendition_width=*/0}, 8, 9, 8, 1, 3},
+      {{{kWebp, kDef, 0, 0}, "A", "", /*rendition_width=*/4}, 4, 5, 8, 1, 2},
+      {{{kWebp, kDef, 0, 0}, "B", "", /*rendition_width=*/4}, 4, 4, 8, 1, 1}};
+  const auto aggregate = SplitByCodecSettingsAndAggregateByImageAndQuality(
+      results, /*quiet=*/false);
+  ASSERT_EQ(aggregate.status, Status::kOk);
+  ExpectEq(aggregate.value, {{results[0]}, {results[1], results[2]}});
+}
+
+TEST(PlanTasksTest, RenditionWidths) {
+  ComparisonSettings settings;
+  settings.codec_settings = {{kWebp, kDef, 0, 50}, {kWebp2, kDef, 0, 50}};
+  settings.rendition_widths = {320, 640};
+  settings.encoded_folder_path = "encoded";
+  const StatusOr<std::vector<TaskInput>> tasks =
+      PlanTasks({"A.png", "B.png"}, settings);
+  ASSERT_EQ(tasks.status, Status::kOk);
+  ASSERT_EQ(tasks.value.size(), 2u * 2u * 2u);
+  // All the tasks of an image are adjacent.
+  for (size_t i = 0; i < tasks.value.size(); ++i) {
+    EXPECT_EQ(tasks.value[i].image_path, i < 4 ? "A.png" : "B.png");
+    EXPECT_EQ(tasks.value[i].rendition_width, i % 4 < 2 ? 320u : 640u);
+  }
+  EXPECT_NE(tasks.value[0].encoded_path, tasks.value[2].encoded_path);
+  EXPECT_NE(tasks.value[0].encoded_path.find(".320w"), std::string::npos);
+}
+
+TEST(PlanTasksTest, SharedConversions) {
+  ComparisonSettings settings;
+  settings.codec_settings = {{Codec::kAvif, kDef, 6, 50},
+                             {Codec::kAvif, kDef, 6, 75}};
+  const std::vector<std::string> images = {"A.png", "B.png", "C.png"};
+  StatusOr<std::vector<TaskInput>> tasks = PlanTasks(images, settings);
+  ASSERT_EQ(tasks.status, Status::kOk);
+  ASSERT_EQ(tasks.value.size(), 2u * 3u);
+  // Without any shared conversion, the tasks are ordered by settings.
+  for (size_t i = 0; i < tasks.value.size(); ++i) {
+    EXPECT_EQ(tasks.value[i].codec_settings.quality, i < 3 ? 50 : 75);
+  }
+
+  // The conversion of each image is shared by all qualities, so all the tasks
+  // of an image are adjacent, whatever the number of images.
+  settings.codec_settings = {{kWebp, kDef, 4, 50}, {kWebp, kDef, 4, 75}};
+  tasks = PlanTasks(images, settings);
+  ASSERT_EQ(tasks.status, Status::kOk);
+  ASSERT_EQ(tasks.value.size(), 2u * 3u);
+  for (size_t i = 0; i < tasks.value.size(); ++i) {
+    EXPECT_EQ(tasks.value[i].image_path, images[i / 2]);
+  }
+}
+
+TEST(PlanTasksTest, CodecCapabilities) {
+  ComparisonSettings settings;
+  for (const CodecSettings& codec_settings : std::vector<CodecSettings>{
+           {kWebp, Subsampling::k444, 4, 50},
+           {kWebp, Subsampling::k420, 4, kQualityLossless},
+           {kWebp, kDef, /*effort=*/7, 50},
+           {Codec::kAvif, Subsampling::k420, 6, kQualityLossless},
+           {Codec::kJpegXl, kDef, /*effort=*/0, 50},
+           {Codec::kJpegli, kDef, 0, kQualityLossless},
+           {Codec::kJpegturbo, kDef, /*effort=*/3, 50},
+           {Codec::kJpegli, kDef, 0, 50, /*build=*/"", /*num_threads=*/2},
+           {kWebp, kDef, 4, 50, /*build=*/"", /*num_threads=*/0}}) {
+    settings.codec_settings = {codec_settings};
+    EXPECT_NE(PlanTasks({"A.png"}, settings).status, Status::kOk);
+
+    // Skipped along with supported settings.
+    settings.codec_settings = {codec_settings, {kWebp, kDef, 4, 50}};
+    const StatusOr<std::vector<TaskInput>> tasks =
+        PlanTasks({"A.png"}, settings);
+    ASSERT_EQ(tasks.status, Status::kOk);
+    ASSERT_EQ(tasks.value.size(), 1u);
+    EXPECT_EQ(tasks.value[0].codec_settings.effort, 4);
+  }
+  settings.codec_settings = {{kWebp, Subsampling::k420, 4, 50},
+                             {kWebp, kDef, /*effort=*/9, kQualityLossless},
+                             {Codec::kAvif, Subsampling::k444, 6, 50},
+                             {Codec::kJpegli, Subsampling::k444, 0, 50},
+                             {Codec::kJpegXl, kDef, 7, 50, /*build=*/"",
+                              /*num_threads=*/8},
+                             {kWebp, kDef, 4, 50, /*build=*/"plugin.so",
+                              /*num_threads=*/2}};
+  EXPECT_EQ(PlanTasks({"A.png"}, settings).status, Status::kOk);
+}
+
+// Writes a 1x1 GIF with a black and white color table and one 10-centisecond
+// frame per color index in frame_colors.
+std::string WriteGif(const std::string& file_name,
+                     const std::vector<int>& frame_colors) {
+  const std::string path =
+      (std::filesystem::temp_directory_path() / file_name).string();
+  std::ofstream file(path, std::ios::binary);
+  file << "GIF89a";
+  file.write("\x01\x00\x01\x00\x80\x00\x00", 7);
+  file.write("\x00\x00\x00\xff\xff\xff", 6);
+  for (const int color : frame_colors) {
+    file.write("\x21\xf9\x04\x00\x0a\x00\x00\x00", 8);  // Duration.
+    file.write("\x2c\x00\x00\x00\x00\x01\x00\x01\x00\x00", 10);
+    // LZW minimum code size 2, then the clear, color and end codes.
+    file.write(color == 0 ? "\x02\x02\x44\x01\x00" : "\x02\x02\x4c\x01\x00",
+               5);
+  }
+  file.write("\x3b", 1);
+  return path;
+}
+
+TEST(PlanTasksTest, SkipAnimationsForStillImageCodecs) {
+  const std::string animation_path =
+      WriteGif("plan_tasks_animation.gif", {0, 1});
+  // Only the header is read, so identical frames count as an animation too.
+  const std::string identical_frames_path =
+      WriteGif("plan_tasks_identical_frames.gif", {1, 1});
+  const std::string still_path = WriteGif("plan_tasks_still.gif", {1});
+
+  ComparisonSettings settings;
+  settings.codec_settings = {{kWebp, kDef, 4, 50},
+                             {Codec::kJpegturbo, kDef, 0, 50}};
+  const StatusOr<std::vector<TaskInput>> tasks = PlanTasks(
+      {animation_path, identical_frames_path, still_path, "missing.png"},
+      settings);
+  ASSERT_EQ(tasks.status, Status::kOk);
+  ASSERT_EQ(tasks.value.size(), 6u);
+  for (const TaskInput& task : tasks.value) {
+    EXPECT_TRUE(task.codec_settings.codec == kWebp ||
+                (task.image_path != animation_path &&
+                 task.image_path != identical_frames_path));
+  }
+}
+
+TEST(BatchNameTest, RenditionWidth) {
+  const CodecSettings settings = {kWebp, Subsampling::k420, 4, 50};
+  EXPECT_EQ(BatchName(settings, /*rendition_width=*/0, SimdLevel::kNative,
+                      DecodeTiming::kWarm),
+            "webp_420_4");
+  EXPECT_EQ(BatchName(settings, /*rendition_width=*/320, SimdLevel::kNative,
+                      DecodeTiming::kWarm),
+            "webp_420_4_320w");
+}
+
 }  // namespace
 }  // namespace codec_compare_gen
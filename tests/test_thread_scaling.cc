@@ -0,0 +1,97 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/thread_scaling.h"
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/base.h"
+#include "src/framework.h"
+#include "src/task.h"
+#include "tests/task_factory.h"
+
+namespace codec_compare_gen {
+namespace {
+
+// Used to pass the data folder path to the GoogleTest suites.
+const char* data_path = nullptr;
+
+TaskOutput MakeTask(const CodecSettings& codec_settings,
+                    const std::string& image_name) {
+  return MakeFakeTaskOutput(codec_settings,
+                            std::string(data_path) + image_name);
+}
+
+TEST(ThreadScalingTest, Measure) {
+  const CodecSettings webp = {Codec::kWebp, Subsampling::k420, /*effort=*/2,
+                              /*quality=*/75};
+  const CodecSettings webp2 = {Codec::kWebp2, Subsampling::k420, /*effort=*/2,
+                               /*quality=*/75};
+  const CodecSettings jpeg = {Codec::kJpegturbo, Subsampling::k420,
+                              /*effort=*/0, /*quality=*/75};
+  const std::vector<TaskOutput> tasks = {
+      MakeTask(webp, "gradient32x32.png"),
+      MakeTask(webp2, "gradient32x32.png"),
+      MakeTask(webp, "gradient32x32.png"),  // Repetition.
+      MakeTask(webp, "anim80x80.gif"),
+      MakeTask(jpeg, "gradient32x32.png")};  // Single-threaded codec.
+
+  ThreadScalingSettings settings;
+  settings.thread_counts = {1, 2, 4};
+  settings.num_repetitions = 2;
+  const StatusOr<std::vector<ThreadScaling>> results =
+      MeasureThreadScaling(tasks, settings, /*quiet=*/false);
+  ASSERT_EQ(results.status, Status::kOk);
+  ASSERT_EQ(results.value.size(), 2u);
+  EXPECT_EQ(results.value[0].batch_name, "webp_420_2");
+  EXPECT_EQ(results.value[0].num_images, 2u);
+  EXPECT_EQ(results.value[1].batch_name, "webp2_420_2");
+  EXPECT_EQ(results.value[1].num_images, 1u);
+  for (const ThreadScaling& scaling : results.value) {
+    ASSERT_EQ(scaling.points.size(), 3u);
+    EXPECT_EQ(scaling.points[2].num_threads, 4u);
+    EXPECT_DOUBLE_EQ(scaling.points[0].encoding_speedup, 1);
+    EXPECT_DOUBLE_EQ(scaling.points[0].decoding_efficiency, 1);
+    for (const ThreadScalingPoint& point : scaling.points) {
+      EXPECT_GT(point.encoding_duration, 0);
+      EXPECT_GT(point.decoding_duration, 0);
+      EXPECT_GT(point.encoded_size, 0u);
+      EXPECT_DOUBLE_EQ(point.encoding_efficiency,
+                       point.encoding_speedup / point.num_threads);
+    }
+  }
+
+  settings.thread_counts = {0};
+  EXPECT_NE(MeasureThreadScaling(tasks, settings, /*quiet=*/true).status,
+            Status::kOk);
+}
+
+}  // namespace
+}  // namespace codec_compare_gen
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  if (argc != 2) {
+    std::cerr << "There must be exactly one argument containing the path to "
+                 "the test data folder"
+              << std::endl;
+    return 1;
+  }
+  codec_compare_gen::data_path = argv[1];
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,194 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/yuv.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/base.h"
+#include "src/frame.h"
+
+namespace codec_compare_gen {
+namespace {
+
+// Used to pass the data folder path to the GoogleTest suites.
+const char* data_path = nullptr;
+
+std::string WriteTempFile(const std::string& file_name,
+                          const std::string& bytes) {
+  const std::string path =
+      std::filesystem::path(::testing::TempDir()) / file_name;
+  std::ofstream(path, std::ios::binary) << bytes;
+  return path;
+}
+
+TEST(YuvTest, IsYuvFile) {
+  EXPECT_TRUE(IsYuvFile("path/to/frame.y4m"));
+  EXPECT_TRUE(IsYuvFile("path/to/frame_640x480.yuv"));
+  EXPECT_FALSE(IsYuvFile("path/to/frame.png"));
+  EXPECT_FALSE(IsYuvFile("path/to/y4m"));
+}
+
+TEST(YuvTest, Y4m) {
+  const StatusOr<YuvImage> image = ReadYuvFile(
+      std::string(data_path) + "gradient16x16.y4m", /*quiet=*/false);
+  ASSERT_EQ(image.status, Status::kOk);
+  EXPECT_EQ(image.value.width, 16u);
+  EXPECT_EQ(image.value.height, 16u);
+  EXPECT_EQ(image.value.bit_depth, 8u);
+  EXPECT_EQ(image.value.subsampling, Subsampling::k420);
+  EXPECT_FALSE(image.value.full_range);
+  EXPECT_EQ(image.value.planes[0].size(), 16u * 16u);
+  EXPECT_EQ(image.value.planes[1].size(), 8u * 8u);
+  EXPECT_EQ(image.value.planes[2].size(), 8u * 8u);
+  EXPECT_EQ(image.value.Sample(0, 0, 0), 16u);
+}
+
+TEST(YuvTest, RawYuv) {
+  const StatusOr<YuvImage> image = ReadYuvFile(
+      std::string(data_path) + "gradient_16x16_444_full.yuv", /*quiet=*/false);
+  ASSERT_EQ(image.status, Status::kOk);
+  EXPECT_EQ(image.value.width, 16u);
+  EXPECT_EQ(image.value.height, 16u);
+  EXPECT_EQ(image.value.bit_depth, 8u);
+  EXPECT_EQ(image.value.subsampling, Subsampling::k444);
+  EXPECT_TRUE(image.value.full_range);
+  EXPECT_EQ(image.value.Sample(1, 15, 0), 255u);
+}
+
+TEST(YuvTest, TenBits) {
+  // 2x2 4:2:0 frame with native-endian 16-bit samples.
+  const std::vector<uint16_t> samples = {64, 64, 940, 940, 512, 512};
+  const std::string bytes(reinterpret_cast<const char*>(samples.data()),
+                          samples.size() * sizeof(uint16_t));
+  const StatusOr<YuvImage> image =
+      ReadY4m(WriteTempFile("ten_bits.y4m",
+                            "YUV4MPEG2 W2 H2 C420p10\nFRAME\n" + bytes),
+              /*quiet=*/false);
+  ASSERT_EQ(image.status, Status::kOk);
+  EXPECT_EQ(image.value.bit_depth, 10u);
+  EXPECT_EQ(image.value.RowBytes(0), 4u);
+  EXPECT_EQ(image.value.Sample(0, 0, 1), 940u);
+
+  // Limited-range black and white without chroma.
+  EXPECT_EQ(YuvToRgb(image.value, /*rgb_bit_depth=*/8),
+            std::vector<uint16_t>({0, 0, 0, 0, 0, 0,  //
+                                   255, 255, 255, 255, 255, 255}));
+  EXPECT_EQ(YuvToRgb(image.value, /*rgb_bit_depth=*/16)[6], 65535u);
+}
+
+TEST(YuvTest, YuvToRgb) {
+  YuvImage image;
+  image.width = image.height = 1;
+  image.subsampling = Subsampling::k444;
+  image.full_range = true;
+  image.planes[0] = {128};
+  image.planes[1] = {128};
+  image.planes[2] = {255};  // Max Cr.
+  const std::vector<uint16_t> rgb = YuvToRgb(image, /*rgb_bit_depth=*/8);
+  ASSERT_EQ(rgb.size(), 3u);
+  EXPECT_EQ(rgb[0], 255u);  // Clamped.
+  EXPECT_LT(rgb[1], 128u);
+  EXPECT_EQ(rgb[2], 128u);
+}
+
+TEST(YuvTest, BilinearChroma) {
+  // 4x2 4:2:0 frame going from min to max Cr.
+  YuvImage image;
+  image.width = 4;
+  image.height = 2;
+  image.full_range = true;
+  image.planes[0] = std::vector<uint8_t>(8, 128);
+  image.planes[1] = {128, 128};
+  image.planes[2] = {0, 255};
+  const std::vector<uint16_t> rgb = YuvToRgb(image, /*rgb_bit_depth=*/8);
+  ASSERT_EQ(rgb.size(), 4u * 2u * 3u);
+  // Nearest-neighbor upsampling would give two pairs of equal red samples.
+  EXPECT_EQ(rgb[0 * 3], 0u);  // Clamped.
+  EXPECT_LT(rgb[0 * 3], rgb[1 * 3]);
+  EXPECT_LT(rgb[1 * 3], rgb[2 * 3]);
+  EXPECT_LT(rgb[2 * 3], rgb[3 * 3]);
+  // Both rows have the same chroma neighbors.
+  EXPECT_EQ(std::vector<uint16_t>(rgb.begin(), rgb.begin() + 12),
+            std::vector<uint16_t>(rgb.begin() + 12, rgb.end()));
+}
+
+TEST(YuvTest, TenBitReference) {
+  const std::vector<uint16_t> samples = {64, 500, 940, 1000, 512, 512};
+  const std::string bytes(reinterpret_cast<const char*>(samples.data()),
+                          samples.size() * sizeof(uint16_t));
+  const std::string path = WriteTempFile(
+      "ten_bit_reference.y4m", "YUV4MPEG2 W2 H2 C420p10\nFRAME\n" + bytes);
+  const StatusOr<Image> image =
+      ReadStillImageOrAnimation(path.c_str(), WP2_ARGB_32, /*quiet=*/false);
+  ASSERT_EQ(image.status, Status::kOk);
+  ASSERT_EQ(image.value.size(), 1u);
+  EXPECT_EQ(WP2Formatbpc(image.value.front().pixels.format()), 16u);
+  EXPECT_EQ(GetSignificantBitDepth(image.value), 10u);
+  ASSERT_NE(image.value.front().yuv, nullptr);
+  EXPECT_EQ(image.value.front().yuv->bit_depth, 10u);
+}
+
+TEST(YuvTest, BadFiles) {
+  EXPECT_NE(ReadYuvFile("missing.y4m", /*quiet=*/true).status, Status::kOk);
+  EXPECT_NE(
+      ReadY4m(WriteTempFile("bad_magic.y4m", "YUV4MPEG W2 H2\nFRAME\n123456"),
+              /*quiet=*/true)
+          .status,
+      Status::kOk);
+  EXPECT_NE(ReadY4m(WriteTempFile("mono.y4m", "YUV4MPEG2 W2 H2 Cmono\nFRAME\n"
+                                              "1234"),
+                    /*quiet=*/true)
+                .status,
+            Status::kOk);
+  EXPECT_NE(ReadY4m(WriteTempFile("truncated.y4m",
+                                  "YUV4MPEG2 W2 H2 C420\nFRAME\n12345"),
+                    /*quiet=*/true)
+                .status,
+            Status::kOk);
+  EXPECT_EQ(ReadY4m(WriteTempFile("minimal.y4m",
+                                  "YUV4MPEG2 W2 H2 C420\nFRAME\n123456"),
+                    /*quiet=*/true)
+                .status,
+            Status::kOk);
+  EXPECT_NE(ReadRawYuv(WriteTempFile("no_dimensions.yuv", "123456"),
+                       /*quiet=*/true)
+                .status,
+            Status::kOk);
+  EXPECT_EQ(ReadRawYuv(WriteTempFile("frame-2x2.yuv", "123456"),
+                       /*quiet=*/true)
+                .status,
+            Status::kOk);
+}
+
+}  // namespace
+}  // namespace codec_compare_gen
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  if (argc != 2) {
+    std::cerr << "There must be exactly one argument containing the path to "
+                 "the test data folder"
+              << std::endl;
+    return 1;
+  }
+  codec_compare_gen::data_path = argv[1];
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,117 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the aggregate decoding throughput of the encoded images referenced
+// by progress files, with an increasing number of concurrent threads.
+
+#include <algorithm>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "src/base.h"
+#include "src/decode_scaling.h"
+#include "src/task.h"
+
+namespace codec_compare_gen {
+namespace {
+
+void PrintDecodeScaling(const DecodeScaling& scaling) {
+  std::cout << scaling.batch_name << " (" << scaling.num_bitstreams
+            << " bitstreams)" << std::endl;
+  for (const DecodeScalingPoint& point : scaling.points) {
+    const double speedup =
+        point.images_per_second / scaling.points.front().images_per_second;
+    std::cout << "  " << std::setw(3) << point.num_threads << " threads: "
+              << std::fixed << std::setprecision(1) << std::setw(9)
+              << point.images_per_second << " images/s (x"
+              << std::setprecision(2) << speedup << "), latency p50 "
+              << std::setprecision(3) << point.latency_p50 * 1000 << " ms, p90 "
+              << point.latency_p90 * 1000 << " ms, p99 "
+              << point.latency_p99 * 1000 << " ms" << std::endl;
+  }
+  std::cout << std::defaultfloat;
+}
+
+int DecodeScalingMain(int argc, const char* const argv[]) {
+  size_t max_num_threads = std::max(1u, std::thread::hardware_concurrency());
+  DecodeScalingSettings settings;
+  bool quiet = false;
+  std::vector<std::string> file_paths;
+
+  for (int arg_index = 1; arg_index < argc; ++arg_index) {
+    const std::string arg = argv[arg_index];
+    if (arg == "-h" || arg == "--help") {
+      std::cout << "Usage: " << argv[0] << std::endl
+                << " [--max_threads {number, default " << max_num_threads
+                << "}] (1, 2, 4 etc. up to that number)" << std::endl
+                << " [--passes {number of times each thread decodes each "
+                   "bitstream, default "
+                << settings.num_passes << "}]" << std::endl
+                << " [--quiet] (no logging, results are still printed)"
+                << std::endl
+                << " {progress file path}..." << std::endl
+                << "The progress files must have been generated with "
+                   "--encoded_folder."
+                << std::endl;
+      return 0;
+    } else if (arg == "--max_threads" && arg_index + 1 < argc) {
+      max_num_threads = std::stoul(argv[++arg_index]);
+    } else if (arg == "--passes" && arg_index + 1 < argc) {
+      settings.num_passes = std::stoul(argv[++arg_index]);
+    } else if (arg == "--quiet") {
+      quiet = true;
+    } else if (!arg.empty() && arg[0] == '-') {
+      std::cerr << "Error: Unknown argument \"" << arg
+                << "\" or missing following arguments" << std::endl;
+      return 1;
+    } else {
+      file_paths.push_back(arg);
+    }
+  }
+  if (file_paths.empty()) {
+    std::cerr << "Error: Expected at least one progress file path"
+              << std::endl;
+    return 1;
+  }
+  settings.thread_counts = DecodeScalingThreadCounts(max_num_threads);
+
+  std::vector<TaskOutput> tasks;
+  for (const std::string& file_path : file_paths) {
+    StatusOr<std::vector<TaskOutput>> file_tasks =
+        ReadTaskOutputs(file_path, /*discard_distortion_values=*/false,
+                        max_num_threads, quiet);
+    if (file_tasks.status != Status::kOk) return 1;
+    tasks.insert(tasks.end(), file_tasks.value.begin(),
+                 file_tasks.value.end());
+  }
+
+  const StatusOr<std::vector<DecodeScaling>> results =
+      MeasureDecodeScaling(tasks, settings, quiet);
+  if (results.status != Status::kOk) return 1;
+  for (const DecodeScaling& scaling : results.value) {
+    PrintDecodeScaling(scaling);
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace codec_compare_gen
+
+int main(int argc, char* argv[]) {
+  return codec_compare_gen::DecodeScalingMain(argc, argv);
+}
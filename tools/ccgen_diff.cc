@@ -0,0 +1,124 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compares two progress files generated by ccgen and reports regressions.
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "src/base.h"
+#include "src/diff.h"
+#include "src/task.h"
+
+namespace codec_compare_gen {
+namespace {
+
+// Exit codes.
+constexpr int kNoRegression = 0;
+constexpr int kError = 1;
+constexpr int kRegression = 2;
+
+int DiffMain(int argc, const char* const argv[]) {
+  DiffThresholds thresholds;
+  size_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+  bool quiet = false;
+  std::vector<std::string> file_paths;
+
+  for (int arg_index = 1; arg_index < argc; ++arg_index) {
+    const std::string arg = argv[arg_index];
+    if (arg == "-h" || arg == "--help") {
+      std::cout << "Usage: " << argv[0] << std::endl
+                << " [--max_size_increase {percent, default "
+                << thresholds.max_size_increase * 100 << "}]" << std::endl
+                << " [--max_encoding_slowdown {percent, default "
+                << thresholds.max_encoding_slowdown * 100 << "}]" << std::endl
+                << " [--max_decoding_slowdown {percent, default "
+                << thresholds.max_decoding_slowdown * 100 << "}]" << std::endl
+                << " [--significance {p-value, default "
+                << thresholds.significance << "}]" << std::endl
+                << " [--threads {number of parsing threads}]" << std::endl
+                << " [--quiet]" << std::endl
+                << " {before progress file path} {after progress file path}"
+                << std::endl
+                << "Exits with " << kRegression << " if there is a regression."
+                << std::endl;
+      return kNoRegression;
+    } else if (arg == "--max_size_increase" && arg_index + 1 < argc) {
+      thresholds.max_size_increase = std::stod(argv[++arg_index]) / 100;
+    } else if (arg == "--max_encoding_slowdown" && arg_index + 1 < argc) {
+      thresholds.max_encoding_slowdown = std::stod(argv[++arg_index]) / 100;
+    } else if (arg == "--max_decoding_slowdown" && arg_index + 1 < argc) {
+      thresholds.max_decoding_slowdown = std::stod(argv[++arg_index]) / 100;
+    } else if (arg == "--significance" && arg_index + 1 < argc) {
+      thresholds.significance = std::stod(argv[++arg_index]);
+    } else if (arg == "--threads" && arg_index + 1 < argc) {
+      num_threads = std::stoul(argv[++arg_index]);
+    } else if (arg == "--quiet") {
+      quiet = true;
+    } else if (!arg.empty() && arg[0] == '-') {
+      std::cerr << "Error: Unknown argument \"" << arg
+                << "\" or missing following arguments" << std::endl;
+      return kError;
+    } else {
+      file_paths.push_back(arg);
+    }
+  }
+  if (file_paths.size() != 2) {
+    std::cerr << "Error: Expected two progress file paths" << std::endl;
+    return kError;
+  }
+
+  std::vector<TaskOutput> runs[2];
+  for (size_t i = 0; i < 2; ++i) {
+    StatusOr<std::vector<TaskOutput>> tasks = ReadTaskOutputs(
+        file_paths[i], /*discard_distortion_values=*/false, num_threads,
+        quiet);
+    if (tasks.status != Status::kOk) return kError;
+    runs[i] = std::move(tasks.value);
+  }
+
+  const StatusOr<Diff> diff =
+      DiffTaskOutputs(runs[0], runs[1], thresholds, quiet);
+  if (diff.status != Status::kOk) return kError;
+
+  bool regression = false;
+  for (const SettingsDiff& settings_diff : diff.value.settings) {
+    if (!quiet || settings_diff.regression()) {
+      std::cout << settings_diff.ToString() << std::endl;
+    }
+    regression |= settings_diff.regression();
+  }
+  if (!quiet) {
+    std::cout << diff.value.num_unmatched_before << " tasks only in "
+              << file_paths[0] << ", " << diff.value.num_unmatched_after
+              << " tasks only in " << file_paths[1] << std::endl;
+  }
+  if (diff.value.settings.empty()) {
+    std::cerr << "Error: No common task" << std::endl;
+    return kError;
+  }
+  return regression ? kRegression : kNoRegression;
+}
+
+}  // namespace
+}  // namespace codec_compare_gen
+
+int main(int argc, char* argv[]) {
+  return codec_compare_gen::DiffMain(argc, argv);
+}
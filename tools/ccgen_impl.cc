@@ -14,17 +14,27 @@
 
 #include "tools/ccgen_impl.h"
 
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <filesystem>  // NOLINT
 #include <iostream>
+#include <map>
 #include <string>
 #include <unordered_set>
 #include <vector>
 
 #include "src/base.h"
 #include "src/codec.h"
+#include "src/codec_plugin.h"
 #include "src/framework.h"
 #include "src/serialization.h"
+#include "src/system_conditions.h"
 
 namespace codec_compare_gen {
 
@@ -48,6 +58,68 @@ struct CodecEffort {
   int effort;
 };
 
+// Returns "folder/name_suffix.ext" for "folder/name.ext".
+std::string AppendToFileName(const std::string& file_path,
+                             const std::string& suffix) {
+  std::filesystem::path path(file_path);
+  path.replace_filename(path.stem().string() + suffix +
+                        path.extension().string());
+  return path;
+}
+
+// Most codec libraries detect the CPU features only once per process, so each
+// SIMD level is evaluated in a forked process, with its own progress file.
+int CompareAtEachSimdLevel(const std::vector<std::string>& image_paths,
+                           ComparisonSettings settings,
+                           const std::vector<SimdLevel>& simd_levels,
+                           const std::string& completed_tasks_file_path,
+                           const std::string& results_folder_path) {
+  const std::string summary_file_path = settings.summary_file_path;
+  const std::string columnar_file_path = settings.columnar_file_path;
+  for (const SimdLevel simd_level : simd_levels) {
+    settings.simd_level = simd_level;
+    const std::string level_completed_tasks_file_path =
+        completed_tasks_file_path.empty()
+            ? ""
+            : AppendToFileName(completed_tasks_file_path,
+                               "_" + SimdLevelToString(simd_level));
+    if (!summary_file_path.empty()) {
+      settings.summary_file_path = AppendToFileName(
+          summary_file_path, "_" + SimdLevelToString(simd_level));
+    }
+    if (!columnar_file_path.empty()) {
+      settings.columnar_file_path = AppendToFileName(
+          columnar_file_path, "_" + SimdLevelToString(simd_level));
+    }
+    if (!settings.quiet) {
+      std::cout << "SIMD level " << SimdLevelToString(simd_level) << std::endl;
+    }
+    std::cout.flush();
+    const pid_t pid = fork();
+    if (pid < 0) {
+      std::cerr << "Error: fork() failed" << std::endl;
+      return 1;
+    }
+    if (pid == 0) {
+      const Status status = Compare(image_paths, settings,
+                                    level_completed_tasks_file_path,
+                                    results_folder_path);
+      std::cout.flush();
+      std::cerr.flush();
+      std::fflush(nullptr);
+      _exit(status == Status::kOk ? 0 : 1);
+    }
+    int child_status = 0;
+    if (waitpid(pid, &child_status, 0) != pid || !WIFEXITED(child_status) ||
+        WEXITSTATUS(child_status) != 0) {
+      std::cerr << "Error: SIMD level " << SimdLevelToString(simd_level)
+                << " failed" << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
+
 }  // namespace
 
 int Main(int argc, const char* const argv[]) {
@@ -59,6 +131,9 @@ int Main(int argc, const char* const argv[]) {
   std::unordered_set<int> allowed_qualities;
   std::string completed_tasks_file_path;
   std::string results_folder_path;
+  std::vector<SimdLevel> simd_levels;
+  // Builds to evaluate per codec. Only the linked one for the other codecs.
+  std::map<Codec, std::vector<std::string>> builds;
 
   settings.random_order = true;
   settings.quiet = false;
@@ -84,9 +159,37 @@ int Main(int argc, const char* const argv[]) {
                 << " [--repeat {number of times to encode each image}]"
                 << std::endl
                 << " [--recompute_distortion]" << std::endl
+                << " [--quick_metrics] (sampled frames and tiles, approximate)"
+                << std::endl
+                << " [--retry_failures] (of previous runs)" << std::endl
+                << " [--sample_system {period in milliseconds}]"
+                << " (CPU frequency, run queue, pressure, throttling)"
+                << std::endl
+                << " [--abnormal_thresholds {min CPU frequency ratio}:"
+                << "{max run queue per CPU}:{max CPU pressure %}:"
+                << "{max memory pressure %}:{max thermal throttles}]"
+                << std::endl
+                << " [--remeasure_abnormal_timings] (of previous runs)"
+                << std::endl
                 << " [--threads {extra threads on top of main thread}]"
                 << std::endl
                 << " [--deterministic]" << std::endl
+                << " [--simd_level {native|none|sse2|sse4|avx2}]"
+                << " (repeat the flag for a sweep)" << std::endl
+                << " [--decode_timing {warm|cold|steady}]" << std::endl
+                << " [--rendition_width {pixels}]"
+                << " (repeat the flag for several downscaled renditions)"
+                << std::endl
+                << " [--image_cache {max number of decoded images in memory}]"
+                << std::endl
+                << " [--shared_image_cache {max MiB of decoded images shared"
+                << " with other ccgen processes}]" << std::endl
+                << " [--dedup {none|bytes|pixels}]"
+                << " (evaluate identical images once)" << std::endl
+                << " [--skip_duplicates] (instead of copying their results)"
+                << std::endl
+                << " [--codec_build {codec} {linked|path to codec plugin}]"
+                << " (repeat the flag for an A/B comparison)" << std::endl
                 << " [--quiet]" << std::endl
                 << " [--metric_binary_folder {path to third_party created by "
                    "deps.sh}]"
@@ -94,6 +197,22 @@ int Main(int argc, const char* const argv[]) {
                 << " [--encoded_folder {path}]" << std::endl
                 << " --progress_file {path}" << std::endl
                 << " --results_folder {path}" << std::endl
+                << " [--compress_json] (gzip)" << std::endl
+                << " [--regenerate_json] (even for unchanged batches)"
+                << std::endl
+                << " [--json_chunk_images {max number of images per JSON}]"
+                << std::endl
+                << " [--summary {path}]"
+                << " (BD-rate and size at equal quality JSON)" << std::endl
+                << " [--summary_reference {batch name, e.g. webp_420_4}]"
+                << std::endl
+                << " [--columnar_file {path}] (binary copy of all results)"
+                << std::endl
+                << " [--dry_run] (print the predicted cost of the remaining"
+                << " tasks instead)" << std::endl
+                << " [--calibration_file {progress file of a previous run}]"
+                << " (repeat the flag to calibrate --dry_run on several)"
+                << std::endl
                 << " --" << std::endl
                 << " {image file path}..." << std::endl;
       return 0;
@@ -144,6 +263,29 @@ int Main(int argc, const char* const argv[]) {
       settings.num_repetitions = std::stoul(argv[++arg_index]);
     } else if (arg == "--recompute_distortion") {
       settings.discard_distortion_values = true;
+    } else if (arg == "--quick_metrics") {
+      settings.quick_metrics = true;
+    } else if (arg == "--retry_failures") {
+      settings.retry_failed_tasks = true;
+    } else if (arg == "--sample_system" && arg_index + 1 < argc) {
+      settings.system_sampling_period = std::stoul(argv[++arg_index]);
+    } else if (arg == "--abnormal_thresholds" && arg_index + 1 < argc) {
+      const std::vector<std::string> values = Split(argv[++arg_index], ':');
+      if (values.size() != 5) {
+        std::cerr << "Error: --abnormal_thresholds expects 5 values separated "
+                     "by ':'"
+                  << std::endl;
+        return 1;
+      }
+      SystemConditionThresholds& thresholds =
+          settings.system_condition_thresholds;
+      thresholds.min_cpu_frequency_ratio = std::stof(values[0]);
+      thresholds.max_run_queue_length_per_cpu = std::stof(values[1]);
+      thresholds.max_cpu_pressure = std::stof(values[2]);
+      thresholds.max_memory_pressure = std::stof(values[3]);
+      thresholds.max_num_thermal_throttles = std::stoul(values[4]);
+    } else if (arg == "--remeasure_abnormal_timings") {
+      settings.remeasure_abnormal_timings = true;
     } else if (arg == "--lossy") {
       lossy = true;
     } else if (arg == "--lossless") {
@@ -164,6 +306,40 @@ int Main(int argc, const char* const argv[]) {
       lossy = true;
     } else if (arg == "--threads" && arg_index + 1 < argc) {
       settings.num_extra_threads = std::stoul(argv[++arg_index]);
+    } else if (arg == "--simd_level" && arg_index + 1 < argc) {
+      const StatusOr<SimdLevel> simd_level =
+          SimdLevelFromString(argv[++arg_index], /*quiet=*/false);
+      if (simd_level.status != Status::kOk) return 1;
+      simd_levels.push_back(simd_level.value);
+    } else if (arg == "--decode_timing" && arg_index + 1 < argc) {
+      const StatusOr<DecodeTiming> decode_timing =
+          DecodeTimingFromString(argv[++arg_index], /*quiet=*/false);
+      if (decode_timing.status != Status::kOk) return 1;
+      settings.decode_timing = decode_timing.value;
+    } else if (arg == "--rendition_width" && arg_index + 1 < argc) {
+      const uint32_t width = std::stoul(argv[++arg_index]);
+      if (width == 0) {
+        std::cerr << "--rendition_width must be positive" << std::endl;
+        return 1;
+      }
+      settings.rendition_widths.push_back(width);
+    } else if (arg == "--image_cache" && arg_index + 1 < argc) {
+      settings.image_cache_size = std::stoul(argv[++arg_index]);
+    } else if (arg == "--shared_image_cache" && arg_index + 1 < argc) {
+      settings.shared_image_cache_size = std::stoul(argv[++arg_index]);
+    } else if (arg == "--dedup" && arg_index + 1 < argc) {
+      const StatusOr<DedupMode> dedup_mode =
+          DedupModeFromString(argv[++arg_index], /*quiet=*/false);
+      if (dedup_mode.status != Status::kOk) return 1;
+      settings.dedup_mode = dedup_mode.value;
+    } else if (arg == "--skip_duplicates") {
+      settings.copy_results_to_duplicates = false;
+    } else if (arg == "--codec_build" && arg_index + 2 < argc) {
+      const StatusOr<Codec> codec =
+          CodecFromName(argv[++arg_index], /*quiet=*/false);
+      if (codec.status != Status::kOk) return 1;
+      const std::string build = argv[++arg_index];
+      builds[codec.value].push_back(build == "linked" ? "" : build);
     } else if (arg == "--deterministic") {
       settings.random_order = false;
     } else if (arg == "--quiet") {
@@ -176,6 +352,22 @@ int Main(int argc, const char* const argv[]) {
       completed_tasks_file_path = argv[++arg_index];
     } else if (arg == "--results_folder" && arg_index + 1 < argc) {
       results_folder_path = argv[++arg_index];
+    } else if (arg == "--compress_json") {
+      settings.compress_json = true;
+    } else if (arg == "--regenerate_json") {
+      settings.regenerate_json = true;
+    } else if (arg == "--json_chunk_images" && arg_index + 1 < argc) {
+      settings.num_images_per_json_chunk = std::stoul(argv[++arg_index]);
+    } else if (arg == "--summary" && arg_index + 1 < argc) {
+      settings.summary_file_path = argv[++arg_index];
+    } else if (arg == "--summary_reference" && arg_index + 1 < argc) {
+      settings.summary_reference_batch_name = argv[++arg_index];
+    } else if (arg == "--columnar_file" && arg_index + 1 < argc) {
+      settings.columnar_file_path = argv[++arg_index];
+    } else if (arg == "--dry_run") {
+      settings.dry_run = true;
+    } else if (arg == "--calibration_file" && arg_index + 1 < argc) {
+      settings.calibration_file_paths.push_back(argv[++arg_index]);
     } else if (arg == "--") {
       ++arg_index;
       break;
@@ -196,7 +388,17 @@ int Main(int argc, const char* const argv[]) {
               << std::endl;
     return 1;
   }
-  if (lossy && settings.metric_binary_folder_path.empty()) {
+  if (lossless && !settings.summary_file_path.empty()) {
+    std::cerr << "--summary requires --lossy" << std::endl;
+    return 1;
+  }
+  if (!settings.copy_results_to_duplicates &&
+      settings.dedup_mode == DedupMode::kNone) {
+    std::cerr << "--skip_duplicates requires --dedup" << std::endl;
+    return 1;
+  }
+  if (lossy && settings.metric_binary_folder_path.empty() &&
+      !settings.dry_run) {
     std::cerr << "Missing --metric_binary_folder for lossy evaluations"
               << std::endl;
     return 1;
@@ -207,6 +409,36 @@ int Main(int argc, const char* const argv[]) {
     GetAllFilesIn(argv[arg_index], image_paths);
   }
 
+  for (const auto& [codec, codec_builds] : builds) {
+    if (std::none_of(codec_settings.begin(), codec_settings.end(),
+                     [codec = codec](const CodecEffort& setting) {
+                       return setting.codec == codec;
+                     })) {
+      std::cerr << "Error: --codec_build " << CodecName(codec)
+                << " without --codec " << CodecName(codec) << std::endl;
+      return 1;
+    }
+    for (size_t i = 0; i < codec_builds.size(); ++i) {
+      for (size_t j = 0; j < i; ++j) {
+        if (CodecBuildName(codec_builds[i]) ==
+            CodecBuildName(codec_builds[j])) {
+          std::cerr << "Error: --codec_build " << CodecName(codec) << " "
+                    << codec_builds[i] << " and " << codec_builds[j]
+                    << " have the same file name" << std::endl;
+          return 1;
+        }
+      }
+    }
+  }
+  // The codecs linked to libccgen, for the codecs without --codec_build.
+  const std::vector<std::string> linked_build = {""};
+  const auto get_builds = [&](Codec codec) -> const std::vector<std::string>& {
+    const auto it = builds.find(codec);
+    return it == builds.end() ? linked_build : it->second;
+  };
+
+  // Builds of the same settings are adjacent so that their tasks are
+  // interleaved. See PlanTasks().
   if (lossy) {
     std::vector<std::vector<int>> qualities(static_cast<int>(Codec::kJpegmoz) +
                                             1);
@@ -217,20 +449,32 @@ int Main(int argc, const char* const argv[]) {
       for (const int quality : qualities.at(static_cast<int>(setting.codec))) {
         if (allowed_qualities.empty() ||
             allowed_qualities.find(quality) != allowed_qualities.end()) {
-          settings.codec_settings.push_back({setting.codec,
-                                             setting.chroma_subsampling,
-                                             setting.effort, quality});
+          for (const std::string& build : get_builds(setting.codec)) {
+            settings.codec_settings.push_back({setting.codec,
+                                               setting.chroma_subsampling,
+                                               setting.effort, quality, build});
+          }
         }
       }
     }
   } else {
     for (const CodecEffort& setting : codec_settings) {
-      settings.codec_settings.push_back({setting.codec,
-                                         setting.chroma_subsampling,
-                                         setting.effort, kQualityLossless});
+      for (const std::string& build : get_builds(setting.codec)) {
+        settings.codec_settings.push_back({setting.codec,
+                                           setting.chroma_subsampling,
+                                           setting.effort, kQualityLossless,
+                                           build});
+      }
     }
   }
 
+  if (simd_levels.size() > 1) {
+    return CompareAtEachSimdLevel(image_paths, settings, simd_levels,
+                                  completed_tasks_file_path,
+                                  results_folder_path);
+  }
+  if (!simd_levels.empty()) settings.simd_level = simd_levels.front();
+
   if (Compare(image_paths, settings, completed_tasks_file_path,
               results_folder_path) != Status::kOk) {
     return 1;
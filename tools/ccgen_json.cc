@@ -0,0 +1,110 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Generates the JSON results from progress files without running any task.
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "src/base.h"
+#include "src/result_json.h"
+#include "src/task.h"
+
+namespace codec_compare_gen {
+namespace {
+
+int JsonMain(int argc, const char* const argv[]) {
+  JsonOptions options;
+  options.skip_unchanged = true;
+  size_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::string results_folder_path;
+  bool quiet = false;
+  std::vector<std::string> file_paths;
+
+  for (int arg_index = 1; arg_index < argc; ++arg_index) {
+    const std::string arg = argv[arg_index];
+    if (arg == "-h" || arg == "--help") {
+      std::cout << "Usage: " << argv[0] << std::endl
+                << " --results_folder {path}" << std::endl
+                << " [--compress_json] (gzip)" << std::endl
+                << " [--json_chunk_images {max number of images per JSON}]"
+                << std::endl
+                << " [--regenerate_json] (even for unchanged batches)"
+                << std::endl
+                << " [--threads {number of parsing threads}]" << std::endl
+                << " [--quiet]" << std::endl
+                << " {progress file path}..." << std::endl;
+      return 0;
+    } else if (arg == "--results_folder" && arg_index + 1 < argc) {
+      results_folder_path = argv[++arg_index];
+    } else if (arg == "--compress_json") {
+      options.compress = true;
+    } else if (arg == "--json_chunk_images" && arg_index + 1 < argc) {
+      options.num_images_per_chunk = std::stoul(argv[++arg_index]);
+    } else if (arg == "--regenerate_json") {
+      options.skip_unchanged = false;
+    } else if (arg == "--threads" && arg_index + 1 < argc) {
+      num_threads = std::stoul(argv[++arg_index]);
+    } else if (arg == "--quiet") {
+      quiet = true;
+    } else if (!arg.empty() && arg[0] == '-') {
+      std::cerr << "Error: Unknown argument \"" << arg
+                << "\" or missing following arguments" << std::endl;
+      return 1;
+    } else {
+      file_paths.push_back(arg);
+    }
+  }
+  if (results_folder_path.empty() || file_paths.empty()) {
+    std::cerr << "Error: Expected --results_folder and at least one progress "
+                 "file path"
+              << std::endl;
+    return 1;
+  }
+
+  std::vector<TaskOutput> tasks;
+  for (const std::string& file_path : file_paths) {
+    StatusOr<std::vector<TaskOutput>> file_tasks =
+        ReadTaskOutputs(file_path, /*discard_distortion_values=*/false,
+                        num_threads, /*quiet=*/false);
+    if (file_tasks.status != Status::kOk) return 1;
+    tasks.insert(tasks.end(), file_tasks.value.begin(),
+                 file_tasks.value.end());
+  }
+
+  const StatusOr<std::vector<std::vector<TaskOutput>>> batches =
+      SplitByCodecSettingsAndAggregateByImageAndQuality(tasks,
+                                                        /*quiet=*/false);
+  if (batches.status != Status::kOk) return 1;
+  const StatusOr<size_t> num_written_batches = BatchesToJson(
+      batches.value, results_folder_path, options, /*quiet=*/false);
+  if (num_written_batches.status != Status::kOk) return 1;
+  if (!quiet) {
+    std::cout << "Wrote " << num_written_batches.value << " of "
+              << batches.value.size() << " JSON batches to "
+              << results_folder_path << std::endl;
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace codec_compare_gen
+
+int main(int argc, char* argv[]) {
+  return codec_compare_gen::JsonMain(argc, argv);
+}
@@ -0,0 +1,178 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Computes BD-rates and sizes at equal quality from progress files or columnar
+// files generated by ccgen.
+
+#include <algorithm>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "src/base.h"
+#include "src/codec.h"
+#include "src/columnar.h"
+#include "src/serialization.h"
+#include "src/summary.h"
+#include "src/task.h"
+
+namespace codec_compare_gen {
+namespace {
+
+void PrintSummary(const Summary& summary) {
+  std::cout << "BD-rates relative to " << summary.reference_batch_name
+            << std::endl;
+  for (const BatchSummary& batch : summary.batches) {
+    std::cout << "  " << batch.batch_name << " (" << batch.num_images
+              << " images):";
+    for (size_t m = 0; m < kNumDistortionMetrics; ++m) {
+      if (batch.bd_rate_num_images[m] == 0) continue;
+      std::cout << " "
+                << DistortionMetricToString(static_cast<DistortionMetric>(m))
+                << " " << std::fixed << std::setprecision(2) << std::showpos
+                << batch.bd_rates[m] * 100 << "%" << std::noshowpos;
+    }
+    std::cout << std::endl;
+  }
+  for (size_t t = 0; t < summary.equal_quality_targets.size(); ++t) {
+    const auto& [metric, distortion] = summary.equal_quality_targets[t];
+    std::cout << "Bits per pixel at " << DistortionMetricToString(metric) << " "
+              << std::defaultfloat << distortion << std::endl;
+    for (const BatchSummary& batch : summary.batches) {
+      if (batch.equal_quality_num_images[t] == 0) continue;
+      std::cout << "  " << batch.batch_name << ": " << std::fixed
+                << std::setprecision(4) << batch.bpp_at_equal_quality[t]
+                << " (" << batch.equal_quality_num_images[t] << " images)"
+                << std::endl;
+    }
+  }
+  for (const ParetoFrontier& frontier : summary.pareto_frontiers) {
+    const auto& [metric, distortion] =
+        summary.equal_quality_targets[frontier.target];
+    std::cout << std::defaultfloat << "Pareto frontier of "
+              << CodecName(frontier.codec) << " at "
+              << DistortionMetricToString(metric) << " " << distortion << " ("
+              << frontier.num_batches << " batches, " << frontier.num_images
+              << " images)" << std::endl;
+    for (size_t p = 0; p < frontier.points.size(); ++p) {
+      const ParetoPoint& point = frontier.points[p];
+      std::cout << "  " << summary.batches[point.batch].batch_name << ": "
+                << std::fixed << std::setprecision(4)
+                << point.encoding_duration << "s, " << point.bpp << " bpp";
+      if (p > 0) {
+        // Trade-off relative to the next faster setting.
+        const ParetoPoint& faster = frontier.points[p - 1];
+        std::cout << " (" << std::setprecision(1) << std::showpos
+                  << (point.encoding_duration / faster.encoding_duration - 1) *
+                         100
+                  << "% time, "
+                  << (point.bpp / faster.bpp - 1) * 100 << "% size)"
+                  << std::noshowpos;
+      }
+      if (!point.convex_hull) std::cout << " [not on convex hull]";
+      std::cout << std::endl;
+    }
+  }
+  std::cout << std::defaultfloat;
+}
+
+int SummaryMain(int argc, const char* const argv[]) {
+  SummarySettings settings;
+  settings.num_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::pair<DistortionMetric, double>> targets;
+  std::string output_path;
+  bool quiet = false;
+  std::vector<std::string> file_paths;
+
+  for (int arg_index = 1; arg_index < argc; ++arg_index) {
+    const std::string arg = argv[arg_index];
+    if (arg == "-h" || arg == "--help") {
+      std::cout << "Usage: " << argv[0] << std::endl
+                << " [--reference {batch name, e.g. webp_420_4}]" << std::endl
+                << " [--target {metric, e.g. ssimulacra2} {value}]"
+                << " (repeat the flag for several targets)" << std::endl
+                << " [--threads {number of threads}]" << std::endl
+                << " [--output {summary JSON file path}]" << std::endl
+                << " [--quiet]" << std::endl
+                << " {progress file or .ccgencol columnar file path}..."
+                << std::endl;
+      return 0;
+    } else if (arg == "--reference" && arg_index + 1 < argc) {
+      settings.reference_batch_name = argv[++arg_index];
+    } else if (arg == "--target" && arg_index + 2 < argc) {
+      const StatusOr<DistortionMetric> metric =
+          DistortionMetricFromString(argv[++arg_index], /*quiet=*/false);
+      if (metric.status != Status::kOk) return 1;
+      targets.emplace_back(metric.value, std::stod(argv[++arg_index]));
+    } else if (arg == "--threads" && arg_index + 1 < argc) {
+      settings.num_threads = std::stoul(argv[++arg_index]);
+    } else if (arg == "--output" && arg_index + 1 < argc) {
+      output_path = argv[++arg_index];
+    } else if (arg == "--quiet") {
+      quiet = true;
+    } else if (!arg.empty() && arg[0] == '-') {
+      std::cerr << "Error: Unknown argument \"" << arg
+                << "\" or missing following arguments" << std::endl;
+      return 1;
+    } else {
+      file_paths.push_back(arg);
+    }
+  }
+  if (file_paths.empty()) {
+    std::cerr << "Error: Expected at least one progress file path"
+              << std::endl;
+    return 1;
+  }
+  if (!targets.empty()) settings.equal_quality_targets = targets;
+
+  std::vector<TaskOutput> tasks;
+  for (const std::string& file_path : file_paths) {
+    StatusOr<std::vector<TaskOutput>> file_tasks = Status::kUnknownError;
+    if (EndsWith(file_path, ".ccgencol")) {
+      StatusOr<ColumnarResults> columnar =
+          ColumnarResults::Open(file_path, /*quiet=*/false);
+      if (columnar.status != Status::kOk) return 1;
+      file_tasks = columnar.value.ToTaskOutputs(/*quiet=*/false);
+    } else {
+      file_tasks = ReadTaskOutputs(file_path,
+                                   /*discard_distortion_values=*/false,
+                                   settings.num_threads, /*quiet=*/false);
+    }
+    if (file_tasks.status != Status::kOk) return 1;
+    tasks.insert(tasks.end(), file_tasks.value.begin(),
+                 file_tasks.value.end());
+  }
+
+  const StatusOr<Summary> summary =
+      Summarize(tasks, settings, /*quiet=*/false);
+  if (summary.status != Status::kOk) return 1;
+  if (!quiet) PrintSummary(summary.value);
+  if (!output_path.empty() &&
+      SummaryToJson(summary.value, output_path, /*quiet=*/false) !=
+          Status::kOk) {
+    return 1;
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace codec_compare_gen
+
+int main(int argc, char* argv[]) {
+  return codec_compare_gen::SummaryMain(argc, argv);
+}
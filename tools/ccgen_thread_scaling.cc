@@ -0,0 +1,119 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures how the encoding and decoding durations of single images decrease
+// when the codec libraries are given more threads, for the images and codec
+// settings of progress files.
+
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "src/base.h"
+#include "src/decode_scaling.h"
+#include "src/task.h"
+#include "src/thread_scaling.h"
+
+namespace codec_compare_gen {
+namespace {
+
+void PrintThreadScaling(const ThreadScaling& scaling) {
+  std::cout << scaling.batch_name << " (" << scaling.num_images << " images)"
+            << std::endl;
+  for (const ThreadScalingPoint& point : scaling.points) {
+    std::cout << "  " << std::setw(3) << point.num_threads << " threads:"
+              << std::fixed << " encoding " << std::setprecision(3)
+              << std::setw(9) << point.encoding_duration * 1000 << " ms (x"
+              << std::setprecision(2) << point.encoding_speedup << ", "
+              << std::setprecision(0) << point.encoding_efficiency * 100
+              << "% efficiency), decoding " << std::setprecision(3)
+              << std::setw(9) << point.decoding_duration * 1000 << " ms (x"
+              << std::setprecision(2) << point.decoding_speedup << ", "
+              << std::setprecision(0) << point.decoding_efficiency * 100
+              << "% efficiency), " << point.encoded_size << " bytes"
+              << std::endl;
+  }
+  std::cout << std::defaultfloat;
+}
+
+int ThreadScalingMain(int argc, const char* const argv[]) {
+  size_t max_num_threads = 16;
+  ThreadScalingSettings settings;
+  bool quiet = false;
+  std::vector<std::string> file_paths;
+
+  for (int arg_index = 1; arg_index < argc; ++arg_index) {
+    const std::string arg = argv[arg_index];
+    if (arg == "-h" || arg == "--help") {
+      std::cout << "Usage: " << argv[0] << std::endl
+                << " [--max_threads {number, default " << max_num_threads
+                << "}] (1, 2, 4 etc. up to that number)" << std::endl
+                << " [--repeat {number of times each image is encoded and "
+                   "decoded per thread count, default "
+                << settings.num_repetitions << "}]" << std::endl
+                << " [--quiet] (no logging, results are still printed)"
+                << std::endl
+                << " {progress file path}..." << std::endl
+                << "Only the codecs linked to ccgen that support "
+                   "multithreading are measured."
+                << std::endl;
+      return 0;
+    } else if (arg == "--max_threads" && arg_index + 1 < argc) {
+      max_num_threads = std::stoul(argv[++arg_index]);
+    } else if (arg == "--repeat" && arg_index + 1 < argc) {
+      settings.num_repetitions = std::stoul(argv[++arg_index]);
+    } else if (arg == "--quiet") {
+      quiet = true;
+    } else if (!arg.empty() && arg[0] == '-') {
+      std::cerr << "Error: Unknown argument \"" << arg
+                << "\" or missing following arguments" << std::endl;
+      return 1;
+    } else {
+      file_paths.push_back(arg);
+    }
+  }
+  if (file_paths.empty()) {
+    std::cerr << "Error: Expected at least one progress file path"
+              << std::endl;
+    return 1;
+  }
+  settings.thread_counts = DecodeScalingThreadCounts(max_num_threads);
+
+  std::vector<TaskOutput> tasks;
+  for (const std::string& file_path : file_paths) {
+    StatusOr<std::vector<TaskOutput>> file_tasks =
+        ReadTaskOutputs(file_path, /*discard_distortion_values=*/false,
+                        /*num_threads=*/1, quiet);
+    if (file_tasks.status != Status::kOk) return 1;
+    tasks.insert(tasks.end(), file_tasks.value.begin(),
+                 file_tasks.value.end());
+  }
+
+  const StatusOr<std::vector<ThreadScaling>> results =
+      MeasureThreadScaling(tasks, settings, quiet);
+  if (results.status != Status::kOk) return 1;
+  for (const ThreadScaling& scaling : results.value) {
+    PrintThreadScaling(scaling);
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace codec_compare_gen
+
+int main(int argc, char* argv[]) {
+  return codec_compare_gen::ThreadScalingMain(argc, argv);
+}